@@ -1,14 +1,58 @@
 SOURCE= \
 	src/json.c \
+	src/json_batch.c \
+	src/json_binary.c \
+	src/json_binding.c \
+	src/json_buffer.c \
+	src/json_cache.c \
+	src/json_cbor.c \
+	src/json_codec.c \
+	src/json_columns.c \
+	src/json_diff.c \
+	src/json_digest.c \
+	src/json_dom.c \
+	src/json_encoding.c \
+	src/json_frozen.c \
+	src/json_index.c \
 	src/json_lexer.c \
+	src/json_msgpack.c \
+	src/json_number.c \
 	src/json_parser.c \
-	src/json_unparser.c
+	src/json_patch.c \
+	src/json_persistent.c \
+	src/json_schema.c \
+	src/json_snapshot.c \
+	src/json_stream.c \
+	src/json_unparser.c \
+	src/json_vector.c \
+	src/json_writer.c
 TEST_SOURCE= \
 	src/test.c \
+	src/json_batch_test.c \
+	src/json_binding_test.c \
+	src/json_cache_test.c \
+	src/json_cbor_test.c \
+	src/json_codec_test.c \
+	src/json_columns_test.c \
+	src/json_diff_test.c \
+	src/json_digest_test.c \
+	src/json_dom_test.c \
+	src/json_encoding_test.c \
+	src/json_frozen_test.c \
+	src/json_index_test.c \
 	src/json_lexer_test.c \
+	src/json_msgpack_test.c \
+	src/json_number_test.c \
 	src/json_parser_test.c \
-	src/json_unparser_test.c
-LIBRARIES=-L../cutil/bin -lcutil
+	src/json_patch_test.c \
+	src/json_persistent_test.c \
+	src/json_schema_test.c \
+	src/json_snapshot_test.c \
+	src/json_stream_test.c \
+	src/json_unparser_test.c \
+	src/json_vector_test.c \
+	src/json_writer_test.c
+LIBRARIES=-L../cutil/bin -lcutil -lpthread
 INCLUDES=-I../
 
 COVERAGE_CC=gcc
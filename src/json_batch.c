@@ -0,0 +1,285 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_batch.h"
+#include "cutil/src/error.h"
+#include "cutil/src/map/map.h"
+
+struct BatchParseJob {
+    struct Generic **generics;
+    char **inputs;
+};
+
+struct BatchUnparseJob {
+    struct Generic **generics;
+    char **outputs;
+    unsigned int *outputLengths;
+    struct JSONFormat fmt;
+};
+
+// Consecutive runs of a container's children, each serialized into its
+// own part.
+struct BatchChildrenJob {
+    struct JSONChild *children;
+    unsigned int count;
+    unsigned int partCount;
+    struct JSONBuffer *parts;
+    struct JSONFormat fmt;
+};
+
+// Runs per worker, enough for stealing to even out uneven children.
+#define BATCH_PARTS_PER_WORKER 8
+
+static void runJob(struct JSONBatchWorker *worker) {
+    struct JSONBatch *batch = worker->batch;
+    unsigned int id = worker - batch->workers;
+    // Drain our own slice first, then steal from the other workers.
+    for(unsigned int i = 0; i < batch->workerCount; i++) {
+        struct JSONBatchWorker *victim = &batch->workers[(id + i) % batch->workerCount];
+        unsigned int index;
+        while((index = __atomic_fetch_add(&victim->next, 1, __ATOMIC_SEQ_CST)) < victim->end) {
+            unsigned int result = batch->job(worker, index);
+            if(batch->results) batch->results[index] = result;
+            if(result) {
+                unsigned int expected = STATUS_OK;
+                __atomic_compare_exchange_n(
+                    &batch->failed, &expected, result, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+            }
+        }
+    }
+}
+
+static void *batchWorker(void *argument) {
+    struct JSONBatchWorker *worker = argument;
+    struct JSONBatch *batch = worker->batch;
+    unsigned int generation = 0;
+
+    pthread_mutex_lock(&batch->lock);
+    while(1) {
+        while(!batch->stopping && batch->generation == generation) {
+            pthread_cond_wait(&batch->start, &batch->lock);
+        }
+        if(batch->stopping) break;
+        generation = batch->generation;
+        pthread_mutex_unlock(&batch->lock);
+
+        runJob(worker);
+
+        pthread_mutex_lock(&batch->lock);
+        if(--batch->running == 0) pthread_cond_signal(&batch->done);
+    }
+    pthread_mutex_unlock(&batch->lock);
+    return NULL;
+}
+
+static void batchStop(struct JSONBatch *batch, unsigned int started) {
+    pthread_mutex_lock(&batch->lock);
+    batch->stopping = 1;
+    pthread_cond_broadcast(&batch->start);
+    pthread_mutex_unlock(&batch->lock);
+    for(unsigned int i = 0; i < started; i++) {
+        pthread_join(batch->workers[i].thread, NULL);
+    }
+    for(unsigned int i = 0; i < batch->workerCount; i++) {
+        parserRelease(&batch->workers[i].parser);
+        unparserRelease(&batch->workers[i].unparser);
+    }
+    pthread_cond_destroy(&batch->done);
+    pthread_cond_destroy(&batch->start);
+    pthread_mutex_destroy(&batch->lock);
+    free(batch->workers);
+    batch->workers = NULL;
+    batch->workerCount = 0;
+}
+
+unsigned int batchCompose(struct JSONBatch *batch, unsigned int workerCount) {
+    if(workerCount == 0) return STATUS_INPUT_ERR;
+    batch->workers = calloc(workerCount, sizeof(struct JSONBatchWorker));
+    if(batch->workers == NULL) return STATUS_ALLOC_ERR;
+    batch->workerCount = workerCount;
+    batch->generation = 0;
+    batch->running = 0;
+    batch->stopping = 0;
+    batch->job = NULL;
+    batch->jobData = NULL;
+    batch->results = NULL;
+    batch->failed = STATUS_OK;
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_cond_init(&batch->start, NULL);
+    pthread_cond_init(&batch->done, NULL);
+
+    for(unsigned int i = 0; i < workerCount; i++) {
+        struct JSONBatchWorker *worker = &batch->workers[i];
+        worker->batch = batch;
+        parserCompose(&worker->parser);
+        unparserCompose(&worker->unparser);
+        worker->next = 0;
+        worker->end = 0;
+    }
+    for(unsigned int i = 0; i < workerCount; i++) {
+        struct JSONBatchWorker *worker = &batch->workers[i];
+        if(pthread_create(&worker->thread, NULL, batchWorker, worker)) {
+            batchStop(batch, i);
+            return STATUS_ALLOC_ERR;
+        }
+    }
+    return STATUS_OK;
+}
+
+void batchRelease(struct JSONBatch *batch) {
+    if(batch->workers == NULL) return;
+    batchStop(batch, batch->workerCount);
+}
+
+static unsigned int batchRun(
+        struct JSONBatch *batch,
+        unsigned int (*job)(struct JSONBatchWorker*, unsigned int),
+        void *jobData,
+        unsigned int *results,
+        unsigned int count) {
+    if(count == 0) return STATUS_OK;
+
+    pthread_mutex_lock(&batch->lock);
+    // Hand each worker a contiguous slice to keep neighbours together.
+    for(unsigned int i = 0; i < batch->workerCount; i++) {
+        struct JSONBatchWorker *worker = &batch->workers[i];
+        __atomic_store_n(&worker->next, (unsigned long long)count * i / batch->workerCount, __ATOMIC_SEQ_CST);
+        worker->end = (unsigned long long)count * (i + 1) / batch->workerCount;
+    }
+    batch->job = job;
+    batch->jobData = jobData;
+    batch->results = results;
+    __atomic_store_n(&batch->failed, STATUS_OK, __ATOMIC_SEQ_CST);
+    batch->running = batch->workerCount;
+    batch->generation++;
+    pthread_cond_broadcast(&batch->start);
+    while(batch->running) {
+        pthread_cond_wait(&batch->done, &batch->lock);
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    return __atomic_load_n(&batch->failed, __ATOMIC_SEQ_CST);
+}
+
+static unsigned int parseJob(struct JSONBatchWorker *worker, unsigned int index) {
+    struct BatchParseJob *job = worker->batch->jobData;
+    return parseJSONWith(&worker->parser, &job->generics[index], job->inputs[index]);
+}
+
+unsigned int batchParse(
+        struct JSONBatch *batch,
+        struct Generic **generics,
+        char **inputs,
+        unsigned int *results,
+        unsigned int count) {
+    struct BatchParseJob job = {generics, inputs};
+    return batchRun(batch, parseJob, &job, results, count);
+}
+
+static unsigned int unparseJob(struct JSONBatchWorker *worker, unsigned int index) {
+    struct BatchUnparseJob *job = worker->batch->jobData;
+    job->outputs[index] = NULL;
+    job->outputLengths[index] = 0;
+
+    const char *data;
+    unsigned int length;
+    unsigned int result = unparseJSONWith(
+        &worker->unparser,
+        job->generics[index],
+        &data,
+        &length,
+        job->fmt);
+    if(result) return result;
+
+    // The worker buffer stays warm, callers get an exact size copy.
+    char *output = malloc(length + 1);
+    if(output == NULL) return STATUS_ALLOC_ERR;
+    memcpy(output, data, length + 1);
+    job->outputs[index] = output;
+    job->outputLengths[index] = length;
+    return STATUS_OK;
+}
+
+unsigned int batchUnparse(
+        struct JSONBatch *batch,
+        struct Generic **generics,
+        char **outputs,
+        unsigned int *outputLengths,
+        unsigned int *results,
+        unsigned int count,
+        struct JSONFormat fmt) {
+    struct BatchUnparseJob job = {generics, outputs, outputLengths, fmt};
+    return batchRun(batch, unparseJob, &job, results, count);
+}
+
+static unsigned int childrenJob(struct JSONBatchWorker *worker, unsigned int index) {
+    struct BatchChildrenJob *job = worker->batch->jobData;
+    unsigned int first = (unsigned long long)job->count * index / job->partCount;
+    unsigned int end = (unsigned long long)job->count * (index + 1) / job->partCount;
+
+    // Written straight into the part, which the caller releases.
+    struct JSONUnparser unparser = {.cache = NULL};
+    unparser.buffer = job->parts[index];
+    unsigned int result = STATUS_OK;
+    for(unsigned int i = first; i < end && !result; i++) {
+        result = unparseJSONChild(&unparser, &job->children[i], i + 1 == job->count, job->fmt);
+    }
+    job->parts[index] = unparser.buffer;
+    return result;
+}
+
+unsigned int batchUnparseJSON(
+        struct JSONBatch *batch,
+        struct Generic *generic,
+        char **output,
+        unsigned int *outputLength,
+        struct JSONFormat fmt) {
+    struct JSONChild *children = NULL;
+    unsigned int count = 0;
+    if(generic->object == &Array.object || generic->object == &Map.object) {
+        unsigned int result = unparseJSONChildren(generic, &children, &count, fmt);
+        if(result) return result;
+    }
+    // Nothing worth splitting.
+    if(count < 2 || batch->workerCount < 2) {
+        free(children);
+        return unparseJSON(generic, output, outputLength, fmt);
+    }
+
+    unsigned int partCount = batch->workerCount * BATCH_PARTS_PER_WORKER;
+    if(partCount > count) partCount = count;
+    struct JSONBuffer *parts = malloc(partCount * sizeof(struct JSONBuffer));
+    if(parts == NULL) {
+        free(children);
+        return STATUS_ALLOC_ERR;
+    }
+    for(unsigned int i = 0; i < partCount; i++) bufferCompose(&parts[i]);
+
+    struct BatchChildrenJob job = {children, count, partCount, parts, fmt};
+    unsigned int result = batchRun(batch, childrenJob, &job, NULL, partCount);
+
+    struct JSONUnparser unparser;
+    unparserCompose(&unparser);
+    unsigned int length = 0;
+    // Brackets and the closing indentation.
+    size_t extra = (size_t)fmt.indent * fmt.level + 3;
+    if(!result) result = bufferJoinedLength(parts, partCount, extra, &length);
+    if(!result) result = bufferReserve(&unparser.buffer, length);
+    if(!result) result = unparseJSONOpen(&unparser, generic, fmt);
+    for(unsigned int i = 0; i < partCount && !result; i++) {
+        result = bufferAppend(&unparser.buffer, parts[i].data, parts[i].length);
+    }
+    if(!result) result = unparseJSONClose(&unparser, generic, fmt);
+    if(!result) result = bufferTerminate(&unparser.buffer);
+
+    for(unsigned int i = 0; i < partCount; i++) bufferRelease(&parts[i]);
+    free(parts);
+    free(children);
+    if(result) {
+        unparserRelease(&unparser);
+        return result;
+    }
+
+    *output = bufferDetach(&unparser.buffer, outputLength);
+    if(!*output) return STATUS_ALLOC_ERR;
+    return STATUS_OK;
+}
@@ -0,0 +1,76 @@
+#ifndef __JSON_BATCH_H
+#define __JSON_BATCH_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <pthread.h>
+#include "json_parser.h"
+#include "json_unparser.h"
+
+struct JSONBatch;
+
+struct JSONBatchWorker {
+    struct JSONBatch *batch;
+    pthread_t thread;
+    struct JSONParser parser;
+    struct JSONUnparser unparser;
+    // Slice of the current batch owned by this worker, others steal from it
+    // once their own slice is exhausted. next and failed below are only
+    // touched through atomic builtins, <stdatomic.h> is not usable from C++.
+    unsigned int next;
+    unsigned int end;
+};
+
+// Fixed pool of threads that stays alive between batches.
+struct JSONBatch {
+    struct JSONBatchWorker *workers;
+    unsigned int workerCount;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned int generation;
+    unsigned int running;
+    int stopping;
+    // Current batch.
+    unsigned int (*job)(struct JSONBatchWorker *worker, unsigned int index);
+    void *jobData;
+    unsigned int *results;
+    unsigned int failed;
+};
+
+unsigned int batchCompose(struct JSONBatch *batch, unsigned int workerCount);
+void batchRelease(struct JSONBatch *batch);
+
+// Parse inputs[i] into generics[i]. Per document results are optional,
+// the first failure found is returned.
+unsigned int batchParse(
+    struct JSONBatch *batch,
+    struct Generic **generics,
+    char **inputs,
+    unsigned int *results,
+    unsigned int count);
+
+// Serialize generics[i] into a newly allocated outputs[i].
+unsigned int batchUnparse(
+    struct JSONBatch *batch,
+    struct Generic **generics,
+    char **outputs,
+    unsigned int *outputLengths,
+    unsigned int *results,
+    unsigned int count,
+    struct JSONFormat fmt);
+
+// Serialize one document, spreading the children of its root container
+// over the workers. The output is byte for byte what unparseJSON gives.
+unsigned int batchUnparseJSON(
+    struct JSONBatch *batch,
+    struct Generic *generic,
+    char **output,
+    unsigned int *outputLength,
+    struct JSONFormat fmt);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,139 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json_batch.h"
+#include "json_buffer.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+#define TEST_BATCH_COUNT 100
+
+void testJSONBatchParseUnparse() {
+    struct JSONBatch batch;
+    unsigned int result = batchCompose(&batch, 4);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char inputs[TEST_BATCH_COUNT][32];
+    char *inputPointers[TEST_BATCH_COUNT];
+    for(unsigned int i = 0; i < TEST_BATCH_COUNT; i++) {
+        snprintf(inputs[i], sizeof(inputs[i]), "[%u,[]]", i);
+        inputPointers[i] = inputs[i];
+    }
+
+    struct Generic *generics[TEST_BATCH_COUNT];
+    unsigned int results[TEST_BATCH_COUNT];
+    result = batchParse(&batch, generics, inputPointers, results, TEST_BATCH_COUNT);
+    assertIntegersEqual(result, STATUS_OK);
+    unsigned int matched = 0;
+    for(unsigned int i = 0; i < TEST_BATCH_COUNT; i++) {
+        long value = *((long*)genericData(getAt(generics[i], "0")));
+        matched += results[i] == STATUS_OK && value == i;
+    }
+    assertIntegersEqual(matched, TEST_BATCH_COUNT);
+
+    char *outputs[TEST_BATCH_COUNT];
+    unsigned int outputLengths[TEST_BATCH_COUNT];
+    struct JSONFormat fmt = {0, 0, 0};
+    result = batchUnparse(&batch, generics, outputs, outputLengths, NULL, TEST_BATCH_COUNT, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    matched = 0;
+    for(unsigned int i = 0; i < TEST_BATCH_COUNT; i++) {
+        matched += strcmp(outputs[i], inputs[i]) == 0 && outputLengths[i] == strlen(inputs[i]);
+        free(outputs[i]);
+        genericRelease(generics[i]);
+    }
+    assertIntegersEqual(matched, TEST_BATCH_COUNT);
+
+    batchRelease(&batch);
+}
+
+void testJSONBatchParseFailure() {
+    struct JSONBatch batch;
+    unsigned int result = batchCompose(&batch, 2);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char first[] = "[1]";
+    char second[] = "[1";
+    char third[] = "{}";
+    char *inputs[] = {first, second, third};
+    struct Generic *generics[3];
+    unsigned int results[3];
+    result = batchParse(&batch, generics, inputs, results, 3);
+    assertIntegersEqual(result, STATUS_PARSE_ERR);
+    assertIntegersEqual(results[0], STATUS_OK);
+    assertIntegersEqual(results[1], STATUS_PARSE_ERR);
+    assertIntegersEqual(results[2], STATUS_OK);
+    assertIsNull(generics[1]);
+    genericRelease(generics[0]);
+    genericRelease(generics[2]);
+
+    batchRelease(&batch);
+}
+
+// Parallel output must match the sequential serializer exactly.
+static void assertBatchUnparseMatches(struct JSONBatch *batch, struct Generic *generic, struct JSONFormat fmt) {
+    char *expected;
+    char *output;
+    unsigned int expectedLength;
+    unsigned int outputLength;
+    assertIntegersEqual(unparseJSON(generic, &expected, &expectedLength, fmt), STATUS_OK);
+    assertIntegersEqual(batchUnparseJSON(batch, generic, &output, &outputLength, fmt), STATUS_OK);
+    assertIntegersEqual(outputLength, expectedLength);
+    assertStringsEqual(output, expected);
+    free(expected);
+    free(output);
+}
+
+void testJSONBatchUnparseDocument() {
+    struct JSONBatch batch;
+    unsigned int result = batchCompose(&batch, 4);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char input[8192] = "[";
+    for(unsigned int i = 0; i < 100; i++) {
+        sprintf(input + strlen(input), "%s{\"id\": %u, \"b\": [true, null], \"a\": \"x%u\"}", i ? "," : "", i, i);
+    }
+    strcat(input, "]");
+    struct Generic *generic;
+    assertIntegersEqual(parseJSON(&generic, input), STATUS_OK);
+
+    struct JSONFormat formats[] = {{0, 0, 0}, {2, 0, 0}, {1, 1, 1}, {0, 0, 0, 1}};
+    for(unsigned int i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        assertBatchUnparseMatches(&batch, generic, formats[i]);
+        // Objects split by member, sorted when canonical.
+        assertBatchUnparseMatches(&batch, getAt(generic, "7"), formats[i]);
+    }
+    genericRelease(generic);
+
+    // Scalars, empty and single child containers are not split.
+    char scalar[] = "[[], [1], 2]";
+    assertIntegersEqual(parseJSON(&generic, scalar), STATUS_OK);
+    assertBatchUnparseMatches(&batch, getAt(generic, "0"), formats[1]);
+    assertBatchUnparseMatches(&batch, getAt(generic, "1"), formats[1]);
+    assertBatchUnparseMatches(&batch, getAt(generic, "2"), formats[1]);
+    genericRelease(generic);
+
+    batchRelease(&batch);
+}
+
+void testJSONBatchJoinLimit() {
+    // Parts of a very large export must not wrap the joined length.
+    struct JSONBuffer parts[3];
+    for(unsigned int i = 0; i < 3; i++) bufferCompose(&parts[i]);
+    parts[0].length = UINT_MAX / 2;
+    parts[1].length = UINT_MAX / 2;
+    unsigned int length = 0;
+    assertIntegersEqual(bufferJoinedLength(parts, 3, 0, &length), STATUS_OK);
+    assertIntegersEqual(length == UINT_MAX - 1, 1);
+    assertIntegersEqual(bufferJoinedLength(parts, 3, 1, &length), STATUS_ALLOC_ERR);
+    parts[2].length = UINT_MAX;
+    assertIntegersEqual(bufferJoinedLength(parts, 3, 3, &length), STATUS_ALLOC_ERR);
+}
+
+void testJSONBatch() {
+    testJSONBatchParseUnparse();
+    testJSONBatchParseFailure();
+    testJSONBatchUnparseDocument();
+    testJSONBatchJoinLimit();
+}
@@ -0,0 +1,102 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include "json_binary.h"
+#include "json_encoding.h"
+#include "cutil/src/error.h"
+#include "cutil/src/map/map.h"
+
+void binaryReaderCompose(struct JSONBinaryReader *reader, const char *input, unsigned int length) {
+    reader->data = (const unsigned char*)input;
+    reader->length = length;
+    reader->offset = 0;
+    reader->depth = 0;
+}
+
+unsigned int binaryReadBigEndian(struct JSONBinaryReader *reader, uint64_t *value, unsigned int bytes) {
+    if(reader->length - reader->offset < bytes) return STATUS_PARSE_ERR;
+    *value = 0;
+    for(unsigned int i = 0; i < bytes; i++) {
+        *value = (*value << 8) | reader->data[reader->offset++];
+    }
+    return STATUS_OK;
+}
+
+unsigned int binaryReadString(struct JSONBinaryReader *reader, char **value, uint64_t length) {
+    if(reader->length - reader->offset < length) return STATUS_PARSE_ERR;
+    const char *text = (const char*)reader->data + reader->offset;
+    if(validateUTF8(text, length)) return STATUS_PARSE_ERR;
+
+    struct JSONBuffer escaped;
+    bufferCompose(&escaped);
+    unsigned int result = bufferAppendEscaped(&escaped, text, length);
+    if(!result) result = bufferTerminate(&escaped);
+    if(result) {
+        bufferRelease(&escaped);
+        return result;
+    }
+    *value = bufferDetach(&escaped, NULL);
+    reader->offset += length;
+    return STATUS_OK;
+}
+
+unsigned int binaryUnescape(struct JSONBuffer *text, const char *value) {
+    bufferCompose(text);
+    unsigned int result = bufferAppendUnescaped(text, value, strlen(value));
+    if(!result) result = bufferTerminate(text);
+    if(result) {
+        bufferRelease(text);
+        return result == STATUS_PARSE_ERR ? STATUS_INPUT_ERR : result;
+    }
+    return STATUS_OK;
+}
+
+unsigned int binaryDecodeInteger(struct Generic **generic, uint64_t magnitude, int negative) {
+    if(magnitude > LONG_MAX) {
+        double value = (double)magnitude;
+        return binaryDecodeFloat(generic, negative ? -1 - value : value);
+    }
+    *generic = genericCompose(&Integer);
+    if(!*generic) return STATUS_ALLOC_ERR;
+    *((long*)genericData(*generic)) = negative ? -1 - (long)magnitude : (long)magnitude;
+    return STATUS_OK;
+}
+
+unsigned int binaryDecodeFloat(struct Generic **generic, double value) {
+    *generic = genericCompose(&Float);
+    if(!*generic) return STATUS_ALLOC_ERR;
+    *((float*)genericData(*generic)) = value;
+    return STATUS_OK;
+}
+
+unsigned int binaryDecodeCollection(
+        struct Generic **generic,
+        struct JSONBinaryReader *reader,
+        int isMap,
+        uint64_t count,
+        unsigned int (*decodeKey)(char **key, struct JSONBinaryReader *reader),
+        unsigned int (*decodeValue)(struct Generic **generic, struct JSONBinaryReader *reader)) {
+    if(reader->depth == JSON_BINARY_MAX_DEPTH) return STATUS_PARSE_ERR;
+    struct Generic *collection = genericCompose(isMap ? &Map.object : &Array.object);
+    if(!collection) return STATUS_ALLOC_ERR;
+
+    reader->depth++;
+    for(uint64_t i = 0; i < count; i++) {
+        char *key = NULL;
+        struct Generic *element = NULL;
+        // Only string keys map onto Generic maps.
+        unsigned int result = isMap ? decodeKey(&key, reader) : STATUS_OK;
+        if(!result) result = decodeValue(&element, reader);
+        if(!result) result = genericAdd(collection, isMap ? key : "-1", element);
+        if(result) {
+            free(key);
+            if(element) genericRelease(element);
+            genericRelease(collection);
+            return result;
+        }
+    }
+    reader->depth--;
+
+    *generic = collection;
+    return STATUS_OK;
+}
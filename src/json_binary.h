@@ -0,0 +1,49 @@
+#ifndef __JSON_BINARY_H
+#define __JSON_BINARY_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stdint.h>
+#include "json_buffer.h"
+#include "cutil/src/generic/generic.h"
+
+// Nesting past this is a STATUS_PARSE_ERR instead of a stack overflow.
+#define JSON_BINARY_MAX_DEPTH 512
+
+// Cursor over MessagePack or CBOR input, the decoding side of the
+// bufferAppendBigEndian encoders.
+struct JSONBinaryReader {
+    const unsigned char *data;
+    unsigned int length;
+    unsigned int offset;
+    unsigned int depth;
+};
+
+void binaryReaderCompose(struct JSONBinaryReader *reader, const char *input, unsigned int length);
+unsigned int binaryReadBigEndian(struct JSONBinaryReader *reader, uint64_t *value, unsigned int bytes);
+// Generic strings and keys hold escaped JSON text, as the parser leaves
+// them. A text string read is checked to be UTF-8 and escaped, and a
+// string to write is unescaped into text, which the caller releases.
+unsigned int binaryReadString(struct JSONBinaryReader *reader, char **value, uint64_t length);
+unsigned int binaryUnescape(struct JSONBuffer *text, const char *value);
+
+// Magnitudes past the range of long become a Float, as the parser does
+// for such numbers. Negative values are -1 - magnitude, the CBOR form.
+unsigned int binaryDecodeInteger(struct Generic **generic, uint64_t magnitude, int negative);
+unsigned int binaryDecodeFloat(struct Generic **generic, double value);
+
+// Map or Array of count entries read with the format's own decoders,
+// counting one level of depth.
+unsigned int binaryDecodeCollection(
+    struct Generic **generic,
+    struct JSONBinaryReader *reader,
+    int isMap,
+    uint64_t count,
+    unsigned int (*decodeKey)(char **key, struct JSONBinaryReader *reader),
+    unsigned int (*decodeValue)(struct Generic **generic, struct JSONBinaryReader *reader));
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,425 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+#include "json_binding.h"
+#include "json_parser.h"
+#include "json_buffer.h"
+#include "json_number.h"
+#include "cutil/src/error.h"
+#include "cutil/src/string.h"
+
+static unsigned int bindObject(
+    char *object,
+    const struct JSONDescriptor *descriptor,
+    struct JSONParser *parser);
+
+static size_t elementSize(enum JSON_FIELD type, const struct JSONDescriptor *descriptor) {
+    switch(type) {
+        case JSON_FIELD_INTEGER: return sizeof(long);
+        case JSON_FIELD_DOUBLE: return sizeof(double);
+        case JSON_FIELD_BOOLEAN: return sizeof(char);
+        case JSON_FIELD_STRING: return sizeof(char*);
+        case JSON_FIELD_NUMBER: return sizeof(struct JSONNumber);
+        case JSON_FIELD_OBJECT: return descriptor->size;
+        default: return 0;
+    }
+}
+
+static int isSymbol(struct JSONToken *token, char symbol) {
+    return token && token->token == JSON_TOKEN_SYMBOL && *token->lexeme == symbol;
+}
+
+static struct JSONToken *bindCurrent(struct JSONParser *parser) {
+    if(parser->position >= parser->tokens.length) return NULL;
+    return &parser->tokens.tokens[parser->position];
+}
+
+static struct JSONToken *bindNext(struct JSONParser *parser) {
+    if(parser->position < parser->tokens.length) parser->position++;
+    return bindCurrent(parser);
+}
+
+static const struct JSONField *findField(
+        const struct JSONDescriptor *descriptor,
+        const char *lexeme) {
+    // Lexeme still includes its quotation marks.
+    const char *end = strAfterQuotedString(lexeme);
+    size_t length = end - lexeme - 2;
+    for(unsigned int i = 0; i < descriptor->fieldCount; i++) {
+        const char *name = descriptor->fields[i].name;
+        if(strlen(name) == length && strncmp(name, lexeme + 1, length) == 0) {
+            return &descriptor->fields[i];
+        }
+    }
+    return NULL;
+}
+
+// Consume one value of any shape, used for members without a field. It is
+// checked as strictly as parseJSON would check it.
+static unsigned int skipValue(struct JSONParser *parser) {
+    struct JSONToken *token = bindCurrent(parser);
+    if(!token) return STATUS_PARSE_ERR;
+    struct JSONSkip skip;
+    unsigned int result = skipCompose(&skip, token);
+    while(!result && skip.depth) {
+        token = bindNext(parser);
+        result = token ? skipNext(&skip, token) : STATUS_PARSE_ERR;
+    }
+    if(!result) bindNext(parser);
+    return result;
+}
+
+static void releaseValue(char *value, enum JSON_FIELD type, const struct JSONDescriptor *descriptor);
+
+static unsigned int bindValue(
+        char *target,
+        enum JSON_FIELD type,
+        const struct JSONDescriptor *descriptor,
+        struct JSONParser *parser) {
+    struct JSONToken *token = bindCurrent(parser);
+    if(!token) return STATUS_PARSE_ERR;
+
+    switch(type) {
+        case JSON_FIELD_INTEGER:
+        case JSON_FIELD_DOUBLE:
+        case JSON_FIELD_NUMBER: {
+            struct JSONNumber number = {JSON_TYPE_NULL, 0, 0, 0, NULL};
+            if(token->token == JSON_TOKEN_NUMBER) {
+                if(numberCompose(&number, token->lexeme)) return STATUS_PARSE_ERR;
+                if(number.lexeme + number.length != strAfterNumber(token->lexeme)) return STATUS_PARSE_ERR;
+            } else if(type != JSON_FIELD_NUMBER || token->token != JSON_TOKEN_NULL) {
+                return STATUS_PARSE_ERR;
+            }
+            if(type == JSON_FIELD_INTEGER) {
+                int64_t value;
+                if(numberInteger(&number, &value)) return STATUS_PARSE_ERR;
+                if(value < LONG_MIN || value > LONG_MAX) return STATUS_PARSE_ERR;
+                *((long*)target) = value;
+            } else if(type == JSON_FIELD_DOUBLE) {
+                *((double*)target) = numberDouble(&number);
+            } else {
+                *((struct JSONNumber*)target) = number;
+            }
+            break;
+        }
+        case JSON_FIELD_BOOLEAN: {
+            if(token->token != JSON_TOKEN_BOOL) return STATUS_PARSE_ERR;
+            *target = *token->lexeme == *JSON_TRUE_STR;
+            break;
+        }
+        case JSON_FIELD_STRING: {
+            char *value = NULL;
+            if(token->token == JSON_TOKEN_STRING) {
+                // Contents between the quotation marks, escapes decoded.
+                char *endQuote = strAfterQuotedString(token->lexeme);
+                struct JSONBuffer unescaped;
+                bufferCompose(&unescaped);
+                unsigned int result = bufferAppendUnescaped(
+                    &unescaped, token->lexeme + 1, endQuote - token->lexeme - 2);
+                if(result) {
+                    bufferRelease(&unescaped);
+                    return result;
+                }
+                unsigned int length;
+                value = bufferDetach(&unescaped, &length);
+                if(!value) return STATUS_ALLOC_ERR;
+                // A C string cannot hold an escaped null character.
+                if(strlen(value) != length) {
+                    free(value);
+                    return STATUS_PARSE_ERR;
+                }
+            } else if(token->token != JSON_TOKEN_NULL) {
+                return STATUS_PARSE_ERR;
+            }
+            // A repeated member replaces the earlier value.
+            free(*((char**)target));
+            *((char**)target) = value;
+            break;
+        }
+        case JSON_FIELD_OBJECT:
+            return bindObject(target, descriptor, parser);
+        default:
+            return STATUS_INPUT_ERR;
+    }
+
+    bindNext(parser);
+    return STATUS_OK;
+}
+
+static unsigned int bindArray(
+        char *object,
+        const struct JSONField *field,
+        struct JSONParser *parser) {
+    char *items = object + field->offset;
+    unsigned int *count = (unsigned int*)(object + field->countOffset);
+    size_t size = elementSize(field->elementType, field->descriptor);
+    // A repeated member replaces the earlier elements entirely.
+    if(*count > field->capacity) *count = field->capacity;
+    for(unsigned int i = 0; i < *count; i++) {
+        releaseValue(items + i * size, field->elementType, field->descriptor);
+    }
+    *count = 0;
+
+    struct JSONToken *open = bindCurrent(parser);
+    if(!isSymbol(open, JSON_ARR_BEGIN)) return STATUS_PARSE_ERR;
+    // Reject documents with more elements than the caller made room for
+    // before writing any of them.
+    if(open->count > field->capacity) return STATUS_PARSE_ERR;
+    bindNext(parser);
+    if(isSymbol(bindCurrent(parser), JSON_ARR_CLOSE)) {
+        bindNext(parser);
+        return STATUS_OK;
+    }
+
+    while(1) {
+        if(*count == field->capacity) return STATUS_PARSE_ERR;
+
+        unsigned int result = bindValue(
+            items + *count * size,
+            field->elementType,
+            field->descriptor,
+            parser);
+        if(result) {
+            // Strings of a partially bound element are not counted yet.
+            releaseValue(items + *count * size, field->elementType, field->descriptor);
+            return result;
+        }
+        (*count)++;
+
+        struct JSONToken *token = bindCurrent(parser);
+        if(isSymbol(token, JSON_SEPERATOR)) {
+            bindNext(parser);
+            continue;
+        }
+        if(isSymbol(token, JSON_ARR_CLOSE)) {
+            bindNext(parser);
+            return STATUS_OK;
+        }
+        return STATUS_PARSE_ERR;
+    }
+}
+
+static unsigned int bindField(
+        char *object,
+        const struct JSONField *field,
+        struct JSONParser *parser) {
+    if(field->type == JSON_FIELD_ARRAY) {
+        return bindArray(object, field, parser);
+    }
+    return bindValue(object + field->offset, field->type, field->descriptor, parser);
+}
+
+static unsigned int bindObject(
+        char *object,
+        const struct JSONDescriptor *descriptor,
+        struct JSONParser *parser) {
+    if(!isSymbol(bindCurrent(parser), JSON_MAP_BEGIN)) return STATUS_PARSE_ERR;
+    bindNext(parser);
+    if(isSymbol(bindCurrent(parser), JSON_MAP_CLOSE)) {
+        bindNext(parser);
+        return STATUS_OK;
+    }
+
+    while(1) {
+        struct JSONToken *token = bindCurrent(parser);
+        if(!token || token->token != JSON_TOKEN_STRING) return STATUS_PARSE_ERR;
+        const struct JSONField *field = findField(descriptor, token->lexeme);
+
+        bindNext(parser);
+        if(!isSymbol(bindCurrent(parser), JSON_MEMBER_SEP)) return STATUS_PARSE_ERR;
+        bindNext(parser);
+
+        // Members without a matching field are ignored.
+        unsigned int result = field ?
+            bindField(object, field, parser) :
+            skipValue(parser);
+        if(result) return result;
+
+        token = bindCurrent(parser);
+        if(isSymbol(token, JSON_SEPERATOR)) {
+            bindNext(parser);
+            continue;
+        }
+        if(isSymbol(token, JSON_MAP_CLOSE)) {
+            bindNext(parser);
+            return STATUS_OK;
+        }
+        return STATUS_PARSE_ERR;
+    }
+}
+
+unsigned int parseJSONInto(
+        void *target,
+        const struct JSONDescriptor *descriptor,
+        char *toCheck) {
+    struct JSONParser parser;
+    parserCompose(&parser);
+
+    unsigned int result = lexJSONTokens(&parser.tokens, toCheck);
+    if(result) {
+        parserRelease(&parser);
+        return result == STATUS_ALLOC_ERR ? result : STATUS_PARSE_ERR;
+    }
+
+    result = bindObject((char*)target, descriptor, &parser);
+    if(result == STATUS_OK && bindCurrent(&parser)) {
+        // Garbage followed valid JSON.
+        result = STATUS_PARSE_ERR;
+    }
+
+    parserRelease(&parser);
+    return result;
+}
+
+static unsigned int emitObject(
+    struct JSONBuffer *buffer,
+    const char *object,
+    const struct JSONDescriptor *descriptor,
+    struct JSONFormat fmt);
+
+static unsigned int emitValue(
+        struct JSONBuffer *buffer,
+        const char *value,
+        enum JSON_FIELD type,
+        const struct JSONDescriptor *descriptor,
+        struct JSONFormat fmt) {
+    char number[100];
+    switch(type) {
+        case JSON_FIELD_INTEGER:
+            snprintf(number, sizeof(number), "%ld", *((long*)value));
+            return bufferAppendString(buffer, number);
+        case JSON_FIELD_DOUBLE:
+            return bufferAppendDouble(buffer, *((double*)value));
+        case JSON_FIELD_BOOLEAN:
+            return bufferAppendString(buffer, *value ? JSON_TRUE_STR : JSON_FALSE_STR);
+        case JSON_FIELD_NUMBER: {
+            const struct JSONNumber *number = (const struct JSONNumber*)value;
+            if(!number->lexeme) return bufferAppendString(buffer, JSON_NULL_STR);
+            return numberUnparse(number, buffer);
+        }
+        case JSON_FIELD_STRING: {
+            const char *string = *((char**)value);
+            if(!string) return bufferAppendString(buffer, JSON_NULL_STR);
+            return bufferAppendQuoted(buffer, string);
+        }
+        case JSON_FIELD_OBJECT:
+            return emitObject(buffer, value, descriptor, fmt);
+        default:
+            return STATUS_INPUT_ERR;
+    }
+}
+
+static unsigned int emitArray(
+        struct JSONBuffer *buffer,
+        const char *object,
+        const struct JSONField *field,
+        struct JSONFormat fmt) {
+    const char *items = object + field->offset;
+    unsigned int count = *((unsigned int*)(object + field->countOffset));
+    if(count > field->capacity) count = field->capacity;
+    size_t size = elementSize(field->elementType, field->descriptor);
+
+    unsigned int result = bufferAppendChar(buffer, JSON_ARR_BEGIN);
+    if(result) return result;
+
+    fmt.level++;
+    for(unsigned int i = 0; i < count; i++) {
+        result = unparseIndent(buffer, fmt);
+        if(result) return result;
+        result = emitValue(buffer, items + i * size, field->elementType, field->descriptor, fmt);
+        if(result) return result;
+        result = unparseSeparator(buffer, i + 1 == count, fmt);
+        if(result) return result;
+    }
+    fmt.level--;
+
+    result = unparseWhitespace(buffer, fmt);
+    if(result) return result;
+    return bufferAppendChar(buffer, JSON_ARR_CLOSE);
+}
+
+static unsigned int emitObject(
+        struct JSONBuffer *buffer,
+        const char *object,
+        const struct JSONDescriptor *descriptor,
+        struct JSONFormat fmt) {
+    unsigned int result = bufferAppendChar(buffer, JSON_MAP_BEGIN);
+    if(result) return result;
+
+    fmt.level++;
+    for(unsigned int i = 0; i < descriptor->fieldCount; i++) {
+        const struct JSONField *field = &descriptor->fields[i];
+        result = unparseIndent(buffer, fmt);
+        if(result) return result;
+
+        result = bufferAppendQuoted(buffer, field->name);
+        if(result) return result;
+        result = bufferAppendChar(buffer, JSON_MEMBER_SEP);
+        if(result) return result;
+        result = bufferAppendChar(buffer, JSON_SPACE);
+        if(result) return result;
+
+        if(field->type == JSON_FIELD_ARRAY) {
+            result = emitArray(buffer, object, field, fmt);
+        } else {
+            result = emitValue(buffer, object + field->offset, field->type, field->descriptor, fmt);
+        }
+        if(result) return result;
+
+        result = unparseSeparator(buffer, i + 1 == descriptor->fieldCount, fmt);
+        if(result) return result;
+    }
+    fmt.level--;
+
+    result = unparseWhitespace(buffer, fmt);
+    if(result) return result;
+    return bufferAppendChar(buffer, JSON_MAP_CLOSE);
+}
+
+unsigned int unparseJSONFrom(
+        const void *source,
+        const struct JSONDescriptor *descriptor,
+        char **output,
+        unsigned int *outputLength,
+        struct JSONFormat fmt) {
+    struct JSONBuffer buffer;
+    bufferCompose(&buffer);
+
+    unsigned int result = emitObject(&buffer, source, descriptor, fmt);
+    if(result) {
+        bufferRelease(&buffer);
+        return result;
+    }
+
+    *output = bufferDetach(&buffer, outputLength);
+    if(!*output) return STATUS_ALLOC_ERR;
+    return STATUS_OK;
+}
+
+static void releaseValue(char *value, enum JSON_FIELD type, const struct JSONDescriptor *descriptor) {
+    if(type == JSON_FIELD_STRING) {
+        free(*((char**)value));
+        *((char**)value) = NULL;
+    } else if(type == JSON_FIELD_OBJECT) {
+        bindingRelease(value, descriptor);
+    }
+}
+
+void bindingRelease(void *target, const struct JSONDescriptor *descriptor) {
+    char *object = target;
+    for(unsigned int i = 0; i < descriptor->fieldCount; i++) {
+        const struct JSONField *field = &descriptor->fields[i];
+        if(field->type != JSON_FIELD_ARRAY) {
+            releaseValue(object + field->offset, field->type, field->descriptor);
+            continue;
+        }
+        unsigned int count = *((unsigned int*)(object + field->countOffset));
+        if(count > field->capacity) count = field->capacity;
+        size_t size = elementSize(field->elementType, field->descriptor);
+        for(unsigned int j = 0; j < count; j++) {
+            releaseValue(object + field->offset + j * size, field->elementType, field->descriptor);
+        }
+    }
+}
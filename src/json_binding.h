@@ -0,0 +1,63 @@
+#ifndef __JSON_BINDING_H
+#define __JSON_BINDING_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stddef.h>
+#include "json_parser.h"
+#include "json_unparser.h"
+
+enum JSON_FIELD {
+    JSON_FIELD_INTEGER, // long
+    JSON_FIELD_DOUBLE,  // double
+    JSON_FIELD_BOOLEAN, // char
+    JSON_FIELD_STRING,  // char*, allocated by the parser.
+    JSON_FIELD_OBJECT,  // Nested struct described by descriptor.
+    JSON_FIELD_ARRAY,   // Inline array of elementType, see capacity/countOffset.
+    JSON_FIELD_NUMBER   // struct JSONNumber pointing into the input, which must
+                        // outlive it. Written back verbatim, null leaves no lexeme.
+};
+
+struct JSONDescriptor;
+
+struct JSONField {
+    const char *name;
+    size_t offset;
+    enum JSON_FIELD type;
+    // Layout of nested objects, or of array elements that are objects.
+    const struct JSONDescriptor *descriptor;
+    // Arrays only: element type, number of slots at offset and the offset
+    // of the unsigned int receiving the number of elements parsed.
+    enum JSON_FIELD elementType;
+    unsigned int capacity;
+    size_t countOffset;
+};
+
+struct JSONDescriptor {
+    size_t size;
+    const struct JSONField *fields;
+    unsigned int fieldCount;
+};
+
+// Parse an object straight into a zero initialised struct described by
+// descriptor. On failure the target may be partially filled and should
+// still be passed to bindingRelease.
+unsigned int parseJSONInto(
+    void *target,
+    const struct JSONDescriptor *descriptor,
+    char *toCheck);
+
+unsigned int unparseJSONFrom(
+    const void *source,
+    const struct JSONDescriptor *descriptor,
+    char **output,
+    unsigned int *outputLength,
+    struct JSONFormat fmt);
+
+void bindingRelease(void *target, const struct JSONDescriptor *descriptor);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,306 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "json_binding.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+struct TestPoint {
+    long x;
+    double y;
+};
+
+struct TestRecord {
+    long id;
+    char *name;
+    char active;
+    struct TestPoint origin;
+    struct TestPoint points[4];
+    unsigned int pointCount;
+    long tags[3];
+    unsigned int tagCount;
+};
+
+static const struct JSONField pointFields[] = {
+    {"x", offsetof(struct TestPoint, x), JSON_FIELD_INTEGER},
+    {"y", offsetof(struct TestPoint, y), JSON_FIELD_DOUBLE}
+};
+static const struct JSONDescriptor pointDescriptor = {
+    sizeof(struct TestPoint), pointFields, 2
+};
+
+static const struct JSONField recordFields[] = {
+    {"id", offsetof(struct TestRecord, id), JSON_FIELD_INTEGER},
+    {"name", offsetof(struct TestRecord, name), JSON_FIELD_STRING},
+    {"active", offsetof(struct TestRecord, active), JSON_FIELD_BOOLEAN},
+    {"origin", offsetof(struct TestRecord, origin), JSON_FIELD_OBJECT, &pointDescriptor},
+    {"points", offsetof(struct TestRecord, points), JSON_FIELD_ARRAY, &pointDescriptor,
+        JSON_FIELD_OBJECT, 4, offsetof(struct TestRecord, pointCount)},
+    {"tags", offsetof(struct TestRecord, tags), JSON_FIELD_ARRAY, NULL,
+        JSON_FIELD_INTEGER, 3, offsetof(struct TestRecord, tagCount)}
+};
+static const struct JSONDescriptor recordDescriptor = {
+    sizeof(struct TestRecord), recordFields, 6
+};
+
+void testJSONBindParse() {
+    char input[] = "{ \"id\": 7, \"name\": \"foo\", \"skip\": {\"a\": [1, {}]},"
+        " \"active\": true, \"origin\": {\"x\": -2, \"y\": 1.5},"
+        " \"points\": [{\"x\": 1}, {\"y\": 2.0}], \"tags\": [] }";
+    struct TestRecord record;
+    memset(&record, 0, sizeof(record));
+    unsigned int result = parseJSONInto(&record, &recordDescriptor, input);
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(record.id, 7);
+    assertStringsEqual(record.name, "foo");
+    assertIntegersEqual(record.active, 1);
+    assertIntegersEqual(record.origin.x, -2);
+    assertFloatsEqual(record.origin.y, 1.5);
+    assertIntegersEqual(record.pointCount, 2);
+    assertIntegersEqual(record.points[0].x, 1);
+    assertFloatsEqual(record.points[1].y, 2.0);
+    assertIntegersEqual(record.tagCount, 0);
+    bindingRelease(&record, &recordDescriptor);
+    assertIsNull(record.name);
+}
+
+void testJSONBindParseTypeMismatch() {
+    char input[] = "{\"id\": 1.5}";
+    struct TestRecord record;
+    memset(&record, 0, sizeof(record));
+    unsigned int result = parseJSONInto(&record, &recordDescriptor, input);
+    assertIntegersEqual(result, STATUS_PARSE_ERR);
+    bindingRelease(&record, &recordDescriptor);
+
+    // Unknown members are skipped but must still be well formed.
+    const char *malformed[] = {
+        "{\"junk\": [1 2], \"x\": 3}",
+        "{\"junk\": {\"a\" 1}, \"x\": 3}",
+        "{\"junk\": {\"a\":1 \"b\":2}, \"x\": 3}",
+        "{\"junk\": [:], \"x\": 3}",
+        "{\"junk\": [1,], \"x\": 3}",
+        "{\"junk\": {\"a\": 1]}"
+    };
+    for(unsigned int i = 0; i < sizeof(malformed) / sizeof(*malformed); i++) {
+        char text[64];
+        strcpy(text, malformed[i]);
+        struct TestPoint point = {0, 0};
+        assertIntegersEqual(parseJSONInto(&point, &pointDescriptor, text), STATUS_PARSE_ERR);
+    }
+}
+
+void testJSONBindParseArrayOverflow() {
+    char input[] = "{\"tags\": [1, 2, 3, 4]}";
+    struct TestRecord record;
+    memset(&record, 0, sizeof(record));
+    unsigned int result = parseJSONInto(&record, &recordDescriptor, input);
+    assertIntegersEqual(result, STATUS_PARSE_ERR);
+    assertIntegersEqual(record.tagCount, 0);
+    bindingRelease(&record, &recordDescriptor);
+}
+
+void testJSONBindUnparse() {
+    struct TestRecord record;
+    memset(&record, 0, sizeof(record));
+    record.id = 3;
+    record.name = "bar";
+    record.tags[0] = 4;
+    record.tags[1] = 5;
+    record.tagCount = 2;
+
+    char *output;
+    unsigned int outputLength;
+    struct JSONFormat fmt = {0, 0, 0};
+    unsigned int result = unparseJSONFrom(&record, &recordDescriptor, &output, &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output,
+        "{\"id\": 3,\"name\": \"bar\",\"active\": false,"
+        "\"origin\": {\"x\": 0,\"y\": 0},\"points\": [],\"tags\": [4,5]}");
+    assertIntegersEqual(outputLength, strlen(output));
+    free(output);
+}
+
+void testJSONBindUnparseFormatted() {
+    struct TestPoint point = {1, 2.5};
+    char *output;
+    unsigned int outputLength;
+    struct JSONFormat fmt = {4, 0, 0};
+    unsigned int result = unparseJSONFrom(&point, &pointDescriptor, &output, &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output, "{\r\n    \"x\": 1,\r\n    \"y\": 2.5\r\n}");
+    free(output);
+}
+
+struct TestAmount {
+    struct JSONNumber value;
+    struct JSONNumber missing;
+};
+
+static const struct JSONField amountFields[] = {
+    {"value", offsetof(struct TestAmount, value), JSON_FIELD_NUMBER},
+    {"missing", offsetof(struct TestAmount, missing), JSON_FIELD_NUMBER}
+};
+static const struct JSONDescriptor amountDescriptor = {
+    sizeof(struct TestAmount), amountFields, 2
+};
+
+void testJSONBindNumber() {
+    // Digits beyond double precision survive a round trip.
+    char input[] = "{\"value\": 12345678901234567890.10, \"missing\": null}";
+    struct TestAmount amount;
+    memset(&amount, 0, sizeof(amount));
+    unsigned int result = parseJSONInto(&amount, &amountDescriptor, input);
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(amount.value.length, 23);
+    assertIsNull(amount.missing.lexeme);
+
+    char *output;
+    unsigned int outputLength;
+    struct JSONFormat fmt = {0, 0, 0};
+    result = unparseJSONFrom(&amount, &amountDescriptor, &output, &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output, "{\"value\": 12345678901234567890.10,\"missing\": null}");
+    free(output);
+    bindingRelease(&amount, &amountDescriptor);
+
+    char invalid[] = "{\"value\": 01}";
+    result = parseJSONInto(&amount, &amountDescriptor, invalid);
+    assertIntegersEqual(result, STATUS_PARSE_ERR);
+}
+
+void testJSONBindEscapes() {
+    char input[] = "{\"name\": \"a\\\"b\\\\c\\n\\u00e9\\uD83D\\uDE00\"}";
+    struct TestRecord record;
+    memset(&record, 0, sizeof(record));
+    assertIntegersEqual(parseJSONInto(&record, &recordDescriptor, input), STATUS_OK);
+    assertStringsEqual(record.name, "a\"b\\c\n\xC3\xA9\xF0\x9F\x98\x80");
+
+    // Written back escaped, and the output reads back to the same string.
+    char *output;
+    unsigned int outputLength;
+    struct JSONFormat fmt = {0, 0, 0};
+    assertIntegersEqual(unparseJSONFrom(&record, &recordDescriptor, &output, &outputLength, fmt), STATUS_OK);
+    assertIntegersEqual(strstr(output, "\"name\": \"a\\\"b\\\\c\\n\xC3\xA9\xF0\x9F\x98\x80\"") != NULL, 1);
+    struct TestRecord copy;
+    memset(&copy, 0, sizeof(copy));
+    assertIntegersEqual(parseJSONInto(&copy, &recordDescriptor, output), STATUS_OK);
+    assertStringsEqual(copy.name, record.name);
+    free(output);
+    bindingRelease(&copy, &recordDescriptor);
+    bindingRelease(&record, &recordDescriptor);
+
+    char loneSurrogate[] = "{\"name\": \"\\uD83D\"}";
+    memset(&record, 0, sizeof(record));
+    assertIntegersEqual(parseJSONInto(&record, &recordDescriptor, loneSurrogate), STATUS_PARSE_ERR);
+    char nullCharacter[] = "{\"name\": \"a\\u0000b\"}";
+    assertIntegersEqual(parseJSONInto(&record, &recordDescriptor, nullCharacter), STATUS_PARSE_ERR);
+    assertIsNull(record.name);
+}
+
+void testJSONBindDoubles() {
+    struct TestPoint point = {0, 1e-7};
+    char *output;
+    unsigned int outputLength;
+    struct JSONFormat fmt = {0, 0, 0};
+    assertIntegersEqual(unparseJSONFrom(&point, &pointDescriptor, &output, &outputLength, fmt), STATUS_OK);
+    assertStringsEqual(output, "{\"x\": 0,\"y\": 1e-07}");
+    struct TestPoint copy = {0, 0};
+    assertIntegersEqual(parseJSONInto(&copy, &pointDescriptor, output), STATUS_OK);
+    assertIntegersEqual(copy.y == point.y, 1);
+    free(output);
+
+    point.y = 0.1;
+    assertIntegersEqual(unparseJSONFrom(&point, &pointDescriptor, &output, &outputLength, fmt), STATUS_OK);
+    assertStringsEqual(output, "{\"x\": 0,\"y\": 0.1}");
+    free(output);
+
+    point.y = NAN;
+    assertIntegersEqual(unparseJSONFrom(&point, &pointDescriptor, &output, &outputLength, fmt), STATUS_INPUT_ERR);
+    point.y = INFINITY;
+    assertIntegersEqual(unparseJSONFrom(&point, &pointDescriptor, &output, &outputLength, fmt), STATUS_INPUT_ERR);
+}
+
+struct TestNames {
+    char *names[3];
+    unsigned int nameCount;
+};
+
+static const struct JSONField namesFields[] = {
+    {"names", offsetof(struct TestNames, names), JSON_FIELD_ARRAY, NULL,
+        JSON_FIELD_STRING, 3, offsetof(struct TestNames, nameCount)}
+};
+static const struct JSONDescriptor namesDescriptor = {
+    sizeof(struct TestNames), namesFields, 1
+};
+
+struct TestLabel {
+    char *label;
+    long weight;
+};
+
+struct TestLabels {
+    struct TestLabel labels[2];
+    unsigned int labelCount;
+};
+
+static const struct JSONField labelFields[] = {
+    {"label", offsetof(struct TestLabel, label), JSON_FIELD_STRING},
+    {"weight", offsetof(struct TestLabel, weight), JSON_FIELD_INTEGER}
+};
+static const struct JSONDescriptor labelDescriptor = {
+    sizeof(struct TestLabel), labelFields, 2
+};
+static const struct JSONField labelsFields[] = {
+    {"labels", offsetof(struct TestLabels, labels), JSON_FIELD_ARRAY, &labelDescriptor,
+        JSON_FIELD_OBJECT, 2, offsetof(struct TestLabels, labelCount)}
+};
+static const struct JSONDescriptor labelsDescriptor = {
+    sizeof(struct TestLabels), labelsFields, 1
+};
+
+void testJSONBindArrayReleases() {
+    // The repeated member drops all three earlier strings.
+    char repeated[] = "{\"names\": [\"a\", \"b\", \"c\"], \"names\": [\"d\"]}";
+    struct TestNames names;
+    memset(&names, 0, sizeof(names));
+    assertIntegersEqual(parseJSONInto(&names, &namesDescriptor, repeated), STATUS_OK);
+    assertIntegersEqual(names.nameCount, 1);
+    assertStringsEqual(names.names[0], "d");
+    assertIsNull(names.names[1]);
+    bindingRelease(&names, &namesDescriptor);
+
+    // An element failing halfway keeps nothing it allocated.
+    char partial[] = "{\"labels\": [{\"label\": \"a\"}, {\"label\": \"b\", \"weight\": \"bad\"}]}";
+    struct TestLabels labels;
+    memset(&labels, 0, sizeof(labels));
+    assertIntegersEqual(parseJSONInto(&labels, &labelsDescriptor, partial), STATUS_PARSE_ERR);
+    assertIntegersEqual(labels.labelCount, 1);
+    assertIsNull(labels.labels[1].label);
+    bindingRelease(&labels, &labelsDescriptor);
+}
+
+void testJSONBindBufferLimits() {
+    // A length past what the buffer can index fails instead of wrapping.
+    struct JSONBuffer buffer;
+    bufferCompose(&buffer);
+    buffer.length = UINT_MAX - 10;
+    assertIntegersEqual(bufferReserve(&buffer, 100), STATUS_ALLOC_ERR);
+    assertIntegersEqual(bufferReserve(&buffer, 10), STATUS_ALLOC_ERR);
+    assertIsNull(buffer.data);
+    buffer.length = 0;
+    bufferRelease(&buffer);
+}
+
+void testJSONBinding() {
+    testJSONBindParse();
+    testJSONBindParseTypeMismatch();
+    testJSONBindParseArrayOverflow();
+    testJSONBindUnparse();
+    testJSONBindUnparseFormatted();
+    testJSONBindNumber();
+    testJSONBindEscapes();
+    testJSONBindDoubles();
+    testJSONBindArrayReleases();
+    testJSONBindBufferLimits();
+}
@@ -0,0 +1,284 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "json_buffer.h"
+#include "cutil/src/error.h"
+
+#define JSON_BUFFER_MIN_CAPACITY 64
+
+void bufferCompose(struct JSONBuffer *buffer) {
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+    buffer->fixed = 0;
+    buffer->sink = NULL;
+    buffer->sinkContext = NULL;
+}
+
+void bufferComposeFixed(struct JSONBuffer *buffer, char *data, unsigned int capacity) {
+    buffer->data = data;
+    buffer->length = 0;
+    buffer->capacity = data ? capacity : 0;
+    buffer->fixed = 1;
+    buffer->sink = NULL;
+    buffer->sinkContext = NULL;
+    if(buffer->capacity) *data = 0;
+}
+
+void bufferComposeSink(
+        struct JSONBuffer *buffer,
+        unsigned int (*sink)(void *context, const char *data, unsigned int length),
+        void *context) {
+    bufferComposeFixed(buffer, NULL, 0);
+    buffer->sink = sink;
+    buffer->sinkContext = context;
+}
+
+void bufferRelease(struct JSONBuffer *buffer) {
+    if(!buffer->fixed) free(buffer->data);
+    bufferCompose(buffer);
+}
+
+void bufferClear(struct JSONBuffer *buffer) {
+    buffer->length = 0;
+    if(buffer->capacity) *buffer->data = 0;
+}
+
+int bufferTruncated(struct JSONBuffer *buffer) {
+    return buffer->fixed && buffer->length >= buffer->capacity;
+}
+
+unsigned int bufferTerminate(struct JSONBuffer *buffer) {
+    if(buffer->fixed) {
+        if(buffer->capacity == 0) return STATUS_OK;
+        unsigned int end = buffer->length < buffer->capacity ?
+            buffer->length : buffer->capacity - 1;
+        buffer->data[end] = 0;
+        return STATUS_OK;
+    }
+    unsigned int result = bufferReserve(buffer, 0);
+    if(result) return result;
+    buffer->data[buffer->length] = 0;
+    return STATUS_OK;
+}
+
+// Room left in a fixed buffer, keeping the last byte for the terminator.
+static unsigned int bufferAvailable(struct JSONBuffer *buffer, unsigned int length) {
+    if(buffer->length + 1 >= buffer->capacity) return 0;
+    unsigned int available = buffer->capacity - buffer->length - 1;
+    return length < available ? length : available;
+}
+
+unsigned int bufferReserve(struct JSONBuffer *buffer, unsigned int length) {
+    if(buffer->fixed) return STATUS_OK;
+    // Leave room for the null terminator.
+    if(length > UINT_MAX - buffer->length - 1) return STATUS_ALLOC_ERR;
+    unsigned int required = buffer->length + length + 1;
+    if(required <= buffer->capacity) return STATUS_OK;
+
+    unsigned int capacity = buffer->capacity ? buffer->capacity : JSON_BUFFER_MIN_CAPACITY;
+    while(capacity < required) {
+        capacity = capacity > UINT_MAX / 2 ? UINT_MAX : capacity * 2;
+    }
+
+    char *data = realloc(buffer->data, capacity);
+    if(data == NULL) return STATUS_ALLOC_ERR;
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return STATUS_OK;
+}
+
+unsigned int bufferJoinedLength(
+        const struct JSONBuffer *buffers,
+        unsigned int count,
+        size_t extra,
+        unsigned int *length) {
+    // Summed wide, buffer lengths alone can add up past UINT_MAX.
+    size_t total = extra;
+    for(unsigned int i = 0; i < count && total < UINT_MAX; i++) total += buffers[i].length;
+    // One byte stays free for the terminator.
+    if(total >= UINT_MAX) return STATUS_ALLOC_ERR;
+    *length = total;
+    return STATUS_OK;
+}
+
+unsigned int bufferAppend(struct JSONBuffer *buffer, const char *data, unsigned int length) {
+    if(buffer->fixed) {
+        unsigned int available = bufferAvailable(buffer, length);
+        if(available) memcpy(buffer->data + buffer->length, data, available);
+        buffer->length += length;
+        return buffer->sink ? buffer->sink(buffer->sinkContext, data, length) : STATUS_OK;
+    }
+    unsigned int result = bufferReserve(buffer, length);
+    if(result) return result;
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = 0;
+    return STATUS_OK;
+}
+
+unsigned int bufferAppendChar(struct JSONBuffer *buffer, char c) {
+    return bufferAppend(buffer, &c, 1);
+}
+
+unsigned int bufferAppendString(struct JSONBuffer *buffer, const char *string) {
+    return bufferAppend(buffer, string, strlen(string));
+}
+
+unsigned int bufferAppendRepeat(struct JSONBuffer *buffer, char c, unsigned int count) {
+    if(buffer->sink) {
+        char chunk[64];
+        memset(chunk, c, sizeof(chunk));
+        while(count) {
+            unsigned int length = count < sizeof(chunk) ? count : sizeof(chunk);
+            unsigned int result = bufferAppend(buffer, chunk, length);
+            if(result) return result;
+            count -= length;
+        }
+        return STATUS_OK;
+    }
+    if(buffer->fixed) {
+        unsigned int available = bufferAvailable(buffer, count);
+        if(available) memset(buffer->data + buffer->length, c, available);
+        buffer->length += count;
+        return STATUS_OK;
+    }
+    unsigned int result = bufferReserve(buffer, count);
+    if(result) return result;
+    memset(buffer->data + buffer->length, c, count);
+    buffer->length += count;
+    buffer->data[buffer->length] = 0;
+    return STATUS_OK;
+}
+
+unsigned int bufferAppendBigEndian(struct JSONBuffer *buffer, uint64_t value, unsigned int bytes) {
+    char data[8];
+    for(unsigned int i = 0; i < bytes; i++) {
+        data[bytes - i - 1] = (char)(value >> (8 * i));
+    }
+    return bufferAppend(buffer, data, bytes);
+}
+
+unsigned int bufferAppendUTF8(struct JSONBuffer *buffer, unsigned long codePoint) {
+    char encoded[4];
+    unsigned int length;
+    if(codePoint < 0x80) {
+        encoded[0] = (char)codePoint;
+        length = 1;
+    } else if(codePoint < 0x800) {
+        encoded[0] = (char)(0xC0 | (codePoint >> 6));
+        encoded[1] = (char)(0x80 | (codePoint & 0x3F));
+        length = 2;
+    } else if(codePoint < 0x10000) {
+        encoded[0] = (char)(0xE0 | (codePoint >> 12));
+        encoded[1] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        encoded[2] = (char)(0x80 | (codePoint & 0x3F));
+        length = 3;
+    } else {
+        encoded[0] = (char)(0xF0 | (codePoint >> 18));
+        encoded[1] = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+        encoded[2] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        encoded[3] = (char)(0x80 | (codePoint & 0x3F));
+        length = 4;
+    }
+    return bufferAppend(buffer, encoded, length);
+}
+
+unsigned int bufferAppendEscaped(struct JSONBuffer *buffer, const char *string, unsigned int length) {
+    const char *end = string + length;
+    unsigned int result = STATUS_OK;
+    while(!result && string < end) {
+        const char *run = string;
+        while(string < end && (unsigned char)*string >= 0x20 && *string != '"' && *string != '\\') string++;
+        result = bufferAppend(buffer, run, string - run);
+        if(result || string == end) break;
+
+        const char *escapes = "\"\"\\\\\bb\ff\nn\rr\tt";
+        const char *escape = escapes;
+        while(*escape && *escape != *string) escape += 2;
+        char encoded[8];
+        unsigned int encodedLength = *escape ?
+            (unsigned int)snprintf(encoded, sizeof(encoded), "\\%c", escape[1]) :
+            (unsigned int)snprintf(encoded, sizeof(encoded), "\\u%04x", (unsigned char)*string);
+        result = bufferAppend(buffer, encoded, encodedLength);
+        string++;
+    }
+    return result;
+}
+
+unsigned int bufferAppendQuoted(struct JSONBuffer *buffer, const char *string) {
+    unsigned int result = bufferAppendChar(buffer, '"');
+    if(!result) result = bufferAppendEscaped(buffer, string, strlen(string));
+    if(result) return result;
+    return bufferAppendChar(buffer, '"');
+}
+
+// Four hex digits of a \u escape, -1 when they are not.
+static long bufferHexUnit(const char *digits) {
+    long value = 0;
+    for(unsigned int i = 0; i < 4; i++) {
+        char c = digits[i];
+        if(c >= '0' && c <= '9') value = value * 16 + c - '0';
+        else if(c >= 'a' && c <= 'f') value = value * 16 + c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F') value = value * 16 + c - 'A' + 10;
+        else return -1;
+    }
+    return value;
+}
+
+unsigned int bufferAppendUnescaped(struct JSONBuffer *buffer, const char *string, unsigned int length) {
+    const char *end = string + length;
+    while(string < end) {
+        const char *run = string;
+        while(string < end && *string != '\\') string++;
+        unsigned int result = bufferAppend(buffer, run, string - run);
+        if(result) return result;
+        if(string == end) break;
+
+        if(end - string < 2) return STATUS_PARSE_ERR;
+        const char *simple = "\"\"\\\\//b\bf\fn\nr\rt\t";
+        const char *c = simple;
+        while(*c && *c != string[1]) c += 2;
+        if(*c) {
+            result = bufferAppendChar(buffer, c[1]);
+            string += 2;
+        } else {
+            if(string[1] != 'u' || end - string < 6) return STATUS_PARSE_ERR;
+            long unit = bufferHexUnit(string + 2);
+            string += 6;
+            if(unit < 0 || (unit >= 0xDC00 && unit <= 0xDFFF)) return STATUS_PARSE_ERR;
+            if(unit >= 0xD800 && unit <= 0xDBFF) {
+                long low = end - string >= 6 && string[0] == '\\' && string[1] == 'u' ?
+                    bufferHexUnit(string + 2) : -1;
+                if(low < 0xDC00 || low > 0xDFFF) return STATUS_PARSE_ERR;
+                unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                string += 6;
+            }
+            result = bufferAppendUTF8(buffer, unit);
+        }
+        if(result) return result;
+    }
+    return STATUS_OK;
+}
+
+unsigned int bufferAppendDouble(struct JSONBuffer *buffer, double value) {
+    if(isnan(value) || isinf(value)) return STATUS_INPUT_ERR;
+    char number[32];
+    unsigned int length = 0;
+    for(int precision = 1; precision <= 17; precision++) {
+        length = snprintf(number, sizeof(number), "%.*g", precision, value);
+        if(strtod(number, NULL) == value) break;
+    }
+    return bufferAppend(buffer, number, length);
+}
+
+char *bufferDetach(struct JSONBuffer *buffer, unsigned int *length) {
+    // Always hand back a valid string, even when nothing was written.
+    if(buffer->fixed || bufferTerminate(buffer)) return NULL;
+    char *data = buffer->data;
+    if(length) *length = buffer->length;
+    bufferCompose(buffer);
+    return data;
+}
@@ -0,0 +1,64 @@
+#ifndef __JSON_BUFFER_H
+#define __JSON_BUFFER_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Growable, null terminated output buffer used by the serializers.
+// A fixed buffer writes into caller storage and never allocates: bytes past
+// the end are dropped but still counted in length, so a fixed buffer with
+// no storage measures output exactly. A sink buffer is a storageless
+// fixed buffer that hands every appended byte to a callback instead.
+struct JSONBuffer {
+    char *data;
+    unsigned int length;
+    unsigned int capacity;
+    unsigned char fixed;
+    unsigned int (*sink)(void *context, const char *data, unsigned int length);
+    void *sinkContext;
+};
+
+void bufferCompose(struct JSONBuffer *buffer);
+void bufferComposeFixed(struct JSONBuffer *buffer, char *data, unsigned int capacity);
+void bufferComposeSink(
+    struct JSONBuffer *buffer,
+    unsigned int (*sink)(void *context, const char *data, unsigned int length),
+    void *context);
+int bufferTruncated(struct JSONBuffer *buffer);
+unsigned int bufferTerminate(struct JSONBuffer *buffer);
+void bufferRelease(struct JSONBuffer *buffer);
+void bufferClear(struct JSONBuffer *buffer);
+unsigned int bufferReserve(struct JSONBuffer *buffer, unsigned int length);
+// Combined length of count buffers plus extra bytes, a STATUS_ALLOC_ERR
+// when one buffer could not hold it.
+unsigned int bufferJoinedLength(
+    const struct JSONBuffer *buffers,
+    unsigned int count,
+    size_t extra,
+    unsigned int *length);
+unsigned int bufferAppend(struct JSONBuffer *buffer, const char *data, unsigned int length);
+unsigned int bufferAppendChar(struct JSONBuffer *buffer, char c);
+unsigned int bufferAppendString(struct JSONBuffer *buffer, const char *string);
+unsigned int bufferAppendRepeat(struct JSONBuffer *buffer, char c, unsigned int count);
+unsigned int bufferAppendBigEndian(struct JSONBuffer *buffer, uint64_t value, unsigned int bytes);
+unsigned int bufferAppendUTF8(struct JSONBuffer *buffer, unsigned long codePoint);
+// Contents of a JSON string for length bytes of UTF-8, escaped where JSON
+// requires it. Null bytes are written as \u0000.
+unsigned int bufferAppendEscaped(struct JSONBuffer *buffer, const char *string, unsigned int length);
+// UTF-8 string in quotation marks, escaped where JSON requires it.
+unsigned int bufferAppendQuoted(struct JSONBuffer *buffer, const char *string);
+// Contents of a JSON string with its escapes decoded. Malformed escapes
+// and unpaired surrogates are a STATUS_PARSE_ERR.
+unsigned int bufferAppendUnescaped(struct JSONBuffer *buffer, const char *string, unsigned int length);
+// Shortest digits that read back to value, NaN and infinities are a
+// STATUS_INPUT_ERR.
+unsigned int bufferAppendDouble(struct JSONBuffer *buffer, double value);
+char *bufferDetach(struct JSONBuffer *buffer, unsigned int *length);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_cache.h"
+#include "cutil/src/map/map.h"
+#include "cutil/src/error.h"
+
+static unsigned int cacheSlot(const struct JSONCache *cache, const struct Generic *generic) {
+    uint64_t hash = (uint64_t)(uintptr_t)generic * 0x9E3779B97F4A7C15ULL;
+    return (unsigned int)(hash >> 32) & (cache->capacity - 1);
+}
+
+static struct JSONCacheEntry *cacheLookup(struct JSONCache *cache, const struct Generic *generic) {
+    if(cache->size == 0) return NULL;
+    unsigned int slot = cacheSlot(cache, generic);
+    while(cache->entries[slot].generic) {
+        if(cache->entries[slot].generic == generic) return &cache->entries[slot];
+        slot = (slot + 1) & (cache->capacity - 1);
+    }
+    return NULL;
+}
+
+static unsigned int cacheGrow(struct JSONCache *cache) {
+    unsigned int capacity = cache->capacity ? cache->capacity * 2 : 64;
+    struct JSONCacheEntry *entries = calloc(capacity, sizeof(struct JSONCacheEntry));
+    if(entries == NULL) return STATUS_ALLOC_ERR;
+
+    struct JSONCacheEntry *old = cache->entries;
+    unsigned int oldCapacity = cache->capacity;
+    cache->entries = entries;
+    cache->capacity = capacity;
+    for(unsigned int i = 0; i < oldCapacity; i++) {
+        if(!old[i].generic) continue;
+        unsigned int slot = cacheSlot(cache, old[i].generic);
+        while(entries[slot].generic) slot = (slot + 1) & (capacity - 1);
+        entries[slot] = old[i];
+    }
+    free(old);
+    return STATUS_OK;
+}
+
+void cacheCompose(struct JSONCache *cache, unsigned int threshold) {
+    cache->entries = NULL;
+    cache->size = 0;
+    cache->capacity = 0;
+    cache->threshold = threshold;
+}
+
+void cacheRelease(struct JSONCache *cache) {
+    for(unsigned int i = 0; i < cache->capacity; i++) {
+        free(cache->entries[i].text);
+    }
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->size = 0;
+    cache->capacity = 0;
+}
+
+const struct JSONCacheEntry *cacheFind(
+        struct JSONCache *cache,
+        const struct Generic *generic,
+        struct JSONFormat fmt) {
+    struct JSONCacheEntry *entry = cacheLookup(cache, generic);
+    if(!entry || !entry->text) return NULL;
+    // Indented text depends on the depth it was written at.
+    if(entry->fmt.indent != fmt.indent
+            || entry->fmt.useTabs != fmt.useTabs
+            || entry->fmt.canonical != fmt.canonical
+            || (fmt.indent && entry->fmt.level != fmt.level)) {
+        return NULL;
+    }
+    return entry;
+}
+
+// Entry of a node, added empty when missing.
+static struct JSONCacheEntry *cacheInsert(struct JSONCache *cache, const struct Generic *generic) {
+    struct JSONCacheEntry *entry = cacheLookup(cache, generic);
+    if(entry) return entry;
+    if((cache->size + 1) * 4 > cache->capacity * 3 && cacheGrow(cache)) return NULL;
+
+    unsigned int slot = cacheSlot(cache, generic);
+    while(cache->entries[slot].generic) slot = (slot + 1) & (cache->capacity - 1);
+    entry = &cache->entries[slot];
+    entry->generic = generic;
+    cache->size++;
+    return entry;
+}
+
+unsigned int cacheStore(
+        struct JSONCache *cache,
+        const struct Generic *generic,
+        struct JSONFormat fmt,
+        const char *text,
+        unsigned int length) {
+    char *copy = malloc(length);
+    if(copy == NULL) return STATUS_ALLOC_ERR;
+    memcpy(copy, text, length);
+
+    struct JSONCacheEntry *entry = cacheInsert(cache, generic);
+    if(!entry) {
+        free(copy);
+        return STATUS_ALLOC_ERR;
+    }
+    // A node keeps a single text, the latest format wins.
+    free(entry->text);
+    entry->fmt = fmt;
+    entry->text = copy;
+    entry->length = length;
+    return STATUS_OK;
+}
+
+int cacheFindHash(struct JSONCache *cache, const struct Generic *generic, uint64_t *hash) {
+    struct JSONCacheEntry *entry = cacheLookup(cache, generic);
+    if(!entry || !entry->hashed) return 0;
+    *hash = entry->hash;
+    return 1;
+}
+
+unsigned int cacheStoreHash(struct JSONCache *cache, const struct Generic *generic, uint64_t hash) {
+    struct JSONCacheEntry *entry = cacheInsert(cache, generic);
+    if(!entry) return STATUS_ALLOC_ERR;
+    entry->hash = hash;
+    entry->hashed = 1;
+    return STATUS_OK;
+}
+
+// Take an entry out of the table, its text is left to the caller.
+static void cacheRemove(struct JSONCache *cache, struct JSONCacheEntry *entry) {
+    cache->size--;
+
+    // Shift later entries of the probe run back instead of leaving tombstones.
+    unsigned int mask = cache->capacity - 1;
+    unsigned int hole = entry - cache->entries;
+    unsigned int slot = hole;
+    while(1) {
+        slot = (slot + 1) & mask;
+        if(!cache->entries[slot].generic) break;
+        unsigned int home = cacheSlot(cache, cache->entries[slot].generic);
+        if(((slot - home) & mask) >= ((slot - hole) & mask)) {
+            cache->entries[hole] = cache->entries[slot];
+            hole = slot;
+        }
+    }
+    memset(&cache->entries[hole], 0, sizeof(struct JSONCacheEntry));
+}
+
+void cacheInvalidate(struct JSONCache *cache, const struct Generic *generic) {
+    struct JSONCacheEntry *entry = cacheLookup(cache, generic);
+    if(!entry) return;
+    free(entry->text);
+    cacheRemove(cache, entry);
+}
+
+void cacheMove(struct JSONCache *cache, const struct Generic *from, const struct Generic *to) {
+    struct JSONCacheEntry *entry = cacheLookup(cache, from);
+    if(!entry) return;
+    struct JSONCacheEntry moved = *entry;
+    cacheRemove(cache, entry);
+
+    // The table held from, so it has room for to without growing.
+    unsigned int slot = cacheSlot(cache, to);
+    while(cache->entries[slot].generic) slot = (slot + 1) & (cache->capacity - 1);
+    moved.generic = to;
+    cache->entries[slot] = moved;
+    cache->size++;
+}
+
+void cacheForget(struct JSONCache *cache, struct Generic *generic) {
+    if(cache->size == 0) return;
+    if(generic->object != &Array.object && generic->object != &Map.object) return;
+    cacheInvalidate(cache, generic);
+
+    struct Collection *collection = (struct Collection*)generic->object;
+    struct Iterator iterator = collection->iterator(genericData(generic));
+    struct Generic *element;
+    while((element = collection->next(&iterator))) {
+        cacheForget(cache, element);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef __JSON_CACHE_H
+#define __JSON_CACHE_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stdint.h>
+#include "json_unparser.h"
+
+struct JSONCacheEntry {
+    const struct Generic *generic;
+    struct JSONFormat fmt;
+    // NULL until the node was serialized.
+    char *text;
+    unsigned int length;
+    uint64_t hash;
+    unsigned char hashed;
+};
+
+// Serialized text and structural hashes of containers, keyed by node.
+// Entries must be invalidated whenever a node or anything below it changes.
+struct JSONCache {
+    struct JSONCacheEntry *entries;
+    unsigned int size;
+    unsigned int capacity;
+    // Subtrees serializing to fewer bytes are not worth keeping.
+    unsigned int threshold;
+};
+
+void cacheCompose(struct JSONCache *cache, unsigned int threshold);
+void cacheRelease(struct JSONCache *cache);
+
+const struct JSONCacheEntry *cacheFind(
+    struct JSONCache *cache,
+    const struct Generic *generic,
+    struct JSONFormat fmt);
+unsigned int cacheStore(
+    struct JSONCache *cache,
+    const struct Generic *generic,
+    struct JSONFormat fmt,
+    const char *text,
+    unsigned int length);
+
+int cacheFindHash(struct JSONCache *cache, const struct Generic *generic, uint64_t *hash);
+unsigned int cacheStoreHash(struct JSONCache *cache, const struct Generic *generic, uint64_t hash);
+
+// Drop the entry of a single node, e.g. every ancestor of an edit.
+void cacheInvalidate(struct JSONCache *cache, const struct Generic *generic);
+// Drop the entries of a node and all its descendants before it is freed.
+void cacheForget(struct JSONCache *cache, struct Generic *generic);
+// Hand the entry of a node to the node that took over its contents.
+void cacheMove(struct JSONCache *cache, const struct Generic *from, const struct Generic *to);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_cache.h"
+#include "json_parser.h"
+#include "cutil/src/string.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+void testJSONCacheStoreInvalidate() {
+    struct JSONCache cache;
+    cacheCompose(&cache, 0);
+    struct JSONFormat fmt = {0, 0, 0};
+
+    // Enough entries to grow the table and exercise probe runs.
+    struct Generic *generics[200];
+    for(unsigned int i = 0; i < 200; i++) {
+        generics[i] = genericCompose(&Integer);
+        unsigned int result = cacheStore(&cache, generics[i], fmt, (char*)&i, sizeof(i));
+        assertIntegersEqual(result, STATUS_OK);
+    }
+    assertIntegersEqual(cache.size, 200);
+
+    for(unsigned int i = 0; i < 200; i += 2) {
+        cacheInvalidate(&cache, generics[i]);
+    }
+    assertIntegersEqual(cache.size, 100);
+    for(unsigned int i = 0; i < 200; i++) {
+        const struct JSONCacheEntry *entry = cacheFind(&cache, generics[i], fmt);
+        if(i % 2) {
+            assertNotNull(entry);
+            assertIntegersEqual(*(unsigned int*)entry->text, i);
+        } else {
+            assertIsNull(entry);
+        }
+        genericRelease(generics[i]);
+    }
+    cacheRelease(&cache);
+}
+
+void testJSONCacheFormat() {
+    struct JSONCache cache;
+    cacheCompose(&cache, 0);
+    struct Generic *generic = genericCompose(&Integer);
+
+    struct JSONFormat compact = {0, 0, 0};
+    struct JSONFormat compactNested = {0, 3, 0};
+    struct JSONFormat indented = {2, 1, 0};
+    struct JSONFormat indentedNested = {2, 2, 0};
+    cacheStore(&cache, generic, compact, "[]", 2);
+    assertNotNull(cacheFind(&cache, generic, compactNested));
+    assertIsNull(cacheFind(&cache, generic, indented));
+
+    cacheStore(&cache, generic, indented, "[ ]", 3);
+    assertIntegersEqual(cache.size, 1);
+    assertNotNull(cacheFind(&cache, generic, indented));
+    assertIsNull(cacheFind(&cache, generic, indentedNested));
+
+    genericRelease(generic);
+    cacheRelease(&cache);
+}
+
+void testJSONCacheUnparse() {
+    char input[] = "{\"a\": [1, 2, 3, 4], \"b\": {\"c\": \"long enough\"}, \"d\": [4]}";
+    struct Generic *generic;
+    unsigned int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    struct JSONCache cache;
+    cacheCompose(&cache, 8);
+    struct JSONUnparser unparser;
+    unparserCompose(&unparser);
+    unparser.cache = &cache;
+
+    struct JSONFormat fmt = {0, 0, 0};
+    const char *output;
+    unsigned int length;
+    result = unparseJSONWith(&unparser, generic, &output, &length, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    char *expected = strCopy(output);
+
+    // Short subtrees stay below the threshold.
+    assertNotNull(cacheFind(&cache, generic, fmt));
+    assertNotNull(cacheFind(&cache, getAt(generic, "b"), fmt));
+    assertIsNull(cacheFind(&cache, getAt(generic, "d"), fmt));
+
+    // Cached text is reused verbatim.
+    cacheInvalidate(&cache, generic);
+    struct JSONCacheEntry *entry = (struct JSONCacheEntry*)cacheFind(&cache, getAt(generic, "a"), fmt);
+    entry->text[1] = '7';
+    result = unparseJSONWith(&unparser, generic, &output, &length, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(length, strlen(expected));
+    assertNotNull(strstr(output, "[7,2,3,4]"));
+
+    cacheForget(&cache, generic);
+    assertIntegersEqual(cache.size, 0);
+    result = unparseJSONWith(&unparser, generic, &output, &length, fmt);
+    assertStringsEqual(output, expected);
+
+    free(expected);
+    unparserRelease(&unparser);
+    cacheRelease(&cache);
+    genericRelease(generic);
+}
+
+void testJSONCache() {
+    testJSONCacheStoreInvalidate();
+    testJSONCacheFormat();
+    testJSONCacheUnparse();
+}
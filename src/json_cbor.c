@@ -0,0 +1,269 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "json_cbor.h"
+#include "json_binary.h"
+#include "json_buffer.h"
+#include "cutil/src/error.h"
+#include "cutil/src/map/map.h"
+
+#define CBOR_UNSIGNED 0
+#define CBOR_NEGATIVE 1
+#define CBOR_BYTES 2
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_TAG 6
+#define CBOR_SIMPLE 7
+
+#define CBOR_FALSE 20
+#define CBOR_TRUE 21
+#define CBOR_NULL 22
+#define CBOR_FLOAT16 25
+#define CBOR_FLOAT32 26
+#define CBOR_FLOAT64 27
+#define CBOR_INDEFINITE 31
+
+static unsigned int encodeValue(struct JSONBuffer *buffer, struct Generic *generic);
+
+// Major type in the top three bits, argument in the smallest encoding.
+static unsigned int encodeHead(struct JSONBuffer *buffer, unsigned char major, uint64_t argument) {
+    unsigned char type = major << 5;
+    unsigned int bytes;
+    if(argument < 24) return bufferAppendChar(buffer, type | argument);
+    if(argument <= 0xff) {
+        type |= 24;
+        bytes = 1;
+    } else if(argument <= 0xffff) {
+        type |= 25;
+        bytes = 2;
+    } else if(argument <= 0xffffffffUL) {
+        type |= 26;
+        bytes = 4;
+    } else {
+        type |= 27;
+        bytes = 8;
+    }
+    unsigned int result = bufferAppendChar(buffer, type);
+    if(result) return result;
+    return bufferAppendBigEndian(buffer, argument, bytes);
+}
+
+static unsigned int encodeString(struct JSONBuffer *buffer, const char *value) {
+    struct JSONBuffer text;
+    unsigned int result = binaryUnescape(&text, value);
+    if(result) return result;
+    result = encodeHead(buffer, CBOR_TEXT, text.length);
+    if(!result) result = bufferAppend(buffer, text.data, text.length);
+    bufferRelease(&text);
+    return result;
+}
+
+static unsigned int encodeCollection(struct JSONBuffer *buffer, struct Generic *generic) {
+    int isMap = generic->object == &Map.object;
+    struct Collection *collection = (struct Collection*)generic->object;
+
+    // Use definite lengths, they are smaller and simpler to decode.
+    unsigned int count = 0;
+    struct Iterator iterator = collection->iterator(genericData(generic));
+    while(collection->next(&iterator)) count++;
+
+    unsigned int result = encodeHead(buffer, isMap ? CBOR_MAP : CBOR_ARRAY, count);
+    if(result) return result;
+
+    iterator = collection->iterator(genericData(generic));
+    while(1) {
+        const char *key = isMap ? mapKey(&iterator) : NULL;
+        struct Generic *element = collection->next(&iterator);
+        if(!element) break;
+        if(key) {
+            result = encodeString(buffer, key);
+            if(result) return result;
+        }
+        result = encodeValue(buffer, element);
+        if(result) return result;
+    }
+    return STATUS_OK;
+}
+
+static unsigned int encodeValue(struct JSONBuffer *buffer, struct Generic *generic) {
+    if(generic->object == &Map.object || generic->object == &Array.object) {
+        return encodeCollection(buffer, generic);
+    } else if(generic->object == &String) {
+        return encodeString(buffer, *((char**)genericData(generic)));
+    } else if(generic->object == &Integer) {
+        long value = *((long*)genericData(generic));
+        if(value >= 0) return encodeHead(buffer, CBOR_UNSIGNED, value);
+        return encodeHead(buffer, CBOR_NEGATIVE, -1 - value);
+    } else if(generic->object == &Float) {
+        float value = *((float*)genericData(generic));
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        unsigned int result = bufferAppendChar(buffer, (char)(CBOR_SIMPLE << 5 | CBOR_FLOAT32));
+        if(result) return result;
+        return bufferAppendBigEndian(buffer, bits, 4);
+    } else if(generic->object == &Boolean) {
+        char boolValue = *((char*)genericData(generic));
+        return bufferAppendChar(buffer, (char)(CBOR_SIMPLE << 5 | (boolValue ? CBOR_TRUE : CBOR_FALSE)));
+    } else if(generic->object == &Pointer) {
+        if(*((void**)genericData(generic)) != NULL) return STATUS_INPUT_ERR;
+        return bufferAppendChar(buffer, (char)(CBOR_SIMPLE << 5 | CBOR_NULL));
+    }
+    return STATUS_INPUT_ERR;
+}
+
+unsigned int encodeCBOR(
+        struct Generic *generic,
+        char **output,
+        unsigned int *outputLength) {
+    struct JSONBuffer buffer;
+    bufferCompose(&buffer);
+
+    unsigned int result = encodeValue(&buffer, generic);
+    if(result) {
+        bufferRelease(&buffer);
+        return result;
+    }
+
+    *output = bufferDetach(&buffer, outputLength);
+    if(!*output) return STATUS_ALLOC_ERR;
+    return STATUS_OK;
+}
+
+static unsigned int readHead(struct JSONBinaryReader *reader, unsigned char *major, unsigned char *minor, uint64_t *argument) {
+    if(reader->offset >= reader->length) return STATUS_PARSE_ERR;
+    unsigned char type = reader->data[reader->offset++];
+    *major = type >> 5;
+    *minor = type & 0x1f;
+    if(*minor < 24) {
+        *argument = *minor;
+        return STATUS_OK;
+    }
+    switch(*minor) {
+        case 24: return binaryReadBigEndian(reader, argument, 1);
+        case 25: return binaryReadBigEndian(reader, argument, 2);
+        case 26: return binaryReadBigEndian(reader, argument, 4);
+        case 27: return binaryReadBigEndian(reader, argument, 8);
+        // Indefinite lengths and reserved values are not supported.
+        default: return STATUS_PARSE_ERR;
+    }
+}
+
+static unsigned int decodeText(char **value, struct JSONBinaryReader *reader) {
+    unsigned char major;
+    unsigned char minor;
+    uint64_t length;
+    unsigned int result = readHead(reader, &major, &minor, &length);
+    if(result) return result;
+    if(major != CBOR_TEXT) return STATUS_PARSE_ERR;
+    return binaryReadString(reader, value, length);
+}
+
+static double decodeHalf(uint16_t half) {
+    int exponent = (half >> 10) & 0x1f;
+    double mantissa = half & 0x3ff;
+    double value;
+    if(exponent == 0) {
+        value = mantissa / (1 << 24);
+    } else if(exponent == 31) {
+        value = mantissa == 0 ? INFINITY : NAN;
+    } else {
+        value = (1024 + mantissa) / 1024;
+        for(; exponent > 15; exponent--) value *= 2;
+        for(; exponent < 15; exponent++) value /= 2;
+    }
+    return half & 0x8000 ? -value : value;
+}
+
+static unsigned int decodeValue(struct Generic **generic, struct JSONBinaryReader *reader) {
+    if(reader->offset >= reader->length) return STATUS_PARSE_ERR;
+    unsigned char type = reader->data[reader->offset];
+    if(type >> 5 == CBOR_TEXT) {
+        char *value;
+        unsigned int result = decodeText(&value, reader);
+        if(result) return result;
+        *generic = genericCompose(&String);
+        if(!*generic) {
+            free(value);
+            return STATUS_ALLOC_ERR;
+        }
+        *((char**)genericData(*generic)) = value;
+        return STATUS_OK;
+    }
+
+    unsigned char major;
+    unsigned char minor;
+    uint64_t argument;
+    unsigned int result = readHead(reader, &major, &minor, &argument);
+    if(result) return result;
+
+    switch(major) {
+        case CBOR_UNSIGNED:
+        case CBOR_NEGATIVE:
+            return binaryDecodeInteger(generic, argument, major == CBOR_NEGATIVE);
+        case CBOR_ARRAY:
+        case CBOR_MAP:
+            return binaryDecodeCollection(
+                generic, reader, major == CBOR_MAP, argument, decodeText, decodeValue);
+        case CBOR_TAG:
+            // Tags only annotate the following item, but nest like one.
+            if(reader->depth == JSON_BINARY_MAX_DEPTH) return STATUS_PARSE_ERR;
+            reader->depth++;
+            result = decodeValue(generic, reader);
+            reader->depth--;
+            return result;
+        case CBOR_SIMPLE:
+            break;
+        default:
+            // Byte strings have no Generic equivalent.
+            return STATUS_PARSE_ERR;
+    }
+
+    double floatValue;
+    switch(minor) {
+        case CBOR_FALSE:
+        case CBOR_TRUE:
+            *generic = genericCompose(&Boolean);
+            if(!*generic) return STATUS_ALLOC_ERR;
+            *((char*)genericData(*generic)) = minor == CBOR_TRUE;
+            return STATUS_OK;
+        case CBOR_NULL:
+            *generic = genericCompose(&Pointer);
+            if(!*generic) return STATUS_ALLOC_ERR;
+            *((void**)genericData(*generic)) = NULL;
+            return STATUS_OK;
+        case CBOR_FLOAT16:
+            floatValue = decodeHalf(argument);
+            break;
+        case CBOR_FLOAT32: {
+            uint32_t bits = argument;
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            floatValue = value;
+            break;
+        }
+        case CBOR_FLOAT64:
+            memcpy(&floatValue, &argument, sizeof(floatValue));
+            break;
+        default:
+            return STATUS_PARSE_ERR;
+    }
+    return binaryDecodeFloat(generic, floatValue);
+}
+
+unsigned int decodeCBOR(
+        struct Generic **generic,
+        const char *input,
+        unsigned int inputLength) {
+    *generic = NULL;
+    struct JSONBinaryReader reader;
+    binaryReaderCompose(&reader, input, inputLength);
+    unsigned int result = decodeValue(generic, &reader);
+    if(result == STATUS_OK && reader.offset != reader.length) {
+        // Garbage followed a valid value.
+        genericRelease(*generic);
+        *generic = NULL;
+        result = STATUS_PARSE_ERR;
+    }
+    return result;
+}
@@ -0,0 +1,22 @@
+#ifndef __JSON_CBOR_H
+#define __JSON_CBOR_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include "cutil/src/generic/generic.h"
+
+unsigned int encodeCBOR(
+    struct Generic *generic,
+    char **output,
+    unsigned int *outputLength);
+
+unsigned int decodeCBOR(
+    struct Generic **generic,
+    const char *input,
+    unsigned int inputLength);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_codec.h"
+#include "cutil/src/error.h"
+
+unsigned int encoderCompose(
+        struct JSONEncoder *encoder,
+        struct JSONCodec *codec,
+        unsigned int (*sink)(void *context, const char *data, unsigned int length),
+        void *context) {
+    encoder->codec = codec;
+    encoder->sink = sink;
+    encoder->sinkContext = context;
+    encoder->blockLength = 0;
+    encoder->block = malloc(JSON_CODEC_BLOCK);
+    encoder->output = malloc(JSON_CODEC_BLOCK);
+    if(encoder->block == NULL || encoder->output == NULL) {
+        encoderRelease(encoder);
+        return STATUS_ALLOC_ERR;
+    }
+    return STATUS_OK;
+}
+
+void encoderRelease(struct JSONEncoder *encoder) {
+    free(encoder->block);
+    free(encoder->output);
+    encoder->block = NULL;
+    encoder->output = NULL;
+}
+
+// Run the pending block through the codec, to the end when finishing.
+static unsigned int encoderFlush(struct JSONEncoder *encoder, int finish) {
+    const char *input = encoder->block;
+    const char *inputEnd = encoder->block + encoder->blockLength;
+    int done = 0;
+    while(input < inputEnd || (finish && !done)) {
+        const char *consumed = input;
+        char *output = encoder->output;
+        unsigned int result = encoder->codec->process(
+            encoder->codec->state,
+            &input,
+            inputEnd,
+            &output,
+            encoder->output + JSON_CODEC_BLOCK,
+            finish,
+            &done);
+        if(result) return result;
+        if(output > encoder->output) {
+            result = encoder->sink(encoder->sinkContext, encoder->output, output - encoder->output);
+            if(result) return result;
+        } else if(input == consumed && !done) {
+            // The codec is stuck.
+            return STATUS_INPUT_ERR;
+        }
+    }
+    encoder->blockLength = 0;
+    return STATUS_OK;
+}
+
+unsigned int encoderWrite(void *context, const char *data, unsigned int length) {
+    struct JSONEncoder *encoder = context;
+    while(length) {
+        unsigned int count = JSON_CODEC_BLOCK - encoder->blockLength;
+        if(count > length) count = length;
+        memcpy(encoder->block + encoder->blockLength, data, count);
+        encoder->blockLength += count;
+        data += count;
+        length -= count;
+        if(encoder->blockLength == JSON_CODEC_BLOCK) {
+            unsigned int result = encoderFlush(encoder, 0);
+            if(result) return result;
+        }
+    }
+    return STATUS_OK;
+}
+
+unsigned int encoderFinish(struct JSONEncoder *encoder) {
+    return encoderFlush(encoder, 1);
+}
+
+unsigned int decoderCompose(
+        struct JSONDecoder *decoder,
+        struct JSONCodec *codec,
+        unsigned int (*source)(void *context, char *data, unsigned int capacity, unsigned int *length),
+        void *context) {
+    decoder->codec = codec;
+    decoder->source = source;
+    decoder->sourceContext = context;
+    decoder->start = 0;
+    decoder->end = 0;
+    decoder->eof = 0;
+    decoder->done = 0;
+    decoder->block = malloc(JSON_CODEC_BLOCK);
+    if(decoder->block == NULL) return STATUS_ALLOC_ERR;
+    return STATUS_OK;
+}
+
+void decoderRelease(struct JSONDecoder *decoder) {
+    free(decoder->block);
+    decoder->block = NULL;
+}
+
+unsigned int decoderRead(void *context, char *data, unsigned int capacity, unsigned int *length) {
+    struct JSONDecoder *decoder = context;
+    *length = 0;
+    while(*length == 0 && !decoder->done && capacity) {
+        if(decoder->start == decoder->end && !decoder->eof) {
+            unsigned int count;
+            unsigned int result = decoder->source(decoder->sourceContext, decoder->block, JSON_CODEC_BLOCK, &count);
+            if(result) return result;
+            decoder->start = 0;
+            decoder->end = count;
+            decoder->eof = count == 0;
+        }
+
+        const char *input = decoder->block + decoder->start;
+        char *output = data;
+        int done = 0;
+        unsigned int result = decoder->codec->process(
+            decoder->codec->state,
+            &input,
+            decoder->block + decoder->end,
+            &output,
+            data + capacity,
+            decoder->eof,
+            &done);
+        if(result) return result;
+
+        unsigned int consumed = input - (decoder->block + decoder->start);
+        decoder->start += consumed;
+        decoder->done = done;
+        *length = output - data;
+        // Without progress at the end of the input it was cut short.
+        if(!*length && !done && !consumed && (decoder->eof || decoder->start < decoder->end)) {
+            return STATUS_PARSE_ERR;
+        }
+    }
+    return STATUS_OK;
+}
+
+unsigned int parseJSONCompressedWith(
+        struct JSONParser *parser,
+        struct Generic **generic,
+        struct JSONCodec *codec,
+        unsigned int (*source)(void *context, char *data, unsigned int capacity, unsigned int *length),
+        void *context) {
+    *generic = NULL;
+    struct JSONDecoder decoder;
+    unsigned int result = decoderCompose(&decoder, codec, source, context);
+    if(result) return result;
+
+    bufferClear(&parser->text);
+    unsigned int length = 1;
+    while(!result && length) {
+        result = bufferReserve(&parser->text, JSON_CODEC_BLOCK);
+        if(!result) result = decoderRead(&decoder, parser->text.data + parser->text.length, JSON_CODEC_BLOCK, &length);
+        if(!result) parser->text.length += length;
+    }
+    decoderRelease(&decoder);
+    if(!result) result = bufferTerminate(&parser->text);
+    if(result) return result;
+    // A raw null would cut the document short.
+    if(strlen(parser->text.data) != parser->text.length) return STATUS_PARSE_ERR;
+
+    return parseJSONWith(parser, generic, parser->text.data);
+}
+
+unsigned int parseJSONCompressed(
+        struct Generic **generic,
+        struct JSONCodec *codec,
+        unsigned int (*source)(void *context, char *data, unsigned int capacity, unsigned int *length),
+        void *context) {
+    struct JSONParser parser;
+    parserCompose(&parser);
+    unsigned int result = parseJSONCompressedWith(&parser, generic, codec, source, context);
+    parserRelease(&parser);
+    return result;
+}
+
+unsigned int unparseJSONCompressed(
+        struct Generic *generic,
+        struct JSONCodec *codec,
+        unsigned int (*sink)(void *context, const char *data, unsigned int length),
+        void *context,
+        struct JSONFormat fmt) {
+    struct JSONEncoder encoder;
+    unsigned int result = encoderCompose(&encoder, codec, sink, context);
+    if(result) return result;
+
+    struct JSONUnparser unparser = {.cache = NULL};
+    bufferComposeSink(&unparser.buffer, encoderWrite, &encoder);
+    const char *data;
+    unsigned int length;
+    result = unparseJSONWith(&unparser, generic, &data, &length, fmt);
+    if(!result) result = encoderFinish(&encoder);
+    encoderRelease(&encoder);
+    return result;
+}
@@ -0,0 +1,103 @@
+#ifndef __JSON_CODEC_H
+#define __JSON_CODEC_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include "json_parser.h"
+#include "json_unparser.h"
+
+// Size of the blocks handed to codecs.
+#define JSON_CODEC_BLOCK 65536
+
+// Streaming compressor or decompressor in the style of zlib's deflate and
+// inflate, so gzip or zstd plug in with a thin wrapper. process consumes
+// what it can of the input and produces what it can of the output,
+// advancing both pointers. Input that is not consumed is only allowed when
+// the output is full, partial units are kept in state. finish marks the
+// end of the input, *done is set once nothing more will be produced.
+// STATUS_PARSE_ERR for corrupt data.
+struct JSONCodec {
+    unsigned int (*process)(
+        void *state,
+        const char **input,
+        const char *inputEnd,
+        char **output,
+        char *outputEnd,
+        int finish,
+        int *done);
+    void *state;
+};
+
+// Collects what is written to it into blocks for the codec and hands the
+// codec's output to sink.
+struct JSONEncoder {
+    struct JSONCodec *codec;
+    unsigned int (*sink)(void *context, const char *data, unsigned int length);
+    void *sinkContext;
+    char *block;
+    unsigned int blockLength;
+    char *output;
+};
+
+unsigned int encoderCompose(
+    struct JSONEncoder *encoder,
+    struct JSONCodec *codec,
+    unsigned int (*sink)(void *context, const char *data, unsigned int length),
+    void *context);
+void encoderRelease(struct JSONEncoder *encoder);
+// A buffer sink, see bufferComposeSink.
+unsigned int encoderWrite(void *encoder, const char *data, unsigned int length);
+// Compress what is left and flush the codec.
+unsigned int encoderFinish(struct JSONEncoder *encoder);
+
+// Reads compressed input from source a block at a time, itself a source
+// for JSONStream.
+struct JSONDecoder {
+    struct JSONCodec *codec;
+    unsigned int (*source)(void *context, char *data, unsigned int capacity, unsigned int *length);
+    void *sourceContext;
+    char *block;
+    unsigned int start;
+    unsigned int end;
+    unsigned char eof;
+    unsigned char done;
+};
+
+unsigned int decoderCompose(
+    struct JSONDecoder *decoder,
+    struct JSONCodec *codec,
+    unsigned int (*source)(void *context, char *data, unsigned int capacity, unsigned int *length),
+    void *context);
+void decoderRelease(struct JSONDecoder *decoder);
+// STATUS_PARSE_ERR when the compressed input ends early.
+unsigned int decoderRead(void *decoder, char *data, unsigned int capacity, unsigned int *length);
+
+// Decompressed block by block into the parser's text, then parsed as a
+// whole: only a block of compressed input is held at a time, but the
+// plain document is held entire. Use a JSONStream reading from a
+// JSONDecoder for memory bounded by its window.
+unsigned int parseJSONCompressed(
+    struct Generic **generic,
+    struct JSONCodec *codec,
+    unsigned int (*source)(void *context, char *data, unsigned int capacity, unsigned int *length),
+    void *context);
+unsigned int parseJSONCompressedWith(
+    struct JSONParser *parser,
+    struct Generic **generic,
+    struct JSONCodec *codec,
+    unsigned int (*source)(void *context, char *data, unsigned int capacity, unsigned int *length),
+    void *context);
+
+// Serialized straight into the codec, the plain text is never held whole.
+unsigned int unparseJSONCompressed(
+    struct Generic *generic,
+    struct JSONCodec *codec,
+    unsigned int (*sink)(void *context, const char *data, unsigned int length),
+    void *context,
+    struct JSONFormat fmt);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
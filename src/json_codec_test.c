@@ -0,0 +1,195 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_codec.h"
+#include "json_stream.h"
+#include "json_patch.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+// Run length coding as (count, byte) pairs, enough to exercise partial
+// input and output the way a real codec would.
+struct TestRuns {
+    unsigned char count;
+    char value;
+    unsigned char pending;
+    unsigned char haveCount;
+};
+
+static unsigned int testRunsEncode(
+        void *state,
+        const char **input,
+        const char *inputEnd,
+        char **output,
+        char *outputEnd,
+        int finish,
+        int *done) {
+    struct TestRuns *runs = state;
+    while(1) {
+        // A finished run is written once there is room for the pair.
+        if(runs->pending) {
+            if(outputEnd - *output < 2) return STATUS_OK;
+            *(*output)++ = runs->count;
+            *(*output)++ = runs->value;
+            runs->pending = 0;
+            runs->count = 0;
+        }
+        if(*input == inputEnd) {
+            if(finish && runs->count) {
+                runs->pending = 1;
+                continue;
+            }
+            *done = finish;
+            return STATUS_OK;
+        }
+        if(runs->count && (**input != runs->value || runs->count == 255)) {
+            runs->pending = 1;
+            continue;
+        }
+        runs->value = *(*input)++;
+        runs->count++;
+    }
+}
+
+static unsigned int testRunsDecode(
+        void *state,
+        const char **input,
+        const char *inputEnd,
+        char **output,
+        char *outputEnd,
+        int finish,
+        int *done) {
+    struct TestRuns *runs = state;
+    while(1) {
+        while(runs->pending && *output < outputEnd) {
+            *(*output)++ = runs->value;
+            runs->pending--;
+        }
+        if(runs->pending) return STATUS_OK;
+        if(*input == inputEnd) {
+            if(finish && runs->haveCount) return STATUS_PARSE_ERR;
+            *done = finish;
+            return STATUS_OK;
+        }
+        if(!runs->haveCount) {
+            runs->count = *(*input)++;
+            if(runs->count == 0) return STATUS_PARSE_ERR;
+            runs->haveCount = 1;
+        } else {
+            runs->value = *(*input)++;
+            runs->pending = runs->count;
+            runs->haveCount = 0;
+        }
+    }
+}
+
+// Hands out a few bytes at a time.
+struct TestSource {
+    const char *data;
+    unsigned int length;
+    unsigned int position;
+};
+
+static unsigned int testSourceRead(void *context, char *data, unsigned int capacity, unsigned int *length) {
+    struct TestSource *source = context;
+    unsigned int count = source->length - source->position;
+    if(count > 7) count = 7;
+    if(count > capacity) count = capacity;
+    memcpy(data, source->data + source->position, count);
+    source->position += count;
+    *length = count;
+    return STATUS_OK;
+}
+
+static unsigned int testBufferSink(void *context, const char *data, unsigned int length) {
+    return bufferAppend(context, data, length);
+}
+
+static const char *testCodecInput =
+    "{\"padding\": \"                                                                                                                                \","
+    " \"values\": [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16]}";
+
+void testJSONCodecRoundTrip() {
+    struct Generic *generic;
+    char input[256];
+    strcpy(input, testCodecInput);
+    assertIntegersEqual(parseJSON(&generic, input), STATUS_OK);
+
+    struct TestRuns encodeState = {0, 0, 0, 0};
+    struct JSONCodec encode = {testRunsEncode, &encodeState};
+    struct JSONBuffer compressed;
+    bufferCompose(&compressed);
+    struct JSONFormat fmt = {0, 0, 0};
+    unsigned int result = unparseJSONCompressed(generic, &encode, testBufferSink, &compressed, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+
+    // The run of spaces shrinks to one pair.
+    assertIntegersEqual(compressed.length < strlen(input), 1);
+
+    struct TestRuns decodeState = {0, 0, 0, 0};
+    struct JSONCodec decode = {testRunsDecode, &decodeState};
+    struct TestSource source = {compressed.data, compressed.length, 0};
+    struct Generic *decoded;
+    result = parseJSONCompressed(&decoded, &decode, testSourceRead, &source);
+    assertIntegersEqual(result, STATUS_OK);
+
+    assertIntegersEqual(jsonEquals(decoded, generic), 1);
+
+    bufferRelease(&compressed);
+    genericRelease(decoded);
+    genericRelease(generic);
+}
+
+void testJSONCodecStream() {
+    // Encode by hand through a sink buffer, then read events while
+    // decompressing.
+    struct TestRuns encodeState = {0, 0, 0, 0};
+    struct JSONCodec encode = {testRunsEncode, &encodeState};
+    struct JSONBuffer compressed;
+    bufferCompose(&compressed);
+    struct JSONEncoder encoder;
+    assertIntegersEqual(encoderCompose(&encoder, &encode, testBufferSink, &compressed), STATUS_OK);
+    struct JSONBuffer sink;
+    bufferComposeSink(&sink, encoderWrite, &encoder);
+    assertIntegersEqual(bufferAppendString(&sink, testCodecInput), STATUS_OK);
+    assertIntegersEqual(encoderFinish(&encoder), STATUS_OK);
+    encoderRelease(&encoder);
+
+    struct TestRuns decodeState = {0, 0, 0, 0};
+    struct JSONCodec decode = {testRunsDecode, &decodeState};
+    struct TestSource source = {compressed.data, compressed.length, 0};
+    struct JSONDecoder decoder;
+    assertIntegersEqual(decoderCompose(&decoder, &decode, testSourceRead, &source), STATUS_OK);
+    struct JSONStream stream;
+    assertIntegersEqual(streamComposeSource(&stream, decoderRead, &decoder, 256), STATUS_OK);
+
+    struct JSONEvent event;
+    unsigned int result;
+    unsigned int numbers = 0;
+    while(!(result = streamNext(&stream, &event)) && event.type != JSON_EVENT_END) {
+        numbers += event.type == JSON_EVENT_NUMBER;
+    }
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(numbers, 16);
+
+    streamRelease(&stream);
+    decoderRelease(&decoder);
+    bufferRelease(&compressed);
+}
+
+void testJSONCodecTruncated() {
+    // A count without its byte.
+    char compressed[] = {3, '[', 1, ']', 2};
+    struct TestRuns decodeState = {0, 0, 0, 0};
+    struct JSONCodec decode = {testRunsDecode, &decodeState};
+    struct TestSource source = {compressed, sizeof(compressed), 0};
+    struct Generic *generic;
+    unsigned int result = parseJSONCompressed(&generic, &decode, testSourceRead, &source);
+    assertIntegersEqual(result, STATUS_PARSE_ERR);
+    assertIsNull(generic);
+}
+
+void testJSONCodec() {
+    testJSONCodecRoundTrip();
+    testJSONCodecStream();
+    testJSONCodecTruncated();
+}
@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json.h"
+#include "json_columns.h"
+#include "json_lexer.h"
+#include "json_number.h"
+#include "cutil/src/error.h"
+
+static size_t columnWidth(const struct JSONColumn *column) {
+    switch(column->type) {
+        case JSON_COLUMN_INT64: return sizeof(int64_t);
+        case JSON_COLUMN_DOUBLE: return sizeof(double);
+        case JSON_COLUMN_BOOLEAN: return sizeof(unsigned char);
+        default: return sizeof(uint32_t);
+    }
+}
+
+static int isSymbol(const struct JSONToken *token, char symbol) {
+    return token->lexeme && token->token == JSON_TOKEN_SYMBOL && *token->lexeme == symbol;
+}
+
+static unsigned int columnGrow(struct JSONColumn *column, unsigned int capacity) {
+    // String offsets need one more slot than there are rows.
+    size_t slots = capacity + (column->type == JSON_COLUMN_STRING);
+    void *values = realloc(column->values, slots * columnWidth(column));
+    if(values == NULL) return STATUS_ALLOC_ERR;
+    column->values = values;
+    unsigned char *validity = realloc(column->validity, (capacity + 7) / 8);
+    if(validity == NULL) return STATUS_ALLOC_ERR;
+    column->validity = validity;
+    column->capacity = capacity;
+    return STATUS_OK;
+}
+
+// Row starts out null, values are filled in as members are read.
+static unsigned int columnsAddRow(struct JSONColumn *columns, unsigned int columnCount, unsigned int row) {
+    for(unsigned int i = 0; i < columnCount; i++) {
+        struct JSONColumn *column = &columns[i];
+        if(row >= column->capacity) {
+            unsigned int result = columnGrow(column, column->capacity ? column->capacity * 2 : 64);
+            if(result) return result;
+        }
+        if(row % 8 == 0) column->validity[row / 8] = 0;
+        switch(column->type) {
+            case JSON_COLUMN_INT64: ((int64_t*)column->values)[row] = 0; break;
+            case JSON_COLUMN_DOUBLE: ((double*)column->values)[row] = 0; break;
+            case JSON_COLUMN_BOOLEAN: ((unsigned char*)column->values)[row] = 0; break;
+            case JSON_COLUMN_STRING: ((uint32_t*)column->values)[row + 1] = column->dataLength; break;
+        }
+    }
+    return STATUS_OK;
+}
+
+static unsigned int columnAppendData(struct JSONColumn *column, const char *data, uint32_t length) {
+    if(length > UINT32_MAX - column->dataLength) return STATUS_ALLOC_ERR;
+    if(column->dataLength + length > column->dataCapacity) {
+        uint32_t capacity = column->dataCapacity ? column->dataCapacity : 256;
+        while(capacity < column->dataLength + length) {
+            capacity = capacity > UINT32_MAX / 2 ? UINT32_MAX : capacity * 2;
+        }
+        char *grown = realloc(column->data, capacity);
+        if(grown == NULL) return STATUS_ALLOC_ERR;
+        column->data = grown;
+        column->dataCapacity = capacity;
+    }
+    memcpy(column->data + column->dataLength, data, length);
+    column->dataLength += length;
+    return STATUS_OK;
+}
+
+static unsigned int columnSet(
+        struct JSONColumn *column,
+        unsigned int row,
+        const struct JSONToken *token,
+        unsigned int length) {
+    if(token->token == JSON_TOKEN_NULL) return STATUS_OK;
+    struct JSONNumber number;
+    switch(column->type) {
+        case JSON_COLUMN_INT64:
+        case JSON_COLUMN_DOUBLE:
+            if(token->token != JSON_TOKEN_NUMBER) return STATUS_PARSE_ERR;
+            if(numberCompose(&number, token->lexeme) || number.length != length) return STATUS_PARSE_ERR;
+            if(column->type == JSON_COLUMN_DOUBLE) {
+                ((double*)column->values)[row] = numberDouble(&number);
+            } else if(numberInteger(&number, &((int64_t*)column->values)[row])) {
+                return STATUS_PARSE_ERR;
+            }
+            break;
+        case JSON_COLUMN_BOOLEAN:
+            if(token->token != JSON_TOKEN_BOOL) return STATUS_PARSE_ERR;
+            ((unsigned char*)column->values)[row] = *token->lexeme == 't';
+            break;
+        case JSON_COLUMN_STRING: {
+            if(token->token != JSON_TOKEN_STRING) return STATUS_PARSE_ERR;
+            unsigned int result = columnAppendData(column, token->lexeme + 1, length - 2);
+            if(result) return result;
+            ((uint32_t*)column->values)[row + 1] = column->dataLength;
+            break;
+        }
+    }
+    column->validity[row / 8] |= 1 << (row % 8);
+    return STATUS_OK;
+}
+
+static struct JSONColumn *columnFind(
+        struct JSONColumn *columns,
+        unsigned int columnCount,
+        const char *key,
+        unsigned int keyLength) {
+    for(unsigned int i = 0; i < columnCount; i++) {
+        if(strncmp(columns[i].name, key, keyLength) == 0 && columns[i].name[keyLength] == '\0') {
+            return &columns[i];
+        }
+    }
+    return NULL;
+}
+
+static unsigned int parseRow(
+        struct JSONReader *reader,
+        struct JSONColumn *columns,
+        unsigned int columnCount,
+        unsigned int row,
+        unsigned char *seen) {
+    struct JSONToken token;
+    unsigned int length;
+    memset(seen, 0, columnCount);
+    unsigned int result = readerNext(reader, &token, &length);
+    if(result) return result;
+    if(isSymbol(&token, JSON_MAP_CLOSE)) return STATUS_OK;
+
+    while(1) {
+        if(!token.lexeme || token.token != JSON_TOKEN_STRING) return STATUS_PARSE_ERR;
+        struct JSONColumn *column = columnFind(columns, columnCount, token.lexeme + 1, length - 2);
+        result = readerNext(reader, &token, &length);
+        if(result) return result;
+        if(!isSymbol(&token, JSON_MEMBER_SEP)) return STATUS_PARSE_ERR;
+        result = readerNext(reader, &token, &length);
+        if(result) return result;
+        if(!token.lexeme) return STATUS_PARSE_ERR;
+
+        if(column) {
+            if(seen[column - columns]) return STATUS_PARSE_ERR;
+            seen[column - columns] = 1;
+            result = columnSet(column, row, &token, length);
+        } else {
+            result = readerSkip(reader, &token);
+        }
+        if(result) return result;
+
+        result = readerNext(reader, &token, &length);
+        if(result) return result;
+        if(isSymbol(&token, JSON_MAP_CLOSE)) return STATUS_OK;
+        if(!isSymbol(&token, JSON_SEPERATOR)) return STATUS_PARSE_ERR;
+        result = readerNext(reader, &token, &length);
+        if(result) return result;
+    }
+}
+
+unsigned int parseJSONColumns(
+        struct JSONColumn *columns,
+        unsigned int columnCount,
+        unsigned int *rows,
+        char *toCheck) {
+    *rows = 0;
+    for(unsigned int i = 0; i < columnCount; i++) {
+        columns[i].dataLength = 0;
+        if(columns[i].type == JSON_COLUMN_STRING) {
+            if(!columns[i].capacity && columnGrow(&columns[i], 64)) return STATUS_ALLOC_ERR;
+            ((uint32_t*)columns[i].values)[0] = 0;
+        }
+    }
+    unsigned char *seen = malloc(columnCount ? columnCount : 1);
+    if(seen == NULL) return STATUS_ALLOC_ERR;
+
+    struct JSONReader reader;
+    readerCompose(&reader, toCheck);
+    struct JSONToken token;
+    unsigned int length;
+    unsigned int result = readerNext(&reader, &token, &length);
+    if(!result && !isSymbol(&token, JSON_ARR_BEGIN)) result = STATUS_PARSE_ERR;
+    if(!result) result = readerNext(&reader, &token, &length);
+    if(!result && !isSymbol(&token, JSON_ARR_CLOSE)) {
+        while(!result) {
+            if(!isSymbol(&token, JSON_MAP_BEGIN)) {
+                result = STATUS_PARSE_ERR;
+                break;
+            }
+            result = columnsAddRow(columns, columnCount, *rows);
+            if(!result) result = parseRow(&reader, columns, columnCount, *rows, seen);
+            if(result) break;
+            (*rows)++;
+
+            result = readerNext(&reader, &token, &length);
+            if(result || isSymbol(&token, JSON_ARR_CLOSE)) break;
+            if(!isSymbol(&token, JSON_SEPERATOR)) result = STATUS_PARSE_ERR;
+            if(!result) result = readerNext(&reader, &token, &length);
+        }
+    }
+    free(seen);
+    if(result) return result;
+
+    // Nothing may follow the array.
+    result = readerNext(&reader, &token, &length);
+    if(!result && token.lexeme) result = STATUS_PARSE_ERR;
+    return result;
+}
+
+void columnsRelease(struct JSONColumn *columns, unsigned int columnCount) {
+    for(unsigned int i = 0; i < columnCount; i++) {
+        free(columns[i].values);
+        free(columns[i].data);
+        free(columns[i].validity);
+        columns[i].values = NULL;
+        columns[i].data = NULL;
+        columns[i].dataLength = 0;
+        columns[i].dataCapacity = 0;
+        columns[i].validity = NULL;
+        columns[i].capacity = 0;
+    }
+}
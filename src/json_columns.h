@@ -0,0 +1,52 @@
+#ifndef __JSON_COLUMNS_H
+#define __JSON_COLUMNS_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stdint.h>
+
+enum JSON_COLUMN {
+    JSON_COLUMN_INT64,   // int64_t per row.
+    JSON_COLUMN_DOUBLE,  // double per row, from any number.
+    JSON_COLUMN_BOOLEAN, // unsigned char per row.
+    JSON_COLUMN_STRING   // Row i is data[offsets[i]..offsets[i + 1]), as
+                         // written without quotation marks.
+};
+
+// One member of the records pulled into contiguous storage. Only name and
+// type are set by the caller, the rest is zero initialised and kept for
+// reuse between calls.
+struct JSONColumn {
+    const char *name;
+    enum JSON_COLUMN type;
+    // int64_t, double or unsigned char per row, or rows + 1 uint32_t
+    // string offsets.
+    void *values;
+    char *data;
+    uint32_t dataLength;
+    uint32_t dataCapacity;
+    // Bit i % 8 of byte i / 8 is set when row i has a value, rows with null
+    // or no member have it clear and a zero value or empty string.
+    unsigned char *validity;
+    unsigned int capacity;
+};
+
+// Read an array of objects straight into columns, one row per object,
+// without building records. Other members are skipped but still checked
+// like the rest of the input, a value of the wrong type or a member
+// repeated within a record is a STATUS_PARSE_ERR.
+// On failure rows counts the records completed and the columns should
+// still be passed to columnsRelease.
+unsigned int parseJSONColumns(
+    struct JSONColumn *columns,
+    unsigned int columnCount,
+    unsigned int *rows,
+    char *toCheck);
+
+void columnsRelease(struct JSONColumn *columns, unsigned int columnCount);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
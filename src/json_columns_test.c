@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json_columns.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+static int columnValid(const struct JSONColumn *column, unsigned int row) {
+    return (column->validity[row / 8] >> (row % 8)) & 1;
+}
+
+void testJSONColumnsParse() {
+    char input[] = "["
+        "{\"id\": 1, \"price\": 2.5, \"name\": \"ab\", \"ok\": true, \"extra\": {\"x\": [1]}},"
+        "{\"name\": \"\", \"id\": -7, \"price\": 3, \"ok\": null},"
+        "{},"
+        "{\"id\": 9223372036854775807, \"name\": \"c\\\"d\", \"ok\": false}"
+    "]";
+    struct JSONColumn columns[] = {
+        {"id", JSON_COLUMN_INT64},
+        {"price", JSON_COLUMN_DOUBLE},
+        {"name", JSON_COLUMN_STRING},
+        {"ok", JSON_COLUMN_BOOLEAN}
+    };
+    unsigned int rows;
+    assertIntegersEqual(parseJSONColumns(columns, 4, &rows, input), STATUS_OK);
+    assertIntegersEqual(rows, 4);
+
+    const int64_t *ids = columns[0].values;
+    assertIntegersEqual(ids[0], 1);
+    assertIntegersEqual(ids[1], -7);
+    assertIntegersEqual(ids[2], 0);
+    assertIntegersEqual(ids[3] == INT64_MAX, 1);
+    assertIntegersEqual(columnValid(&columns[0], 2), 0);
+
+    const double *prices = columns[1].values;
+    assertFloatsEqual(prices[0], 2.5);
+    assertFloatsEqual(prices[1], 3.0);
+    assertIntegersEqual(columnValid(&columns[1], 3), 0);
+
+    const uint32_t *offsets = columns[2].values;
+    assertIntegersEqual(offsets[0], 0);
+    assertIntegersEqual(offsets[1], 2);
+    assertIntegersEqual(offsets[2], 2);
+    assertIntegersEqual(offsets[3], 2);
+    assertIntegersEqual(offsets[4], 6);
+    assertIntegersEqual(strncmp(columns[2].data, "abc\\\"d", 6), 0);
+    // An empty string has a value, a missing one does not.
+    assertIntegersEqual(columnValid(&columns[2], 1), 1);
+    assertIntegersEqual(columnValid(&columns[2], 2), 0);
+
+    const unsigned char *oks = columns[3].values;
+    assertIntegersEqual(oks[0], 1);
+    assertIntegersEqual(columnValid(&columns[3], 1), 0);
+    assertIntegersEqual(oks[3], 0);
+    assertIntegersEqual(columnValid(&columns[3], 3), 1);
+
+    // Storage is reused by the next call.
+    char empty[] = " [ ] ";
+    assertIntegersEqual(parseJSONColumns(columns, 4, &rows, empty), STATUS_OK);
+    assertIntegersEqual(rows, 0);
+    assertIntegersEqual(columns[2].dataLength, 0);
+    columnsRelease(columns, 4);
+    assertIsNull(columns[0].values);
+}
+
+void testJSONColumnsGrow() {
+    char *input = malloc(64 * 1024);
+    unsigned int length = 0;
+    input[length++] = '[';
+    for(unsigned int i = 0; i < 1000; i++) {
+        length += sprintf(input + length, "%s{\"n\": %u, \"s\": \"v%u\"}", i ? "," : "", i, i % 10);
+    }
+    input[length++] = ']';
+    input[length] = '\0';
+
+    struct JSONColumn columns[] = {
+        {"n", JSON_COLUMN_INT64},
+        {"s", JSON_COLUMN_STRING}
+    };
+    unsigned int rows;
+    assertIntegersEqual(parseJSONColumns(columns, 2, &rows, input), STATUS_OK);
+    assertIntegersEqual(rows, 1000);
+    const int64_t *values = columns[0].values;
+    const uint32_t *offsets = columns[1].values;
+    unsigned int matched = 0;
+    for(unsigned int i = 0; i < rows; i++) {
+        matched += values[i] == i && columnValid(&columns[0], i)
+            && offsets[i + 1] - offsets[i] == 2 && columns[1].data[offsets[i] + 1] == '0' + i % 10;
+    }
+    assertIntegersEqual(matched, 1000);
+    columnsRelease(columns, 2);
+    free(input);
+}
+
+void testJSONColumnsInvalid() {
+    struct JSONColumn columns[] = {
+        {"id", JSON_COLUMN_INT64},
+        {"name", JSON_COLUMN_STRING}
+    };
+    unsigned int rows;
+    char fraction[] = "[{\"id\": 1}, {\"id\": 1.5}]";
+    assertIntegersEqual(parseJSONColumns(columns, 2, &rows, fraction), STATUS_PARSE_ERR);
+    assertIntegersEqual(rows, 1);
+    char mismatch[] = "[{\"name\": 1}]";
+    assertIntegersEqual(parseJSONColumns(columns, 2, &rows, mismatch), STATUS_PARSE_ERR);
+    char repeated[] = "[{\"id\": 1, \"id\": 2}]";
+    assertIntegersEqual(parseJSONColumns(columns, 2, &rows, repeated), STATUS_PARSE_ERR);
+    char notRecord[] = "[1]";
+    assertIntegersEqual(parseJSONColumns(columns, 2, &rows, notRecord), STATUS_PARSE_ERR);
+    char notArray[] = "{\"id\": 1}";
+    assertIntegersEqual(parseJSONColumns(columns, 2, &rows, notArray), STATUS_PARSE_ERR);
+    char unterminated[] = "[{\"id\": 1, \"skip\": [1, 2}";
+    assertIntegersEqual(parseJSONColumns(columns, 2, &rows, unterminated), STATUS_PARSE_ERR);
+    // Skipped members are still checked as the parser would.
+    char *skipped[] = {
+        "[{\"x\": [1 2}, \"id\": 5}]",
+        "[{\"x\": [1}, \"id\": 5}]",
+        "[{\"x\": {\"a\" 1 2], \"id\": 5}]",
+        "[{\"x\": [1,], \"id\": 5}]",
+        "[{\"x\": {\"a\": 1,}, \"id\": 5}]",
+        "[{\"x\": ], \"id\": 5}]"
+    };
+    for(unsigned int i = 0; i < sizeof(skipped) / sizeof(skipped[0]); i++) {
+        assertIntegersEqual(parseJSONColumns(columns, 2, &rows, skipped[i]), STATUS_PARSE_ERR);
+        assertIntegersEqual(rows, 0);
+    }
+    char trailing[] = "[] 1";
+    assertIntegersEqual(parseJSONColumns(columns, 2, &rows, trailing), STATUS_PARSE_ERR);
+    columnsRelease(columns, 2);
+}
+
+void testJSONColumns() {
+    testJSONColumnsParse();
+    testJSONColumnsGrow();
+    testJSONColumnsInvalid();
+}
@@ -0,0 +1,316 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json_diff.h"
+#include "json_patch.h"
+#include "cutil/src/string.h"
+#include "cutil/src/map/map.h"
+#include "cutil/src/error.h"
+
+#define HASH_NULL 0x6E756C6CULL
+#define HASH_BOOLEAN 0x626F6F6CULL
+#define HASH_NUMBER 0x6E756D62ULL
+#define HASH_INTEGER 0x696E7467ULL
+#define HASH_STRING 0x73747269ULL
+#define HASH_ARRAY 0x61727261ULL
+#define HASH_OBJECT 0x6F626A65ULL
+
+struct DiffState {
+    struct Generic *patch;
+    struct JSONCache *cache;
+    // Pointer of the node being compared, truncated on the way back up.
+    struct JSONBuffer path;
+};
+
+static uint64_t hashMix(uint64_t hash) {
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EBULL;
+    return hash ^ (hash >> 31);
+}
+
+static uint64_t hashString(const char *string) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for(; *string; string++) {
+        hash = (hash ^ (unsigned char)*string) * 0x100000001B3ULL;
+    }
+    return hashMix(hash ^ HASH_STRING);
+}
+
+static uint64_t hashDouble(double value) {
+    // Both zeros compare equal.
+    if(value == 0) value = 0;
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return hashMix(bits ^ HASH_NUMBER);
+}
+
+static uint64_t hashValue(struct Generic *generic, struct JSONCache *cache) {
+    void *data = genericData(generic);
+    if(generic->object == &Integer) {
+        // Integers equal to a float hash like it, the rest by their bits.
+        long value = *((long*)data);
+        double asDouble = value;
+        if((long)asDouble == value) return hashDouble(asDouble);
+        return hashMix((uint64_t)value ^ HASH_INTEGER);
+    }
+    if(generic->object == &Float) return hashDouble(*((float*)data));
+    if(generic->object == &Boolean) return hashMix(HASH_BOOLEAN + !!*((char*)data));
+    if(generic->object == &String) return hashString(*((char**)data));
+    if(generic->object == &Pointer) return hashMix(HASH_NULL);
+
+    struct Collection *collection = (struct Collection*)generic->object;
+    struct Iterator iterator = collection->iterator(data);
+    uint64_t hash;
+    if(generic->object == &Array.object) {
+        hash = HASH_ARRAY;
+        struct Generic *element;
+        while((element = collection->next(&iterator))) {
+            hash = hashMix(hash * 31 + jsonHash(element, cache));
+        }
+    } else {
+        // Members combine commutatively so order does not matter.
+        hash = 0;
+        unsigned int count = 0;
+        const void *key;
+        while((key = mapKey(&iterator))) {
+            struct Generic *member = collection->next(&iterator);
+            hash += hashMix(hashString(key) ^ (jsonHash(member, cache) * 0x9E3779B97F4A7C15ULL));
+            count++;
+        }
+        hash = hashMix(hash ^ HASH_OBJECT ^ ((uint64_t)count << 32));
+    }
+    return hash;
+}
+
+uint64_t jsonHash(struct Generic *generic, struct JSONCache *cache) {
+    int isContainer = generic->object == &Array.object || generic->object == &Map.object;
+    uint64_t hash;
+    if(cache && isContainer && cacheFindHash(cache, generic, &hash)) return hash;
+    hash = hashValue(generic, cache);
+    // A full cache only loses the memo.
+    if(cache && isContainer) cacheStoreHash(cache, generic, hash);
+    return hash;
+}
+
+int jsonHashEquals(struct Generic *a, struct Generic *b, struct JSONCache *cache) {
+    return jsonHash(a, cache) == jsonHash(b, cache);
+}
+
+// Append an operation to the patch. Takes ownership of value.
+static unsigned int diffEmit(
+        struct DiffState *state,
+        const char *op,
+        struct Generic *value) {
+    struct Generic *operation = genericCompose(&Map.object);
+    struct Generic *opString = genericCompose(&String);
+    struct Generic *pathString = genericCompose(&String);
+    char *opKey = strCopy("op");
+    char *pathKey = strCopy("path");
+    char *valueKey = value ? strCopy("value") : NULL;
+    char *opValue = strCopy(op);
+    char *pathValue = strCopyN(state->path.data ? state->path.data : "", state->path.length);
+
+    unsigned int result = STATUS_ALLOC_ERR;
+    if(!operation || !opString || !pathString || !opKey || !pathKey
+            || (value && !valueKey) || !opValue || !pathValue) {
+        goto fail;
+    }
+    *((char**)genericData(opString)) = opValue;
+    opValue = NULL;
+    *((char**)genericData(pathString)) = pathValue;
+    pathValue = NULL;
+
+    if((result = genericAdd(operation, opKey, opString))) goto fail;
+    opKey = NULL;
+    opString = NULL;
+    if((result = genericAdd(operation, pathKey, pathString))) goto fail;
+    pathKey = NULL;
+    pathString = NULL;
+    if(value) {
+        if((result = genericAdd(operation, valueKey, value))) goto fail;
+        valueKey = NULL;
+        value = NULL;
+    }
+    if((result = genericAdd(state->patch, "-1", operation))) goto fail;
+    return STATUS_OK;
+
+fail:
+    free(opKey);
+    free(pathKey);
+    free(valueKey);
+    free(opValue);
+    free(pathValue);
+    if(opString) genericRelease(opString);
+    if(pathString) genericRelease(pathString);
+    if(value) genericRelease(value);
+    if(operation) genericRelease(operation);
+    return result;
+}
+
+static unsigned int diffEmitCopy(
+        struct DiffState *state,
+        const char *op,
+        struct Generic *value) {
+    struct Generic *copy;
+    unsigned int result = jsonCopy(&copy, value);
+    if(result) return result;
+    return diffEmit(state, op, copy);
+}
+
+// Append "/token" to the path, escaping "~" and "/".
+static unsigned int diffPushKey(struct DiffState *state, const char *key) {
+    unsigned int result = bufferAppendChar(&state->path, '/');
+    for(; *key && !result; key++) {
+        if(*key == '~') {
+            result = bufferAppend(&state->path, "~0", 2);
+        } else if(*key == '/') {
+            result = bufferAppend(&state->path, "~1", 2);
+        } else {
+            result = bufferAppendChar(&state->path, *key);
+        }
+    }
+    return result;
+}
+
+static unsigned int diffPushIndex(struct DiffState *state, unsigned int index) {
+    char token[16];
+    snprintf(token, sizeof(token), "%u", index);
+    return diffPushKey(state, token);
+}
+
+static struct Generic **diffElements(struct Generic *array, unsigned int *count) {
+    struct Collection *collection = (struct Collection*)array->object;
+    struct Iterator iterator = collection->iterator(genericData(array));
+    *count = 0;
+    while(collection->next(&iterator)) (*count)++;
+
+    struct Generic **elements = malloc((*count ? *count : 1) * sizeof(struct Generic*));
+    if(!elements) return NULL;
+    iterator = collection->iterator(genericData(array));
+    for(unsigned int i = 0; i < *count; i++) {
+        elements[i] = collection->next(&iterator);
+    }
+    return elements;
+}
+
+static unsigned int diffNode(struct DiffState *state, struct Generic *from, struct Generic *to);
+
+static unsigned int diffObjects(struct DiffState *state, struct Generic *from, struct Generic *to) {
+    struct Collection *collection = (struct Collection*)from->object;
+    unsigned int length = state->path.length;
+    unsigned int result = STATUS_OK;
+
+    struct Iterator iterator = collection->iterator(genericData(from));
+    const void *key;
+    while(!result && (key = mapKey(&iterator))) {
+        struct Generic *member = collection->next(&iterator);
+        struct Generic *other = jsonMember(to, key);
+        result = diffPushKey(state, key);
+        if(!result) result = other ? diffNode(state, member, other) : diffEmit(state, "remove", NULL);
+        state->path.length = length;
+    }
+
+    iterator = collection->iterator(genericData(to));
+    while(!result && (key = mapKey(&iterator))) {
+        struct Generic *member = collection->next(&iterator);
+        if(jsonMember(from, key)) continue;
+        result = diffPushKey(state, key);
+        if(!result) result = diffEmitCopy(state, "add", member);
+        state->path.length = length;
+    }
+    return result;
+}
+
+static unsigned int diffArrays(struct DiffState *state, struct Generic *from, struct Generic *to) {
+    unsigned int fromCount, toCount;
+    struct Generic **fromElements = diffElements(from, &fromCount);
+    struct Generic **toElements = diffElements(to, &toCount);
+    unsigned int result = STATUS_ALLOC_ERR;
+    if(!fromElements || !toElements) goto done;
+
+    // Trim the unchanged ends so insertions and removals stay single
+    // operations instead of shifting every later element.
+    unsigned int prefix = 0;
+    while(prefix < fromCount && prefix < toCount
+            && jsonHashEquals(fromElements[prefix], toElements[prefix], state->cache)) {
+        prefix++;
+    }
+    unsigned int suffix = 0;
+    while(suffix < fromCount - prefix && suffix < toCount - prefix
+            && jsonHashEquals(
+                fromElements[fromCount - 1 - suffix],
+                toElements[toCount - 1 - suffix],
+                state->cache)) {
+        suffix++;
+    }
+    unsigned int fromMiddle = fromCount - prefix - suffix;
+    unsigned int toMiddle = toCount - prefix - suffix;
+    unsigned int common = fromMiddle < toMiddle ? fromMiddle : toMiddle;
+    unsigned int length = state->path.length;
+
+    result = STATUS_OK;
+    for(unsigned int i = 0; i < common && !result; i++) {
+        result = diffPushIndex(state, prefix + i);
+        if(!result) result = diffNode(state, fromElements[prefix + i], toElements[prefix + i]);
+        state->path.length = length;
+    }
+    // Each removal shifts the next surplus element into the same index.
+    for(unsigned int i = common; i < fromMiddle && !result; i++) {
+        result = diffPushIndex(state, prefix + common);
+        if(!result) result = diffEmit(state, "remove", NULL);
+        state->path.length = length;
+    }
+    for(unsigned int i = common; i < toMiddle && !result; i++) {
+        result = diffPushIndex(state, prefix + i);
+        if(!result) result = diffEmitCopy(state, "add", toElements[prefix + i]);
+        state->path.length = length;
+    }
+
+done:
+    free(fromElements);
+    free(toElements);
+    return result;
+}
+
+static unsigned int diffNode(struct DiffState *state, struct Generic *from, struct Generic *to) {
+    if(jsonHashEquals(from, to, state->cache)) return STATUS_OK;
+    if(from->object == &Map.object && to->object == &Map.object) {
+        return diffObjects(state, from, to);
+    }
+    if(from->object == &Array.object && to->object == &Array.object) {
+        return diffArrays(state, from, to);
+    }
+    return diffEmitCopy(state, "replace", to);
+}
+
+unsigned int diffJSON(
+        struct Generic **patch,
+        struct Generic *from,
+        struct Generic *to,
+        struct JSONCache *cache) {
+    struct DiffState state;
+    struct JSONCache localCache;
+    if(!cache) {
+        cacheCompose(&localCache, 0);
+        cache = &localCache;
+    }
+    state.cache = cache;
+    bufferCompose(&state.path);
+
+    unsigned int result = STATUS_ALLOC_ERR;
+    state.patch = genericCompose(&Array.object);
+    if(state.patch) {
+        result = diffNode(&state, from, to);
+        if(result) {
+            genericRelease(state.patch);
+            state.patch = NULL;
+        }
+    }
+    *patch = state.patch;
+
+    bufferRelease(&state.path);
+    if(cache == &localCache) cacheRelease(&localCache);
+    return result;
+}
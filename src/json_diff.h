@@ -0,0 +1,33 @@
+#ifndef __JSON_DIFF_H
+#define __JSON_DIFF_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stdint.h>
+#include "json_cache.h"
+#include "cutil/src/generic/generic.h"
+
+// Structural hash, equal for trees jsonEquals considers equal whatever
+// their member order. With a cache, container hashes are memoized and a
+// repeated call on an unchanged tree is O(1).
+uint64_t jsonHash(struct Generic *generic, struct JSONCache *cache);
+
+// Equal hashes are trusted, jsonEquals gives an exact answer.
+int jsonHashEquals(struct Generic *a, struct Generic *b, struct JSONCache *cache);
+
+// Build an RFC 6902 patch, an array of operation objects, turning from
+// into to. Subtrees with equal hashes are skipped without being visited.
+// The cache may hold nodes of both trees and is kept for later calls,
+// trees must be passed to cacheForget before they are released. Without
+// one a temporary cache is used.
+unsigned int diffJSON(
+    struct Generic **patch,
+    struct Generic *from,
+    struct Generic *to,
+    struct JSONCache *cache);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include "json_parser.h"
+#include "json_patch.h"
+#include "json_diff.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/map/map.h"
+#include "cutil/src/error.h"
+
+static unsigned int operationCount(struct Generic *patch) {
+    struct Collection *collection = (struct Collection*)patch->object;
+    struct Iterator iterator = collection->iterator(genericData(patch));
+    unsigned int count = 0;
+    while(collection->next(&iterator)) count++;
+    return count;
+}
+
+static void assertDiffApplies(char *fromInput, char *toInput, unsigned int operations) {
+    struct Generic *from, *to, *patch;
+    assertIntegersEqual(parseJSON(&from, fromInput), STATUS_OK);
+    assertIntegersEqual(parseJSON(&to, toInput), STATUS_OK);
+
+    unsigned int result = diffJSON(&patch, from, to, NULL);
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(operationCount(patch), operations);
+
+    result = patchJSON(&from, patch, NULL);
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(jsonEquals(from, to), 1);
+
+    genericRelease(patch);
+    genericRelease(from);
+    genericRelease(to);
+}
+
+void testJSONDiffHash() {
+    char aInput[] = "{\"a\": [1, 2.5, \"x\"], \"b\": {\"c\": null, \"d\": false}}";
+    char bInput[] = "{\"b\": {\"d\": false, \"c\": null}, \"a\": [1.0, 2.5, \"x\"]}";
+    char cInput[] = "{\"a\": [2.5, 1, \"x\"], \"b\": {\"c\": null, \"d\": false}}";
+    struct Generic *a, *b, *c;
+    assertIntegersEqual(parseJSON(&a, aInput), STATUS_OK);
+    assertIntegersEqual(parseJSON(&b, bInput), STATUS_OK);
+    assertIntegersEqual(parseJSON(&c, cInput), STATUS_OK);
+
+    assertIntegersEqual(jsonHashEquals(a, b, NULL), 1);
+    assertIntegersEqual(jsonHashEquals(a, c, NULL), 0);
+    assertIntegersEqual(jsonEquals(a, b), 1);
+    assertIntegersEqual(jsonEquals(a, c), 0);
+
+    // Memoized hashes are reused until invalidated.
+    struct JSONCache cache;
+    cacheCompose(&cache, 0);
+    uint64_t hash = jsonHash(a, &cache);
+    assertIntegersEqual(cache.size, 3);
+    assertIntegersEqual(jsonHash(a, &cache) == hash, 1);
+    char patch[] = "[{\"op\": \"replace\", \"path\": \"/b/d\", \"value\": true}]";
+    assertIntegersEqual(patchJSONText(&a, patch, &cache), STATUS_OK);
+    assertIntegersEqual(cache.size, 1);
+    assertIntegersEqual(jsonHash(a, &cache) != hash, 1);
+    assertIntegersEqual(jsonHash(a, NULL) == jsonHash(a, &cache), 1);
+
+    cacheRelease(&cache);
+    genericRelease(a);
+    genericRelease(b);
+    genericRelease(c);
+}
+
+void testJSONDiffPatch() {
+    char same[] = "{\"a\": [1, {\"b\": 2, \"c\": 3}]}";
+    char sameReordered[] = "{\"a\": [1, {\"c\": 3, \"b\": 2}]}";
+    assertDiffApplies(same, sameReordered, 0);
+
+    char members[] = "{\"a\": 1, \"b\": {\"c\": 2, \"d\": 3}, \"e/f\": 4}";
+    char membersChanged[] = "{\"a\": 1, \"b\": {\"c\": 5, \"g\": 3}, \"h~\": 4}";
+    assertDiffApplies(members, membersChanged, 5);
+
+    char inserted[] = "[1, 2, 3, 4]";
+    char insertedFront[] = "[0, 1, 2, 3, 4]";
+    assertDiffApplies(inserted, insertedFront, 1);
+
+    char removed[] = "[1, 2, 3, 4]";
+    char removedMiddle[] = "[1, 4]";
+    assertDiffApplies(removed, removedMiddle, 2);
+
+    char nested[] = "[{\"a\": [1, 2]}, 3]";
+    char nestedChanged[] = "[{\"a\": [1, 7]}, \"3\"]";
+    assertDiffApplies(nested, nestedChanged, 2);
+
+    char root[] = "{\"a\": 1}";
+    char rootChanged[] = "[1]";
+    assertDiffApplies(root, rootChanged, 1);
+}
+
+void testJSONDiffSkipsHashedSubtrees() {
+    char fromInput[] = "{\"a\": [1, 2], \"b\": [3]}";
+    char toInput[] = "{\"a\": [1, 9], \"b\": [4]}";
+    struct Generic *from, *to, *patch;
+    assertIntegersEqual(parseJSON(&from, fromInput), STATUS_OK);
+    assertIntegersEqual(parseJSON(&to, toInput), STATUS_OK);
+
+    // Equal memoized hashes are trusted without visiting the subtree.
+    struct JSONCache cache;
+    cacheCompose(&cache, 0);
+    cacheStoreHash(&cache, getAt(from, "a"), 42);
+    cacheStoreHash(&cache, getAt(to, "a"), 42);
+    assertIntegersEqual(diffJSON(&patch, from, to, &cache), STATUS_OK);
+    assertNotNull(getAt(patch, "0"));
+    assertIsNull(getAt(patch, "1"));
+    assertStringsEqual(*(char**)genericData(getAt(patch, "0.path")), "/b/0");
+
+    genericRelease(patch);
+    cacheRelease(&cache);
+    genericRelease(from);
+    genericRelease(to);
+}
+
+void testJSONDiff() {
+    testJSONDiffHash();
+    testJSONDiffPatch();
+    testJSONDiffSkipsHashedSubtrees();
+}
@@ -0,0 +1,129 @@
+#include <string.h>
+#include "json_digest.h"
+#include "cutil/src/error.h"
+
+static const uint32_t DIGEST_ROUNDS[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static uint32_t rotate(uint32_t value, unsigned int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+static void digestBlock(struct JSONDigest *digest, const unsigned char *block) {
+    uint32_t words[64];
+    for(unsigned int i = 0; i < 16; i++) {
+        words[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16
+            | (uint32_t)block[i * 4 + 2] << 8 | block[i * 4 + 3];
+    }
+    for(unsigned int i = 16; i < 64; i++) {
+        uint32_t s0 = rotate(words[i - 15], 7) ^ rotate(words[i - 15], 18) ^ (words[i - 15] >> 3);
+        uint32_t s1 = rotate(words[i - 2], 17) ^ rotate(words[i - 2], 19) ^ (words[i - 2] >> 10);
+        words[i] = words[i - 16] + s0 + words[i - 7] + s1;
+    }
+
+    uint32_t a = digest->state[0], b = digest->state[1], c = digest->state[2], d = digest->state[3];
+    uint32_t e = digest->state[4], f = digest->state[5], g = digest->state[6], h = digest->state[7];
+    for(unsigned int i = 0; i < 64; i++) {
+        uint32_t s1 = rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25);
+        uint32_t choice = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + choice + DIGEST_ROUNDS[i] + words[i];
+        uint32_t s0 = rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22);
+        uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    digest->state[0] += a;
+    digest->state[1] += b;
+    digest->state[2] += c;
+    digest->state[3] += d;
+    digest->state[4] += e;
+    digest->state[5] += f;
+    digest->state[6] += g;
+    digest->state[7] += h;
+}
+
+void digestCompose(struct JSONDigest *digest) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(digest->state, initial, sizeof(initial));
+    digest->length = 0;
+    digest->blockLength = 0;
+}
+
+void digestUpdate(struct JSONDigest *digest, const void *data, unsigned int length) {
+    const unsigned char *bytes = data;
+    digest->length += length;
+    if(digest->blockLength) {
+        unsigned int fill = 64 - digest->blockLength;
+        if(fill > length) fill = length;
+        memcpy(digest->block + digest->blockLength, bytes, fill);
+        digest->blockLength += fill;
+        bytes += fill;
+        length -= fill;
+        if(digest->blockLength < 64) return;
+        digestBlock(digest, digest->block);
+        digest->blockLength = 0;
+    }
+    for(; length >= 64; bytes += 64, length -= 64) {
+        digestBlock(digest, bytes);
+    }
+    memcpy(digest->block, bytes, length);
+    digest->blockLength = length;
+}
+
+void digestFinish(struct JSONDigest *digest, unsigned char output[JSON_DIGEST_LENGTH]) {
+    uint64_t bits = digest->length * 8;
+    unsigned char padding[72] = {0x80};
+    unsigned int paddingLength = (digest->blockLength < 56 ? 56 : 120) - digest->blockLength;
+    for(unsigned int i = 0; i < 8; i++) {
+        padding[paddingLength + i] = (unsigned char)(bits >> (56 - 8 * i));
+    }
+    digestUpdate(digest, padding, paddingLength + 8);
+
+    for(unsigned int i = 0; i < 8; i++) {
+        output[i * 4] = (unsigned char)(digest->state[i] >> 24);
+        output[i * 4 + 1] = (unsigned char)(digest->state[i] >> 16);
+        output[i * 4 + 2] = (unsigned char)(digest->state[i] >> 8);
+        output[i * 4 + 3] = (unsigned char)digest->state[i];
+    }
+}
+
+static unsigned int digestSink(void *context, const char *data, unsigned int length) {
+    digestUpdate(context, data, length);
+    return STATUS_OK;
+}
+
+unsigned int digestJSON(
+        struct Generic *generic,
+        unsigned char output[JSON_DIGEST_LENGTH],
+        struct JSONFormat fmt) {
+    struct JSONDigest digest;
+    digestCompose(&digest);
+
+    struct JSONUnparser unparser = {.cache = NULL};
+    bufferComposeSink(&unparser.buffer, digestSink, &digest);
+    const char *data;
+    unsigned int length;
+    unsigned int result = unparseJSONWith(&unparser, generic, &data, &length, fmt);
+    if(result) return result;
+
+    digestFinish(&digest, output);
+    return STATUS_OK;
+}
@@ -0,0 +1,35 @@
+#ifndef __JSON_DIGEST_H
+#define __JSON_DIGEST_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stdint.h>
+#include "json_unparser.h"
+
+#define JSON_DIGEST_LENGTH 32
+
+// Incremental SHA-256.
+struct JSONDigest {
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char block[64];
+    unsigned int blockLength;
+};
+
+void digestCompose(struct JSONDigest *digest);
+void digestUpdate(struct JSONDigest *digest, const void *data, unsigned int length);
+void digestFinish(struct JSONDigest *digest, unsigned char output[JSON_DIGEST_LENGTH]);
+
+// SHA-256 of the text unparseJSON would produce, hashed while it is
+// written so the text is never held in memory. Use a canonical format to
+// get the same digest for equal documents.
+unsigned int digestJSON(
+    struct Generic *generic,
+    unsigned char output[JSON_DIGEST_LENGTH],
+    struct JSONFormat fmt);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
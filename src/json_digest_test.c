@@ -0,0 +1,74 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_parser.h"
+#include "json_digest.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+static void assertDigestEqual(const unsigned char *digest, const char *hex) {
+    char output[JSON_DIGEST_LENGTH * 2 + 1];
+    for(unsigned int i = 0; i < JSON_DIGEST_LENGTH; i++) {
+        sprintf(output + i * 2, "%02x", digest[i]);
+    }
+    assertStringsEqual(output, hex);
+}
+
+void testJSONDigestVectors() {
+    unsigned char output[JSON_DIGEST_LENGTH];
+    struct JSONDigest digest;
+
+    digestCompose(&digest);
+    digestFinish(&digest, output);
+    assertDigestEqual(output, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+    digestCompose(&digest);
+    digestUpdate(&digest, "abc", 3);
+    digestFinish(&digest, output);
+    assertDigestEqual(output, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+    // Split across calls and blocks.
+    const char *message = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    digestCompose(&digest);
+    unsigned int length = strlen(message);
+    for(unsigned int i = 0; i < length; i += 5) {
+        digestUpdate(&digest, message + i, length - i < 5 ? length - i : 5);
+    }
+    digestFinish(&digest, output);
+    assertDigestEqual(output, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+void testJSONDigestDocument() {
+    char input[] = "{\"a\": [1, 2.5, \"x\"], \"b\": {\"c\": null, \"d\": false}}";
+    char reordered[] = "{\"b\": {\"d\": false, \"c\": null}, \"a\": [1, 2.50, \"x\"]}";
+    struct Generic *generic, *other;
+    assertIntegersEqual(parseJSON(&generic, input), STATUS_OK);
+    assertIntegersEqual(parseJSON(&other, reordered), STATUS_OK);
+
+    // Streaming matches hashing the materialized text.
+    struct JSONFormat fmt = {2, 0, 0};
+    unsigned char streamed[JSON_DIGEST_LENGTH];
+    unsigned char expected[JSON_DIGEST_LENGTH];
+    assertIntegersEqual(digestJSON(generic, streamed, fmt), STATUS_OK);
+    char *output;
+    unsigned int outputLength;
+    assertIntegersEqual(unparseJSON(generic, &output, &outputLength, fmt), STATUS_OK);
+    struct JSONDigest digest;
+    digestCompose(&digest);
+    digestUpdate(&digest, output, outputLength);
+    digestFinish(&digest, expected);
+    assertIntegersEqual(memcmp(streamed, expected, JSON_DIGEST_LENGTH), 0);
+    free(output);
+
+    struct JSONFormat canonical = {0, 0, 0, 1};
+    assertIntegersEqual(digestJSON(generic, streamed, canonical), STATUS_OK);
+    assertIntegersEqual(digestJSON(other, expected, canonical), STATUS_OK);
+    assertIntegersEqual(memcmp(streamed, expected, JSON_DIGEST_LENGTH), 0);
+
+    genericRelease(generic);
+    genericRelease(other);
+}
+
+void testJSONDigest() {
+    testJSONDigestVectors();
+    testJSONDigestDocument();
+}
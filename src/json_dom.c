@@ -0,0 +1,393 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "json.h"
+#include "json_dom.h"
+#include "json_number.h"
+#include "cutil/src/error.h"
+#include "cutil/src/string.h"
+
+// Parser position plus the free space left in the document's node block.
+struct DOMBuilder {
+    struct JSONParser *parser;
+    char *next;
+};
+
+static unsigned int indexSlots(unsigned int length) {
+    unsigned int slots = 32;
+    while(slots < length * 2) slots *= 2;
+    return slots;
+}
+
+static size_t containerSize(const struct JSONToken *token) {
+    if(*token->lexeme == JSON_ARR_BEGIN) return token->count * sizeof(struct JSONValue);
+    size_t size = token->count * sizeof(struct JSONPair);
+    if(token->count >= JSON_DOM_INDEX_THRESHOLD) size += indexSlots(token->count) * sizeof(unsigned int);
+    return size;
+}
+
+static uint64_t hashKey(const char *key, unsigned int length) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for(unsigned int i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)key[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static int keyEquals(const struct JSONString *name, const char *key, unsigned int length) {
+    return name->length == length && memcmp(name->value, key, length) == 0;
+}
+
+// The index directly follows the pairs, slots hold a pair index plus one.
+static unsigned int *objectIndex(const struct JSONObject *object) {
+    return (unsigned int*)(object->pairs + object->length);
+}
+
+static void indexBuild(struct JSONObject *object) {
+    unsigned int *index = objectIndex(object);
+    unsigned int mask = indexSlots(object->length) - 1;
+    memset(index, 0, (mask + 1) * sizeof(unsigned int));
+    for(unsigned int i = 0; i < object->length; i++) {
+        const struct JSONString *name = &object->pairs[i].name;
+        unsigned int slot = hashKey(name->value, name->length) & mask;
+        while(index[slot] && !keyEquals(&object->pairs[index[slot] - 1].name, name->value, name->length)) {
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = i + 1;
+    }
+}
+
+static struct JSONToken *builderCurrent(struct DOMBuilder *builder) {
+    struct JSONParser *parser = builder->parser;
+    if(parser->position >= parser->tokens.length) return NULL;
+    return &parser->tokens.tokens[parser->position];
+}
+
+static struct JSONToken *builderNext(struct DOMBuilder *builder) {
+    builder->parser->position++;
+    return builderCurrent(builder);
+}
+
+static int isSymbol(const struct JSONToken *token, char symbol) {
+    return token && token->token == JSON_TOKEN_SYMBOL && *token->lexeme == symbol;
+}
+
+static unsigned int buildValue(struct DOMBuilder *builder, struct JSONValue *value);
+
+static unsigned int buildString(struct JSONToken *token, struct JSONString *string) {
+    const char *endQuote = strAfterQuotedString(token->lexeme);
+    if(endQuote == token->lexeme) return STATUS_PARSE_ERR;
+    string->type = JSON_TYPE_STRING;
+    string->length = endQuote - token->lexeme - 2;
+    string->value = token->lexeme + 1;
+    return STATUS_OK;
+}
+
+static unsigned int buildArray(struct DOMBuilder *builder, struct JSONArray *array) {
+    struct JSONToken *token = builderCurrent(builder);
+    array->type = JSON_TYPE_ARRAY;
+    array->length = 0;
+    array->values = (struct JSONValue*)builder->next;
+    builder->next += containerSize(token);
+
+    unsigned int capacity = token->count;
+    token = builderNext(builder);
+    if(isSymbol(token, JSON_ARR_CLOSE)) {
+        builderNext(builder);
+        return STATUS_OK;
+    }
+    while(1) {
+        if(array->length == capacity) return STATUS_PARSE_ERR;
+        unsigned int result = buildValue(builder, &array->values[array->length++]);
+        if(result) return result;
+
+        token = builderCurrent(builder);
+        if(isSymbol(token, JSON_ARR_CLOSE)) break;
+        if(!isSymbol(token, JSON_SEPERATOR)) return STATUS_PARSE_ERR;
+        builderNext(builder);
+    }
+    builderNext(builder);
+    return STATUS_OK;
+}
+
+static unsigned int buildObject(struct DOMBuilder *builder, struct JSONObject *object) {
+    struct JSONToken *token = builderCurrent(builder);
+    object->type = JSON_TYPE_OBJECT;
+    object->length = 0;
+    object->pairs = (struct JSONPair*)builder->next;
+    builder->next += containerSize(token);
+
+    unsigned int capacity = token->count;
+    token = builderNext(builder);
+    if(isSymbol(token, JSON_MAP_CLOSE)) {
+        builderNext(builder);
+        return STATUS_OK;
+    }
+    while(1) {
+        if(object->length == capacity) return STATUS_PARSE_ERR;
+        if(!token || token->token != JSON_TOKEN_STRING) return STATUS_PARSE_ERR;
+        struct JSONPair *pair = &object->pairs[object->length++];
+        unsigned int result = buildString(token, &pair->name);
+        if(result) return result;
+        if(!isSymbol(builderNext(builder), JSON_MEMBER_SEP)) return STATUS_PARSE_ERR;
+        builderNext(builder);
+        result = buildValue(builder, &pair->value);
+        if(result) return result;
+
+        token = builderCurrent(builder);
+        if(isSymbol(token, JSON_MAP_CLOSE)) break;
+        if(!isSymbol(token, JSON_SEPERATOR)) return STATUS_PARSE_ERR;
+        token = builderNext(builder);
+    }
+    builderNext(builder);
+
+    // Space for the index was reserved from the count, which the length
+    // never exceeds.
+    if(object->length >= JSON_DOM_INDEX_THRESHOLD) indexBuild(object);
+    return STATUS_OK;
+}
+
+static unsigned int buildValue(struct DOMBuilder *builder, struct JSONValue *value) {
+    struct JSONToken *token = builderCurrent(builder);
+    if(!token) return STATUS_PARSE_ERR;
+
+    switch(token->token) {
+        case JSON_TOKEN_SYMBOL:
+            if(*token->lexeme == JSON_ARR_BEGIN) return buildArray(builder, &value->array);
+            if(*token->lexeme == JSON_MAP_BEGIN) return buildObject(builder, &value->object);
+            return STATUS_PARSE_ERR;
+        case JSON_TOKEN_STRING: {
+            unsigned int result = buildString(token, &value->string);
+            if(result) return result;
+            break;
+        }
+        case JSON_TOKEN_NUMBER: {
+            // The whole token must follow the strict grammar.
+            const char *end = strAfterNumber(token->lexeme);
+            if(numberCompose(&value->number, token->lexeme)) return STATUS_PARSE_ERR;
+            if(value->number.lexeme + value->number.length != end) return STATUS_PARSE_ERR;
+            break;
+        }
+        case JSON_TOKEN_BOOL:
+            value->type = *token->lexeme == *JSON_TRUE_STR ? JSON_TYPE_TRUE : JSON_TYPE_FALSE;
+            break;
+        case JSON_TOKEN_NULL:
+            value->type = JSON_TYPE_NULL;
+            break;
+        default:
+            return STATUS_PARSE_ERR;
+    }
+    builderNext(builder);
+    return STATUS_OK;
+}
+
+unsigned int parseDocumentWith(
+        struct JSONParser *parser,
+        struct JSONDocument *document,
+        const char *toCheck) {
+    document->root.type = JSON_TYPE_NULL;
+    document->nodes = NULL;
+    parser->position = 0;
+
+    // Nodes point into the text, so the document keeps its own copy.
+    size_t length = strlen(toCheck);
+    document->text = malloc(length + 1);
+    if(document->text == NULL) return STATUS_ALLOC_ERR;
+    memcpy(document->text, toCheck, length + 1);
+
+    unsigned int result = lexJSONTokens(&parser->tokens, document->text);
+    if(result) {
+        documentRelease(document);
+        return result == STATUS_ALLOC_ERR ? result : STATUS_PARSE_ERR;
+    }
+
+    // Every container's children are reserved up front from its count.
+    size_t size = 0;
+    for(unsigned int i = 0; i < parser->tokens.length; i++) {
+        const struct JSONToken *token = &parser->tokens.tokens[i];
+        if(isSymbol(token, JSON_ARR_BEGIN) || isSymbol(token, JSON_MAP_BEGIN)) {
+            size += containerSize(token);
+        }
+    }
+    if(size) {
+        document->nodes = malloc(size);
+        if(document->nodes == NULL) {
+            documentRelease(document);
+            return STATUS_ALLOC_ERR;
+        }
+    }
+
+    struct DOMBuilder builder = {parser, document->nodes};
+    result = buildValue(&builder, &document->root);
+    if(result == STATUS_OK && builderCurrent(&builder)) {
+        // Garbage followed valid JSON.
+        result = STATUS_PARSE_ERR;
+    }
+    if(result) documentRelease(document);
+    return result;
+}
+
+unsigned int parseDocument(struct JSONDocument *document, const char *toCheck) {
+    struct JSONParser parser;
+    parserCompose(&parser);
+    unsigned int result = parseDocumentWith(&parser, document, toCheck);
+    parserRelease(&parser);
+    return result;
+}
+
+void documentRelease(struct JSONDocument *document) {
+    free(document->text);
+    free(document->nodes);
+    document->text = NULL;
+    document->nodes = NULL;
+    document->root.type = JSON_TYPE_NULL;
+}
+
+const struct JSONValue *domMemberN(
+        const struct JSONValue *object,
+        const char *key,
+        unsigned int keyLength) {
+    if(!object || object->type != JSON_TYPE_OBJECT) return NULL;
+    const struct JSONObject *map = &object->object;
+
+    if(map->length < JSON_DOM_INDEX_THRESHOLD) {
+        for(unsigned int i = map->length; i > 0; i--) {
+            if(keyEquals(&map->pairs[i - 1].name, key, keyLength)) return &map->pairs[i - 1].value;
+        }
+        return NULL;
+    }
+
+    const unsigned int *index = objectIndex(map);
+    unsigned int mask = indexSlots(map->length) - 1;
+    unsigned int slot = hashKey(key, keyLength) & mask;
+    for(; index[slot]; slot = (slot + 1) & mask) {
+        const struct JSONPair *pair = &map->pairs[index[slot] - 1];
+        if(keyEquals(&pair->name, key, keyLength)) return &pair->value;
+    }
+    return NULL;
+}
+
+const struct JSONValue *domMember(const struct JSONValue *object, const char *key) {
+    return domMemberN(object, key, strlen(key));
+}
+
+const struct JSONValue *domElement(const struct JSONValue *array, unsigned int index) {
+    if(!array || array->type != JSON_TYPE_ARRAY || index >= array->array.length) return NULL;
+    return &array->array.values[index];
+}
+
+const struct JSONValue *domGetAt(const struct JSONValue *value, const char *path) {
+    while(value && *path) {
+        const char *end = strchr(path, '.');
+        if(!end) end = path + strlen(path);
+
+        if(value->type == JSON_TYPE_ARRAY) {
+            unsigned long index = 0;
+            const char *digit = path;
+            for(; digit < end && *digit >= '0' && *digit <= '9'; digit++) {
+                index = index * 10 + (*digit - '0');
+                if(index >= value->array.length) return NULL;
+            }
+            if(digit == path || digit != end) return NULL;
+            value = domElement(value, index);
+        } else {
+            value = domMemberN(value, path, end - path);
+        }
+        path = *end ? end + 1 : end;
+    }
+    return value;
+}
+
+static unsigned int emitString(struct JSONBuffer *buffer, const struct JSONString *string) {
+    unsigned int result = bufferAppendChar(buffer, '"');
+    if(!result) result = bufferAppend(buffer, string->value, string->length);
+    if(!result) result = bufferAppendChar(buffer, '"');
+    return result;
+}
+
+static unsigned int emitValue(struct JSONBuffer *buffer, const struct JSONValue *value, struct JSONFormat fmt);
+
+static unsigned int emitContainer(struct JSONBuffer *buffer, const struct JSONValue *value, struct JSONFormat fmt) {
+    int isArray = value->type == JSON_TYPE_ARRAY;
+    unsigned int length = isArray ? value->array.length : value->object.length;
+    unsigned int result = bufferAppendChar(buffer, isArray ? JSON_ARR_BEGIN : JSON_MAP_BEGIN);
+    if(result) return result;
+
+    fmt.level++;
+    for(unsigned int i = 0; i < length; i++) {
+        result = unparseIndent(buffer, fmt);
+        if(!result && isArray) {
+            result = emitValue(buffer, &value->array.values[i], fmt);
+        } else if(!result) {
+            const struct JSONPair *pair = &value->object.pairs[i];
+            result = emitString(buffer, &pair->name);
+            if(!result) result = bufferAppend(buffer, ": ", 2);
+            if(!result) result = emitValue(buffer, &pair->value, fmt);
+        }
+        if(!result) result = unparseSeparator(buffer, i + 1 == length, fmt);
+        if(result) return result;
+    }
+    fmt.level--;
+
+    result = unparseWhitespace(buffer, fmt);
+    if(result) return result;
+    return bufferAppendChar(buffer, isArray ? JSON_ARR_CLOSE : JSON_MAP_CLOSE);
+}
+
+static unsigned int emitValue(struct JSONBuffer *buffer, const struct JSONValue *value, struct JSONFormat fmt) {
+    switch(value->type) {
+        case JSON_TYPE_OBJECT:
+        case JSON_TYPE_ARRAY:
+            return emitContainer(buffer, value, fmt);
+        case JSON_TYPE_STRING:
+            return emitString(buffer, &value->string);
+        case JSON_TYPE_NUMBER:
+            return numberUnparse(&value->number, buffer);
+        case JSON_TYPE_TRUE:
+            return bufferAppendString(buffer, JSON_TRUE_STR);
+        case JSON_TYPE_FALSE:
+            return bufferAppendString(buffer, JSON_FALSE_STR);
+        case JSON_TYPE_NULL:
+            return bufferAppendString(buffer, JSON_NULL_STR);
+        default:
+            return STATUS_INPUT_ERR;
+    }
+}
+
+unsigned int unparseDocumentWith(
+        struct JSONUnparser *unparser,
+        const struct JSONValue *value,
+        const char **output,
+        unsigned int *outputLength,
+        struct JSONFormat fmt) {
+    bufferClear(&unparser->buffer);
+    unsigned int result = fmt.canonical ? STATUS_INPUT_ERR : emitValue(&unparser->buffer, value, fmt);
+
+    // Make sure an empty document still yields a valid string.
+    unsigned int terminateResult = bufferTerminate(&unparser->buffer);
+    if(terminateResult) return terminateResult;
+
+    *output = unparser->buffer.data;
+    *outputLength = unparser->buffer.length;
+    return result;
+}
+
+unsigned int unparseDocument(
+        const struct JSONValue *value,
+        char **output,
+        unsigned int *outputLength,
+        struct JSONFormat fmt) {
+    struct JSONUnparser unparser;
+    unparserCompose(&unparser);
+
+    const char *data;
+    unsigned int result = unparseDocumentWith(&unparser, value, &data, outputLength, fmt);
+    if(result) {
+        unparserRelease(&unparser);
+        return result;
+    }
+
+    *output = bufferDetach(&unparser.buffer, outputLength);
+    if(!*output) return STATUS_ALLOC_ERR;
+    return STATUS_OK;
+}
@@ -0,0 +1,57 @@
+#ifndef __JSON_DOM_H
+#define __JSON_DOM_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include "json_parser.h"
+#include "json_unparser.h"
+
+// Objects with fewer members are searched linearly.
+#define JSON_DOM_INDEX_THRESHOLD 16
+
+// Native document, an alternative to Generic trees. All nodes live in one
+// block sized from the lexer's element counts, strings and numbers are
+// views into a private copy of the input.
+struct JSONDocument {
+    struct JSONValue root;
+    char *text;
+    void *nodes;
+};
+
+unsigned int parseDocument(struct JSONDocument *document, const char *toCheck);
+unsigned int parseDocumentWith(
+    struct JSONParser *parser,
+    struct JSONDocument *document,
+    const char *toCheck);
+void documentRelease(struct JSONDocument *document);
+
+// Lookups return NULL for missing members, out of range indexes and
+// values of the wrong type. Repeated keys resolve to the last member.
+const struct JSONValue *domMember(const struct JSONValue *object, const char *key);
+const struct JSONValue *domMemberN(
+    const struct JSONValue *object,
+    const char *key,
+    unsigned int keyLength);
+const struct JSONValue *domElement(const struct JSONValue *array, unsigned int index);
+// Dot separated keys and array indexes, an empty path is value itself.
+const struct JSONValue *domGetAt(const struct JSONValue *value, const char *path);
+
+// Same layout as unparseJSON, with members in document order and strings
+// and numbers written as they were read. Canonical output is not supported.
+unsigned int unparseDocument(
+    const struct JSONValue *value,
+    char **output,
+    unsigned int *outputLength,
+    struct JSONFormat fmt);
+unsigned int unparseDocumentWith(
+    struct JSONUnparser *unparser,
+    const struct JSONValue *value,
+    const char **output,
+    unsigned int *outputLength,
+    struct JSONFormat fmt);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
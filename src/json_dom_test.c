@@ -0,0 +1,131 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json_dom.h"
+#include "json_number.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+void testJSONDomParse() {
+    const char *input = "{\"a\": [\"foo\", -9, 2.5e1], \"b\": {\"t\": true, \"f\": false, \"n\": null}}";
+    struct JSONDocument document;
+    unsigned int result = parseDocument(&document, input);
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(document.root.type, JSON_TYPE_OBJECT);
+    assertIntegersEqual(document.root.object.length, 2);
+    assertIntegersEqual(sizeof(struct JSONValue), 2 * sizeof(void*));
+
+    // Members keep document order.
+    assertIntegersEqual(strncmp(document.root.object.pairs[0].name.value, "a", 1), 0);
+    assertIntegersEqual(strncmp(document.root.object.pairs[1].name.value, "b", 1), 0);
+
+    const struct JSONValue *value = domGetAt(&document.root, "a.0");
+    assertIntegersEqual(value->type, JSON_TYPE_STRING);
+    assertIntegersEqual(value->string.length, 3);
+    assertIntegersEqual(strncmp(value->string.value, "foo", 3), 0);
+
+    int64_t integer;
+    value = domGetAt(&document.root, "a.1");
+    assertIntegersEqual(value->type, JSON_TYPE_NUMBER);
+    assertIntegersEqual(numberInteger(&value->number, &integer), STATUS_OK);
+    assertIntegersEqual(integer, -9);
+    value = domElement(domMember(&document.root, "a"), 2);
+    assertFloatsEqual(numberDouble(&value->number), 25.0);
+
+    assertIntegersEqual(domGetAt(&document.root, "b.t")->type, JSON_TYPE_TRUE);
+    assertIntegersEqual(domGetAt(&document.root, "b.f")->type, JSON_TYPE_FALSE);
+    assertIntegersEqual(domGetAt(&document.root, "b.n")->type, JSON_TYPE_NULL);
+    assertPointersEqual(domGetAt(&document.root, ""), &document.root);
+
+    assertIsNull(domGetAt(&document.root, "a.3"));
+    assertIsNull(domGetAt(&document.root, "a.x"));
+    assertIsNull(domGetAt(&document.root, "c"));
+    assertIsNull(domGetAt(&document.root, "b.t.x"));
+    assertIsNull(domElement(&document.root, 0));
+    documentRelease(&document);
+    assertIsNull(document.text);
+}
+
+void testJSONDomParseInvalid() {
+    const char *inputs[] = {
+        "", "[1,]", "[1 2]", "{\"a\" 1}", "{\"a\": 1,}", "{1: 2}", "[01]", "[1] 2", "[\"a\"", "{\"a\": }"
+    };
+    for(unsigned int i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        struct JSONDocument document;
+        unsigned int result = parseDocument(&document, inputs[i]);
+        assertIntegersEqual(result, STATUS_PARSE_ERR);
+        assertIsNull(document.text);
+        assertIsNull(document.nodes);
+    }
+}
+
+void testJSONDomIndex() {
+    // Large enough for a hash index, with a repeated key.
+    char input[2048] = "{";
+    for(unsigned int i = 0; i < 100; i++) {
+        sprintf(input + strlen(input), "\"k%u\": %u, ", i, i);
+    }
+    strcat(input, "\"k7\": 700}");
+
+    struct JSONDocument document;
+    unsigned int result = parseDocument(&document, input);
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(document.root.object.length, 101);
+
+    char key[8];
+    int64_t integer;
+    unsigned int found = 0;
+    for(unsigned int i = 0; i < 100; i++) {
+        sprintf(key, "k%u", i);
+        const struct JSONValue *value = domMember(&document.root, key);
+        if(value && numberInteger(&value->number, &integer) == STATUS_OK) {
+            found += integer == (i == 7 ? 700 : i);
+        }
+    }
+    assertIntegersEqual(found, 100);
+    assertIsNull(domMember(&document.root, "k100"));
+    assertIsNull(domMember(&document.root, "k"));
+    documentRelease(&document);
+
+    // Linear search also prefers the last member.
+    result = parseDocument(&document, "{\"a\": 1, \"a\": 2}");
+    assertIntegersEqual(result, STATUS_OK);
+    numberInteger(&domMember(&document.root, "a")->number, &integer);
+    assertIntegersEqual(integer, 2);
+    documentRelease(&document);
+}
+
+void testJSONDomUnparse() {
+    const char *input = "{ \"a\" : [1.50, \"x\\n\", {}], \"b\": {\"c\": null, \"d\": []} }";
+    struct JSONDocument document;
+    unsigned int result = parseDocument(&document, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char *output;
+    unsigned int outputLength;
+    struct JSONFormat fmt = {0, 0, 0};
+    result = unparseDocument(&document.root, &output, &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output, "{\"a\": [1.50,\"x\\n\",{}],\"b\": {\"c\": null,\"d\": []}}");
+    assertIntegersEqual(outputLength, strlen(output));
+    free(output);
+
+    // Empty containers are padded like unparseJSON does.
+    struct JSONFormat indented = {2, 0, 0};
+    result = unparseDocument(domMember(&document.root, "b"), &output, &outputLength, indented);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output, "{\r\n  \"c\": null,\r\n  \"d\": [  ]\r\n}");
+    free(output);
+
+    struct JSONFormat canonical = {0, 0, 0, 1};
+    result = unparseDocument(&document.root, &output, &outputLength, canonical);
+    assertIntegersEqual(result, STATUS_INPUT_ERR);
+    documentRelease(&document);
+}
+
+void testJSONDom() {
+    testJSONDomParse();
+    testJSONDomParseInvalid();
+    testJSONDomIndex();
+    testJSONDomUnparse();
+}
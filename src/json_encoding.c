@@ -0,0 +1,212 @@
+#include <string.h>
+#include <stdint.h>
+#include "json_encoding.h"
+#include "cutil/src/error.h"
+
+#define TRANSCODE_CHUNK 256
+
+enum ENCODING detectEncoding(const char *input, size_t length, unsigned int *markLength) {
+    const unsigned char *bytes = (const unsigned char*)input;
+    *markLength = 0;
+    if(length >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF) {
+        *markLength = 3;
+        return UTF8;
+    }
+    if(length >= 4 && !bytes[0] && !bytes[1] && bytes[2] == 0xFE && bytes[3] == 0xFF) {
+        *markLength = 4;
+        return UTF32BE;
+    }
+    if(length >= 4 && bytes[0] == 0xFF && bytes[1] == 0xFE && !bytes[2] && !bytes[3]) {
+        *markLength = 4;
+        return UTF32LE;
+    }
+    if(length >= 2 && bytes[0] == 0xFE && bytes[1] == 0xFF) {
+        *markLength = 2;
+        return UTF16BE;
+    }
+    if(length >= 2 && bytes[0] == 0xFF && bytes[1] == 0xFE) {
+        *markLength = 2;
+        return UTF16LE;
+    }
+
+    // JSON text starts with ASCII, so the nulls give the encoding away.
+    if(length >= 4 && !bytes[0] && !bytes[1] && !bytes[2]) return UTF32BE;
+    if(length >= 4 && bytes[0] && !bytes[1] && !bytes[2] && !bytes[3]) return UTF32LE;
+    if(length >= 2 && !bytes[0] && bytes[1]) return UTF16BE;
+    if(length >= 2 && bytes[0] && !bytes[1]) return UTF16LE;
+    return UTF8;
+}
+
+unsigned int validateUTF8(const char *data, size_t length) {
+    const unsigned char *bytes = (const unsigned char*)data;
+    const unsigned char *end = bytes + length;
+    while(bytes < end) {
+        // Skip ASCII a word at a time.
+        if(end - bytes >= 8) {
+            uint64_t word;
+            memcpy(&word, bytes, 8);
+            if((word & 0x8080808080808080ULL) == 0) {
+                bytes += 8;
+                continue;
+            }
+        }
+        if(*bytes < 0x80) {
+            bytes++;
+            continue;
+        }
+
+        // Allowed range of the second byte depends on the first, the rest
+        // are plain continuation bytes.
+        unsigned int count;
+        unsigned char low = 0x80, high = 0xBF;
+        if(*bytes >= 0xC2 && *bytes <= 0xDF) {
+            count = 1;
+        } else if(*bytes >= 0xE0 && *bytes <= 0xEF) {
+            count = 2;
+            if(*bytes == 0xE0) low = 0xA0;
+            if(*bytes == 0xED) high = 0x9F;
+        } else if(*bytes >= 0xF0 && *bytes <= 0xF4) {
+            count = 3;
+            if(*bytes == 0xF0) low = 0x90;
+            if(*bytes == 0xF4) high = 0x8F;
+        } else {
+            return STATUS_PARSE_ERR;
+        }
+        if(end - bytes <= count) return STATUS_PARSE_ERR;
+        if(bytes[1] < low || bytes[1] > high) return STATUS_PARSE_ERR;
+        for(unsigned int i = 2; i <= count; i++) {
+            if((bytes[i] & 0xC0) != 0x80) return STATUS_PARSE_ERR;
+        }
+        bytes += count + 1;
+    }
+    return STATUS_OK;
+}
+
+void transcoderCompose(struct JSONTranscoder *transcoder, enum ENCODING encoding) {
+    transcoder->encoding = encoding;
+    transcoder->partialLength = 0;
+    transcoder->surrogate = 0;
+}
+
+static unsigned int unitSize(enum ENCODING encoding) {
+    return encoding == UTF16BE || encoding == UTF16LE ? 2 : 4;
+}
+
+static unsigned long readUnit(enum ENCODING encoding, const unsigned char *bytes) {
+    switch(encoding) {
+    case UTF16BE:
+        return (unsigned long)bytes[0] << 8 | bytes[1];
+    case UTF16LE:
+        return (unsigned long)bytes[1] << 8 | bytes[0];
+    case UTF32BE:
+        return (unsigned long)bytes[0] << 24 | (unsigned long)bytes[1] << 16
+            | (unsigned long)bytes[2] << 8 | bytes[3];
+    default:
+        return (unsigned long)bytes[3] << 24 | (unsigned long)bytes[2] << 16
+            | (unsigned long)bytes[1] << 8 | bytes[0];
+    }
+}
+
+static unsigned int transcodeUnit(
+        struct JSONTranscoder *transcoder,
+        struct JSONBuffer *output,
+        unsigned long unit) {
+    if(transcoder->surrogate) {
+        if(unit < 0xDC00 || unit > 0xDFFF) return STATUS_PARSE_ERR;
+        unit = 0x10000 + ((transcoder->surrogate - 0xD800) << 10) + (unit - 0xDC00);
+        transcoder->surrogate = 0;
+        return bufferAppendUTF8(output, unit);
+    }
+    if(unit >= 0xD800 && unit <= 0xDBFF && unitSize(transcoder->encoding) == 2) {
+        transcoder->surrogate = unit;
+        return STATUS_OK;
+    }
+    if(unit == 0 || (unit >= 0xD800 && unit <= 0xDFFF) || unit > 0x10FFFF) {
+        return STATUS_PARSE_ERR;
+    }
+    return bufferAppendUTF8(output, unit);
+}
+
+// Byte pattern of a word holding only ASCII units: every bit set in the
+// mask must be clear.
+static uint64_t asciiMask(enum ENCODING encoding) {
+    static const unsigned char masks[4][8] = {
+        {0xFF, 0xFF, 0xFF, 0x80, 0xFF, 0xFF, 0xFF, 0x80},
+        {0x80, 0xFF, 0xFF, 0xFF, 0x80, 0xFF, 0xFF, 0xFF},
+        {0xFF, 0x80, 0xFF, 0x80, 0xFF, 0x80, 0xFF, 0x80},
+        {0x80, 0xFF, 0x80, 0xFF, 0x80, 0xFF, 0x80, 0xFF}
+    };
+    uint64_t mask;
+    memcpy(&mask, masks[encoding], sizeof(mask));
+    return mask;
+}
+
+unsigned int transcodeChunk(
+        struct JSONTranscoder *transcoder,
+        struct JSONBuffer *output,
+        const char *input,
+        size_t length) {
+    if(transcoder->encoding == UTF8) return bufferAppend(output, input, length);
+
+    const unsigned char *bytes = (const unsigned char*)input;
+    unsigned int size = unitSize(transcoder->encoding);
+    unsigned int result;
+
+    // Finish a unit split by the previous chunk.
+    while(transcoder->partialLength && length) {
+        transcoder->partial[transcoder->partialLength++] = *bytes++;
+        length--;
+        if(transcoder->partialLength == size) {
+            transcoder->partialLength = 0;
+            result = transcodeUnit(transcoder, output, readUnit(transcoder->encoding, transcoder->partial));
+            if(result) return result;
+        }
+    }
+
+    // Runs of ASCII are checked a word at a time and only need their low
+    // bytes copied out.
+    uint64_t mask = asciiMask(transcoder->encoding);
+    unsigned int low = transcoder->encoding == UTF16BE ? 1 : transcoder->encoding == UTF32BE ? 3 : 0;
+    char ascii[TRANSCODE_CHUNK];
+    unsigned int asciiLength = 0;
+    while(length >= size) {
+        uint64_t word;
+        if(length >= 8 && !transcoder->surrogate
+                && (memcpy(&word, bytes, 8), (word & mask) == 0)
+                && (size == 4 ? bytes[low] && bytes[4 + low] :
+                    bytes[low] && bytes[2 + low] && bytes[4 + low] && bytes[6 + low])) {
+            for(unsigned int i = low; i < 8; i += size) ascii[asciiLength++] = bytes[i];
+            bytes += 8;
+            length -= 8;
+            if(asciiLength + 4 > TRANSCODE_CHUNK) {
+                result = bufferAppend(output, ascii, asciiLength);
+                if(result) return result;
+                asciiLength = 0;
+            }
+            continue;
+        }
+
+        if(asciiLength) {
+            result = bufferAppend(output, ascii, asciiLength);
+            if(result) return result;
+            asciiLength = 0;
+        }
+        result = transcodeUnit(transcoder, output, readUnit(transcoder->encoding, bytes));
+        if(result) return result;
+        bytes += size;
+        length -= size;
+    }
+    if(asciiLength) {
+        result = bufferAppend(output, ascii, asciiLength);
+        if(result) return result;
+    }
+
+    memcpy(transcoder->partial, bytes, length);
+    transcoder->partialLength = length;
+    return STATUS_OK;
+}
+
+unsigned int transcodeFinish(struct JSONTranscoder *transcoder) {
+    if(transcoder->partialLength || transcoder->surrogate) return STATUS_PARSE_ERR;
+    return STATUS_OK;
+}
@@ -0,0 +1,44 @@
+#ifndef __JSON_ENCODING_H
+#define __JSON_ENCODING_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stddef.h>
+#include "json_lexer.h"
+#include "json_buffer.h"
+
+// Encoding of a JSON text from its byte order mark or, without one, the
+// pattern of null bytes its first two characters leave (RFC 4627). The
+// mark's length is returned so it can be skipped.
+enum ENCODING detectEncoding(const char *input, size_t length, unsigned int *markLength);
+
+// STATUS_PARSE_ERR unless data is well formed UTF-8 (RFC 3629): no
+// overlong forms, surrogates or code points past U+10FFFF.
+unsigned int validateUTF8(const char *data, size_t length);
+
+// Converts UTF-16 or UTF-32 to UTF-8 a chunk at a time. Code units split
+// between chunks are carried over to the next one.
+struct JSONTranscoder {
+    enum ENCODING encoding;
+    unsigned char partial[4];
+    unsigned int partialLength;
+    // High surrogate waiting for its pair.
+    unsigned long surrogate;
+};
+
+void transcoderCompose(struct JSONTranscoder *transcoder, enum ENCODING encoding);
+// Malformed input, including U+0000 which JSON text cannot contain raw,
+// is a STATUS_PARSE_ERR.
+unsigned int transcodeChunk(
+    struct JSONTranscoder *transcoder,
+    struct JSONBuffer *output,
+    const char *input,
+    size_t length);
+// Fails when the input ended inside a character.
+unsigned int transcodeFinish(struct JSONTranscoder *transcoder);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_parser.h"
+#include "json_encoding.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+// Encode ASCII or UTF-8 text the slow obvious way for comparison.
+static size_t encodeText(char *output, const char *text, enum ENCODING encoding) {
+    size_t length = 0;
+    const unsigned char *s = (const unsigned char*)text;
+    while(*s) {
+        unsigned long codePoint = *s;
+        unsigned int extra = *s >= 0xF0 ? 3 : *s >= 0xE0 ? 2 : *s >= 0xC0 ? 1 : 0;
+        if(extra) codePoint &= 0x3F >> extra;
+        s++;
+        for(unsigned int i = 0; i < extra; i++) codePoint = codePoint << 6 | (*s++ & 0x3F);
+
+        unsigned long units[2] = {codePoint, 0};
+        unsigned int unitCount = 1;
+        if((encoding == UTF16BE || encoding == UTF16LE) && codePoint >= 0x10000) {
+            units[0] = 0xD800 + ((codePoint - 0x10000) >> 10);
+            units[1] = 0xDC00 + ((codePoint - 0x10000) & 0x3FF);
+            unitCount = 2;
+        }
+        for(unsigned int u = 0; u < unitCount; u++) {
+            unsigned int size = encoding == UTF16BE || encoding == UTF16LE ? 2 : 4;
+            for(unsigned int i = 0; i < size; i++) {
+                unsigned int shift = encoding == UTF16BE || encoding == UTF32BE ? (size - 1 - i) * 8 : i * 8;
+                output[length++] = (char)(units[u] >> shift);
+            }
+        }
+    }
+    return length;
+}
+
+void testJSONEncodingDetect() {
+    unsigned int markLength;
+    assertIntegersEqual(detectEncoding("\xEF\xBB\xBF{}", 5, &markLength), UTF8);
+    assertIntegersEqual(markLength, 3);
+    assertIntegersEqual(detectEncoding("\xFE\xFF\0[", 4, &markLength), UTF16BE);
+    assertIntegersEqual(markLength, 2);
+    assertIntegersEqual(detectEncoding("\xFF\xFE\0\0[\0\0\0", 8, &markLength), UTF32LE);
+    assertIntegersEqual(markLength, 4);
+    assertIntegersEqual(detectEncoding("\0\0\xFE\xFF", 4, &markLength), UTF32BE);
+    assertIntegersEqual(markLength, 4);
+
+    assertIntegersEqual(detectEncoding("\0\0\0[", 4, &markLength), UTF32BE);
+    assertIntegersEqual(markLength, 0);
+    assertIntegersEqual(detectEncoding("[\0\0\0", 4, &markLength), UTF32LE);
+    assertIntegersEqual(detectEncoding("\0[\0 ", 4, &markLength), UTF16BE);
+    assertIntegersEqual(detectEncoding("1\0", 2, &markLength), UTF16LE);
+    assertIntegersEqual(detectEncoding("[1]", 3, &markLength), UTF8);
+}
+
+void testJSONEncodingTranscode() {
+    const char *text = "{\"key\": \"long enough to take the word path\", \"\xc3\xa9\xe2\x82\xac\": \"\xf0\x9f\x98\x80\"}";
+    enum ENCODING encodings[] = {UTF16LE, UTF16BE, UTF32LE, UTF32BE};
+    char encoded[512];
+    for(unsigned int e = 0; e < 4; e++) {
+        size_t length = encodeText(encoded, text, encodings[e]);
+
+        // Every split point must give the same text.
+        for(size_t split = 0; split <= length; split += 3) {
+            struct JSONTranscoder transcoder;
+            transcoderCompose(&transcoder, encodings[e]);
+            struct JSONBuffer output;
+            bufferCompose(&output);
+            assertIntegersEqual(transcodeChunk(&transcoder, &output, encoded, split), STATUS_OK);
+            assertIntegersEqual(transcodeChunk(&transcoder, &output, encoded + split, length - split), STATUS_OK);
+            assertIntegersEqual(transcodeFinish(&transcoder), STATUS_OK);
+            bufferTerminate(&output);
+            assertStringsEqual(output.data, text);
+            bufferRelease(&output);
+        }
+
+        struct Generic *generic;
+        assertIntegersEqual(parseJSONEncoded(&generic, encoded, length), STATUS_OK);
+        assertStringsEqual(*(char**)genericData(getAt(generic, "key")), "long enough to take the word path");
+        genericRelease(generic);
+    }
+}
+
+void testJSONEncodingErrors() {
+    struct JSONTranscoder transcoder;
+    struct JSONBuffer output;
+    bufferCompose(&output);
+
+    // Lone low surrogate.
+    transcoderCompose(&transcoder, UTF16LE);
+    assertIntegersEqual(transcodeChunk(&transcoder, &output, "\x00\xDC", 2), STATUS_PARSE_ERR);
+    // High surrogate at the end.
+    transcoderCompose(&transcoder, UTF16BE);
+    assertIntegersEqual(transcodeChunk(&transcoder, &output, "\xD8\x3D", 2), STATUS_OK);
+    assertIntegersEqual(transcodeFinish(&transcoder), STATUS_PARSE_ERR);
+    // Past the last code point.
+    transcoderCompose(&transcoder, UTF32BE);
+    assertIntegersEqual(transcodeChunk(&transcoder, &output, "\0\x11\0\0", 4), STATUS_PARSE_ERR);
+    // Truncated unit.
+    transcoderCompose(&transcoder, UTF32LE);
+    assertIntegersEqual(transcodeChunk(&transcoder, &output, "[\0\0", 3), STATUS_OK);
+    assertIntegersEqual(transcodeFinish(&transcoder), STATUS_PARSE_ERR);
+    bufferRelease(&output);
+
+    struct Generic *generic;
+    assertIntegersEqual(parseJSONEncoded(&generic, "[1,\0 2]", 7), STATUS_PARSE_ERR);
+    assertIsNull(generic);
+    assertIntegersEqual(parseJSONEncoded(&generic, "\xEF\xBB\xBF[1]", 6), STATUS_OK);
+    assertIntegersEqual(*(long*)genericData(getAt(generic, "0")), 1);
+    genericRelease(generic);
+}
+
+void testJSONEncodingValidate() {
+    assertIntegersEqual(validateUTF8("", 0), STATUS_OK);
+    assertIntegersEqual(validateUTF8("plain ascii longer than a word", 30), STATUS_OK);
+    assertIntegersEqual(validateUTF8("\xc2\x80\xdf\xbf\xe0\xa0\x80\xef\xbf\xbf", 10), STATUS_OK);
+    assertIntegersEqual(validateUTF8("\xf0\x90\x80\x80\xf4\x8f\xbf\xbf", 8), STATUS_OK);
+
+    // Overlong forms.
+    assertIntegersEqual(validateUTF8("\xc1\xbf", 2), STATUS_PARSE_ERR);
+    assertIntegersEqual(validateUTF8("\xe0\x9f\xbf", 3), STATUS_PARSE_ERR);
+    assertIntegersEqual(validateUTF8("\xf0\x8f\xbf\xbf", 4), STATUS_PARSE_ERR);
+    // Surrogates and past U+10FFFF.
+    assertIntegersEqual(validateUTF8("\xed\xbf\xbf", 3), STATUS_PARSE_ERR);
+    assertIntegersEqual(validateUTF8("\xf5\x80\x80\x80", 4), STATUS_PARSE_ERR);
+    // Stray and missing continuation bytes.
+    assertIntegersEqual(validateUTF8("abcdefgh\x80", 9), STATUS_PARSE_ERR);
+    assertIntegersEqual(validateUTF8("\xe2\x28\xa1", 3), STATUS_PARSE_ERR);
+    assertIntegersEqual(validateUTF8("\xe2\x82", 2), STATUS_PARSE_ERR);
+}
+
+void testJSONEncoding() {
+    testJSONEncodingValidate();
+    testJSONEncodingDetect();
+    testJSONEncodingTranscode();
+    testJSONEncodingErrors();
+}
@@ -0,0 +1,48 @@
+#include <stdlib.h>
+#include "json_frozen.h"
+#include "cutil/src/error.h"
+
+unsigned int frozenCompose(struct JSONFrozen **frozen, const char *toCheck) {
+    *frozen = malloc(sizeof(struct JSONFrozen));
+    if(*frozen == NULL) return STATUS_ALLOC_ERR;
+    unsigned int result = parseDocument(&(*frozen)->document, toCheck);
+    if(result) {
+        free(*frozen);
+        *frozen = NULL;
+        return result;
+    }
+    (*frozen)->references = 1;
+    return STATUS_OK;
+}
+
+unsigned int freezeJSON(struct JSONFrozen **frozen, struct Generic *generic) {
+    struct JSONUnparser unparser;
+    unparserCompose(&unparser);
+    // Canonical numbers are the shortest that read back to the same value,
+    // plain output would round fractions to six places.
+    struct JSONFormat fmt = {0, 0, 0, 1};
+    const char *text;
+    unsigned int length;
+    unsigned int result = unparseJSONWith(&unparser, generic, &text, &length, fmt);
+    if(result == STATUS_OK) result = frozenCompose(frozen, text);
+    unparserRelease(&unparser);
+    return result;
+}
+
+struct JSONFrozen *frozenRetain(struct JSONFrozen *frozen) {
+    // Whoever retains already holds a reference, so no ordering is needed.
+    __atomic_fetch_add(&frozen->references, 1, __ATOMIC_RELAXED);
+    return frozen;
+}
+
+void frozenRelease(struct JSONFrozen *frozen) {
+    if(frozen == NULL) return;
+    // Reads by other holders happen before the last one frees.
+    if(__atomic_fetch_sub(&frozen->references, 1, __ATOMIC_ACQ_REL) != 1) return;
+    documentRelease(&frozen->document);
+    free(frozen);
+}
+
+const struct JSONValue *frozenRoot(const struct JSONFrozen *frozen) {
+    return &frozen->document.root;
+}
@@ -0,0 +1,35 @@
+#ifndef __JSON_FROZEN_H
+#define __JSON_FROZEN_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include "json_dom.h"
+#include "cutil/src/generic/generic.h"
+
+// Read only document shared between threads by reference. Nothing writes
+// to it after it is built, so lookups with json_dom.h, walking the node
+// arrays and unparseDocument need no locking.
+struct JSONFrozen {
+    struct JSONDocument document;
+    // Only touched through atomic builtins, <stdatomic.h> is not usable
+    // from C++ before C++23.
+    unsigned int references;
+};
+
+// Both start with one reference held by the caller.
+unsigned int frozenCompose(struct JSONFrozen **frozen, const char *toCheck);
+// The tree is serialized in canonical form, members sorted and numbers
+// exact, then parsed like frozenCompose. It is not kept.
+unsigned int freezeJSON(struct JSONFrozen **frozen, struct Generic *generic);
+
+struct JSONFrozen *frozenRetain(struct JSONFrozen *frozen);
+// The last reference dropped frees the document.
+void frozenRelease(struct JSONFrozen *frozen);
+
+const struct JSONValue *frozenRoot(const struct JSONFrozen *frozen);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
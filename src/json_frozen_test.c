@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "json_frozen.h"
+#include "json_number.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+#define FROZEN_TEST_THREADS 4
+
+struct FrozenReader {
+    struct JSONFrozen *frozen;
+    pthread_t thread;
+    unsigned int matches;
+    unsigned int result;
+};
+
+// Each reader owns a reference and drops it when done, so the document
+// outlives whichever finishes last.
+static void *frozenRead(void *data) {
+    struct FrozenReader *reader = data;
+    const struct JSONValue *root = frozenRoot(reader->frozen);
+    for(unsigned int round = 0; round < 100; round++) {
+        const struct JSONValue *records = domMember(root, "records");
+        for(unsigned int i = 0; records && i < records->array.length; i++) {
+            int64_t id = -1;
+            const struct JSONValue *value = domMember(domElement(records, i), "id");
+            if(value && numberInteger(&value->number, &id) == STATUS_OK && id == i) reader->matches++;
+        }
+        char *output;
+        unsigned int outputLength;
+        struct JSONFormat fmt = {0, 0, 0};
+        reader->result |= unparseDocument(root, &output, &outputLength, fmt);
+        free(output);
+    }
+    frozenRelease(reader->frozen);
+    return NULL;
+}
+
+void testJSONFrozenShared() {
+    struct JSONFrozen *frozen;
+    unsigned int result = frozenCompose(&frozen,
+        "{\"records\": [{\"id\": 0}, {\"id\": 1}, {\"id\": 2}], \"name\": \"shared\"}");
+    assertIntegersEqual(result, STATUS_OK);
+
+    struct FrozenReader readers[FROZEN_TEST_THREADS];
+    for(unsigned int i = 0; i < FROZEN_TEST_THREADS; i++) {
+        readers[i].frozen = frozenRetain(frozen);
+        readers[i].matches = 0;
+        readers[i].result = STATUS_OK;
+        pthread_create(&readers[i].thread, NULL, frozenRead, &readers[i]);
+    }
+    // The creator may let go while readers are still running.
+    frozenRelease(frozen);
+
+    unsigned int matches = 0;
+    unsigned int results = STATUS_OK;
+    for(unsigned int i = 0; i < FROZEN_TEST_THREADS; i++) {
+        pthread_join(readers[i].thread, NULL);
+        matches += readers[i].matches;
+        results |= readers[i].result;
+    }
+    assertIntegersEqual(matches, FROZEN_TEST_THREADS * 100 * 3);
+    assertIntegersEqual(results, STATUS_OK);
+}
+
+void testJSONFrozenFromGeneric() {
+    char input[] = "[{\"key\": \"value\"}, 12.5, null, 1e-7, 0.1]";
+    struct Generic *generic = NULL;
+    assertIntegersEqual(parseJSON(&generic, input), STATUS_OK);
+
+    struct JSONFrozen *frozen;
+    assertIntegersEqual(freezeJSON(&frozen, generic), STATUS_OK);
+    genericRelease(generic);
+
+    assertIntegersEqual(frozen->references, 1);
+    const struct JSONValue *value = domGetAt(frozenRoot(frozen), "0.key");
+    assertIntegersEqual(value->type, JSON_TYPE_STRING);
+    assertIntegersEqual(strncmp(value->string.value, "value", 5), 0);
+    assertIntegersEqual(domGetAt(frozenRoot(frozen), "2")->type, JSON_TYPE_NULL);
+
+    // Numbers keep every digit the tree holds.
+    assertIntegersEqual(numberDouble(&domGetAt(frozenRoot(frozen), "1")->number) == 12.5, 1);
+    const struct JSONValue *small = domGetAt(frozenRoot(frozen), "3");
+    assertIntegersEqual(small->type, JSON_TYPE_NUMBER);
+    assertIntegersEqual((float)numberDouble(&small->number) == 1e-7f, 1);
+    const struct JSONValue *tenth = domGetAt(frozenRoot(frozen), "4");
+    assertIntegersEqual((float)numberDouble(&tenth->number) == 0.1f, 1);
+
+    assertPointersEqual(frozenRetain(frozen), frozen);
+    assertIntegersEqual(frozen->references, 2);
+    frozenRelease(frozen);
+    frozenRelease(frozen);
+    frozenRelease(NULL);
+}
+
+void testJSONFrozenInvalid() {
+    struct JSONFrozen *frozen;
+    assertIntegersEqual(frozenCompose(&frozen, "[1,"), STATUS_PARSE_ERR);
+    assertIsNull(frozen);
+}
+
+void testJSONFrozen() {
+    testJSONFrozenShared();
+    testJSONFrozenFromGeneric();
+    testJSONFrozenInvalid();
+}
@@ -0,0 +1,148 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_index.h"
+#include "json_patch.h"
+#include "cutil/src/error.h"
+#include "cutil/src/map/map.h"
+
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t length) {
+    const unsigned char *bytes = data;
+    for(size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static uint64_t hashString(const char *key) {
+    return hashBytes(0xCBF29CE484222325ULL, key, strlen(key));
+}
+
+// Integers and floats with the same value must land in the same slot.
+static uint64_t hashNumber(double value) {
+    if(value == 0) value = 0;
+    return hashBytes(0x84222325CBF29CE4ULL, &value, sizeof(value));
+}
+
+static int isNumber(struct Generic *generic) {
+    return generic->object == &Integer || generic->object == &Float;
+}
+
+static double numberValue(struct Generic *generic) {
+    if(generic->object == &Integer) return *((long*)genericData(generic));
+    return *((float*)genericData(generic));
+}
+
+// Containers all share one hash and are told apart by jsonEquals.
+static uint64_t hashGeneric(struct Generic *generic) {
+    if(generic->object == &String) return hashString(*((char**)genericData(generic)));
+    if(isNumber(generic)) return hashNumber(numberValue(generic));
+    if(generic->object == &Boolean) return *((char*)genericData(generic)) ? 1 : 2;
+    if(generic->object == &Pointer) return 3;
+    return 4;
+}
+
+static unsigned int indexSlots(unsigned int length) {
+    unsigned int slots = 16;
+    while(slots < length * 2) slots *= 2;
+    return slots;
+}
+
+unsigned int indexCompose(struct JSONIndex *index, struct Generic *array, const char *path) {
+    index->entries = NULL;
+    index->count = 0;
+    index->slots = NULL;
+    index->slotCount = 0;
+    if(array->object != &Array.object) return STATUS_INPUT_ERR;
+
+    struct Collection *collection = (struct Collection*)array->object;
+    struct Iterator iterator = collection->iterator(genericData(array));
+    unsigned int length = 0;
+    while(collection->next(&iterator)) length++;
+
+    index->slotCount = indexSlots(length);
+    index->entries = malloc((length ? length : 1) * sizeof(struct JSONIndexEntry));
+    index->slots = calloc(index->slotCount, sizeof(unsigned int));
+    if(index->entries == NULL || index->slots == NULL) {
+        indexRelease(index);
+        return STATUS_ALLOC_ERR;
+    }
+
+    iterator = collection->iterator(genericData(array));
+    struct Generic *element;
+    for(unsigned int position = 0; (element = collection->next(&iterator)); position++) {
+        if(element->object != &Map.object) continue;
+        struct Generic *key = strchr(path, '.') ? getAt(element, path) : jsonMember(element, path);
+        if(key == NULL) continue;
+        struct JSONIndexEntry *entry = &index->entries[index->count++];
+        entry->element = element;
+        entry->key = key;
+        entry->position = position;
+        entry->hash = hashGeneric(key);
+        entry->next = NULL;
+    }
+
+    // Inserting from the back and prepending keeps duplicates in order.
+    unsigned int mask = index->slotCount - 1;
+    for(unsigned int i = index->count; i-- > 0;) {
+        struct JSONIndexEntry *entry = &index->entries[i];
+        unsigned int slot = entry->hash & mask;
+        while(index->slots[slot]) {
+            struct JSONIndexEntry *head = &index->entries[index->slots[slot] - 1];
+            if(head->hash == entry->hash && jsonEquals(head->key, entry->key)) {
+                entry->next = head;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        index->slots[slot] = i + 1;
+    }
+    return STATUS_OK;
+}
+
+void indexRelease(struct JSONIndex *index) {
+    free(index->entries);
+    free(index->slots);
+    index->entries = NULL;
+    index->count = 0;
+    index->slots = NULL;
+    index->slotCount = 0;
+}
+
+// Walk the probe sequence of hash, matches decides on candidate keys.
+static const struct JSONIndexEntry *indexProbe(
+        const struct JSONIndex *index,
+        uint64_t hash,
+        int (*matches)(struct Generic *key, const void *probe),
+        const void *probe) {
+    if(index->slotCount == 0) return NULL;
+    unsigned int mask = index->slotCount - 1;
+    for(unsigned int slot = hash & mask; index->slots[slot]; slot = (slot + 1) & mask) {
+        const struct JSONIndexEntry *entry = &index->entries[index->slots[slot] - 1];
+        if(entry->hash == hash && matches(entry->key, probe)) return entry;
+    }
+    return NULL;
+}
+
+static int matchesGeneric(struct Generic *key, const void *probe) {
+    return jsonEquals(key, (struct Generic*)probe);
+}
+
+static int matchesString(struct Generic *key, const void *probe) {
+    return key->object == &String && strcmp(*((char**)genericData(key)), probe) == 0;
+}
+
+static int matchesNumber(struct Generic *key, const void *probe) {
+    return isNumber(key) && numberValue(key) == *((const double*)probe);
+}
+
+const struct JSONIndexEntry *indexFind(const struct JSONIndex *index, struct Generic *key) {
+    return indexProbe(index, hashGeneric(key), matchesGeneric, key);
+}
+
+const struct JSONIndexEntry *indexFindString(const struct JSONIndex *index, const char *key) {
+    return indexProbe(index, hashString(key), matchesString, key);
+}
+
+const struct JSONIndexEntry *indexFindNumber(const struct JSONIndex *index, double key) {
+    return indexProbe(index, hashNumber(key), matchesNumber, &key);
+}
@@ -0,0 +1,46 @@
+#ifndef __JSON_INDEX_H
+#define __JSON_INDEX_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stdint.h>
+#include "cutil/src/generic/generic.h"
+
+// Element of the indexed array that has the key member.
+struct JSONIndexEntry {
+    struct Generic *element;
+    struct Generic *key;
+    unsigned int position;
+    uint64_t hash;
+    // Next element with an equal key, in array order.
+    const struct JSONIndexEntry *next;
+};
+
+// Hash index over an array of objects keyed by the value at a member
+// path. It refers into the array, which must outlive it and not change
+// while it is used. Any number of indexes may cover the same array.
+struct JSONIndex {
+    struct JSONIndexEntry *entries;
+    unsigned int count;
+    // Open addressing, slots hold the entry index plus one of the first
+    // element of each distinct key.
+    unsigned int *slots;
+    unsigned int slotCount;
+};
+
+// Path is dot separated as for getAt. Elements that are not objects or
+// lack the member are left out. Keys compare as jsonEquals does, numbers
+// by value whatever their type.
+unsigned int indexCompose(struct JSONIndex *index, struct Generic *array, const char *path);
+void indexRelease(struct JSONIndex *index);
+
+// First element in array order with the key, NULL when there is none.
+const struct JSONIndexEntry *indexFind(const struct JSONIndex *index, struct Generic *key);
+const struct JSONIndexEntry *indexFindString(const struct JSONIndex *index, const char *key);
+const struct JSONIndexEntry *indexFindNumber(const struct JSONIndex *index, double key);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
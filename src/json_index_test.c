@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json_index.h"
+#include "json_parser.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+static char records[] = "["
+    "{\"id\": 1, \"name\": \"a\", \"owner\": {\"team\": \"x\"}},"
+    "{\"id\": 2, \"name\": \"b\", \"owner\": {\"team\": \"y\"}},"
+    "\"not a record\","
+    "{\"name\": \"c\", \"owner\": {\"team\": \"x\"}},"
+    "{\"id\": 4.0, \"name\": \"d\"}"
+"]";
+
+void testJSONIndexLookup() {
+    struct Generic *array = NULL;
+    char *input = malloc(sizeof(records));
+    memcpy(input, records, sizeof(records));
+    assertIntegersEqual(parseJSON(&array, input), STATUS_OK);
+
+    // Two indexes over the same array.
+    struct JSONIndex byId;
+    struct JSONIndex byName;
+    assertIntegersEqual(indexCompose(&byId, array, "id"), STATUS_OK);
+    assertIntegersEqual(indexCompose(&byName, array, "name"), STATUS_OK);
+    assertIntegersEqual(byId.count, 3);
+    assertIntegersEqual(byName.count, 4);
+
+    const struct JSONIndexEntry *entry = indexFindNumber(&byId, 2);
+    assertNotNull(entry);
+    assertIntegersEqual(entry->position, 1);
+    // Floats and integers with the same value are the same key.
+    entry = indexFindNumber(&byId, 4);
+    assertNotNull(entry);
+    assertIntegersEqual(entry->position, 4);
+    assertIsNull(indexFindNumber(&byId, 3));
+    assertIsNull(indexFindString(&byId, "1"));
+
+    entry = indexFindString(&byName, "c");
+    assertNotNull(entry);
+    assertIntegersEqual(entry->position, 3);
+    assertPointersEqual(entry->element, getAt(array, "3"));
+
+    struct Generic *key = getAt(array, "0.id");
+    entry = indexFind(&byId, key);
+    assertNotNull(entry);
+    assertIntegersEqual(entry->position, 0);
+
+    indexRelease(&byId);
+    indexRelease(&byName);
+    genericRelease(array);
+    free(input);
+}
+
+void testJSONIndexDuplicates() {
+    struct Generic *array = NULL;
+    char *input = malloc(sizeof(records));
+    memcpy(input, records, sizeof(records));
+    assertIntegersEqual(parseJSON(&array, input), STATUS_OK);
+
+    struct JSONIndex byTeam;
+    assertIntegersEqual(indexCompose(&byTeam, array, "owner.team"), STATUS_OK);
+    const struct JSONIndexEntry *entry = indexFindString(&byTeam, "x");
+    assertNotNull(entry);
+    assertIntegersEqual(entry->position, 0);
+    assertNotNull(entry->next);
+    assertIntegersEqual(entry->next->position, 3);
+    assertIsNull(entry->next->next);
+    assertIntegersEqual(indexFindString(&byTeam, "y")->position, 1);
+    indexRelease(&byTeam);
+
+    struct JSONIndex invalid;
+    assertIntegersEqual(indexCompose(&invalid, getAt(array, "0"), "id"), STATUS_INPUT_ERR);
+    assertIsNull(indexFindString(&invalid, "a"));
+    indexRelease(&invalid);
+    genericRelease(array);
+    free(input);
+}
+
+void testJSONIndexLarge() {
+    // Enough records to wrap probes around the table.
+    char *input = malloc(64 * 1024);
+    unsigned int length = 0;
+    input[length++] = '[';
+    for(unsigned int i = 0; i < 1000; i++) {
+        length += sprintf(input + length, "%s{\"id\": \"k%u\", \"n\": %u}", i ? "," : "", i, i);
+    }
+    input[length++] = ']';
+    input[length] = '\0';
+    struct Generic *array = NULL;
+    assertIntegersEqual(parseJSON(&array, input), STATUS_OK);
+
+    struct JSONIndex byId;
+    assertIntegersEqual(indexCompose(&byId, array, "id"), STATUS_OK);
+    unsigned int found = 0;
+    char key[16];
+    for(unsigned int i = 0; i < 1000; i++) {
+        sprintf(key, "k%u", i);
+        const struct JSONIndexEntry *entry = indexFindString(&byId, key);
+        found += entry && entry->position == i && !entry->next;
+    }
+    assertIntegersEqual(found, 1000);
+    assertIsNull(indexFindString(&byId, "k1000"));
+    indexRelease(&byId);
+    genericRelease(array);
+    free(input);
+}
+
+void testJSONIndex() {
+    testJSONIndexLookup();
+    testJSONIndexDuplicates();
+    testJSONIndexLarge();
+}
@@ -1,6 +1,8 @@
 #include <stdlib.h>
+#include <string.h>
 #include "json.h"
 #include "json_lexer.h"
+#include "json_encoding.h"
 #include "cutil/src/error.h"
 #include "cutil/src/string.h"
 
@@ -11,6 +13,7 @@ struct JSONToken *tokenCopy(struct JSONToken *other) {
     token->lexeme = other->lexeme;
     token->col = other->col;
     token->row = other->row;
+    token->count = other->count;
     return token;
 }
 
@@ -97,15 +100,9 @@ static unsigned int lexInvalid(struct JSONToken *t, char *toCheck) {
     return 1;
 }
 
-unsigned int lexJSON(struct List *tokens, char *toCheck) {
-    unsigned int result = STATUS_OK;
-
-    struct JSONToken token;
-    token.row = 0;
-    token.col = 0;
-    token.lexeme = NULL;
-    token.token = JSON_TOKEN_INVALID;
-
+// Try each lexer in turn, returning the length of the token found or 0.
+// Strings holding malformed UTF-8 become invalid tokens unless trusted.
+static unsigned int lexToken(struct JSONToken *token, char *toCheck, int trusted) {
     unsigned int (*lexers[])(struct JSONToken*, char*) = {
         lexWhitespace,
         lexString,
@@ -116,34 +113,278 @@ unsigned int lexJSON(struct List *tokens, char *toCheck) {
         lexInvalid
     };
 
-    unsigned int offset;
+    for(unsigned int i = 0; i < sizeof(lexers) / sizeof(lexers[0]); i++) {
+        unsigned int offset = lexers[i](token, toCheck);
+        if(offset) {
+            token->lexeme = toCheck;
+            if(token->token == JSON_TOKEN_STRING && !trusted
+                    && validateUTF8(toCheck + 1, offset - 2)) {
+                token->token = JSON_TOKEN_INVALID;
+            }
+            return offset;
+        }
+    }
+    return 0;
+}
+
+unsigned int lexJSON(struct List *tokens, char *toCheck) {
+    unsigned int result = STATUS_OK;
+
+    struct JSONToken token;
+    token.row = 0;
+    token.col = 0;
+    token.lexeme = NULL;
+    token.token = JSON_TOKEN_INVALID;
+    token.count = 0;
+
     while(*toCheck) {
-        for(unsigned int i = 0; i < sizeof(lexers) / sizeof(lexers[0]); i++) {
-            offset = lexers[i](&token, toCheck);
-            if(offset) {
-                if(token.token == JSON_TOKEN_INVALID) {
-                    result = STATUS_PARSE_ERR;
-                }
-                token.lexeme = toCheck;
-                // Create token.
-                struct JSONToken *newToken = tokenCopy(&token);
-                if(newToken == NULL) {
-                    return STATUS_ALLOC_ERR;
-                }
-                // Add token to token list.
-                int result = listAddTail(tokens, (void*)newToken);
-                if(result) {
-                    tokenRelease(newToken);
-                    return result;
-                }
-                break;
+        unsigned int offset = lexToken(&token, toCheck, 0);
+        if(offset) {
+            if(token.token == JSON_TOKEN_INVALID) {
+                result = STATUS_PARSE_ERR;
             }
+            // Create token.
+            struct JSONToken *newToken = tokenCopy(&token);
+            if(newToken == NULL) {
+                return STATUS_ALLOC_ERR;
+            }
+            // Add token to token list.
+            int result = listAddTail(tokens, (void*)newToken);
+            if(result) {
+                tokenRelease(newToken);
+                return result;
+            }
+        } else {
+            offset = 1;
         }
-        if(!offset) {
+        token.col += offset;
+        toCheck += offset;
+    }
+    return result;
+}
+
+void tokensCompose(struct JSONTokens *tokens) {
+    tokens->tokens = NULL;
+    tokens->length = 0;
+    tokens->capacity = 0;
+    tokens->open = NULL;
+    tokens->openCapacity = 0;
+    tokens->trusted = 0;
+}
+
+void tokensRelease(struct JSONTokens *tokens) {
+    free(tokens->tokens);
+    free(tokens->open);
+    tokensCompose(tokens);
+}
+
+// Maintain element counts of open containers as tokens are added: the
+// first token inside a container makes it non empty, every separator
+// directly inside it starts another element.
+static unsigned int tokensCount(struct JSONTokens *tokens, unsigned int *depth) {
+    struct JSONToken *token = &tokens->tokens[tokens->length - 1];
+    struct JSONToken *parent = *depth ?
+        &tokens->tokens[tokens->open[*depth - 1]] : NULL;
+    char symbol = token->token == JSON_TOKEN_SYMBOL ? *token->lexeme : 0;
+
+    if(symbol == JSON_ARR_CLOSE || symbol == JSON_MAP_CLOSE) {
+        if(*depth) (*depth)--;
+        return STATUS_OK;
+    }
+    if(parent) {
+        if(symbol == JSON_SEPERATOR) parent->count++;
+        else if(parent->count == 0) parent->count = 1;
+    }
+    if(symbol == JSON_ARR_BEGIN || symbol == JSON_MAP_BEGIN) {
+        if(*depth == tokens->openCapacity) {
+            unsigned int capacity = tokens->openCapacity ? tokens->openCapacity * 2 : 16;
+            unsigned int *grown = realloc(tokens->open, capacity * sizeof(unsigned int));
+            if(grown == NULL) return STATUS_ALLOC_ERR;
+            tokens->open = grown;
+            tokens->openCapacity = capacity;
+        }
+        tokens->open[(*depth)++] = tokens->length - 1;
+    }
+    return STATUS_OK;
+}
+
+static unsigned int tokensAdd(struct JSONTokens *tokens, struct JSONToken *token) {
+    if(tokens->length == tokens->capacity) {
+        unsigned int capacity = tokens->capacity ? tokens->capacity * 2 : 64;
+        struct JSONToken *grown = realloc(tokens->tokens, capacity * sizeof(struct JSONToken));
+        if(grown == NULL) return STATUS_ALLOC_ERR;
+        tokens->tokens = grown;
+        tokens->capacity = capacity;
+    }
+    tokens->tokens[tokens->length++] = *token;
+    return STATUS_OK;
+}
+
+unsigned int lexJSONTokens(struct JSONTokens *tokens, char *toCheck) {
+    unsigned int result = STATUS_OK;
+    // Storage is kept between calls, only the length is reset.
+    tokens->length = 0;
+    unsigned int depth = 0;
+
+    struct JSONToken token;
+    token.row = 0;
+    token.col = 0;
+    token.lexeme = NULL;
+    token.token = JSON_TOKEN_INVALID;
+    token.count = 0;
+
+    while(*toCheck) {
+        unsigned int offset = lexToken(&token, toCheck, tokens->trusted);
+        if(offset) {
+            if(token.token == JSON_TOKEN_INVALID) {
+                result = STATUS_PARSE_ERR;
+            }
+            if(token.token != JSON_TOKEN_WHITESPACE && token.token != JSON_TOKEN_NEWLINE) {
+                token.count = 0;
+                unsigned int addResult = tokensAdd(tokens, &token);
+                if(!addResult) addResult = tokensCount(tokens, &depth);
+                if(addResult) return addResult;
+            }
+        } else {
             offset = 1;
         }
         token.col += offset;
         toCheck += offset;
     }
     return result;
+}
+
+void readerCompose(struct JSONReader *reader, char *toCheck) {
+    reader->next = toCheck;
+    reader->row = 0;
+    reader->col = 0;
+    reader->trusted = 0;
+}
+
+unsigned int readerNext(struct JSONReader *reader, struct JSONToken *token, unsigned int *length) {
+    token->count = 0;
+    *length = 0;
+    while(*reader->next) {
+        token->row = reader->row;
+        token->col = reader->col;
+        token->lexeme = NULL;
+        unsigned int offset = lexToken(token, reader->next, reader->trusted);
+        reader->next += offset;
+        if(token->token == JSON_TOKEN_NEWLINE) {
+            reader->row++;
+            reader->col = 0;
+            continue;
+        }
+        reader->col += offset;
+        if(token->token == JSON_TOKEN_WHITESPACE) continue;
+        if(token->token == JSON_TOKEN_INVALID) return STATUS_PARSE_ERR;
+        *length = offset;
+        return STATUS_OK;
+    }
+    token->token = JSON_TOKEN_INVALID;
+    token->lexeme = NULL;
+    return STATUS_OK;
+}
+
+enum SKIP_STATE {
+    SKIP_VALUE,
+    SKIP_FIRST_VALUE,
+    SKIP_KEY,
+    SKIP_FIRST_KEY,
+    SKIP_MEMBER_SEP,
+    SKIP_AFTER_VALUE
+};
+
+static int skipIsScalar(const struct JSONToken *token) {
+    return token->token == JSON_TOKEN_STRING
+        || token->token == JSON_TOKEN_NUMBER
+        || token->token == JSON_TOKEN_BOOL
+        || token->token == JSON_TOKEN_NULL;
+}
+
+unsigned int skipCompose(struct JSONSkip *skip, const struct JSONToken *token) {
+    skip->depth = 0;
+    if(skipIsScalar(token)) return STATUS_OK;
+    if(token->token != JSON_TOKEN_SYMBOL) return STATUS_PARSE_ERR;
+    if(*token->lexeme != JSON_ARR_BEGIN && *token->lexeme != JSON_MAP_BEGIN) return STATUS_PARSE_ERR;
+
+    int isObject = *token->lexeme == JSON_MAP_BEGIN;
+    memset(skip->objects, 0, sizeof(skip->objects));
+    skip->objects[0] = isObject;
+    skip->depth = 1;
+    skip->state = isObject ? SKIP_FIRST_KEY : SKIP_FIRST_VALUE;
+    return STATUS_OK;
+}
+
+unsigned int skipNext(struct JSONSkip *skip, const struct JSONToken *token) {
+    if(!skip->depth) return STATUS_PARSE_ERR;
+    char symbol = token->token == JSON_TOKEN_SYMBOL ? *token->lexeme : 0;
+    unsigned int depth = skip->depth;
+    int isObject = (skip->objects[(depth - 1) / 8] >> ((depth - 1) % 8)) & 1;
+
+    int close = 0;
+    switch(skip->state) {
+        case SKIP_FIRST_KEY:
+            if(symbol == JSON_MAP_CLOSE) {
+                close = 1;
+                break;
+            }
+            // fall through
+        case SKIP_KEY:
+            if(token->token != JSON_TOKEN_STRING) return STATUS_PARSE_ERR;
+            skip->state = SKIP_MEMBER_SEP;
+            break;
+        case SKIP_MEMBER_SEP:
+            if(symbol != JSON_MEMBER_SEP) return STATUS_PARSE_ERR;
+            skip->state = SKIP_VALUE;
+            break;
+        case SKIP_FIRST_VALUE:
+            if(symbol == JSON_ARR_CLOSE) {
+                close = 1;
+                break;
+            }
+            // fall through
+        case SKIP_VALUE:
+            if(skipIsScalar(token)) {
+                skip->state = SKIP_AFTER_VALUE;
+            } else if(symbol == JSON_ARR_BEGIN || symbol == JSON_MAP_BEGIN) {
+                if(depth == JSON_READER_SKIP_DEPTH) return STATUS_PARSE_ERR;
+                isObject = symbol == JSON_MAP_BEGIN;
+                if(isObject) skip->objects[depth / 8] |= 1 << (depth % 8);
+                else skip->objects[depth / 8] &= ~(1 << (depth % 8));
+                skip->depth++;
+                skip->state = isObject ? SKIP_FIRST_KEY : SKIP_FIRST_VALUE;
+            } else {
+                return STATUS_PARSE_ERR;
+            }
+            break;
+        case SKIP_AFTER_VALUE:
+            if(symbol == JSON_SEPERATOR) {
+                skip->state = isObject ? SKIP_KEY : SKIP_VALUE;
+            } else if(symbol == (isObject ? JSON_MAP_CLOSE : JSON_ARR_CLOSE)) {
+                close = 1;
+            } else {
+                return STATUS_PARSE_ERR;
+            }
+            break;
+    }
+    if(close) {
+        skip->depth--;
+        skip->state = SKIP_AFTER_VALUE;
+    }
+    return STATUS_OK;
+}
+
+unsigned int readerSkip(struct JSONReader *reader, const struct JSONToken *token) {
+    struct JSONSkip skip;
+    unsigned int result = skipCompose(&skip, token);
+    struct JSONToken next;
+    unsigned int length;
+    while(!result && skip.depth) {
+        result = readerNext(reader, &next, &length);
+        if(result) return result;
+        if(!next.lexeme) return STATUS_PARSE_ERR;
+        result = skipNext(&skip, &next);
+    }
+    return result;
 }
\ No newline at end of file
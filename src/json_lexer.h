@@ -32,13 +32,69 @@ struct JSONToken {
     char* lexeme;
     unsigned int col;
     unsigned int row;
+    // Opening brackets only: upper bound on elements or members, filled in
+    // by lexJSONTokens so containers can be sized before they are parsed.
+    unsigned int count;
+};
+
+// Contiguous token storage that can be reused across inputs.
+struct JSONTokens {
+    struct JSONToken *tokens;
+    unsigned int length;
+    unsigned int capacity;
+    // Indices of the currently open brackets while lexing.
+    unsigned int *open;
+    unsigned int openCapacity;
+    // Skip UTF-8 validation of strings for input known to be valid.
+    unsigned char trusted;
 };
 
 struct JSONToken* tokenCompose();
 void tokenRelease(struct JSONToken*);
 struct JSONToken* tokenCopy(struct JSONToken* other);
 
+void tokensCompose(struct JSONTokens *tokens);
+void tokensRelease(struct JSONTokens *tokens);
+
+#define JSON_READER_SKIP_DEPTH 1024
+
+// Pull interface over a terminated input, one token per call and nothing
+// allocated. Whitespace is skipped.
+struct JSONReader {
+    char *next;
+    unsigned int row;
+    unsigned int col;
+    // Skip UTF-8 validation of strings for input known to be valid.
+    unsigned char trusted;
+};
+
+// Grammar check while skipping one value a token at a time. One bit per
+// open container, set for objects, so nothing is allocated.
+struct JSONSkip {
+    unsigned char objects[JSON_READER_SKIP_DEPTH / 8];
+    unsigned int depth;
+    unsigned int state;
+};
+
 unsigned int lexJSON(struct List* tokens, char* toCheck);
+// Like lexJSON but keeps only structural and value tokens, no whitespace.
+unsigned int lexJSONTokens(struct JSONTokens *tokens, char *toCheck);
+
+void readerCompose(struct JSONReader *reader, char *toCheck);
+// Next token and the length of its lexeme, which is NULL at the end of
+// the input. STATUS_PARSE_ERR for an invalid token.
+unsigned int readerNext(struct JSONReader *reader, struct JSONToken *token, unsigned int *length);
+// Skip the rest of the value token begins, so the next token is what
+// follows it. The skipped value is checked as the parser would: brackets
+// must match and members and elements be separated properly. Nesting past
+// JSON_READER_SKIP_DEPTH is a STATUS_PARSE_ERR, nothing is allocated.
+unsigned int readerSkip(struct JSONReader *reader, const struct JSONToken *token);
+// Begin skipping the value token starts, done at once for a scalar.
+// STATUS_PARSE_ERR when token cannot start a value.
+unsigned int skipCompose(struct JSONSkip *skip, const struct JSONToken *token);
+// Check the next token of the value, which is complete once skip->depth
+// is zero. STATUS_PARSE_ERR where the parser would reject it.
+unsigned int skipNext(struct JSONSkip *skip, const struct JSONToken *token);
 
 #ifdef __cplusplus
 }
@@ -1,5 +1,7 @@
+#include <string.h>
 #include "json_lexer.h"
 #include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
 
 void testJSONLexTerminator() {
     char input[] = "";
@@ -290,6 +292,148 @@ void testJSONLexWithInvalid() {
     listRelease(&tokens);
 }
 
+void testJSONLexTokensCount() {
+    char input[] = "{\"a\": [1, [], {\"b\": 2}], \"c\": {}}";
+    struct JSONTokens tokens;
+    tokensCompose(&tokens);
+    unsigned int result = lexJSONTokens(&tokens, input);
+    assertIntegersEqual(result, 0);
+    // Whitespace is dropped.
+    assertIntegersEqual(tokens.length, 21);
+
+    unsigned int counts[5];
+    unsigned int containers = 0;
+    for(unsigned int i = 0; i < tokens.length && containers < 5; i++) {
+        char symbol = *tokens.tokens[i].lexeme;
+        if(symbol == '[' || symbol == '{') counts[containers++] = tokens.tokens[i].count;
+    }
+    assertIntegersEqual(containers, 5);
+    assertIntegersEqual(counts[0], 2);
+    assertIntegersEqual(counts[1], 3);
+    assertIntegersEqual(counts[2], 0);
+    assertIntegersEqual(counts[3], 1);
+    assertIntegersEqual(counts[4], 0);
+    tokensRelease(&tokens);
+}
+
+void testJSONLexValidatesUTF8() {
+    char valid[] = "[\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 plain ascii text\"]";
+    struct JSONTokens tokens;
+    tokensCompose(&tokens);
+    assertIntegersEqual(lexJSONTokens(&tokens, valid), STATUS_OK);
+
+    char *invalid[] = {
+        "[\"\xc0\xaf\"]",
+        "[\"\xed\xa0\x80\"]",
+        "[\"\xf4\x90\x80\x80\"]",
+        "[\"0123456789\xe2\x82\"]",
+        "[\"\xff\"]"
+    };
+    for(unsigned int i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        assertIntegersEqual(lexJSONTokens(&tokens, invalid[i]), STATUS_PARSE_ERR);
+    }
+
+    // Trusted input is not checked.
+    tokens.trusted = 1;
+    assertIntegersEqual(lexJSONTokens(&tokens, invalid[0]), STATUS_OK);
+    tokensRelease(&tokens);
+}
+
+void testJSONReaderNext() {
+    char input[] = "{\"a\": [1.5, true],\r\n \"b\": null}";
+    struct JSONReader reader;
+    readerCompose(&reader, input);
+
+    enum JSON_BUILTIN types[] = {
+        JSON_TOKEN_SYMBOL, JSON_TOKEN_STRING, JSON_TOKEN_SYMBOL, JSON_TOKEN_SYMBOL, JSON_TOKEN_NUMBER,
+        JSON_TOKEN_SYMBOL, JSON_TOKEN_BOOL, JSON_TOKEN_SYMBOL, JSON_TOKEN_SYMBOL, JSON_TOKEN_STRING,
+        JSON_TOKEN_SYMBOL, JSON_TOKEN_NULL, JSON_TOKEN_SYMBOL
+    };
+    unsigned int lengths[] = {1, 3, 1, 1, 3, 1, 4, 1, 1, 3, 1, 4, 1};
+    struct JSONToken token;
+    unsigned int length;
+    unsigned int matched = 0;
+    for(unsigned int i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        assertIntegersEqual(readerNext(&reader, &token, &length), STATUS_OK);
+        matched += token.token == types[i] && length == lengths[i];
+        if(i == 9) {
+            // "b" starts the second line.
+            assertIntegersEqual(token.row, 1);
+            assertIntegersEqual(token.col, 1);
+        }
+    }
+    assertIntegersEqual(matched, sizeof(types) / sizeof(types[0]));
+    assertIntegersEqual(readerNext(&reader, &token, &length), STATUS_OK);
+    assertIsNull(token.lexeme);
+}
+
+void testJSONReaderSkip() {
+    char input[] = "{\"skip\": {\"x\": [1, {\"y\": []}]}, \"keep\": 2}";
+    struct JSONReader reader;
+    readerCompose(&reader, input);
+    struct JSONToken token;
+    unsigned int length;
+
+    readerNext(&reader, &token, &length);
+    readerNext(&reader, &token, &length);
+    readerNext(&reader, &token, &length);
+    // Scalars and the value of "skip" as a whole.
+    assertIntegersEqual(readerNext(&reader, &token, &length), STATUS_OK);
+    assertIntegersEqual(readerSkip(&reader, &token), STATUS_OK);
+    readerNext(&reader, &token, &length);
+    assertIntegersEqual(*token.lexeme, ',');
+    readerNext(&reader, &token, &length);
+    assertIntegersEqual(strncmp(token.lexeme, "\"keep\"", length), 0);
+    readerNext(&reader, &token, &length);
+    readerNext(&reader, &token, &length);
+    assertIntegersEqual(readerSkip(&reader, &token), STATUS_OK);
+    assertIntegersEqual(token.token, JSON_TOKEN_NUMBER);
+
+    char unterminated[] = "[[1, 2]";
+    readerCompose(&reader, unterminated);
+    readerNext(&reader, &token, &length);
+    assertIntegersEqual(readerSkip(&reader, &token), STATUS_PARSE_ERR);
+
+    // Brackets are matched and separators checked, not just counted.
+    char *malformed[] = {
+        "[1}", "{\"a\" 1 2]", "[1 2]", "[1,]", "{\"a\": 1,}", "{1: 2}",
+        "{\"a\": }", "[,1]", "[[1], {\"a\": [}]]", "]"
+    };
+    for(unsigned int i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        readerCompose(&reader, malformed[i]);
+        readerNext(&reader, &token, &length);
+        assertIntegersEqual(readerSkip(&reader, &token), STATUS_PARSE_ERR);
+    }
+
+    char nested[] = "[{\"a\": [[], {}]}, {\"b\": {\"c\": [1, \"]\"]}}] 1";
+    readerCompose(&reader, nested);
+    readerNext(&reader, &token, &length);
+    assertIntegersEqual(readerSkip(&reader, &token), STATUS_OK);
+    readerNext(&reader, &token, &length);
+    assertIntegersEqual(token.token, JSON_TOKEN_NUMBER);
+}
+
+void testJSONReaderInvalid() {
+    char input[] = "[1, @]";
+    struct JSONReader reader;
+    readerCompose(&reader, input);
+    struct JSONToken token;
+    unsigned int length;
+    readerNext(&reader, &token, &length);
+    readerNext(&reader, &token, &length);
+    readerNext(&reader, &token, &length);
+    assertIntegersEqual(readerNext(&reader, &token, &length), STATUS_PARSE_ERR);
+
+    char invalid[] = "[\"\xC0\xAF\"]";
+    readerCompose(&reader, invalid);
+    readerNext(&reader, &token, &length);
+    assertIntegersEqual(readerNext(&reader, &token, &length), STATUS_PARSE_ERR);
+    readerCompose(&reader, invalid);
+    reader.trusted = 1;
+    readerNext(&reader, &token, &length);
+    assertIntegersEqual(readerNext(&reader, &token, &length), STATUS_OK);
+}
+
 void testJSONLexer() {
     testJSONLexTerminator();
     testJSONLexEmptyString();
@@ -305,4 +449,9 @@ void testJSONLexer() {
     testJSONLexSimpleArray();
     testJSONLexMultiLine();
     testJSONLexWithInvalid();
+    testJSONLexTokensCount();
+    testJSONLexValidatesUTF8();
+    testJSONReaderNext();
+    testJSONReaderSkip();
+    testJSONReaderInvalid();
 }
\ No newline at end of file
@@ -0,0 +1,286 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_msgpack.h"
+#include "json_binary.h"
+#include "json_buffer.h"
+#include "cutil/src/error.h"
+#include "cutil/src/map/map.h"
+
+#define MSGPACK_NIL 0xc0
+#define MSGPACK_FALSE 0xc2
+#define MSGPACK_TRUE 0xc3
+#define MSGPACK_FLOAT32 0xca
+#define MSGPACK_FLOAT64 0xcb
+#define MSGPACK_UINT8 0xcc
+#define MSGPACK_UINT16 0xcd
+#define MSGPACK_UINT32 0xce
+#define MSGPACK_UINT64 0xcf
+#define MSGPACK_INT8 0xd0
+#define MSGPACK_INT16 0xd1
+#define MSGPACK_INT32 0xd2
+#define MSGPACK_INT64 0xd3
+#define MSGPACK_STR8 0xd9
+#define MSGPACK_STR16 0xda
+#define MSGPACK_STR32 0xdb
+#define MSGPACK_ARRAY16 0xdc
+#define MSGPACK_ARRAY32 0xdd
+#define MSGPACK_MAP16 0xde
+#define MSGPACK_MAP32 0xdf
+#define MSGPACK_FIXMAP 0x80
+#define MSGPACK_FIXARRAY 0x90
+#define MSGPACK_FIXSTR 0xa0
+#define MSGPACK_NEGATIVE_FIXINT 0xe0
+
+static unsigned int encodeValue(struct JSONBuffer *buffer, struct Generic *generic);
+
+static unsigned int encodeTyped(struct JSONBuffer *buffer, unsigned char type, uint64_t value, unsigned int bytes) {
+    unsigned int result = bufferAppendChar(buffer, type);
+    if(result) return result;
+    return bufferAppendBigEndian(buffer, value, bytes);
+}
+
+static unsigned int encodeInteger(struct JSONBuffer *buffer, long value) {
+    if(value >= 0) {
+        if(value < 128) return bufferAppendChar(buffer, value);
+        if(value <= 0xff) return encodeTyped(buffer, MSGPACK_UINT8, value, 1);
+        if(value <= 0xffff) return encodeTyped(buffer, MSGPACK_UINT16, value, 2);
+        if(value <= 0xffffffffL) return encodeTyped(buffer, MSGPACK_UINT32, value, 4);
+        return encodeTyped(buffer, MSGPACK_UINT64, value, 8);
+    }
+    if(value >= -32) return bufferAppendChar(buffer, value);
+    if(value >= -128) return encodeTyped(buffer, MSGPACK_INT8, value, 1);
+    if(value >= -32768) return encodeTyped(buffer, MSGPACK_INT16, value, 2);
+    if(value >= -2147483647L - 1) return encodeTyped(buffer, MSGPACK_INT32, value, 4);
+    return encodeTyped(buffer, MSGPACK_INT64, value, 8);
+}
+
+static unsigned int encodeFloat(struct JSONBuffer *buffer, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return encodeTyped(buffer, MSGPACK_FLOAT32, bits, 4);
+}
+
+static unsigned int encodeString(struct JSONBuffer *buffer, const char *value) {
+    struct JSONBuffer text;
+    unsigned int result = binaryUnescape(&text, value);
+    if(result) return result;
+    unsigned int length = text.length;
+    if(length < 32) {
+        result = bufferAppendChar(buffer, MSGPACK_FIXSTR | length);
+    } else if(length <= 0xff) {
+        result = encodeTyped(buffer, MSGPACK_STR8, length, 1);
+    } else if(length <= 0xffff) {
+        result = encodeTyped(buffer, MSGPACK_STR16, length, 2);
+    } else {
+        result = encodeTyped(buffer, MSGPACK_STR32, length, 4);
+    }
+    if(!result) result = bufferAppend(buffer, text.data, length);
+    bufferRelease(&text);
+    return result;
+}
+
+static unsigned int encodeCollection(struct JSONBuffer *buffer, struct Generic *generic) {
+    int isMap = generic->object == &Map.object;
+    struct Collection *collection = (struct Collection*)generic->object;
+
+    // Headers carry the element count, so count before writing.
+    unsigned int count = 0;
+    struct Iterator iterator = collection->iterator(genericData(generic));
+    while(collection->next(&iterator)) count++;
+
+    unsigned int result;
+    if(count < 16) {
+        result = bufferAppendChar(buffer, (isMap ? MSGPACK_FIXMAP : MSGPACK_FIXARRAY) | count);
+    } else if(count <= 0xffff) {
+        result = encodeTyped(buffer, isMap ? MSGPACK_MAP16 : MSGPACK_ARRAY16, count, 2);
+    } else {
+        result = encodeTyped(buffer, isMap ? MSGPACK_MAP32 : MSGPACK_ARRAY32, count, 4);
+    }
+    if(result) return result;
+
+    iterator = collection->iterator(genericData(generic));
+    while(1) {
+        const char *key = isMap ? mapKey(&iterator) : NULL;
+        struct Generic *element = collection->next(&iterator);
+        if(!element) break;
+        if(key) {
+            result = encodeString(buffer, key);
+            if(result) return result;
+        }
+        result = encodeValue(buffer, element);
+        if(result) return result;
+    }
+    return STATUS_OK;
+}
+
+static unsigned int encodeValue(struct JSONBuffer *buffer, struct Generic *generic) {
+    if(generic->object == &Map.object || generic->object == &Array.object) {
+        return encodeCollection(buffer, generic);
+    } else if(generic->object == &String) {
+        return encodeString(buffer, *((char**)genericData(generic)));
+    } else if(generic->object == &Integer) {
+        return encodeInteger(buffer, *((long*)genericData(generic)));
+    } else if(generic->object == &Float) {
+        return encodeFloat(buffer, *((float*)genericData(generic)));
+    } else if(generic->object == &Boolean) {
+        char boolValue = *((char*)genericData(generic));
+        return bufferAppendChar(buffer, (char)(boolValue ? MSGPACK_TRUE : MSGPACK_FALSE));
+    } else if(generic->object == &Pointer) {
+        if(*((void**)genericData(generic)) != NULL) return STATUS_INPUT_ERR;
+        return bufferAppendChar(buffer, (char)MSGPACK_NIL);
+    }
+    return STATUS_INPUT_ERR;
+}
+
+unsigned int encodeMsgPack(
+        struct Generic *generic,
+        char **output,
+        unsigned int *outputLength) {
+    struct JSONBuffer buffer;
+    bufferCompose(&buffer);
+
+    unsigned int result = encodeValue(&buffer, generic);
+    if(result) {
+        bufferRelease(&buffer);
+        return result;
+    }
+
+    *output = bufferDetach(&buffer, outputLength);
+    if(!*output) return STATUS_ALLOC_ERR;
+    return STATUS_OK;
+}
+
+static unsigned int readStringLength(struct JSONBinaryReader *reader, uint64_t *length) {
+    if(reader->offset >= reader->length) return STATUS_PARSE_ERR;
+    unsigned char type = reader->data[reader->offset++];
+    if((type & 0xe0) == MSGPACK_FIXSTR) {
+        *length = type & 0x1f;
+        return STATUS_OK;
+    }
+    switch(type) {
+        case MSGPACK_STR8: return binaryReadBigEndian(reader, length, 1);
+        case MSGPACK_STR16: return binaryReadBigEndian(reader, length, 2);
+        case MSGPACK_STR32: return binaryReadBigEndian(reader, length, 4);
+        default: return STATUS_PARSE_ERR;
+    }
+}
+
+static unsigned int decodeKey(char **key, struct JSONBinaryReader *reader) {
+    uint64_t length;
+    unsigned int result = readStringLength(reader, &length);
+    if(result) return result;
+    return binaryReadString(reader, key, length);
+}
+
+static unsigned int decodeValue(struct Generic **generic, struct JSONBinaryReader *reader) {
+    if(reader->offset >= reader->length) return STATUS_PARSE_ERR;
+    unsigned char type = reader->data[reader->offset];
+
+    if(type < 0x80) {
+        reader->offset++;
+        return binaryDecodeInteger(generic, type, 0);
+    }
+    if(type >= MSGPACK_NEGATIVE_FIXINT) {
+        reader->offset++;
+        return binaryDecodeInteger(generic, ~type & 0xff, 1);
+    }
+    if((type & 0xf0) == MSGPACK_FIXMAP || (type & 0xf0) == MSGPACK_FIXARRAY) {
+        reader->offset++;
+        return binaryDecodeCollection(
+            generic, reader, (type & 0xf0) == MSGPACK_FIXMAP, type & 0x0f, decodeKey, decodeValue);
+    }
+    if((type & 0xe0) == MSGPACK_FIXSTR || (type >= MSGPACK_STR8 && type <= MSGPACK_STR32)) {
+        char *value;
+        unsigned int result = decodeKey(&value, reader);
+        if(result) return result;
+        *generic = genericCompose(&String);
+        if(!*generic) {
+            free(value);
+            return STATUS_ALLOC_ERR;
+        }
+        *((char**)genericData(*generic)) = value;
+        return STATUS_OK;
+    }
+
+    reader->offset++;
+    uint64_t value = 0;
+    unsigned int result = STATUS_OK;
+    switch(type) {
+        case MSGPACK_NIL:
+            *generic = genericCompose(&Pointer);
+            if(!*generic) return STATUS_ALLOC_ERR;
+            *((void**)genericData(*generic)) = NULL;
+            return STATUS_OK;
+        case MSGPACK_FALSE:
+        case MSGPACK_TRUE:
+            *generic = genericCompose(&Boolean);
+            if(!*generic) return STATUS_ALLOC_ERR;
+            *((char*)genericData(*generic)) = type == MSGPACK_TRUE;
+            return STATUS_OK;
+        case MSGPACK_FLOAT32: {
+            result = binaryReadBigEndian(reader, &value, 4);
+            if(result) return result;
+            uint32_t bits = value;
+            float floatValue;
+            memcpy(&floatValue, &bits, sizeof(floatValue));
+            return binaryDecodeFloat(generic, floatValue);
+        }
+        case MSGPACK_FLOAT64: {
+            result = binaryReadBigEndian(reader, &value, 8);
+            if(result) return result;
+            double doubleValue;
+            memcpy(&doubleValue, &value, sizeof(doubleValue));
+            return binaryDecodeFloat(generic, doubleValue);
+        }
+        case MSGPACK_UINT8: result = binaryReadBigEndian(reader, &value, 1); break;
+        case MSGPACK_UINT16: result = binaryReadBigEndian(reader, &value, 2); break;
+        case MSGPACK_UINT32: result = binaryReadBigEndian(reader, &value, 4); break;
+        case MSGPACK_UINT64: result = binaryReadBigEndian(reader, &value, 8); break;
+        case MSGPACK_INT8:
+        case MSGPACK_INT16:
+        case MSGPACK_INT32:
+        case MSGPACK_INT64: {
+            unsigned int bytes = 1u << (type - MSGPACK_INT8);
+            result = binaryReadBigEndian(reader, &value, bytes);
+            if(result) return result;
+            // Sign extend, then hand over the magnitude of negatives.
+            if(bytes < 8 && value >> (8 * bytes - 1)) value |= ~(uint64_t)0 << (8 * bytes);
+            if(value >> 63) return binaryDecodeInteger(generic, ~value, 1);
+            return binaryDecodeInteger(generic, value, 0);
+        }
+        case MSGPACK_ARRAY16:
+        case MSGPACK_MAP16:
+            result = binaryReadBigEndian(reader, &value, 2);
+            if(result) return result;
+            return binaryDecodeCollection(
+                generic, reader, type == MSGPACK_MAP16, value, decodeKey, decodeValue);
+        case MSGPACK_ARRAY32:
+        case MSGPACK_MAP32:
+            result = binaryReadBigEndian(reader, &value, 4);
+            if(result) return result;
+            return binaryDecodeCollection(
+                generic, reader, type == MSGPACK_MAP32, value, decodeKey, decodeValue);
+        default:
+            // Binary, extension and reserved types have no Generic equivalent.
+            return STATUS_PARSE_ERR;
+    }
+    if(result) return result;
+    return binaryDecodeInteger(generic, value, 0);
+}
+
+unsigned int decodeMsgPack(
+        struct Generic **generic,
+        const char *input,
+        unsigned int inputLength) {
+    *generic = NULL;
+    struct JSONBinaryReader reader;
+    binaryReaderCompose(&reader, input, inputLength);
+    unsigned int result = decodeValue(generic, &reader);
+    if(result == STATUS_OK && reader.offset != reader.length) {
+        // Garbage followed a valid value.
+        genericRelease(*generic);
+        *generic = NULL;
+        result = STATUS_PARSE_ERR;
+    }
+    return result;
+}
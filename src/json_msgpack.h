@@ -0,0 +1,22 @@
+#ifndef __JSON_MSGPACK_H
+#define __JSON_MSGPACK_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include "cutil/src/generic/generic.h"
+
+unsigned int encodeMsgPack(
+    struct Generic *generic,
+    char **output,
+    unsigned int *outputLength);
+
+unsigned int decodeMsgPack(
+    struct Generic **generic,
+    const char *input,
+    unsigned int inputLength);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "json_parser.h"
+#include "json_unparser.h"
+#include "json_binary.h"
+#include "json_msgpack.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+#include "cutil/src/map/map.h"
+
+void testJSONMsgPackScalars() {
+    char input[] = "[1, -1, 300, -200, 70000, true, false, null, \"ab\"]";
+    struct Generic *generic;
+    unsigned int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char *output;
+    unsigned int outputLength;
+    result = encodeMsgPack(generic, &output, &outputLength);
+    assertIntegersEqual(result, STATUS_OK);
+    genericRelease(generic);
+
+    char expected[] = "\x99\x01\xff\xcd\x01\x2c\xd1\xff\x38\xce\x00\x01\x11\x70\xc3\xc2\xc0\xa2" "ab";
+    assertIntegersEqual(outputLength, sizeof(expected) - 1);
+    assertIntegersEqual(memcmp(output, expected, sizeof(expected) - 1), 0);
+    free(output);
+}
+
+void testJSONMsgPackRoundTrip() {
+    char input[] = "{\"a\": [\"foo\", 9, 2.5, [], {}], \"b\": {\"e\": null, \"t\": true}}";
+    struct Generic *generic;
+    unsigned int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char *encoded;
+    unsigned int encodedLength;
+    result = encodeMsgPack(generic, &encoded, &encodedLength);
+    assertIntegersEqual(result, STATUS_OK);
+    genericRelease(generic);
+
+    result = decodeMsgPack(&generic, encoded, encodedLength);
+    assertIntegersEqual(result, STATUS_OK);
+    free(encoded);
+
+    struct Generic *element = getAt(generic, "a.0");
+    assertNotNull(element);
+    assertPointersEqual(element->object, &String);
+    assertStringsEqual(*((char**)genericData(element)), "foo");
+    element = getAt(generic, "a.1");
+    assertNotNull(element);
+    assertPointersEqual(element->object, &Integer);
+    assertIntegersEqual(*((long*)genericData(element)), 9);
+    element = getAt(generic, "a.2");
+    assertNotNull(element);
+    assertPointersEqual(element->object, &Float);
+    assertFloatsEqual(*((float*)genericData(element)), 2.5);
+    element = getAt(generic, "a.4");
+    assertNotNull(element);
+    assertPointersEqual(element->object, &Map.object);
+    element = getAt(generic, "b.e");
+    assertNotNull(element);
+    assertPointersEqual(element->object, &Pointer);
+    element = getAt(generic, "b.t");
+    assertNotNull(element);
+    assertPointersEqual(element->object, &Boolean);
+    assertIntegersEqual(*((char*)genericData(element)), 1);
+    genericRelease(generic);
+}
+
+void testJSONMsgPackDecodeTruncated() {
+    char input[] = "\x92\x01";
+    struct Generic *generic;
+    unsigned int result = decodeMsgPack(&generic, input, sizeof(input) - 1);
+    assertIntegersEqual(result, STATUS_PARSE_ERR);
+    assertIsNull(generic);
+}
+
+void testJSONMsgPackDecodeNested() {
+    // One level past the limit, the innermost element a plain 1.
+    unsigned int levels = JSON_BINARY_MAX_DEPTH + 1;
+    char *input = malloc(levels + 1);
+    memset(input, '\x91', levels);
+    input[levels] = 1;
+    struct Generic *generic;
+    unsigned int result = decodeMsgPack(&generic, input, levels + 1);
+    assertIntegersEqual(result, STATUS_PARSE_ERR);
+    assertIsNull(generic);
+
+    result = decodeMsgPack(&generic, input + 1, levels);
+    assertIntegersEqual(result, STATUS_OK);
+    genericRelease(generic);
+    free(input);
+}
+
+void testJSONMsgPackDecodeLargeIntegers() {
+    // Past the range of long, decoded as Float like the parser does.
+    char large[] = "\xcf\xff\xff\xff\xff\xff\xff\xff\xff";
+    struct Generic *generic;
+    unsigned int result = decodeMsgPack(&generic, large, sizeof(large) - 1);
+    assertIntegersEqual(result, STATUS_OK);
+    assertPointersEqual(generic->object, &Float);
+    assertFloatsEqual(*((float*)genericData(generic)), 18446744073709551615.0);
+    genericRelease(generic);
+
+    char small[] = "\xd3\x80\x00\x00\x00\x00\x00\x00\x00";
+    result = decodeMsgPack(&generic, small, sizeof(small) - 1);
+    assertIntegersEqual(result, STATUS_OK);
+    assertPointersEqual(generic->object, &Integer);
+    assertIntegersEqual(*((long*)genericData(generic)) == LONG_MIN, 1);
+    genericRelease(generic);
+}
+
+void testJSONMsgPackStrings() {
+    // Strings travel decoded and come back escaped as JSON text again.
+    char input[] = "{\"k\\\"\": \"a\\nb\\\"c\\u00e9\"}";
+    struct Generic *generic;
+    unsigned int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char *encoded;
+    unsigned int encodedLength;
+    result = encodeMsgPack(generic, &encoded, &encodedLength);
+    assertIntegersEqual(result, STATUS_OK);
+    genericRelease(generic);
+    char expected[] = "\x81\xa2k\"\xa7" "a\nb\"c\xC3\xA9";
+    assertIntegersEqual(encodedLength, sizeof(expected) - 1);
+    assertIntegersEqual(memcmp(encoded, expected, sizeof(expected) - 1), 0);
+
+    result = decodeMsgPack(&generic, encoded, encodedLength);
+    assertIntegersEqual(result, STATUS_OK);
+    free(encoded);
+    char *output;
+    unsigned int outputLength;
+    struct JSONFormat fmt = {0, 0, 0};
+    result = unparseJSON(generic, &output, &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output, "{\"k\\\"\": \"a\\nb\\\"c\xC3\xA9\"}");
+    genericRelease(generic);
+    free(output);
+
+    // Raw quotes and control characters from a peer are escaped.
+    char raw[] = "\x91\xa3\x61\x22\x0a";
+    result = decodeMsgPack(&generic, raw, sizeof(raw) - 1);
+    assertIntegersEqual(result, STATUS_OK);
+    result = unparseJSON(generic, &output, &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output, "[\"a\\\"\\n\"]");
+    genericRelease(generic);
+    result = parseJSON(&generic, output);
+    assertIntegersEqual(result, STATUS_OK);
+    genericRelease(generic);
+    free(output);
+
+    char invalid[] = "\x91\xa1\xff";
+    result = decodeMsgPack(&generic, invalid, sizeof(invalid) - 1);
+    assertIntegersEqual(result, STATUS_PARSE_ERR);
+    assertIsNull(generic);
+}
+
+void testJSONMsgPack() {
+    testJSONMsgPackScalars();
+    testJSONMsgPackRoundTrip();
+    testJSONMsgPackDecodeTruncated();
+    testJSONMsgPackDecodeNested();
+    testJSONMsgPackDecodeLargeIntegers();
+    testJSONMsgPackStrings();
+}
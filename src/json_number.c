@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include "json_number.h"
+#include "cutil/src/error.h"
+
+#define JSON_NUMBER_MAX_EXPONENT 100000
+
+static const char *afterDigits(const char *c) {
+    while(*c >= '0' && *c <= '9') c++;
+    return c;
+}
+
+unsigned int numberCompose(struct JSONNumber *number, const char *lexeme) {
+    const char *c = lexeme;
+    if(*c == '-') c++;
+    if(*c == '0') {
+        c++;
+    } else if(*c >= '1' && *c <= '9') {
+        c = afterDigits(c);
+    } else {
+        return STATUS_PARSE_ERR;
+    }
+
+    number->fraction = 0;
+    number->exponent = 0;
+    if(*c == '.' && c[1] >= '0' && c[1] <= '9') {
+        number->fraction = 1;
+        c = afterDigits(c + 1);
+    }
+    if(*c == 'e' || *c == 'E') {
+        const char *digits = c + 1 + (c[1] == '+' || c[1] == '-');
+        if(*digits >= '0' && *digits <= '9') {
+            number->exponent = 1;
+            c = afterDigits(digits);
+        }
+    }
+
+    // Lengths share a word with the flags.
+    if(c - lexeme >= (1L << 30)) return STATUS_PARSE_ERR;
+    number->type = JSON_TYPE_NUMBER;
+    number->lexeme = lexeme;
+    number->length = c - lexeme;
+    return STATUS_OK;
+}
+
+unsigned int numberInteger(const struct JSONNumber *number, int64_t *value) {
+    if(number->fraction || number->exponent) return STATUS_INPUT_ERR;
+    const char *c = number->lexeme;
+    const char *end = c + number->length;
+    int negative = *c == '-';
+    c += negative;
+
+    // Accumulate as unsigned so INT64_MIN still fits.
+    uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : INT64_MAX;
+    uint64_t magnitude = 0;
+    for(; c < end; c++) {
+        unsigned int digit = *c - '0';
+        if(magnitude > (limit - digit) / 10) return STATUS_INPUT_ERR;
+        magnitude = magnitude * 10 + digit;
+    }
+    *value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+    return STATUS_OK;
+}
+
+double numberDouble(const struct JSONNumber *number) {
+    // A validated lexeme is always followed by something strtod stops at.
+    return strtod(number->lexeme, NULL);
+}
+
+unsigned int numberDecimal(const struct JSONNumber *number, struct JSONBuffer *output) {
+    const char *c = number->lexeme;
+    const char *end = c + number->length;
+    int negative = *c == '-';
+    c += negative;
+
+    const char *integer = c;
+    const char *integerEnd = afterDigits(c);
+    const char *fraction = integerEnd;
+    const char *fractionEnd = integerEnd;
+    if(number->fraction) {
+        fraction = integerEnd + 1;
+        fractionEnd = afterDigits(fraction);
+    }
+    long exponent = 0;
+    if(number->exponent) {
+        const char *e = fractionEnd + 1;
+        int exponentNegative = *e == '-';
+        e += *e == '-' || *e == '+';
+        for(; e < end; e++) {
+            exponent = exponent * 10 + (*e - '0');
+            if(exponent > JSON_NUMBER_MAX_EXPONENT) return STATUS_INPUT_ERR;
+        }
+        if(exponentNegative) exponent = -exponent;
+    }
+
+    // Significant digits are the integer then fraction digits without
+    // their leading and trailing zeros, point is where the decimal point
+    // falls relative to the first of them.
+    long integerLength = integerEnd - integer;
+    long fractionLength = fractionEnd - fraction;
+    long total = integerLength + fractionLength;
+    long first = 0;
+    long last = total;
+    #define DIGIT(i) ((i) < integerLength ? integer[i] : fraction[(i) - integerLength])
+    while(first < total && DIGIT(first) == '0') first++;
+    while(last > first && DIGIT(last - 1) == '0') last--;
+    if(first == total) return bufferAppendChar(output, '0');
+    long point = integerLength + exponent - first;
+
+    unsigned int result = STATUS_OK;
+    if(negative) result = bufferAppendChar(output, '-');
+    if(!result && point <= 0) {
+        result = bufferAppend(output, "0.", 2);
+        if(!result) result = bufferAppendRepeat(output, '0', -point);
+    }
+    for(long i = first; i < last && !result; i++) {
+        if(i - first == point && point > 0) result = bufferAppendChar(output, '.');
+        if(!result) result = bufferAppendChar(output, DIGIT(i));
+    }
+    #undef DIGIT
+    if(!result && point > last - first) {
+        result = bufferAppendRepeat(output, '0', point - (last - first));
+    }
+    return result;
+}
+
+unsigned int numberUnparse(const struct JSONNumber *number, struct JSONBuffer *output) {
+    return bufferAppend(output, number->lexeme, number->length);
+}
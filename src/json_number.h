@@ -0,0 +1,29 @@
+#ifndef __JSON_NUMBER_H
+#define __JSON_NUMBER_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stdint.h>
+#include "json_parser.h"
+#include "json_buffer.h"
+
+// Classify the number at the start of lexeme using the strict JSON
+// grammar, no leading zeros or bare points. STATUS_PARSE_ERR when lexeme
+// does not start with one, otherwise number->length is the valid prefix.
+unsigned int numberCompose(struct JSONNumber *number, const char *lexeme);
+
+// STATUS_INPUT_ERR for numbers with a fraction or exponent, or outside
+// the range of int64_t.
+unsigned int numberInteger(const struct JSONNumber *number, int64_t *value);
+double numberDouble(const struct JSONNumber *number);
+// Exact value written out without an exponent, trailing fraction zeros
+// removed. Absurd exponents are a STATUS_INPUT_ERR.
+unsigned int numberDecimal(const struct JSONNumber *number, struct JSONBuffer *output);
+// The lexeme as it was read.
+unsigned int numberUnparse(const struct JSONNumber *number, struct JSONBuffer *output);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,101 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_number.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+static void assertDecimalEqual(const char *lexeme, const char *expected) {
+    struct JSONNumber number;
+    struct JSONBuffer buffer;
+    bufferCompose(&buffer);
+    assertIntegersEqual(numberCompose(&number, lexeme), STATUS_OK);
+    assertIntegersEqual(numberDecimal(&number, &buffer), STATUS_OK);
+    assertIntegersEqual(buffer.length, strlen(expected));
+    assertIntegersEqual(strncmp(buffer.data, expected, buffer.length), 0);
+    bufferRelease(&buffer);
+}
+
+void testJSONNumberCompose() {
+    struct JSONNumber number;
+    assertIntegersEqual(numberCompose(&number, "-12.5e+3,"), STATUS_OK);
+    assertIntegersEqual(number.type, JSON_TYPE_NUMBER);
+    assertIntegersEqual(number.length, 8);
+    assertIntegersEqual(number.fraction, 1);
+    assertIntegersEqual(number.exponent, 1);
+
+    // Only the valid prefix is taken.
+    assertIntegersEqual(numberCompose(&number, "012"), STATUS_OK);
+    assertIntegersEqual(number.length, 1);
+    assertIntegersEqual(numberCompose(&number, "1.e5"), STATUS_OK);
+    assertIntegersEqual(number.length, 1);
+    assertIntegersEqual(number.fraction, 0);
+
+    assertIntegersEqual(numberCompose(&number, "-"), STATUS_PARSE_ERR);
+    assertIntegersEqual(numberCompose(&number, ".5"), STATUS_PARSE_ERR);
+    assertIntegersEqual(numberCompose(&number, "+1"), STATUS_PARSE_ERR);
+}
+
+void testJSONNumberInteger() {
+    struct JSONNumber number;
+    int64_t value;
+    numberCompose(&number, "-9223372036854775808");
+    assertIntegersEqual(numberInteger(&number, &value), STATUS_OK);
+    assertIntegersEqual(value == INT64_MIN, 1);
+    numberCompose(&number, "9223372036854775807");
+    assertIntegersEqual(numberInteger(&number, &value), STATUS_OK);
+    assertIntegersEqual(value == INT64_MAX, 1);
+
+    numberCompose(&number, "9223372036854775808");
+    assertIntegersEqual(numberInteger(&number, &value), STATUS_INPUT_ERR);
+    numberCompose(&number, "1.0");
+    assertIntegersEqual(numberInteger(&number, &value), STATUS_INPUT_ERR);
+    numberCompose(&number, "1e2");
+    assertIntegersEqual(numberInteger(&number, &value), STATUS_INPUT_ERR);
+}
+
+void testJSONNumberDouble() {
+    struct JSONNumber number;
+    numberCompose(&number, "-2.5e-1]");
+    assertFloatsEqual(numberDouble(&number), -0.25);
+    numberCompose(&number, "1e400");
+    assertIntegersEqual(numberDouble(&number) > 1e308, 1);
+}
+
+void testJSONNumberDecimal() {
+    assertDecimalEqual("0", "0");
+    assertDecimalEqual("-0.000", "0");
+    assertDecimalEqual("120", "120");
+    assertDecimalEqual("1.50", "1.5");
+    assertDecimalEqual("-0.0012", "-0.0012");
+    assertDecimalEqual("12e3", "12000");
+    assertDecimalEqual("1.25E-3", "0.00125");
+    assertDecimalEqual("125e-1", "12.5");
+    assertDecimalEqual("0.1e1", "1");
+    assertDecimalEqual("12345678901234567890.123456789", "12345678901234567890.123456789");
+
+    struct JSONNumber number;
+    struct JSONBuffer buffer;
+    bufferCompose(&buffer);
+    numberCompose(&number, "1e1000000");
+    assertIntegersEqual(numberDecimal(&number, &buffer), STATUS_INPUT_ERR);
+    bufferRelease(&buffer);
+}
+
+void testJSONNumberUnparse() {
+    struct JSONNumber number;
+    struct JSONBuffer buffer;
+    bufferCompose(&buffer);
+    numberCompose(&number, "1.000E+02, 3");
+    assertIntegersEqual(numberUnparse(&number, &buffer), STATUS_OK);
+    assertIntegersEqual(buffer.length, 9);
+    assertIntegersEqual(strncmp(buffer.data, "1.000E+02", 9), 0);
+    bufferRelease(&buffer);
+}
+
+void testJSONNumber() {
+    testJSONNumberCompose();
+    testJSONNumberInteger();
+    testJSONNumberDouble();
+    testJSONNumberDecimal();
+    testJSONNumberUnparse();
+}
@@ -1,66 +1,70 @@
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 #include "json.h"
 #include "json_parser.h"
+#include "json_encoding.h"
+#include "json_number.h"
 #include "cutil/src/error.h"
 #include "cutil/src/string.h"
 #include "cutil/src/map/map.h"
 
-static unsigned int parseElement(struct Generic **generic, struct Iterator *iterator);
-static inline unsigned int parseMember(char **key, struct Generic **value, struct Iterator *iterator);
+static unsigned int parseElement(struct Generic **generic, struct JSONParser *parser);
+static inline unsigned int parseMember(char **key, struct Generic **value, struct JSONParser *parser);
 
-static unsigned int parseWhitespace(struct Iterator *iterator) {
-    struct JSONToken *token = listCurrent(iterator);
-    while(token) {
-        if(token->token != JSON_TOKEN_WHITESPACE && token->token != JSON_TOKEN_NEWLINE) break;
-        token = listNext(iterator);
-    }
-    return STATUS_OK;
+static struct JSONToken *parserCurrent(struct JSONParser *parser) {
+    if(parser->position >= parser->tokens.length) return NULL;
+    return &parser->tokens.tokens[parser->position];
 }
 
-unsigned int parseNumber(struct Generic **generic, struct Iterator *iterator) {
-    struct Iterator myIt = *iterator;
-    struct JSONToken *token = listCurrent(&myIt);
-    if(token && token->token != JSON_TOKEN_NUMBER) return STATUS_PARSE_ERR;
-    // TODO: Too permissive, should require beginning with only hyphen or 1-9.
+static struct JSONToken *parserNext(struct JSONParser *parser) {
+    if(parser->position < parser->tokens.length) parser->position++;
+    return parserCurrent(parser);
+}
 
+unsigned int parseNumber(struct Generic **generic, struct JSONParser *parser) {
+    struct JSONToken *token = parserCurrent(parser);
+    if(!token || token->token != JSON_TOKEN_NUMBER) return STATUS_PARSE_ERR;
+
+    // The whole token must follow the strict grammar.
+    struct JSONNumber number;
     const char *end = strAfterNumber(token->lexeme);
-    const char *tokenStr = strCopyN(token->lexeme, end-token->lexeme);
-    if(tokenStr == NULL) return STATUS_ALLOC_ERR;
+    if(numberCompose(&number, token->lexeme) || number.lexeme + number.length != end) {
+        return STATUS_PARSE_ERR;
+    }
 
-    if(strAfterDigits(token->lexeme) == end) {
-        *generic = genericCompose(&Integer); // TODO: Handle alloc failure.
-        long integerValue = atoi(tokenStr);
-        *((long*)genericData(*generic)) = integerValue;
+    // Converted straight from the input, integers too large for a long
+    // fall back to floating point. A long may be 32 bits, as on Windows.
+    int64_t integerValue;
+    if(numberInteger(&number, &integerValue) == STATUS_OK
+            && integerValue >= LONG_MIN && integerValue <= LONG_MAX) {
+        *generic = genericCompose(&Integer);
+        if(*generic) *((long*)genericData(*generic)) = integerValue;
     } else {
-        *generic = genericCompose(&Float); // TODO: Handle alloc failure.
-        *((float*)genericData(*generic)) = atof(tokenStr);
+        *generic = genericCompose(&Float);
+        if(*generic) *((float*)genericData(*generic)) = numberDouble(&number);
     }
+    if(!*generic) return STATUS_ALLOC_ERR;
 
-    listNext(&myIt);
-
-    *iterator = myIt;
+    parserNext(parser);
     return STATUS_OK;
 }
 
-unsigned int parseString(struct Generic **generic, struct Iterator *iterator) {
-    struct Iterator myIt = *iterator;
-    struct JSONToken *token = listCurrent(&myIt);
-    if(token && token->token != JSON_TOKEN_STRING) return STATUS_PARSE_ERR;
+unsigned int parseString(struct Generic **generic, struct JSONParser *parser) {
+    struct JSONToken *token = parserCurrent(parser);
+    if(!token || token->token != JSON_TOKEN_STRING) return STATUS_PARSE_ERR;
 
-    // Trim quotation marks.
+    // Trim quotation marks, the input itself is left untouched.
     // TODO: Unescape string.
     char *endQuote = strAfterQuotedString(token->lexeme);
-    if(endQuote != token->lexeme) {
-        token->lexeme++;
-        *(endQuote-1) = 0;
-    }
+    if(endQuote == token->lexeme) return STATUS_PARSE_ERR;
 
     struct Generic *result = genericCompose(&String);
     if(!result) {
         return STATUS_ALLOC_ERR;
-    } 
+    }
 
-    char *value = strCopy(token->lexeme);
+    char *value = strCopyN(token->lexeme + 1, endQuote - token->lexeme - 2);
     if(!value) {
         genericRelease(result);
         return STATUS_ALLOC_ERR;
@@ -68,151 +72,157 @@ unsigned int parseString(struct Generic **generic, struct Iterator *iterator) {
     *((char**)genericData(result)) = value;
     *generic = result;
 
-    listNext(&myIt);
-
-    *iterator = myIt;
+    parserNext(parser);
     return STATUS_OK;
 }
 
-unsigned int parseBoolean(struct Generic **generic, struct Iterator *iterator) {
-    struct Iterator myIt = *iterator;
-    struct JSONToken *token = listCurrent(&myIt);
-    if(token && token->token != JSON_TOKEN_BOOL) return STATUS_PARSE_ERR;
+unsigned int parseBoolean(struct Generic **generic, struct JSONParser *parser) {
+    struct JSONToken *token = parserCurrent(parser);
+    if(!token || token->token != JSON_TOKEN_BOOL) return STATUS_PARSE_ERR;
 
+    char boolValue;
     if(*token->lexeme == *JSON_TRUE_STR) {
-        *generic = genericCompose(&Boolean); // TODO: Handle alloc failure.
-        *((char*)genericData(*generic)) = 1;
+        boolValue = 1;
     } else if(*token->lexeme == *JSON_FALSE_STR) {
-        *generic = genericCompose(&Boolean); // TODO: Handle alloc failure.
-        *((char*)genericData(*generic)) = 0;
+        boolValue = 0;
     } else {
         return STATUS_PARSE_ERR;
     }
+    *generic = genericCompose(&Boolean);
+    if(!*generic) return STATUS_ALLOC_ERR;
+    *((char*)genericData(*generic)) = boolValue;
 
-    listNext(&myIt);
-
-    *iterator = myIt;
+    parserNext(parser);
     return STATUS_OK;
 }
 
-unsigned int parseNull(struct Generic **generic, struct Iterator *iterator) {
-    struct Iterator myIt = *iterator;
-    struct JSONToken* token = listCurrent(&myIt);
-    if(token && token->token != JSON_TOKEN_NULL) return STATUS_PARSE_ERR;
+unsigned int parseNull(struct Generic **generic, struct JSONParser *parser) {
+    struct JSONToken* token = parserCurrent(parser);
+    if(!token || token->token != JSON_TOKEN_NULL) return STATUS_PARSE_ERR;
 
-    *generic = genericCompose(&Pointer); // TODO: Handle alloc failure.
+    *generic = genericCompose(&Pointer);
+    if(!*generic) return STATUS_ALLOC_ERR;
     *((void**)genericData(*generic)) = NULL;
 
-    listNext(&myIt);
-
-    *iterator = myIt;
+    parserNext(parser);
     return STATUS_OK;
 }
 
-unsigned int parseElements(struct Generic *vector, struct Iterator *iterator) {
+unsigned int parseElements(struct Generic *vector, struct JSONParser *parser) {
     while(1) {
         struct Generic *generic = NULL;
-        unsigned int result = parseElement(&generic, iterator);
+        unsigned int result = parseElement(&generic, parser);
         if(result == STATUS_OK) {
             unsigned int addResult = genericAdd(vector, "-1", generic);
             if(addResult) {
+                genericRelease(generic);
                 return addResult;
             }
+        } else if(result == STATUS_ALLOC_ERR) {
+            return result;
         }
-        struct JSONToken *token = listCurrent(iterator);
+        struct JSONToken *token = parserCurrent(parser);
         if(!token || *token->lexeme != JSON_SEPERATOR) {
             break;
         }
-        token = listNext(iterator);
+        parserNext(parser);
     }
     return STATUS_OK;
 }
 
-unsigned int parseArray(struct Generic **generic, struct Iterator *iterator) {
-    struct Iterator myIt = *iterator;
-    struct JSONToken *token = listCurrent(&myIt);
-    if(token && *token->lexeme != JSON_ARR_BEGIN) {
+unsigned int parseArray(struct Generic **generic, struct JSONParser *parser) {
+    unsigned int start = parser->position;
+    struct JSONToken *token = parserCurrent(parser);
+    if(!token || *token->lexeme != JSON_ARR_BEGIN) {
         return STATUS_PARSE_ERR;
     }
-    token = listNext(&myIt);
+    token = parserNext(parser);
 
-    struct Generic *vector = genericCompose(&Array.object); // TODO: Handle alloc failure.
+    struct Generic *vector = genericCompose(&Array.object);
+    if(!vector) return STATUS_ALLOC_ERR;
     if(token && *token->lexeme == JSON_ARR_CLOSE) {
-        listNext(&myIt);
+        parserNext(parser);
         *generic = vector;
-        *iterator = myIt;
         return STATUS_OK;
     }
 
-    parseElements(vector, &myIt);
-    token = listCurrent(&myIt);
-    if(!token) return STATUS_PARSE_ERR;
+    unsigned int result = parseElements(vector, parser);
+    if(result) {
+        genericRelease(vector);
+        return result;
+    }
 
+    token = parserCurrent(parser);
     if(token && *token->lexeme == JSON_ARR_CLOSE) {
-        token = listNext(&myIt);
+        parserNext(parser);
         *generic = vector;
-        *iterator = myIt;
         return STATUS_OK;
     }
 
     genericRelease(vector);
+    parser->position = start;
     return STATUS_PARSE_ERR;
 }
 
-unsigned int parseMembers(struct Generic *map, struct Iterator *iterator) {
+unsigned int parseMembers(struct Generic *map, struct JSONParser *parser) {
     struct JSONToken *token = NULL;
     while(1) {
         char *key = NULL;
         struct Generic *value = NULL;
-        unsigned int result = parseMember(&key, &value, iterator);
-        if(result == STATUS_OK) {\
+        unsigned int result = parseMember(&key, &value, parser);
+        if(result == STATUS_OK) {
             unsigned int addResult = genericAdd(map, key, value);
             if(addResult) {
+                free(key);
+                genericRelease(value);
                 return addResult;
             }
+        } else if(result == STATUS_ALLOC_ERR) {
+            return result;
         }
-        token = listCurrent(iterator);
+        token = parserCurrent(parser);
         if(!token || *token->lexeme != JSON_SEPERATOR) break;
-        token = listNext(iterator);
+        parserNext(parser);
     }
     return STATUS_OK;
 }
 
-static unsigned int parseObject(struct Generic **generic, struct Iterator *iterator) {
-    struct Iterator myIt = *iterator;
-
-    struct JSONToken *token = listCurrent(&myIt);
-    if(token && *token->lexeme != JSON_MAP_BEGIN) {
+static unsigned int parseObject(struct Generic **generic, struct JSONParser *parser) {
+    unsigned int start = parser->position;
+    struct JSONToken *token = parserCurrent(parser);
+    if(!token || *token->lexeme != JSON_MAP_BEGIN) {
         return STATUS_PARSE_ERR;
     }
-    token = listNext(&myIt);
+    token = parserNext(parser);
 
-    struct Generic *map = genericCompose(&Map.object); // TODO: Handle alloc failure.
+    struct Generic *map = genericCompose(&Map.object);
+    if(!map) return STATUS_ALLOC_ERR;
     if(token && *token->lexeme == JSON_MAP_CLOSE) {
-        listNext(&myIt);
+        parserNext(parser);
         *generic = map;
-        *iterator = myIt;
         return STATUS_OK;
     }
 
-    parseMembers(map, &myIt);
-    token = listCurrent(&myIt);
-    if(!token) return STATUS_PARSE_ERR;
+    unsigned int result = parseMembers(map, parser);
+    if(result) {
+        genericRelease(map);
+        return result;
+    }
 
+    token = parserCurrent(parser);
     if(token && *token->lexeme == JSON_MAP_CLOSE) {
-        token = listNext(&myIt);
+        parserNext(parser);
         *generic = map;
-        *iterator = myIt;
         return STATUS_OK;
     }
 
     genericRelease(map);
+    parser->position = start;
     return STATUS_PARSE_ERR;
 }
 
-static unsigned int parseElement(struct Generic **generic, struct Iterator *iterator) {
-    parseWhitespace(iterator);
-    const unsigned int (*parsers[])(struct Generic**, struct Iterator*) = {
+static unsigned int parseElement(struct Generic **generic, struct JSONParser *parser) {
+    unsigned int (*parsers[])(struct Generic**, struct JSONParser*) = {
         parseArray,
         parseObject,
         parseString,
@@ -221,32 +231,27 @@ static unsigned int parseElement(struct Generic **generic, struct Iterator *iter
         parseNull
     };
     for(unsigned int i = 0; i < sizeof(parsers) / sizeof(parsers[0]); i++) {
-        unsigned int result = parsers[i](generic, iterator);
-        parseWhitespace(iterator);
-        if(result == STATUS_OK) return result;
+        unsigned int result = parsers[i](generic, parser);
+        if(result != STATUS_PARSE_ERR) return result;
     }
     return STATUS_PARSE_ERR;
 }
 
-static inline unsigned int parseMember(char **key, struct Generic **value, struct Iterator *iterator) {
-    parseWhitespace(iterator);
+static inline unsigned int parseMember(char **key, struct Generic **value, struct JSONParser *parser) {
     struct Generic* string = NULL;
-    unsigned int result = parseString(&string, iterator);
+    unsigned int result = parseString(&string, parser);
     if(result) return result;
     // TODO: Make generic indexes?
     *key = *((char**)genericData(string));
     free(string);
 
-    struct JSONToken *token = listCurrent(iterator);
-    parseWhitespace(iterator);
-    token = listCurrent(iterator);
-
-    if(token && *token->lexeme != JSON_MEMBER_SEP) {
+    struct JSONToken *token = parserCurrent(parser);
+    if(!token || *token->lexeme != JSON_MEMBER_SEP) {
         free(*key);
         return STATUS_PARSE_ERR;
     }
-    token = listNext(iterator);
-    result = parseElement(value, iterator);
+    parserNext(parser);
+    result = parseElement(value, parser);
     if(result) {
         free(*key);
         return result;
@@ -254,27 +259,71 @@ static inline unsigned int parseMember(char **key, struct Generic **value, struc
     return STATUS_OK;
 }
 
-unsigned int parseJSON(struct Generic **generic, char *toCheck) {
+void parserCompose(struct JSONParser *parser) {
+    tokensCompose(&parser->tokens);
+    parser->position = 0;
+    bufferCompose(&parser->text);
+}
+
+void parserRelease(struct JSONParser *parser) {
+    tokensRelease(&parser->tokens);
+    parser->position = 0;
+    bufferRelease(&parser->text);
+}
+
+unsigned int parseJSONWith(struct JSONParser *parser, struct Generic **generic, char *toCheck) {
     *generic = NULL;
-    struct List tokens;
-    listCompose(&tokens);
-    tokens.freeData = (void (*)(void*))tokenRelease;
+    parser->position = 0;
 
-    int result = lexJSON(&tokens, toCheck);
+    unsigned int result = lexJSONTokens(&parser->tokens, toCheck);
     if(result) {
-        listRelease(&tokens);
-        return STATUS_PARSE_ERR;
+        return result == STATUS_ALLOC_ERR ? result : STATUS_PARSE_ERR;
     }
 
-    struct Iterator iterator = listIterator(&tokens);
-    result = parseElement(generic, &iterator);
-
-    if(listNext(&iterator)) {
+    result = parseElement(generic, parser);
+    if(result == STATUS_OK && parserCurrent(parser)) {
         // Garbage followed valid JSON.
         genericRelease(*generic);
+        *generic = NULL;
         result = STATUS_PARSE_ERR;
     }
+    return result;
+}
 
-    listRelease(&tokens);
+unsigned int parseJSONEncodedWith(
+        struct JSONParser *parser,
+        struct Generic **generic,
+        const char *input,
+        size_t length) {
+    *generic = NULL;
+    unsigned int markLength;
+    struct JSONTranscoder transcoder;
+    transcoderCompose(&transcoder, detectEncoding(input, length, &markLength));
+
+    // Even UTF-8 is copied, the lexer needs a terminated string.
+    bufferClear(&parser->text);
+    unsigned int result = transcodeChunk(&transcoder, &parser->text, input + markLength, length - markLength);
+    if(!result) result = transcodeFinish(&transcoder);
+    if(!result) result = bufferTerminate(&parser->text);
+    if(result) return result;
+    // A raw null would cut the document short.
+    if(strlen(parser->text.data) != parser->text.length) return STATUS_PARSE_ERR;
+
+    return parseJSONWith(parser, generic, parser->text.data);
+}
+
+unsigned int parseJSONEncoded(struct Generic **generic, const char *input, size_t length) {
+    struct JSONParser parser;
+    parserCompose(&parser);
+    unsigned int result = parseJSONEncodedWith(&parser, generic, input, length);
+    parserRelease(&parser);
+    return result;
+}
+
+unsigned int parseJSON(struct Generic **generic, char *toCheck) {
+    struct JSONParser parser;
+    parserCompose(&parser);
+    unsigned int result = parseJSONWith(&parser, generic, toCheck);
+    parserRelease(&parser);
     return result;
 }
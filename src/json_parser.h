@@ -4,7 +4,9 @@
 extern "C"{
 #endif
 
+#include <stddef.h>
 #include "json_lexer.h"
+#include "json_buffer.h"
 #include "cutil/src/generic/generic.h"
 
 enum JSON_TYPE {
@@ -17,38 +19,79 @@ enum JSON_TYPE {
     JSON_TYPE_NULL
 };
 
-struct JSONPair {
-    struct JSONPair *next;
-    char *name;
-    enum JSON_TYPE type;
-};
+// Native document nodes, see json_dom.h. Each shares the leading type
+// and length so a JSONValue stays two words. Children of containers are
+// contiguous, strings and numbers point into the document's text.
+struct JSONPair;
+struct JSONValue;
+
 struct JSONObject {
     enum JSON_TYPE type;
+    unsigned int length;
+    // Followed by a hash index once there are JSON_DOM_INDEX_THRESHOLD.
     struct JSONPair *pairs;
 };
 
-struct JSONValue {
-    struct JSONValue *next;
-    enum JSON_TYPE type;
-};
 struct JSONArray {
     enum JSON_TYPE type;
+    unsigned int length;
     struct JSONValue *values;
 };
 
+// Escaped as in the input, without quotation marks or terminator.
 struct JSONString {
     enum JSON_TYPE type;
-    char *value;
+    unsigned int length;
+    const char *value;
 };
 
+// Number kept as its lexeme and only converted when asked, see
+// json_number.h. The lexeme points into the input and is not terminated.
 struct JSONNumber {
     enum JSON_TYPE type;
-    int integer;
-    int fraction;
-    int exponent;
+    unsigned int length : 30;
+    unsigned int fraction : 1;
+    unsigned int exponent : 1;
+    const char *lexeme;
 };
 
+struct JSONValue {
+    union {
+        enum JSON_TYPE type;
+        struct JSONObject object;
+        struct JSONArray array;
+        struct JSONString string;
+        struct JSONNumber number;
+    };
+};
+
+struct JSONPair {
+    struct JSONString name;
+    struct JSONValue value;
+};
+
+// Parser state that is reset rather than freed between documents.
+struct JSONParser {
+    struct JSONTokens tokens;
+    unsigned int position;
+    // Terminated UTF-8 copy of input passed with a length.
+    struct JSONBuffer text;
+};
+
+void parserCompose(struct JSONParser *parser);
+void parserRelease(struct JSONParser *parser);
+
 unsigned int parseJSON(struct Generic **generic, char *toCheck);
+unsigned int parseJSONWith(struct JSONParser *parser, struct Generic **generic, char *toCheck);
+
+// Input of a known length in UTF-8, UTF-16 or UTF-32, detected from its
+// byte order mark or leading null bytes and transcoded before lexing.
+unsigned int parseJSONEncoded(struct Generic **generic, const char *input, size_t length);
+unsigned int parseJSONEncodedWith(
+    struct JSONParser *parser,
+    struct Generic **generic,
+    const char *input,
+    size_t length);
 
 #ifdef __cplusplus
 }
@@ -1,3 +1,4 @@
+#include <string.h>
 #include "json_lexer.h"
 #include "json_parser.h"
 #include "cutil/src/assertion.h"
@@ -145,6 +146,73 @@ void testJSONParserFormatted() {
     assertIntegersEqual(result, STATUS_OK);
 }
 
+void testJSONParseTrailingValue() {
+    char input[] = "[1] 2";
+    struct Generic *generic;
+    int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_PARSE_ERR);
+    assertIsNull(generic);
+}
+
+void testJSONParseWithReusedParser() {
+    char first[] = "{\"a\": [1, 2, 3], \"b\": \"foo\"}";
+    char second[] = "[true, null]";
+    struct JSONParser parser;
+    parserCompose(&parser);
+
+    struct Generic *generic;
+    int result = parseJSONWith(&parser, &generic, first);
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(*((long*)genericData(getAt(generic, "a.2"))), 3);
+    genericRelease(generic);
+    unsigned int capacity = parser.tokens.capacity;
+
+    result = parseJSONWith(&parser, &generic, second);
+    assertIntegersEqual(result, STATUS_OK);
+    assertPointersEqual(getAt(generic, "1")->object, &Pointer);
+    genericRelease(generic);
+    // Token storage is reused rather than reallocated.
+    assertIntegersEqual(parser.tokens.capacity, capacity);
+    assertIntegersEqual(parser.tokens.length, 5);
+
+    result = parseJSONWith(&parser, &generic, "[1,");
+    assertIntegersEqual(result, STATUS_PARSE_ERR);
+
+    parserRelease(&parser);
+}
+
+void testJSONParseNumbers() {
+    char input[] = "[-3, 1e2, 9223372036854775808, -0.5]";
+    struct Generic *generic;
+    int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    struct Generic *element = getAt(generic, "0");
+    assertPointersEqual(element->object, &Integer);
+    assertIntegersEqual(*((long*)genericData(element)), -3);
+    // Exponents and integers past a long become floats.
+    element = getAt(generic, "1");
+    assertPointersEqual(element->object, &Float);
+    assertFloatsEqual(*((float*)genericData(element)), 100.0);
+    element = getAt(generic, "2");
+    assertPointersEqual(element->object, &Float);
+    element = getAt(generic, "3");
+    assertPointersEqual(element->object, &Float);
+    assertFloatsEqual(*((float*)genericData(element)), -0.5);
+    genericRelease(generic);
+}
+
+void testJSONParseNumbersStrict() {
+    char *inputs[] = {"[01]", "[1.]", "[.5]", "[1e]", "[-]", "[+1]"};
+    for(unsigned int i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        char input[8];
+        strcpy(input, inputs[i]);
+        struct Generic *generic;
+        int result = parseJSON(&generic, input);
+        assertIntegersEqual(result, STATUS_PARSE_ERR);
+    }
+}
+
 void testJSONParser() {
     testJSONParseEmptySequence();
     testJSONParseSeqOfSeq();
@@ -162,4 +230,9 @@ void testJSONParser() {
     testJSONParseArrayNoComma();
     testJSONParseArrayNoClosingBracket();
     testJSONParseArrayNoOpeningBracket();
+
+    testJSONParseTrailingValue();
+    testJSONParseWithReusedParser();
+    testJSONParseNumbers();
+    testJSONParseNumbersStrict();
 }
\ No newline at end of file
@@ -0,0 +1,612 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_patch.h"
+#include "json_parser.h"
+#include "cutil/src/string.h"
+#include "cutil/src/map/map.h"
+#include "cutil/src/error.h"
+
+// Edited location of a pointer. nodes[i] is reached through tokens[0..i),
+// every node but the last must exist.
+struct PatchPath {
+    char **tokens;
+    struct Generic **nodes;
+    unsigned int length;
+};
+
+struct Generic *jsonMember(struct Generic *map, const char *key) {
+    // getAt splits on dots, such keys are looked up by walking the map.
+    if(*key && !strchr(key, '.')) return getAt(map, key);
+
+    struct Collection *collection = (struct Collection*)map->object;
+    struct Iterator iterator = collection->iterator(genericData(map));
+    const void *memberKey;
+    while((memberKey = mapKey(&iterator))) {
+        struct Generic *member = collection->next(&iterator);
+        if(strcmp(memberKey, key) == 0) return member;
+    }
+    return NULL;
+}
+
+static unsigned int memberCount(struct Generic *container) {
+    struct Collection *collection = (struct Collection*)container->object;
+    struct Iterator iterator = collection->iterator(genericData(container));
+    unsigned int count = 0;
+    while(collection->next(&iterator)) count++;
+    return count;
+}
+
+// Array index of a reference token, -1 unless it is digits without a
+// leading zero.
+static long patchIndex(const char *token) {
+    if(*token == '\0' || (*token == '0' && token[1] != '\0')) return -1;
+    long index = 0;
+    for(; *token; token++) {
+        if(*token < '0' || *token > '9' || index > 0xFFFFFFF) return -1;
+        index = index * 10 + (*token - '0');
+    }
+    return index;
+}
+
+static struct Generic *patchChild(struct Generic *container, const char *token) {
+    if(container->object == &Map.object) return jsonMember(container, token);
+    if(container->object == &Array.object && patchIndex(token) >= 0) {
+        return getAt(container, token);
+    }
+    return NULL;
+}
+
+unsigned int jsonCopy(struct Generic **copy, struct Generic *generic) {
+    *copy = genericCompose(generic->object);
+    if(!*copy) return STATUS_ALLOC_ERR;
+    void *data = genericData(*copy);
+    void *source = genericData(generic);
+
+    if(generic->object == &Integer) {
+        *((long*)data) = *((long*)source);
+    } else if(generic->object == &Float) {
+        *((float*)data) = *((float*)source);
+    } else if(generic->object == &Boolean) {
+        *((char*)data) = *((char*)source);
+    } else if(generic->object == &Pointer) {
+        *((void**)data) = *((void**)source);
+    } else if(generic->object == &String) {
+        char *value = strCopy(*((char**)source));
+        if(!value) goto fail;
+        *((char**)data) = value;
+    } else if(generic->object == &Array.object || generic->object == &Map.object) {
+        struct Collection *collection = (struct Collection*)generic->object;
+        struct Iterator iterator = collection->iterator(source);
+        int isMap = generic->object == &Map.object;
+        while(1) {
+            const char *key = isMap ? mapKey(&iterator) : "-1";
+            struct Generic *element = collection->next(&iterator);
+            if(!element) break;
+
+            struct Generic *elementCopy;
+            if(jsonCopy(&elementCopy, element)) goto fail;
+            char *keyCopy = isMap ? strCopy(key) : (char*)key;
+            if(!keyCopy || genericAdd(*copy, keyCopy, elementCopy)) {
+                if(isMap) free(keyCopy);
+                genericRelease(elementCopy);
+                goto fail;
+            }
+        }
+    } else {
+        genericRelease(*copy);
+        *copy = NULL;
+        return STATUS_INPUT_ERR;
+    }
+    return STATUS_OK;
+
+fail:
+    genericRelease(*copy);
+    *copy = NULL;
+    return STATUS_ALLOC_ERR;
+}
+
+static int isNumber(struct Generic *generic) {
+    return generic->object == &Integer || generic->object == &Float;
+}
+
+static double numberValue(struct Generic *generic) {
+    if(generic->object == &Integer) return *((long*)genericData(generic));
+    return *((float*)genericData(generic));
+}
+
+int jsonEquals(struct Generic *a, struct Generic *b) {
+    if(isNumber(a) && isNumber(b)) {
+        if(a->object == &Integer && b->object == &Integer) {
+            return *((long*)genericData(a)) == *((long*)genericData(b));
+        }
+        return numberValue(a) == numberValue(b);
+    }
+    if(a->object != b->object) return 0;
+
+    void *dataA = genericData(a);
+    void *dataB = genericData(b);
+    if(a->object == &Boolean) return !*((char*)dataA) == !*((char*)dataB);
+    if(a->object == &Pointer) return *((void**)dataA) == *((void**)dataB);
+    if(a->object == &String) return strcmp(*((char**)dataA), *((char**)dataB)) == 0;
+
+    struct Collection *collection = (struct Collection*)a->object;
+    if(a->object == &Array.object) {
+        struct Iterator iteratorA = collection->iterator(dataA);
+        struct Iterator iteratorB = collection->iterator(dataB);
+        while(1) {
+            struct Generic *elementA = collection->next(&iteratorA);
+            struct Generic *elementB = collection->next(&iteratorB);
+            if(!elementA || !elementB) return elementA == elementB;
+            if(!jsonEquals(elementA, elementB)) return 0;
+        }
+    }
+    if(a->object == &Map.object) {
+        if(((struct Map*)dataA)->size != ((struct Map*)dataB)->size) return 0;
+        struct Iterator iterator = collection->iterator(dataA);
+        const void *key;
+        while((key = mapKey(&iterator))) {
+            struct Generic *member = collection->next(&iterator);
+            struct Generic *other = jsonMember(b, key);
+            if(!other || !jsonEquals(member, other)) return 0;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static void pathRelease(struct PatchPath *path) {
+    for(unsigned int i = 0; i < path->length; i++) {
+        free(path->tokens[i]);
+    }
+    free(path->tokens);
+    free(path->nodes);
+}
+
+static unsigned int pathCompose(
+        struct PatchPath *path,
+        struct Generic *document,
+        const char *pointer) {
+    path->tokens = NULL;
+    path->nodes = NULL;
+    path->length = 0;
+    if(*pointer != '\0' && *pointer != '/') return STATUS_INPUT_ERR;
+
+    unsigned int length = 0;
+    for(const char *c = pointer; *c; c++) {
+        if(*c == '/') length++;
+    }
+    path->tokens = calloc(length ? length : 1, sizeof(char*));
+    path->nodes = calloc(length + 1, sizeof(struct Generic*));
+    if(!path->tokens || !path->nodes) {
+        pathRelease(path);
+        return STATUS_ALLOC_ERR;
+    }
+
+    // Split on slashes and unescape "~1" then "~0".
+    const char *c = pointer;
+    for(unsigned int i = 0; i < length; i++) {
+        const char *start = ++c;
+        while(*c && *c != '/') c++;
+        char *token = malloc(c - start + 1);
+        if(!token) {
+            pathRelease(path);
+            return STATUS_ALLOC_ERR;
+        }
+        path->tokens[path->length++] = token;
+        for(const char *s = start; s < c; s++) {
+            if(*s != '~') {
+                *token++ = *s;
+            } else if(s[1] == '0' || s[1] == '1') {
+                *token++ = *++s == '0' ? '~' : '/';
+            } else {
+                pathRelease(path);
+                return STATUS_INPUT_ERR;
+            }
+        }
+        *token = '\0';
+    }
+
+    path->nodes[0] = document;
+    for(unsigned int i = 0; i < length; i++) {
+        if(!path->nodes[i]) {
+            pathRelease(path);
+            return STATUS_INPUT_ERR;
+        }
+        path->nodes[i + 1] = patchChild(path->nodes[i], path->tokens[i]);
+    }
+    return STATUS_OK;
+}
+
+struct Generic *pointerGet(struct Generic *document, const char *pointer) {
+    struct PatchPath path;
+    if(pathCompose(&path, document, pointer)) return NULL;
+    struct Generic *target = path.nodes[path.length];
+    pathRelease(&path);
+    return target;
+}
+
+// The containers above the edit serialize differently from now on.
+static void pathInvalidate(struct PatchPath *path, struct JSONCache *cache) {
+    if(!cache) return;
+    for(unsigned int i = 0; i < path->length; i++) {
+        cacheInvalidate(cache, path->nodes[i]);
+    }
+}
+
+// Store value under token, releasing what was there. Takes ownership of
+// value, also on failure.
+static unsigned int patchSet(
+        struct Generic *container,
+        const char *token,
+        struct Generic *value,
+        struct JSONCache *cache) {
+    struct Generic *old = patchChild(container, token);
+    if(old && cache) cacheForget(cache, old);
+
+    unsigned int result;
+    if(container->object == &Map.object) {
+        char *key = strCopy(token);
+        if(!key) {
+            genericRelease(value);
+            return STATUS_ALLOC_ERR;
+        }
+        result = genericAdd(container, key, value);
+        if(result) free(key);
+    } else {
+        result = genericAdd(container, old ? token : "-1", value);
+    }
+    if(result) genericRelease(value);
+    return result;
+}
+
+// Replace the node at depth with value. Takes ownership of value.
+static unsigned int patchReplaceNode(
+        struct Generic **document,
+        struct PatchPath *path,
+        unsigned int depth,
+        struct Generic *value,
+        struct JSONCache *cache) {
+    if(depth > 0) {
+        return patchSet(path->nodes[depth - 1], path->tokens[depth - 1], value, cache);
+    }
+    if(cache) cacheForget(cache, *document);
+    genericRelease(*document);
+    *document = value;
+    return STATUS_OK;
+}
+
+// Bytes of a value that can be handed to another node by swapping them.
+// Scalars hold their value inline and a Map only points at its entries
+// (map.h). Array storage is not documented, so arrays are never swapped.
+static size_t patchRelocatable(struct Generic *node) {
+    if(node->object == &Map.object) return sizeof(struct Map);
+    if(node->object == &Integer) return sizeof(long);
+    if(node->object == &Float) return sizeof(float);
+    if(node->object == &Boolean) return sizeof(char);
+    if(node->object == &String) return sizeof(char*);
+    if(node->object == &Pointer) return sizeof(void*);
+    return 0;
+}
+
+// Members paired with the fresh nodes that take over their values,
+// from and to alternating.
+struct PatchMoves {
+    struct Generic **nodes;
+    unsigned int length;
+    unsigned int capacity;
+};
+
+static unsigned int movesAdd(struct PatchMoves *moves, struct Generic *from, struct Generic *to) {
+    if(moves->length + 2 > moves->capacity) {
+        unsigned int capacity = moves->capacity ? moves->capacity * 2 : 16;
+        struct Generic **nodes = realloc(moves->nodes, capacity * sizeof(struct Generic*));
+        if(!nodes) return STATUS_ALLOC_ERR;
+        moves->nodes = nodes;
+        moves->capacity = capacity;
+    }
+    moves->nodes[moves->length++] = from;
+    moves->nodes[moves->length++] = to;
+    return STATUS_OK;
+}
+
+// An empty node of the same type as from, to receive its value. An array
+// is rebuilt around receivers for its own elements instead.
+static unsigned int patchReceiver(struct Generic **receiver, struct Generic *from, struct PatchMoves *moves) {
+    if(!patchRelocatable(from) && from->object != &Array.object) return STATUS_INPUT_ERR;
+    *receiver = genericCompose(from->object);
+    if(!*receiver) return STATUS_ALLOC_ERR;
+    unsigned int result = movesAdd(moves, from, *receiver);
+    if(result || from->object != &Array.object) {
+        if(result) genericRelease(*receiver);
+        return result;
+    }
+
+    struct Collection *collection = (struct Collection*)from->object;
+    struct Iterator iterator = collection->iterator(genericData(from));
+    struct Generic *element;
+    while(!result && (element = collection->next(&iterator))) {
+        struct Generic *elementReceiver;
+        result = patchReceiver(&elementReceiver, element, moves);
+        if(result) break;
+        result = genericAdd(*receiver, "-1", elementReceiver);
+        if(result) genericRelease(elementReceiver);
+    }
+    if(result) genericRelease(*receiver);
+    return result;
+}
+
+// Swap every relocatable value into its receiver, leaving the members
+// empty so releasing them frees nothing below. Cache entries follow the
+// values.
+static void patchMove(struct PatchMoves *moves, struct JSONCache *cache) {
+    for(unsigned int i = 0; i < moves->length; i += 2) {
+        struct Generic *from = moves->nodes[i];
+        struct Generic *to = moves->nodes[i + 1];
+        size_t size = patchRelocatable(from);
+        char *fromData = genericData(from);
+        char *toData = genericData(to);
+        for(size_t b = 0; b < size; b++) {
+            char swap = fromData[b];
+            fromData[b] = toData[b];
+            toData[b] = swap;
+        }
+        if(cache) cacheMove(cache, from, to);
+    }
+}
+
+// cutil has no way to insert into or remove from a container, so the
+// container is rebuilt around fresh nodes that take over the values of
+// its remaining members. Nothing below a Map or scalar is copied, arrays
+// are rebuilt the same way. Values are only moved once every receiver
+// exists, so a failure leaves the document as it was. Takes ownership of
+// insert.
+static unsigned int patchRebuild(
+        struct Generic **rebuilt,
+        struct Generic *container,
+        const char *skipKey,
+        long skipIndex,
+        long insertIndex,
+        struct Generic *insert,
+        struct JSONCache *cache) {
+    *rebuilt = genericCompose(container->object);
+    if(!*rebuilt) {
+        if(insert) genericRelease(insert);
+        return STATUS_ALLOC_ERR;
+    }
+
+    struct PatchMoves moves = {NULL, 0, 0};
+    struct Collection *collection = (struct Collection*)container->object;
+    struct Iterator iterator = collection->iterator(genericData(container));
+    int isMap = container->object == &Map.object;
+    for(long index = 0;; index++) {
+        if(index == insertIndex) {
+            unsigned int result = genericAdd(*rebuilt, "-1", insert);
+            if(result) {
+                free(moves.nodes);
+                genericRelease(insert);
+                genericRelease(*rebuilt);
+                return result;
+            }
+        }
+
+        const char *key = isMap ? mapKey(&iterator) : "-1";
+        struct Generic *element = collection->next(&iterator);
+        if(!element) break;
+        if(index == skipIndex || (skipKey && strcmp(key, skipKey) == 0)) continue;
+
+        struct Generic *receiver;
+        char *keyCopy = NULL;
+        unsigned int result = patchReceiver(&receiver, element, &moves);
+        if(result == STATUS_OK && isMap && !(keyCopy = strCopy(key))) {
+            genericRelease(receiver);
+            result = STATUS_ALLOC_ERR;
+        }
+        if(result == STATUS_OK) {
+            result = genericAdd(*rebuilt, isMap ? keyCopy : key, receiver);
+            if(result) {
+                free(keyCopy);
+                genericRelease(receiver);
+            }
+        }
+        if(result) {
+            free(moves.nodes);
+            if(insert && index < insertIndex) genericRelease(insert);
+            genericRelease(*rebuilt);
+            return result;
+        }
+    }
+
+    patchMove(&moves, cache);
+    free(moves.nodes);
+    return STATUS_OK;
+}
+
+// Takes ownership of value.
+static unsigned int patchAdd(
+        struct Generic **document,
+        const char *pointer,
+        struct Generic *value,
+        struct JSONCache *cache) {
+    struct PatchPath path;
+    unsigned int result = pathCompose(&path, *document, pointer);
+    if(result) {
+        genericRelease(value);
+        return result;
+    }
+    pathInvalidate(&path, cache);
+
+    if(path.length == 0) {
+        result = patchReplaceNode(document, &path, 0, value, cache);
+        pathRelease(&path);
+        return result;
+    }
+
+    struct Generic *parent = path.nodes[path.length - 1];
+    const char *token = path.tokens[path.length - 1];
+    if(parent->object == &Map.object) {
+        result = patchSet(parent, token, value, cache);
+    } else if(parent->object == &Array.object) {
+        long count = memberCount(parent);
+        long index = strcmp(token, "-") == 0 ? count : patchIndex(token);
+        if(index < 0 || index > count) {
+            genericRelease(value);
+            result = STATUS_INPUT_ERR;
+        } else if(index == count) {
+            result = genericAdd(parent, "-1", value);
+            if(result) genericRelease(value);
+        } else {
+            struct Generic *rebuilt;
+            result = patchRebuild(&rebuilt, parent, NULL, -1, index, value, cache);
+            if(result == STATUS_OK) {
+                result = patchReplaceNode(document, &path, path.length - 1, rebuilt, cache);
+            }
+        }
+    } else {
+        genericRelease(value);
+        result = STATUS_INPUT_ERR;
+    }
+    pathRelease(&path);
+    return result;
+}
+
+static unsigned int patchRemove(
+        struct Generic **document,
+        const char *pointer,
+        struct JSONCache *cache) {
+    struct PatchPath path;
+    unsigned int result = pathCompose(&path, *document, pointer);
+    if(result) return result;
+    if(path.length == 0 || !path.nodes[path.length]) {
+        pathRelease(&path);
+        return STATUS_INPUT_ERR;
+    }
+    pathInvalidate(&path, cache);
+
+    struct Generic *parent = path.nodes[path.length - 1];
+    const char *token = path.tokens[path.length - 1];
+    int isMap = parent->object == &Map.object;
+    struct Generic *rebuilt;
+    result = patchRebuild(
+        &rebuilt,
+        parent,
+        isMap ? token : NULL,
+        isMap ? -1 : patchIndex(token),
+        -1,
+        NULL,
+        cache);
+    if(result == STATUS_OK) {
+        result = patchReplaceNode(document, &path, path.length - 1, rebuilt, cache);
+    }
+    pathRelease(&path);
+    return result;
+}
+
+// Takes ownership of value.
+static unsigned int patchReplace(
+        struct Generic **document,
+        const char *pointer,
+        struct Generic *value,
+        struct JSONCache *cache) {
+    struct PatchPath path;
+    unsigned int result = pathCompose(&path, *document, pointer);
+    if(result == STATUS_OK && !path.nodes[path.length]) {
+        pathRelease(&path);
+        result = STATUS_INPUT_ERR;
+    }
+    if(result) {
+        genericRelease(value);
+        return result;
+    }
+    pathInvalidate(&path, cache);
+    result = patchReplaceNode(document, &path, path.length, value, cache);
+    pathRelease(&path);
+    return result;
+}
+
+static const char *operationString(struct Generic *operation, const char *member) {
+    struct Generic *value = jsonMember(operation, member);
+    if(!value || value->object != &String) return NULL;
+    return *((char**)genericData(value));
+}
+
+static unsigned int patchOperation(
+        struct Generic **document,
+        struct Generic *operation,
+        struct JSONCache *cache) {
+    if(operation->object != &Map.object) return STATUS_PARSE_ERR;
+    const char *op = operationString(operation, "op");
+    const char *pointer = operationString(operation, "path");
+    if(!op || !pointer) return STATUS_PARSE_ERR;
+
+    int needsValue = !strcmp(op, "add") || !strcmp(op, "replace") || !strcmp(op, "test");
+    int needsFrom = !strcmp(op, "move") || !strcmp(op, "copy");
+    if(!needsValue && !needsFrom && strcmp(op, "remove")) return STATUS_PARSE_ERR;
+
+    struct Generic *value = NULL;
+    if(needsValue) {
+        struct Generic *patchValue = jsonMember(operation, "value");
+        if(!patchValue) return STATUS_PARSE_ERR;
+        if(!strcmp(op, "test")) {
+            struct Generic *target = pointerGet(*document, pointer);
+            return target && jsonEquals(target, patchValue) ? STATUS_OK : STATUS_INPUT_ERR;
+        }
+        // The patch keeps its own values.
+        unsigned int result = jsonCopy(&value, patchValue);
+        if(result) return result;
+        if(!strcmp(op, "add")) return patchAdd(document, pointer, value, cache);
+        return patchReplace(document, pointer, value, cache);
+    }
+
+    if(needsFrom) {
+        const char *from = operationString(operation, "from");
+        if(!from) return STATUS_PARSE_ERR;
+        struct Generic *source = pointerGet(*document, from);
+        if(!source) return STATUS_INPUT_ERR;
+
+        unsigned int fromLength = strlen(from);
+        int isMove = !strcmp(op, "move");
+        if(isMove && !strcmp(from, pointer)) return STATUS_OK;
+        // A value cannot be moved into one of its own children.
+        if(isMove && !strncmp(from, pointer, fromLength) && pointer[fromLength] == '/') {
+            return STATUS_INPUT_ERR;
+        }
+
+        unsigned int result = jsonCopy(&value, source);
+        if(result) return result;
+        if(isMove && (result = patchRemove(document, from, cache))) {
+            genericRelease(value);
+            return result;
+        }
+        return patchAdd(document, pointer, value, cache);
+    }
+
+    return patchRemove(document, pointer, cache);
+}
+
+unsigned int patchJSON(
+        struct Generic **document,
+        struct Generic *patch,
+        struct JSONCache *cache) {
+    if(patch->object != &Array.object) return STATUS_PARSE_ERR;
+
+    struct Collection *collection = (struct Collection*)patch->object;
+    struct Iterator iterator = collection->iterator(genericData(patch));
+    struct Generic *operation;
+    while((operation = collection->next(&iterator))) {
+        unsigned int result = patchOperation(document, operation, cache);
+        if(result) return result;
+    }
+    return STATUS_OK;
+}
+
+unsigned int patchJSONText(
+        struct Generic **document,
+        char *patch,
+        struct JSONCache *cache) {
+    struct Generic *operations;
+    unsigned int result = parseJSON(&operations, patch);
+    if(result) return result;
+    result = patchJSON(document, operations, cache);
+    genericRelease(operations);
+    return result;
+}
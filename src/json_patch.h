@@ -0,0 +1,42 @@
+#ifndef __JSON_PATCH_H
+#define __JSON_PATCH_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include "json_cache.h"
+#include "cutil/src/generic/generic.h"
+
+// Deep copy of a tree.
+unsigned int jsonCopy(struct Generic **copy, struct Generic *generic);
+
+// Structural equality, members compare regardless of order and numbers
+// by value.
+int jsonEquals(struct Generic *a, struct Generic *b);
+
+// Member of an object by exact key.
+struct Generic *jsonMember(struct Generic *map, const char *key);
+
+// Resolve an RFC 6901 JSON Pointer, NULL when nothing is there.
+struct Generic *pointerGet(struct Generic *document, const char *pointer);
+
+// Apply an RFC 6902 patch, an array of operation objects, in place. The
+// document root may be replaced. Operations apply in order and stop at
+// the first failure, earlier operations stay applied. A malformed patch
+// is a STATUS_PARSE_ERR, an operation that does not apply or a failing
+// test a STATUS_INPUT_ERR. When a cache is given, entries of the edited
+// path and of every removed subtree are dropped, everything else keeps
+// its entries.
+unsigned int patchJSON(
+    struct Generic **document,
+    struct Generic *patch,
+    struct JSONCache *cache);
+unsigned int patchJSONText(
+    struct Generic **document,
+    char *patch,
+    struct JSONCache *cache);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include "json_parser.h"
+#include "json_patch.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+void testJSONPatchPointer() {
+    char input[] = "{\"a/b\": 1, \"m~n\": 2, \"\": 3, \"c.d\": [4, {\"e\": 5}]}";
+    struct Generic *generic;
+    unsigned int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    assertPointersEqual(pointerGet(generic, ""), generic);
+    assertIntegersEqual(*(long*)genericData(pointerGet(generic, "/a~1b")), 1);
+    assertIntegersEqual(*(long*)genericData(pointerGet(generic, "/m~0n")), 2);
+    assertIntegersEqual(*(long*)genericData(pointerGet(generic, "/")), 3);
+    assertIntegersEqual(*(long*)genericData(pointerGet(generic, "/c.d/1/e")), 5);
+    assertIsNull(pointerGet(generic, "/c.d/01"));
+    assertIsNull(pointerGet(generic, "/c.d/-"));
+    assertIsNull(pointerGet(generic, "/x/y"));
+    assertIsNull(pointerGet(generic, "a"));
+    assertIsNull(pointerGet(generic, "/m~2n"));
+
+    genericRelease(generic);
+}
+
+void testJSONPatchOperations() {
+    char input[] = "{\"foo\": [\"bar\", \"baz\"], \"qux\": {\"x\": 1, \"y\": true}}";
+    struct Generic *generic;
+    unsigned int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char patch[] = "["
+        "{\"op\": \"add\", \"path\": \"/foo/1\", \"value\": \"qux\"},"
+        "{\"op\": \"add\", \"path\": \"/foo/-\", \"value\": [7]},"
+        "{\"op\": \"remove\", \"path\": \"/foo/0\"},"
+        "{\"op\": \"replace\", \"path\": \"/qux/x\", \"value\": 10},"
+        "{\"op\": \"add\", \"path\": \"/new\", \"value\": null},"
+        "{\"op\": \"remove\", \"path\": \"/qux/y\"},"
+        "{\"op\": \"copy\", \"from\": \"/foo/2\", \"path\": \"/qux/copy\"},"
+        "{\"op\": \"move\", \"from\": \"/foo/0\", \"path\": \"/moved\"},"
+        "{\"op\": \"test\", \"path\": \"/foo\", \"value\": [\"baz\", [7]]}"
+    "]";
+    result = patchJSONText(&generic, patch, NULL);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char expectedInput[] = "{\"foo\": [\"baz\", [7]], \"qux\": {\"x\": 10, \"copy\": [7]}, "
+        "\"new\": null, \"moved\": \"qux\"}";
+    struct Generic *expected;
+    result = parseJSON(&expected, expectedInput);
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(jsonEquals(generic, expected), 1);
+
+    // Copies do not share storage with their source.
+    assertIntegersEqual(pointerGet(generic, "/qux/copy") != pointerGet(generic, "/foo/1"), 1);
+
+    genericRelease(expected);
+    genericRelease(generic);
+}
+
+void testJSONPatchFailures() {
+    char input[] = "{\"a\": [1, 2], \"b\": {\"c\": 1}}";
+    struct Generic *generic;
+    unsigned int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char failingTest[] = "[{\"op\": \"test\", \"path\": \"/a/1\", \"value\": 3}]";
+    assertIntegersEqual(patchJSONText(&generic, failingTest, NULL), STATUS_INPUT_ERR);
+    char passingTest[] = "[{\"op\": \"test\", \"path\": \"/b\", \"value\": {\"c\": 1.0}}]";
+    assertIntegersEqual(patchJSONText(&generic, passingTest, NULL), STATUS_OK);
+
+    char outOfRange[] = "[{\"op\": \"add\", \"path\": \"/a/3\", \"value\": 3}]";
+    assertIntegersEqual(patchJSONText(&generic, outOfRange, NULL), STATUS_INPUT_ERR);
+    char missingParent[] = "[{\"op\": \"add\", \"path\": \"/x/y\", \"value\": 3}]";
+    assertIntegersEqual(patchJSONText(&generic, missingParent, NULL), STATUS_INPUT_ERR);
+    char missingTarget[] = "[{\"op\": \"replace\", \"path\": \"/b/d\", \"value\": 3}]";
+    assertIntegersEqual(patchJSONText(&generic, missingTarget, NULL), STATUS_INPUT_ERR);
+    char intoChild[] = "[{\"op\": \"move\", \"from\": \"/b\", \"path\": \"/b/c/d\"}]";
+    assertIntegersEqual(patchJSONText(&generic, intoChild, NULL), STATUS_INPUT_ERR);
+
+    char unknownOp[] = "[{\"op\": \"frob\", \"path\": \"/a\"}]";
+    assertIntegersEqual(patchJSONText(&generic, unknownOp, NULL), STATUS_PARSE_ERR);
+    char missingValue[] = "[{\"op\": \"add\", \"path\": \"/a\"}]";
+    assertIntegersEqual(patchJSONText(&generic, missingValue, NULL), STATUS_PARSE_ERR);
+    char notArray[] = "{\"op\": \"remove\", \"path\": \"/a\"}";
+    assertIntegersEqual(patchJSONText(&generic, notArray, NULL), STATUS_PARSE_ERR);
+
+    // Operations before a failure stay applied.
+    char partial[] = "[{\"op\": \"remove\", \"path\": \"/a/0\"}, {\"op\": \"remove\", \"path\": \"/z\"}]";
+    assertIntegersEqual(patchJSONText(&generic, partial, NULL), STATUS_INPUT_ERR);
+    assertIntegersEqual(*(long*)genericData(pointerGet(generic, "/a/0")), 2);
+
+    char root[] = "[{\"op\": \"replace\", \"path\": \"\", \"value\": [true]}]";
+    assertIntegersEqual(patchJSONText(&generic, root, NULL), STATUS_OK);
+    assertIntegersEqual(*(char*)genericData(pointerGet(generic, "/0")), 1);
+
+    genericRelease(generic);
+}
+
+void testJSONPatchCache() {
+    char input[] = "{\"a\": {\"b\": [1, 2, 3], \"c\": [4, 5, 6]}, \"d\": [7, 8, 9]}";
+    struct Generic *generic;
+    unsigned int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    struct JSONCache cache;
+    cacheCompose(&cache, 0);
+    struct JSONUnparser unparser;
+    unparserCompose(&unparser);
+    unparser.cache = &cache;
+    struct JSONFormat fmt = {2, 0, 0};
+    const char *output;
+    unsigned int length;
+    result = unparseJSONWith(&unparser, generic, &output, &length, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char patch[] = "[{\"op\": \"replace\", \"path\": \"/a/b/1\", \"value\": 20}]";
+    result = patchJSONText(&generic, patch, &cache);
+    assertIntegersEqual(result, STATUS_OK);
+
+    // Only the edited path is dropped, siblings keep their text.
+    assertIsNull(cacheFind(&cache, generic, fmt));
+    assertIsNull(cacheFind(&cache, getAt(generic, "a"), (struct JSONFormat){2, 1, 0}));
+    assertIsNull(cacheFind(&cache, getAt(generic, "a.b"), (struct JSONFormat){2, 2, 0}));
+    assertNotNull(cacheFind(&cache, getAt(generic, "a.c"), (struct JSONFormat){2, 2, 0}));
+    assertNotNull(cacheFind(&cache, getAt(generic, "d"), (struct JSONFormat){2, 1, 0}));
+
+    char removal[] = "[{\"op\": \"remove\", \"path\": \"/a/c/0\"}, {\"op\": \"add\", \"path\": \"/d/0\", \"value\": 0}]";
+    result = patchJSONText(&generic, removal, &cache);
+    assertIntegersEqual(result, STATUS_OK);
+
+    result = unparseJSONWith(&unparser, generic, &output, &length, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    char *uncached;
+    unsigned int uncachedLength;
+    result = unparseJSON(generic, &uncached, &uncachedLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output, uncached);
+    free(uncached);
+
+    unparserRelease(&unparser);
+    cacheRelease(&cache);
+    genericRelease(generic);
+}
+
+void testJSONPatchCacheSiblings() {
+    char input[] = "{\"x\": {\"big\": [1, 2, 3]}, \"y\": [[4, 5], [6, 7], {\"n\": [8, 9]}], \"z\": 1}";
+    struct Generic *generic;
+    unsigned int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    struct JSONCache cache;
+    cacheCompose(&cache, 0);
+    struct JSONUnparser unparser;
+    unparserCompose(&unparser);
+    unparser.cache = &cache;
+    struct JSONFormat fmt = {0, 0, 0};
+    const char *output;
+    unsigned int length;
+    result = unparseJSONWith(&unparser, generic, &output, &length, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    struct Generic *big = getAt(generic, "x.big");
+    struct Generic *nine = getAt(generic, "y.2.n.1");
+
+    // Removing z rebuilds the root. Maps move over whole, arrays are
+    // rebuilt around the values of their elements.
+    char patch[] = "[{\"op\": \"remove\", \"path\": \"/z\"}, {\"op\": \"remove\", \"path\": \"/y/0\"}, {\"op\": \"add\", \"path\": \"/y/0\", \"value\": 0}]";
+    result = patchJSONText(&generic, patch, &cache);
+    assertIntegersEqual(result, STATUS_OK);
+
+    assertIsNull(cacheFind(&cache, generic, fmt));
+    assertIsNull(cacheFind(&cache, getAt(generic, "y"), fmt));
+    assertNotNull(cacheFind(&cache, getAt(generic, "x"), fmt));
+    assertNotNull(cacheFind(&cache, getAt(generic, "y.1"), fmt));
+    assertNotNull(cacheFind(&cache, getAt(generic, "y.2"), fmt));
+    assertPointersEqual(getAt(generic, "x.big"), big);
+    assertPointersEqual(getAt(generic, "y.2.n.1"), nine);
+    struct Generic *moved = getAt(generic, "y.1.1");
+    assertNotNull(moved);
+    assertPointersEqual(moved->object, &Integer);
+    assertIntegersEqual(*((long*)genericData(moved)), 7);
+
+    result = unparseJSONWith(&unparser, generic, &output, &length, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    char *uncached;
+    unsigned int uncachedLength;
+    result = unparseJSON(generic, &uncached, &uncachedLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output, uncached);
+    free(uncached);
+
+    unparserRelease(&unparser);
+    cacheRelease(&cache);
+    genericRelease(generic);
+}
+
+void testJSONPatch() {
+    testJSONPatchPointer();
+    testJSONPatchOperations();
+    testJSONPatchFailures();
+    testJSONPatchCache();
+    testJSONPatchCacheSiblings();
+}
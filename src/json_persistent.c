@@ -0,0 +1,426 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+#include "json_persistent.h"
+#include "json_dom.h"
+#include "json_encoding.h"
+#include "cutil/src/error.h"
+#include "cutil/src/string.h"
+#include "cutil/src/map/map.h"
+
+static struct JSONPersistent *nodeCompose(enum JSON_TYPE type, unsigned int length) {
+    struct JSONPersistent *node = malloc(sizeof(struct JSONPersistent));
+    if(node == NULL) return NULL;
+    node->references = 1;
+    node->type = type;
+    node->length = length;
+    node->children = NULL;
+    node->keys = NULL;
+    node->text = NULL;
+    if(length && (type == JSON_TYPE_OBJECT || type == JSON_TYPE_ARRAY)) {
+        node->children = calloc(length, sizeof(struct JSONPersistent*));
+        if(type == JSON_TYPE_OBJECT) node->keys = calloc(length, sizeof(struct JSONPersistent*));
+        if(node->children == NULL || (type == JSON_TYPE_OBJECT && node->keys == NULL)) {
+            free(node->children);
+            free(node->keys);
+            free(node);
+            return NULL;
+        }
+    }
+    return node;
+}
+
+static struct JSONPersistent *nodeText(enum JSON_TYPE type, const char *text, unsigned int length) {
+    struct JSONPersistent *node = nodeCompose(type, length);
+    if(node == NULL) return NULL;
+    node->text = malloc(length + 1);
+    if(node->text == NULL) {
+        free(node);
+        return NULL;
+    }
+    memcpy(node->text, text, length);
+    node->text[length] = '\0';
+    return node;
+}
+
+struct JSONPersistent *persistentRetain(struct JSONPersistent *node) {
+    __atomic_fetch_add(&node->references, 1, __ATOMIC_RELAXED);
+    return node;
+}
+
+void persistentRelease(struct JSONPersistent *node) {
+    if(node == NULL) return;
+    if(__atomic_fetch_sub(&node->references, 1, __ATOMIC_ACQ_REL) != 1) return;
+    if(node->children) {
+        for(unsigned int i = 0; i < node->length; i++) {
+            persistentRelease(node->children[i]);
+            if(node->keys) persistentRelease(node->keys[i]);
+        }
+    }
+    free(node->children);
+    free(node->keys);
+    free(node->text);
+    free(node);
+}
+
+static unsigned int composeNode(struct JSONPersistent **node, struct Generic *generic) {
+    int isMap = generic->object == &Map.object;
+    if(isMap || generic->object == &Array.object) {
+        struct Collection *collection = (struct Collection*)generic->object;
+        struct Iterator iterator = collection->iterator(genericData(generic));
+        unsigned int length = 0;
+        while(collection->next(&iterator)) length++;
+
+        *node = nodeCompose(isMap ? JSON_TYPE_OBJECT : JSON_TYPE_ARRAY, length);
+        if(*node == NULL) return STATUS_ALLOC_ERR;
+        iterator = collection->iterator(genericData(generic));
+        for(unsigned int i = 0; i < length; i++) {
+            if(isMap) {
+                const char *key = mapKey(&iterator);
+                (*node)->keys[i] = nodeText(JSON_TYPE_STRING, key, strlen(key));
+                if((*node)->keys[i] == NULL) return STATUS_ALLOC_ERR;
+            }
+            unsigned int result = composeNode(&(*node)->children[i], collection->next(&iterator));
+            if(result) return result;
+        }
+        return STATUS_OK;
+    }
+
+    struct JSONBuffer text;
+    bufferCompose(&text);
+    unsigned int result = STATUS_OK;
+    enum JSON_TYPE type = JSON_TYPE_NULL;
+    if(generic->object == &String) {
+        type = JSON_TYPE_STRING;
+        result = bufferAppendChar(&text, '"');
+        if(!result) result = bufferAppendString(&text, *((char**)genericData(generic)));
+        if(!result) result = bufferAppendChar(&text, '"');
+    } else if(generic->object == &Integer) {
+        type = JSON_TYPE_NUMBER;
+        char number[24];
+        snprintf(number, sizeof(number), "%ld", *((long*)genericData(generic)));
+        result = bufferAppendString(&text, number);
+    } else if(generic->object == &Float) {
+        // Shortest digits that read back to the value, not six places.
+        type = JSON_TYPE_NUMBER;
+        result = bufferAppendDouble(&text, *((float*)genericData(generic)));
+    } else if(generic->object == &Boolean) {
+        type = *((char*)genericData(generic)) ? JSON_TYPE_TRUE : JSON_TYPE_FALSE;
+        result = bufferAppendString(&text, type == JSON_TYPE_TRUE ? JSON_TRUE_STR : JSON_FALSE_STR);
+    } else if(generic->object == &Pointer && *((void**)genericData(generic)) == NULL) {
+        result = bufferAppendString(&text, JSON_NULL_STR);
+    } else {
+        result = STATUS_INPUT_ERR;
+    }
+    if(!result) {
+        *node = nodeText(type, text.data, text.length);
+        if(*node == NULL) result = STATUS_ALLOC_ERR;
+    }
+    bufferRelease(&text);
+    return result;
+}
+
+unsigned int persistentCompose(struct JSONPersistent **node, struct Generic *generic) {
+    *node = NULL;
+    unsigned int result = composeNode(node, generic);
+    if(result) {
+        persistentRelease(*node);
+        *node = NULL;
+    }
+    return result;
+}
+
+// Scalars keep their lexemes exactly as the document has them.
+static unsigned int composeValue(struct JSONPersistent **node, const struct JSONValue *value) {
+    switch(value->type) {
+        case JSON_TYPE_OBJECT:
+        case JSON_TYPE_ARRAY: {
+            int isObject = value->type == JSON_TYPE_OBJECT;
+            unsigned int length = isObject ? value->object.length : value->array.length;
+            *node = nodeCompose(value->type, length);
+            if(*node == NULL) return STATUS_ALLOC_ERR;
+            for(unsigned int i = 0; i < length; i++) {
+                const struct JSONValue *child = &value->array.values[i];
+                if(isObject) {
+                    const struct JSONString *name = &value->object.pairs[i].name;
+                    (*node)->keys[i] = nodeText(JSON_TYPE_STRING, name->value, name->length);
+                    if((*node)->keys[i] == NULL) return STATUS_ALLOC_ERR;
+                    child = &value->object.pairs[i].value;
+                }
+                unsigned int result = composeValue(&(*node)->children[i], child);
+                if(result) return result;
+            }
+            return STATUS_OK;
+        }
+        case JSON_TYPE_STRING:
+            // Views into the text are preceded and followed by their quotes.
+            *node = nodeText(value->type, value->string.value - 1, value->string.length + 2);
+            break;
+        case JSON_TYPE_NUMBER:
+            *node = nodeText(value->type, value->number.lexeme, value->number.length);
+            break;
+        case JSON_TYPE_TRUE:
+            *node = nodeText(value->type, JSON_TRUE_STR, strlen(JSON_TRUE_STR));
+            break;
+        case JSON_TYPE_FALSE:
+            *node = nodeText(value->type, JSON_FALSE_STR, strlen(JSON_FALSE_STR));
+            break;
+        default:
+            *node = nodeText(value->type, JSON_NULL_STR, strlen(JSON_NULL_STR));
+            break;
+    }
+    return *node ? STATUS_OK : STATUS_ALLOC_ERR;
+}
+
+unsigned int persistentParse(struct JSONPersistent **node, char *toCheck) {
+    struct JSONDocument document;
+    *node = NULL;
+    unsigned int result = parseDocument(&document, toCheck);
+    if(result) return result;
+    result = composeValue(node, &document.root);
+    documentRelease(&document);
+    if(result) {
+        persistentRelease(*node);
+        *node = NULL;
+    }
+    return result;
+}
+
+// Keys are stored escaped, tokens are compared with what they decode to.
+static unsigned int keyMatches(
+        struct JSONPersistent *key,
+        const char *token,
+        unsigned int tokenLength,
+        int *matches) {
+    if(!memchr(key->text, '\\', key->length)) {
+        *matches = key->length == tokenLength && memcmp(key->text, token, tokenLength) == 0;
+        return STATUS_OK;
+    }
+    struct JSONBuffer decoded;
+    bufferCompose(&decoded);
+    unsigned int result = bufferAppendUnescaped(&decoded, key->text, key->length);
+    *matches = !result && decoded.length == tokenLength
+        && (tokenLength == 0 || memcmp(decoded.data, token, tokenLength) == 0);
+    bufferRelease(&decoded);
+    return result == STATUS_ALLOC_ERR ? result : STATUS_OK;
+}
+
+// Position of the child a reference token names, length when there is
+// none yet. STATUS_INPUT_ERR for scalars and tokens that are no index.
+static unsigned int persistentChild(
+        struct JSONPersistent *node,
+        const char *token,
+        unsigned int tokenLength,
+        unsigned int *index) {
+    if(node->type == JSON_TYPE_OBJECT) {
+        // Repeated keys resolve to the last member, as in json_dom.h.
+        for(*index = node->length; *index > 0; (*index)--) {
+            int matches;
+            unsigned int result = keyMatches(node->keys[*index - 1], token, tokenLength, &matches);
+            if(result) return result;
+            if(matches) {
+                (*index)--;
+                return STATUS_OK;
+            }
+        }
+        *index = node->length;
+        return STATUS_OK;
+    }
+    if(node->type != JSON_TYPE_ARRAY) return STATUS_INPUT_ERR;
+    if(tokenLength == 1 && *token == '-') {
+        *index = node->length;
+        return STATUS_OK;
+    }
+    if(tokenLength == 0 || (*token == '0' && tokenLength > 1)) return STATUS_INPUT_ERR;
+    unsigned long value = 0;
+    for(unsigned int i = 0; i < tokenLength; i++) {
+        if(token[i] < '0' || token[i] > '9' || value > node->length) return STATUS_INPUT_ERR;
+        value = value * 10 + (token[i] - '0');
+    }
+    if(value > node->length) return STATUS_INPUT_ERR;
+    *index = value;
+    return STATUS_OK;
+}
+
+// Next reference token of pointer, unescaped into token. Returns the rest
+// of the pointer or NULL when pointer does not start with a separator.
+static const char *pointerToken(const char *pointer, char *token, unsigned int *tokenLength) {
+    if(*pointer != '/') return NULL;
+    *tokenLength = 0;
+    for(pointer++; *pointer && *pointer != '/'; pointer++) {
+        char c = *pointer;
+        if(c == '~') {
+            if(pointer[1] != '0' && pointer[1] != '1') return NULL;
+            c = *++pointer == '0' ? '~' : '/';
+        }
+        token[(*tokenLength)++] = c;
+    }
+    return pointer;
+}
+
+struct JSONPersistent *persistentGet(struct JSONPersistent *root, const char *pointer) {
+    char *token = malloc(strlen(pointer) + 1);
+    if(token == NULL) return NULL;
+    struct JSONPersistent *node = root;
+    while(node && *pointer) {
+        unsigned int tokenLength;
+        unsigned int index;
+        pointer = pointerToken(pointer, token, &tokenLength);
+        if(pointer == NULL || persistentChild(node, token, tokenLength, &index)
+                || index >= node->length) {
+            node = NULL;
+        } else {
+            node = node->children[index];
+        }
+    }
+    free(token);
+    return node;
+}
+
+// Copy of a container with room for length children, every child that
+// is kept shared with the original.
+static struct JSONPersistent *containerCopy(
+        struct JSONPersistent *node,
+        unsigned int length,
+        unsigned int skip) {
+    struct JSONPersistent *copy = nodeCompose(node->type, length);
+    if(copy == NULL) return NULL;
+    unsigned int target = 0;
+    for(unsigned int i = 0; i < node->length && target < length; i++) {
+        if(i == skip) continue;
+        copy->children[target] = persistentRetain(node->children[i]);
+        if(copy->keys) copy->keys[target] = persistentRetain(node->keys[i]);
+        target++;
+    }
+    return copy;
+}
+
+static unsigned int keyCompose(struct JSONPersistent **key, const char *token, unsigned int tokenLength) {
+    if(validateUTF8(token, tokenLength)) return STATUS_INPUT_ERR;
+    struct JSONBuffer escaped;
+    bufferCompose(&escaped);
+    unsigned int result = bufferAppendEscaped(&escaped, token, tokenLength);
+    if(!result) result = bufferTerminate(&escaped);
+    if(!result) {
+        *key = nodeText(JSON_TYPE_STRING, escaped.data, escaped.length);
+        if(*key == NULL) result = STATUS_ALLOC_ERR;
+    }
+    bufferRelease(&escaped);
+    return result;
+}
+
+// Rebuild the path to pointer, value NULL removing what is there.
+static unsigned int persistentEdit(
+        struct JSONPersistent **updated,
+        struct JSONPersistent *node,
+        const char *pointer,
+        char *token,
+        struct JSONPersistent *value) {
+    if(*pointer == '\0') {
+        if(value == NULL) return STATUS_INPUT_ERR;
+        *updated = persistentRetain(value);
+        return STATUS_OK;
+    }
+    unsigned int tokenLength;
+    unsigned int index;
+    pointer = pointerToken(pointer, token, &tokenLength);
+    if(pointer == NULL) return STATUS_INPUT_ERR;
+    unsigned int result = persistentChild(node, token, tokenLength, &index);
+    if(result) return result;
+    int exists = index < node->length;
+
+    if(*pointer || value) {
+        if(*pointer && !exists) return STATUS_INPUT_ERR;
+        struct JSONPersistent *child;
+        result = persistentEdit(&child, exists ? node->children[index] : NULL, pointer, token, value);
+        if(result) return result;
+        // Only the last token can name a new member, so the recursion did
+        // not reuse token. Its key is stored escaped like parsed keys.
+        struct JSONPersistent *key = NULL;
+        if(!exists && node->type == JSON_TYPE_OBJECT) {
+            result = keyCompose(&key, token, tokenLength);
+            if(result) {
+                persistentRelease(child);
+                return result;
+            }
+        }
+        *updated = containerCopy(node, node->length + !exists, node->length);
+        if(*updated == NULL) {
+            persistentRelease(key);
+            persistentRelease(child);
+            return STATUS_ALLOC_ERR;
+        }
+        if(exists) persistentRelease((*updated)->children[index]);
+        (*updated)->children[index] = child;
+        if(key) (*updated)->keys[index] = key;
+        return STATUS_OK;
+    }
+
+    if(!exists) return STATUS_INPUT_ERR;
+    *updated = containerCopy(node, node->length - 1, index);
+    return *updated ? STATUS_OK : STATUS_ALLOC_ERR;
+}
+
+unsigned int persistentSet(
+        struct JSONPersistent **updated,
+        struct JSONPersistent *root,
+        const char *pointer,
+        struct JSONPersistent *value) {
+    char *token = malloc(strlen(pointer) + 1);
+    if(token == NULL) return STATUS_ALLOC_ERR;
+    unsigned int result = persistentEdit(updated, root, pointer, token, value);
+    free(token);
+    return result;
+}
+
+unsigned int persistentRemove(
+        struct JSONPersistent **updated,
+        struct JSONPersistent *root,
+        const char *pointer) {
+    return persistentSet(updated, root, pointer, NULL);
+}
+
+static unsigned int emitNode(struct JSONBuffer *buffer, struct JSONPersistent *node, struct JSONFormat fmt) {
+    if(node->type != JSON_TYPE_OBJECT && node->type != JSON_TYPE_ARRAY) {
+        return bufferAppend(buffer, node->text, node->length);
+    }
+    int isArray = node->type == JSON_TYPE_ARRAY;
+    unsigned int result = bufferAppendChar(buffer, isArray ? JSON_ARR_BEGIN : JSON_MAP_BEGIN);
+    if(result) return result;
+
+    fmt.level++;
+    for(unsigned int i = 0; i < node->length; i++) {
+        result = unparseIndent(buffer, fmt);
+        if(!result && !isArray) {
+            result = bufferAppendChar(buffer, '"');
+            if(!result) result = bufferAppend(buffer, node->keys[i]->text, node->keys[i]->length);
+            if(!result) result = bufferAppend(buffer, "\": ", 3);
+        }
+        if(!result) result = emitNode(buffer, node->children[i], fmt);
+        if(!result) result = unparseSeparator(buffer, i + 1 == node->length, fmt);
+        if(result) return result;
+    }
+    fmt.level--;
+
+    result = unparseWhitespace(buffer, fmt);
+    if(result) return result;
+    return bufferAppendChar(buffer, isArray ? JSON_ARR_CLOSE : JSON_MAP_CLOSE);
+}
+
+unsigned int unparsePersistent(
+        struct JSONPersistent *node,
+        char **output,
+        unsigned int *outputLength,
+        struct JSONFormat fmt) {
+    if(fmt.canonical) return STATUS_INPUT_ERR;
+    struct JSONBuffer buffer;
+    bufferCompose(&buffer);
+    unsigned int result = emitNode(&buffer, node, fmt);
+    if(result) {
+        bufferRelease(&buffer);
+        return result;
+    }
+    *output = bufferDetach(&buffer, outputLength);
+    return *output ? STATUS_OK : STATUS_ALLOC_ERR;
+}
@@ -0,0 +1,70 @@
+#ifndef __JSON_PERSISTENT_H
+#define __JSON_PERSISTENT_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include "json_parser.h"
+#include "json_unparser.h"
+#include "cutil/src/generic/generic.h"
+
+// Immutable node of a persistent document. Versions share every subtree
+// an edit did not touch, each node counting the versions and parents
+// that hold it. Nodes are never written once built, so versions may be
+// read and released from any thread.
+struct JSONPersistent {
+    // Only touched through atomic builtins, <stdatomic.h> is not usable
+    // from C++ before C++23.
+    unsigned int references;
+    enum JSON_TYPE type;
+    // Number of children, or the length of text.
+    unsigned int length;
+    struct JSONPersistent **children;
+    // Objects only, string nodes holding each child's key.
+    struct JSONPersistent **keys;
+    // Scalars as JSON text, strings with their quotation marks. Keys
+    // are stored as written, without them.
+    char *text;
+};
+
+// Both start with one reference held by the caller. Parsed documents keep
+// their member order and the lexemes of strings and numbers as written,
+// trees have floats written with the shortest digits that read back.
+unsigned int persistentCompose(struct JSONPersistent **node, struct Generic *generic);
+unsigned int persistentParse(struct JSONPersistent **node, char *toCheck);
+
+struct JSONPersistent *persistentRetain(struct JSONPersistent *node);
+// Subtrees no longer held by any version are freed with it.
+void persistentRelease(struct JSONPersistent *node);
+
+// Resolve an RFC 6901 JSON Pointer, NULL when nothing is there. Tokens
+// are compared with the decoded text of keys.
+struct JSONPersistent *persistentGet(struct JSONPersistent *root, const char *pointer);
+
+// New version with value at pointer, root is left as it was. Only the
+// containers on the path are copied, taking one pointer per child, all
+// else is shared. A missing member is added, an array index equal to the
+// length or "-" appends, a new key must be UTF-8 and is stored escaped.
+// The new version holds its own reference to value.
+unsigned int persistentSet(
+    struct JSONPersistent **updated,
+    struct JSONPersistent *root,
+    const char *pointer,
+    struct JSONPersistent *value);
+// New version without the member or element at pointer.
+unsigned int persistentRemove(
+    struct JSONPersistent **updated,
+    struct JSONPersistent *root,
+    const char *pointer);
+
+// Same layout as unparseJSON, canonical output is not supported.
+unsigned int unparsePersistent(
+    struct JSONPersistent *node,
+    char **output,
+    unsigned int *outputLength,
+    struct JSONFormat fmt);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_persistent.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+static void assertPersistentText(struct JSONPersistent *node, const char *expected) {
+    char *output;
+    unsigned int outputLength;
+    struct JSONFormat fmt = {0, 0, 0};
+    assertIntegersEqual(unparsePersistent(node, &output, &outputLength, fmt), STATUS_OK);
+    assertStringsEqual(output, expected);
+    free(output);
+}
+
+void testJSONPersistentCompose() {
+    char input[] = "[{\"a\": 1.5}, \"te\\\"xt\", true, null, [], 7, 1e-7, 0.10, 12345678901234567890]";
+    struct JSONPersistent *root;
+    assertIntegersEqual(persistentParse(&root, input), STATUS_OK);
+    assertIntegersEqual(root->type, JSON_TYPE_ARRAY);
+    assertIntegersEqual(root->length, 9);
+    // Numbers and strings are kept exactly as written.
+    assertPersistentText(root,
+        "[{\"a\": 1.5},\"te\\\"xt\",true,null,[],7,1e-7,0.10,12345678901234567890]");
+
+    assertIntegersEqual(persistentGet(root, "/0/a")->type, JSON_TYPE_NUMBER);
+    assertStringsEqual(persistentGet(root, "/1")->text, "\"te\\\"xt\"");
+    assertPointersEqual(persistentGet(root, ""), root);
+    assertIsNull(persistentGet(root, "/9"));
+    assertIsNull(persistentGet(root, "/0/b"));
+    assertIsNull(persistentGet(root, "/1/x"));
+    assertIsNull(persistentGet(root, "0"));
+
+    char *output;
+    unsigned int outputLength;
+    struct JSONFormat fmt = {2, 0, 0};
+    assertIntegersEqual(unparsePersistent(persistentGet(root, "/0"), &output, &outputLength, fmt), STATUS_OK);
+    assertStringsEqual(output, "{\r\n  \"a\": 1.5\r\n}");
+    free(output);
+    persistentRelease(root);
+}
+
+void testJSONPersistentSharing() {
+    char input[] = "[{\"name\": \"old\", \"list\": [1, 2]}, {\"x\": 1}]";
+    struct JSONPersistent *first;
+    assertIntegersEqual(persistentParse(&first, input), STATUS_OK);
+    char valueText[] = "\"new\"";
+    struct JSONPersistent *value;
+    assertIntegersEqual(persistentParse(&value, valueText), STATUS_OK);
+
+    struct JSONPersistent *second;
+    assertIntegersEqual(persistentSet(&second, first, "/0/name", value), STATUS_OK);
+    persistentRelease(value);
+
+    // The edited path is new, everything beside it is shared.
+    assertStringsEqual(persistentGet(first, "/0/name")->text, "\"old\"");
+    assertStringsEqual(persistentGet(second, "/0/name")->text, "\"new\"");
+    assertIntegersEqual(persistentGet(first, "/0") != persistentGet(second, "/0"), 1);
+    assertPointersEqual(persistentGet(first, "/0/list"), persistentGet(second, "/0/list"));
+    assertPointersEqual(persistentGet(first, "/1"), persistentGet(second, "/1"));
+    assertIntegersEqual(persistentGet(first, "/1")->references, 2);
+
+    // Releasing the old version keeps what the new one shares.
+    persistentRelease(first);
+    assertIntegersEqual(persistentGet(second, "/1")->references, 1);
+    assertPersistentText(second, "[{\"name\": \"new\",\"list\": [1,2]},{\"x\": 1}]");
+    persistentRelease(second);
+}
+
+void testJSONPersistentAddRemove() {
+    char input[] = "{\"items\": [1, 2]}";
+    struct JSONPersistent *root;
+    assertIntegersEqual(persistentParse(&root, input), STATUS_OK);
+    char numberText[] = "3";
+    struct JSONPersistent *number;
+    assertIntegersEqual(persistentParse(&number, numberText), STATUS_OK);
+
+    struct JSONPersistent *appended;
+    assertIntegersEqual(persistentSet(&appended, root, "/items/-", number), STATUS_OK);
+    assertPersistentText(appended, "{\"items\": [1,2,3]}");
+    struct JSONPersistent *added;
+    assertIntegersEqual(persistentSet(&added, appended, "/a~1b", number), STATUS_OK);
+    assertPersistentText(added, "{\"items\": [1,2,3],\"a/b\": 3}");
+    struct JSONPersistent *removed;
+    assertIntegersEqual(persistentRemove(&removed, added, "/items/0"), STATUS_OK);
+    assertPersistentText(removed, "{\"items\": [2,3],\"a/b\": 3}");
+    assertPersistentText(root, "{\"items\": [1,2]}");
+
+    struct JSONPersistent *failed = NULL;
+    assertIntegersEqual(persistentSet(&failed, root, "/missing/x", number), STATUS_INPUT_ERR);
+    assertIntegersEqual(persistentSet(&failed, root, "/items/5", number), STATUS_INPUT_ERR);
+    assertIntegersEqual(persistentSet(&failed, root, "/items/01", number), STATUS_INPUT_ERR);
+    assertIntegersEqual(persistentRemove(&failed, root, "/items/2"), STATUS_INPUT_ERR);
+    assertIntegersEqual(persistentRemove(&failed, root, ""), STATUS_INPUT_ERR);
+    assertIsNull(failed);
+
+    struct JSONPersistent *replaced;
+    assertIntegersEqual(persistentSet(&replaced, root, "", number), STATUS_OK);
+    assertPointersEqual(replaced, number);
+
+    persistentRelease(replaced);
+    persistentRelease(removed);
+    persistentRelease(added);
+    persistentRelease(appended);
+    persistentRelease(number);
+    persistentRelease(root);
+}
+
+void testJSONPersistentFromGeneric() {
+    char input[] = "{\"a\": [0.1, 1e-7, -3, \"x\", false, null]}";
+    struct Generic *generic;
+    assertIntegersEqual(parseJSON(&generic, input), STATUS_OK);
+    struct JSONPersistent *root;
+    assertIntegersEqual(persistentCompose(&root, generic), STATUS_OK);
+    genericRelease(generic);
+    // Floats are written with the digits that read back to them.
+    assertPersistentText(root,
+        "{\"a\": [0.10000000149011612,1.0000000116860974e-07,-3,\"x\",false,null]}");
+    persistentRelease(root);
+
+    char repeated[] = "{\"k\": 1, \"k\": 2}";
+    assertIntegersEqual(persistentParse(&root, repeated), STATUS_OK);
+    assertStringsEqual(persistentGet(root, "/k")->text, "2");
+    persistentRelease(root);
+}
+
+void testJSONPersistentKeys() {
+    // Keys are matched on their decoded text and stored escaped.
+    char input[] = "{\"a\\u0062\": 1}";
+    struct JSONPersistent *root;
+    assertIntegersEqual(persistentParse(&root, input), STATUS_OK);
+    assertStringsEqual(persistentGet(root, "/ab")->text, "1");
+    char valueText[] = "2";
+    struct JSONPersistent *value;
+    assertIntegersEqual(persistentParse(&value, valueText), STATUS_OK);
+
+    struct JSONPersistent *replaced;
+    assertIntegersEqual(persistentSet(&replaced, root, "/ab", value), STATUS_OK);
+    assertPersistentText(replaced, "{\"a\\u0062\": 2}");
+    struct JSONPersistent *added;
+    assertIntegersEqual(persistentSet(&added, root, "/a\"b\n", value), STATUS_OK);
+    assertPersistentText(added, "{\"a\\u0062\": 1,\"a\\\"b\\n\": 2}");
+    assertStringsEqual(persistentGet(added, "/a\"b\n")->text, "2");
+    struct JSONPersistent *invalid = NULL;
+    assertIntegersEqual(persistentSet(&invalid, root, "/\xff", value), STATUS_INPUT_ERR);
+    assertIsNull(invalid);
+
+    persistentRelease(added);
+    persistentRelease(replaced);
+    persistentRelease(value);
+    persistentRelease(root);
+}
+
+void testJSONPersistent() {
+    testJSONPersistentCompose();
+    testJSONPersistentSharing();
+    testJSONPersistentAddRemove();
+    testJSONPersistentFromGeneric();
+    testJSONPersistentKeys();
+}
@@ -0,0 +1,560 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "json.h"
+#include "json_schema.h"
+#include "json_number.h"
+#include "json_dom.h"
+#include "cutil/src/error.h"
+
+static const char *schemaUnsupported[] = {
+    "$ref", "allOf", "anyOf", "oneOf", "not", "if", "pattern",
+    "patternProperties", "propertyNames", "dependencies", "dependentRequired",
+    "dependentSchemas", "uniqueItems", "contains", "prefixItems",
+    "additionalItems", "multipleOf", "unevaluatedItems", "unevaluatedProperties"
+};
+
+static const struct JSONSchemaNode schemaAny = {
+    JSON_SCHEMA_ANY, -INFINITY, INFINITY, -INFINITY, INFINITY,
+    0, UINT_MAX, 0, UINT_MAX, 0, UINT_MAX
+};
+
+static void *schemaGrow(void *items, unsigned int *capacity, unsigned int count, size_t size) {
+    if(count < *capacity) return items;
+    unsigned int grown = *capacity ? *capacity * 2 : 8;
+    void *result = realloc(items, grown * size);
+    if(result) *capacity = grown;
+    return result;
+}
+
+static unsigned int schemaAddNode(struct JSONSchema *schema, unsigned int *index) {
+    struct JSONSchemaNode *nodes = schemaGrow(
+        schema->nodes, &schema->nodeCapacity, schema->nodeCount, sizeof(*nodes));
+    if(nodes == NULL) return STATUS_ALLOC_ERR;
+    schema->nodes = nodes;
+    nodes[schema->nodeCount] = schemaAny;
+    *index = ++schema->nodeCount;
+    return STATUS_OK;
+}
+
+static unsigned int schemaAddProperty(
+        struct JSONSchema *schema,
+        const struct JSONString *name,
+        unsigned char required) {
+    struct JSONSchemaProperty *properties = schemaGrow(
+        schema->properties, &schema->propertyCapacity, schema->propertyCount, sizeof(*properties));
+    if(properties == NULL) return STATUS_ALLOC_ERR;
+    schema->properties = properties;
+    struct JSONSchemaProperty *property = &properties[schema->propertyCount];
+    property->nameLength = name->length;
+    property->name = malloc(name->length + 1);
+    if(property->name == NULL) return STATUS_ALLOC_ERR;
+    memcpy(property->name, name->value, name->length);
+    property->name[name->length] = '\0';
+    property->node = 0;
+    property->required = required;
+    schema->propertyCount++;
+    return STATUS_OK;
+}
+
+static int schemaStringIs(const struct JSONString *string, const char *literal) {
+    return strncmp(string->value, literal, string->length) == 0 && literal[string->length] == '\0';
+}
+
+static unsigned int schemaAddConstant(struct JSONSchema *schema, const struct JSONValue *value) {
+    struct JSONSchemaConstant *constants = schemaGrow(
+        schema->constants, &schema->constantCapacity, schema->constantCount, sizeof(*constants));
+    if(constants == NULL) return STATUS_ALLOC_ERR;
+    schema->constants = constants;
+    struct JSONSchemaConstant *constant = &constants[schema->constantCount];
+    constant->type = value->type;
+    constant->number = 0;
+    constant->string = NULL;
+    constant->stringLength = 0;
+    if(value->type == JSON_TYPE_STRING) {
+        constant->stringLength = value->string.length;
+        constant->string = malloc(value->string.length + 1);
+        if(constant->string == NULL) return STATUS_ALLOC_ERR;
+        memcpy(constant->string, value->string.value, value->string.length);
+        constant->string[value->string.length] = '\0';
+    } else if(value->type == JSON_TYPE_NUMBER) {
+        // Read from the lexeme so it compares equal to the same number in
+        // a document.
+        constant->number = numberDouble(&value->number);
+    } else if(value->type == JSON_TYPE_OBJECT || value->type == JSON_TYPE_ARRAY) {
+        return STATUS_INPUT_ERR;
+    }
+    schema->constantCount++;
+    return STATUS_OK;
+}
+
+static unsigned int schemaTypeBits(const struct JSONValue *type, unsigned int *types) {
+    if(type->type != JSON_TYPE_STRING) return STATUS_INPUT_ERR;
+    const struct JSONString *name = &type->string;
+    if(schemaStringIs(name, "object")) *types |= 1u << JSON_TYPE_OBJECT;
+    else if(schemaStringIs(name, "array")) *types |= 1u << JSON_TYPE_ARRAY;
+    else if(schemaStringIs(name, "string")) *types |= 1u << JSON_TYPE_STRING;
+    else if(schemaStringIs(name, "number")) *types |= 1u << JSON_TYPE_NUMBER;
+    else if(schemaStringIs(name, "integer")) *types |= JSON_SCHEMA_INTEGER;
+    else if(schemaStringIs(name, "boolean")) *types |= 1u << JSON_TYPE_TRUE | 1u << JSON_TYPE_FALSE;
+    else if(schemaStringIs(name, "null")) *types |= 1u << JSON_TYPE_NULL;
+    else return STATUS_INPUT_ERR;
+    return STATUS_OK;
+}
+
+static unsigned int schemaCount(const struct JSONValue *value, unsigned int *count) {
+    if(value->type != JSON_TYPE_NUMBER) return STATUS_INPUT_ERR;
+    int64_t number;
+    if(numberInteger(&value->number, &number) || number < 0) return STATUS_INPUT_ERR;
+    *count = number > UINT_MAX ? UINT_MAX : number;
+    return STATUS_OK;
+}
+
+static unsigned int compileNode(
+    struct JSONSchema *schema,
+    const struct JSONValue *source,
+    unsigned int *index);
+
+// Names of properties and of required members not among them are added
+// before any subschema so the node's range stays contiguous.
+static unsigned int compileProperties(
+        struct JSONSchema *schema,
+        unsigned int index,
+        const struct JSONValue *properties,
+        const struct JSONValue *required) {
+    if(properties && properties->type != JSON_TYPE_OBJECT) return STATUS_INPUT_ERR;
+    if(required && required->type != JSON_TYPE_ARRAY) return STATUS_INPUT_ERR;
+    unsigned int first = schema->propertyCount;
+    unsigned int result = STATUS_OK;
+
+    unsigned int propertyCount = properties ? properties->object.length : 0;
+    for(unsigned int i = 0; result == STATUS_OK && i < propertyCount; i++) {
+        result = schemaAddProperty(schema, &properties->object.pairs[i].name, 0);
+    }
+    unsigned int requiredCount = required ? required->array.length : 0;
+    for(unsigned int r = 0; result == STATUS_OK && r < requiredCount; r++) {
+        const struct JSONValue *name = &required->array.values[r];
+        if(name->type != JSON_TYPE_STRING) return STATUS_INPUT_ERR;
+        unsigned int i = first;
+        while(i < schema->propertyCount && (schema->properties[i].nameLength != name->string.length
+                || memcmp(schema->properties[i].name, name->string.value, name->string.length))) {
+            i++;
+        }
+        if(i < schema->propertyCount) schema->properties[i].required = 1;
+        else result = schemaAddProperty(schema, &name->string, 1);
+    }
+    if(result) return result;
+    schema->nodes[index - 1].firstProperty = first;
+    schema->nodes[index - 1].propertyCount = schema->propertyCount - first;
+
+    for(unsigned int i = 0; result == STATUS_OK && i < propertyCount; i++) {
+        unsigned int node;
+        result = compileNode(schema, &properties->object.pairs[i].value, &node);
+        if(result == STATUS_OK) schema->properties[first + i].node = node;
+    }
+    return result;
+}
+
+static unsigned int compileKeyword(
+        struct JSONSchema *schema,
+        unsigned int index,
+        const struct JSONString *key,
+        const struct JSONValue *value) {
+    struct JSONSchemaNode *node = &schema->nodes[index - 1];
+    for(unsigned int i = 0; i < sizeof(schemaUnsupported) / sizeof(schemaUnsupported[0]); i++) {
+        if(schemaStringIs(key, schemaUnsupported[i])) return STATUS_INPUT_ERR;
+    }
+    double *bound = NULL;
+    unsigned int *count = NULL;
+    if(schemaStringIs(key, "minimum")) bound = &node->minimum;
+    else if(schemaStringIs(key, "maximum")) bound = &node->maximum;
+    else if(schemaStringIs(key, "exclusiveMinimum")) bound = &node->exclusiveMinimum;
+    else if(schemaStringIs(key, "exclusiveMaximum")) bound = &node->exclusiveMaximum;
+    else if(schemaStringIs(key, "minLength")) count = &node->minLength;
+    else if(schemaStringIs(key, "maxLength")) count = &node->maxLength;
+    else if(schemaStringIs(key, "minItems")) count = &node->minItems;
+    else if(schemaStringIs(key, "maxItems")) count = &node->maxItems;
+    else if(schemaStringIs(key, "minProperties")) count = &node->minProperties;
+    else if(schemaStringIs(key, "maxProperties")) count = &node->maxProperties;
+    if(bound) {
+        if(value->type != JSON_TYPE_NUMBER) return STATUS_INPUT_ERR;
+        // From the lexeme, the same conversion documents get.
+        *bound = numberDouble(&value->number);
+        return STATUS_OK;
+    }
+    if(count) return schemaCount(value, count);
+
+    if(schemaStringIs(key, "type")) {
+        unsigned int types = 0;
+        unsigned int result = STATUS_OK;
+        if(value->type == JSON_TYPE_ARRAY) {
+            for(unsigned int i = 0; result == STATUS_OK && i < value->array.length; i++) {
+                result = schemaTypeBits(&value->array.values[i], &types);
+            }
+        } else {
+            result = schemaTypeBits(value, &types);
+        }
+        node->types &= types;
+        return result;
+    }
+    if(schemaStringIs(key, "const") || schemaStringIs(key, "enum")) {
+        // Both narrow the same range, only one of them may be given.
+        if(node->constantCount) return STATUS_INPUT_ERR;
+        node->firstConstant = schema->constantCount;
+        unsigned int result = STATUS_OK;
+        if(*key->value == 'c') {
+            result = schemaAddConstant(schema, value);
+        } else {
+            if(value->type != JSON_TYPE_ARRAY) return STATUS_INPUT_ERR;
+            for(unsigned int i = 0; result == STATUS_OK && i < value->array.length; i++) {
+                result = schemaAddConstant(schema, &value->array.values[i]);
+            }
+        }
+        node = &schema->nodes[index - 1];
+        node->constantCount = schema->constantCount - node->firstConstant;
+        // An empty enum admits nothing.
+        if(node->constantCount == 0) node->types = 0;
+        return result;
+    }
+    if(schemaStringIs(key, "items")) {
+        // Tuple validation is not supported.
+        if(value->type == JSON_TYPE_ARRAY) return STATUS_INPUT_ERR;
+        unsigned int items;
+        unsigned int result = compileNode(schema, value, &items);
+        if(result == STATUS_OK) schema->nodes[index - 1].items = items;
+        return result;
+    }
+    if(schemaStringIs(key, "additionalProperties")) {
+        if(value->type == JSON_TYPE_FALSE) {
+            node->closed = 1;
+            return STATUS_OK;
+        }
+        unsigned int additional;
+        unsigned int result = compileNode(schema, value, &additional);
+        if(result == STATUS_OK) schema->nodes[index - 1].additional = additional;
+        return result;
+    }
+    return STATUS_OK;
+}
+
+static unsigned int compileNode(
+        struct JSONSchema *schema,
+        const struct JSONValue *source,
+        unsigned int *index) {
+    unsigned int result = schemaAddNode(schema, index);
+    if(result) return result;
+    if(source->type == JSON_TYPE_TRUE) return STATUS_OK;
+    if(source->type == JSON_TYPE_FALSE) {
+        schema->nodes[*index - 1].types = 0;
+        return STATUS_OK;
+    }
+    if(source->type != JSON_TYPE_OBJECT) return STATUS_INPUT_ERR;
+
+    for(unsigned int i = 0; result == STATUS_OK && i < source->object.length; i++) {
+        const struct JSONPair *pair = &source->object.pairs[i];
+        if(!schemaStringIs(&pair->name, "properties") && !schemaStringIs(&pair->name, "required")) {
+            result = compileKeyword(schema, *index, &pair->name, &pair->value);
+        }
+    }
+    const struct JSONValue *properties = domMember(source, "properties");
+    const struct JSONValue *required = domMember(source, "required");
+    if(result == STATUS_OK && (properties || required)) {
+        result = compileProperties(schema, *index, properties, required);
+    }
+    return result;
+}
+
+unsigned int schemaCompose(struct JSONSchema *schema, const struct JSONValue *source) {
+    schema->nodes = NULL;
+    schema->nodeCount = 0;
+    schema->nodeCapacity = 0;
+    schema->properties = NULL;
+    schema->propertyCount = 0;
+    schema->propertyCapacity = 0;
+    schema->constants = NULL;
+    schema->constantCount = 0;
+    schema->constantCapacity = 0;
+
+    unsigned int root;
+    unsigned int result = compileNode(schema, source, &root);
+    if(result) schemaRelease(schema);
+    return result;
+}
+
+void schemaRelease(struct JSONSchema *schema) {
+    for(unsigned int i = 0; i < schema->propertyCount; i++) free(schema->properties[i].name);
+    for(unsigned int i = 0; i < schema->constantCount; i++) free(schema->constants[i].string);
+    free(schema->nodes);
+    free(schema->properties);
+    free(schema->constants);
+    schema->nodes = NULL;
+    schema->nodeCount = 0;
+    schema->nodeCapacity = 0;
+    schema->properties = NULL;
+    schema->propertyCount = 0;
+    schema->propertyCapacity = 0;
+    schema->constants = NULL;
+    schema->constantCount = 0;
+    schema->constantCapacity = 0;
+}
+
+// State of one validation. Without $ref a node is never nested in
+// itself, so each object node can track its members in its own range.
+struct SchemaRun {
+    const struct JSONSchema *schema;
+    struct JSONReader *reader;
+    unsigned char *seen;
+    struct JSONToken *failed;
+};
+
+static const struct JSONSchemaNode *schemaNode(const struct JSONSchema *schema, unsigned int index) {
+    return index ? &schema->nodes[index - 1] : &schemaAny;
+}
+
+static unsigned int schemaFail(struct SchemaRun *run, const struct JSONToken *token) {
+    if(run->failed) *run->failed = *token;
+    return STATUS_INPUT_ERR;
+}
+
+static int isSymbol(const struct JSONToken *token, char symbol) {
+    return token->lexeme && token->token == JSON_TOKEN_SYMBOL && *token->lexeme == symbol;
+}
+
+// Code points of an escaped string, a surrogate pair escape is one.
+static unsigned int schemaCodePoints(const char *string, unsigned int length) {
+    unsigned int count = 0;
+    int high = 0;
+    for(unsigned int i = 0; i < length; i++) {
+        unsigned char c = string[i];
+        if((c & 0xC0) == 0x80) continue;
+        if(c != '\\' || i + 1 >= length) {
+            count++;
+            high = 0;
+            continue;
+        }
+        i++;
+        if(string[i] != 'u' || i + 4 >= length) {
+            count++;
+            high = 0;
+            continue;
+        }
+        char first = string[i + 1] | 0x20;
+        char second = string[i + 2] | 0x20;
+        int isHigh = first == 'd' && second >= '8' && second <= 'b';
+        int isLow = first == 'd' && second >= 'c' && second <= 'f';
+        if(!(isLow && high)) count++;
+        high = isHigh;
+        i += 4;
+    }
+    return count;
+}
+
+static int schemaConstantMatches(
+        const struct JSONSchemaConstant *constant,
+        enum JSON_TYPE type,
+        const struct JSONToken *token,
+        unsigned int length,
+        double number) {
+    if(constant->type != type) return 0;
+    if(type == JSON_TYPE_NUMBER) return constant->number == number;
+    if(type == JSON_TYPE_STRING) {
+        return constant->stringLength == length - 2
+            && memcmp(constant->string, token->lexeme + 1, length - 2) == 0;
+    }
+    return 1;
+}
+
+static unsigned int validateValue(
+    struct SchemaRun *run,
+    const struct JSONToken *token,
+    unsigned int length,
+    unsigned int index);
+
+static unsigned int validateObject(
+        struct SchemaRun *run,
+        const struct JSONSchemaNode *node,
+        const struct JSONToken *open) {
+    struct JSONToken token;
+    unsigned int length;
+    unsigned int count = 0;
+    if(node->propertyCount) memset(run->seen + node->firstProperty, 0, node->propertyCount);
+
+    unsigned int result = readerNext(run->reader, &token, &length);
+    if(result) return result;
+    if(!isSymbol(&token, JSON_MAP_CLOSE)) for(;;) {
+        if(token.token != JSON_TOKEN_STRING || !token.lexeme) return STATUS_PARSE_ERR;
+        struct JSONToken key = token;
+        unsigned int keyLength = length;
+        result = readerNext(run->reader, &token, &length);
+        if(result) return result;
+        if(!isSymbol(&token, JSON_MEMBER_SEP)) return STATUS_PARSE_ERR;
+        result = readerNext(run->reader, &token, &length);
+        if(result) return result;
+
+        unsigned int child = node->additional;
+        unsigned int i = node->firstProperty;
+        unsigned int end = node->firstProperty + node->propertyCount;
+        const struct JSONSchemaProperty *properties = run->schema->properties;
+        for(; i < end; i++) {
+            if(properties[i].nameLength == keyLength - 2
+                    && memcmp(properties[i].name, key.lexeme + 1, keyLength - 2) == 0) break;
+        }
+        if(i < end) {
+            run->seen[i] = 1;
+            child = properties[i].node;
+        } else if(node->closed) {
+            return schemaFail(run, &key);
+        }
+        result = validateValue(run, &token, length, child);
+        if(result) return result;
+        if(++count > node->maxProperties) return schemaFail(run, &key);
+
+        result = readerNext(run->reader, &token, &length);
+        if(result) return result;
+        if(isSymbol(&token, JSON_MAP_CLOSE)) break;
+        if(!isSymbol(&token, JSON_SEPERATOR)) return STATUS_PARSE_ERR;
+        result = readerNext(run->reader, &token, &length);
+        if(result) return result;
+    }
+
+    // Missing members are reported at the closing brace.
+    for(unsigned int i = node->firstProperty; i < node->firstProperty + node->propertyCount; i++) {
+        if(run->schema->properties[i].required && !run->seen[i]) return schemaFail(run, &token);
+    }
+    if(count < node->minProperties) return schemaFail(run, open);
+    return STATUS_OK;
+}
+
+static unsigned int validateArray(
+        struct SchemaRun *run,
+        const struct JSONSchemaNode *node,
+        const struct JSONToken *open) {
+    struct JSONToken token;
+    unsigned int length;
+    unsigned int count = 0;
+
+    unsigned int result = readerNext(run->reader, &token, &length);
+    if(result) return result;
+    if(!isSymbol(&token, JSON_ARR_CLOSE)) {
+        for(;;) {
+            if(++count > node->maxItems) return schemaFail(run, &token);
+            result = validateValue(run, &token, length, node->items);
+            if(result) return result;
+            result = readerNext(run->reader, &token, &length);
+            if(result) return result;
+            if(isSymbol(&token, JSON_ARR_CLOSE)) break;
+            if(!isSymbol(&token, JSON_SEPERATOR)) return STATUS_PARSE_ERR;
+            result = readerNext(run->reader, &token, &length);
+            if(result) return result;
+        }
+    }
+    if(count < node->minItems) return schemaFail(run, open);
+    return STATUS_OK;
+}
+
+static unsigned int validateValue(
+        struct SchemaRun *run,
+        const struct JSONToken *token,
+        unsigned int length,
+        unsigned int index) {
+    const struct JSONSchemaNode *node = schemaNode(run->schema, index);
+    if(token->lexeme == NULL) return STATUS_PARSE_ERR;
+
+    enum JSON_TYPE type;
+    struct JSONNumber number;
+    switch(token->token) {
+        case JSON_TOKEN_STRING: type = JSON_TYPE_STRING; break;
+        case JSON_TOKEN_NUMBER:
+            if(numberCompose(&number, token->lexeme) || number.length != length) {
+                return STATUS_PARSE_ERR;
+            }
+            type = JSON_TYPE_NUMBER;
+            break;
+        case JSON_TOKEN_BOOL: type = *token->lexeme == 't' ? JSON_TYPE_TRUE : JSON_TYPE_FALSE; break;
+        case JSON_TOKEN_NULL: type = JSON_TYPE_NULL; break;
+        case JSON_TOKEN_SYMBOL:
+            if(*token->lexeme == JSON_MAP_BEGIN) type = JSON_TYPE_OBJECT;
+            else if(*token->lexeme == JSON_ARR_BEGIN) type = JSON_TYPE_ARRAY;
+            else return STATUS_PARSE_ERR;
+            break;
+        default: return STATUS_PARSE_ERR;
+    }
+
+    double value = type == JSON_TYPE_NUMBER ? numberDouble(&number) : 0;
+    if(!(node->types & 1u << type)) {
+        int integral = type == JSON_TYPE_NUMBER
+            && ((!number.fraction && !number.exponent)
+                || (value > -9e18 && value < 9e18 && value == (double)(long long)value));
+        if(!(node->types & JSON_SCHEMA_INTEGER) || !integral) return schemaFail(run, token);
+    }
+    if(node->constantCount) {
+        const struct JSONSchemaConstant *constants = run->schema->constants + node->firstConstant;
+        unsigned int i = 0;
+        while(i < node->constantCount
+            && !schemaConstantMatches(&constants[i], type, token, length, value)) i++;
+        if(i == node->constantCount) return schemaFail(run, token);
+    }
+
+    switch(type) {
+        case JSON_TYPE_OBJECT: return validateObject(run, node, token);
+        case JSON_TYPE_ARRAY: return validateArray(run, node, token);
+        case JSON_TYPE_STRING: {
+            unsigned int codePoints = schemaCodePoints(token->lexeme + 1, length - 2);
+            if(codePoints < node->minLength || codePoints > node->maxLength) return schemaFail(run, token);
+            return STATUS_OK;
+        }
+        case JSON_TYPE_NUMBER:
+            if(value < node->minimum || value > node->maximum
+                    || value <= node->exclusiveMinimum || value >= node->exclusiveMaximum) {
+                return schemaFail(run, token);
+            }
+            return STATUS_OK;
+        default:
+            return STATUS_OK;
+    }
+}
+
+unsigned int schemaValidateReader(
+        const struct JSONSchema *schema,
+        struct JSONReader *reader,
+        struct JSONToken *failed) {
+    if(schema->nodeCount == 0) return STATUS_INPUT_ERR;
+    struct SchemaRun run = {schema, reader, NULL, failed};
+    if(schema->propertyCount) {
+        run.seen = malloc(schema->propertyCount);
+        if(run.seen == NULL) return STATUS_ALLOC_ERR;
+    }
+    struct JSONToken token;
+    unsigned int length;
+    unsigned int result = readerNext(reader, &token, &length);
+    if(result == STATUS_OK) result = validateValue(&run, &token, length, 1);
+    free(run.seen);
+    return result;
+}
+
+unsigned int schemaValidate(
+        const struct JSONSchema *schema,
+        char *toCheck,
+        struct JSONToken *failed) {
+    struct JSONReader reader;
+    readerCompose(&reader, toCheck);
+    unsigned int result = schemaValidateReader(schema, &reader, failed);
+    if(result) return result;
+
+    struct JSONToken token;
+    unsigned int length;
+    result = readerNext(&reader, &token, &length);
+    if(result == STATUS_OK && token.lexeme) result = STATUS_PARSE_ERR;
+    return result;
+}
+
+unsigned int parseJSONValidated(
+        const struct JSONSchema *schema,
+        struct Generic **generic,
+        char *toCheck,
+        struct JSONToken *failed) {
+    unsigned int result = schemaValidate(schema, toCheck, failed);
+    if(result) return result;
+    return parseJSON(generic, toCheck);
+}
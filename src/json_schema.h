@@ -0,0 +1,107 @@
+#ifndef __JSON_SCHEMA_H
+#define __JSON_SCHEMA_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include "json_lexer.h"
+#include "json_parser.h"
+#include "cutil/src/generic/generic.h"
+
+// Type bits of a schema node are 1 << JSON_TYPE, plus integer which also
+// admits numbers without a fractional part.
+#define JSON_SCHEMA_INTEGER (1u << 7)
+#define JSON_SCHEMA_ANY 0xFFu
+
+// Nodes, properties and constants refer to nodes by index + 1, 0 being
+// the unconstrained schema.
+struct JSONSchemaNode {
+    unsigned int types;
+    double minimum;
+    double maximum;
+    double exclusiveMinimum;
+    double exclusiveMaximum;
+    // Strings count code points, escapes as the character they stand for.
+    unsigned int minLength;
+    unsigned int maxLength;
+    unsigned int minItems;
+    unsigned int maxItems;
+    unsigned int minProperties;
+    unsigned int maxProperties;
+    unsigned int items;
+    // Members not in properties, refused outright when closed.
+    unsigned int additional;
+    unsigned char closed;
+    // Contiguous ranges of the schema's properties and constants.
+    unsigned int firstProperty;
+    unsigned int propertyCount;
+    unsigned int firstConstant;
+    unsigned int constantCount;
+};
+
+// Names are compared as written, escapes included.
+struct JSONSchemaProperty {
+    char *name;
+    unsigned int nameLength;
+    unsigned int node;
+    unsigned char required;
+};
+
+// Values of enum and const, only scalars are supported.
+struct JSONSchemaConstant {
+    enum JSON_TYPE type;
+    double number;
+    char *string;
+    unsigned int stringLength;
+};
+
+// A JSON Schema compiled to flat tables, the root is node 1. Supports
+// type, enum, const, minimum, maximum and their exclusive forms,
+// minLength, maxLength, items, minItems, maxItems, properties, required,
+// additionalProperties, minProperties and maxProperties. Annotations and
+// unknown keywords are ignored, keywords that would need more than this
+// such as $ref, the combinators or pattern are refused.
+struct JSONSchema {
+    struct JSONSchemaNode *nodes;
+    unsigned int nodeCount;
+    unsigned int nodeCapacity;
+    struct JSONSchemaProperty *properties;
+    unsigned int propertyCount;
+    unsigned int propertyCapacity;
+    struct JSONSchemaConstant *constants;
+    unsigned int constantCount;
+    unsigned int constantCapacity;
+};
+
+// Compiled from a document so numbers keep their exact lexemes and match
+// the same numbers in validated input. STATUS_INPUT_ERR for schemas that
+// are malformed or use unsupported keywords. The source may be released
+// once compiled.
+unsigned int schemaCompose(struct JSONSchema *schema, const struct JSONValue *source);
+void schemaRelease(struct JSONSchema *schema);
+
+// Check a document against the schema in one pass over its tokens without
+// building anything, stopping at the first violation. Violations are a
+// STATUS_INPUT_ERR and copy the offending token to failed when given,
+// malformed input a STATUS_PARSE_ERR.
+unsigned int schemaValidate(
+    const struct JSONSchema *schema,
+    char *toCheck,
+    struct JSONToken *failed);
+// Check the next value of a reader, leaving it positioned after the value.
+unsigned int schemaValidateReader(
+    const struct JSONSchema *schema,
+    struct JSONReader *reader,
+    struct JSONToken *failed);
+
+// Build a tree only for documents that satisfy the schema.
+unsigned int parseJSONValidated(
+    const struct JSONSchema *schema,
+    struct Generic **generic,
+    char *toCheck,
+    struct JSONToken *failed);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
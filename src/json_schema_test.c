@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_dom.h"
+#include "json_schema.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+static unsigned int composeSchemaText(struct JSONSchema *schema, const char *text) {
+    char *copy = malloc(strlen(text) + 1);
+    strcpy(copy, text);
+    struct JSONDocument source;
+    unsigned int result = parseDocument(&source, copy);
+    free(copy);
+    if(result) return result;
+    result = schemaCompose(schema, &source.root);
+    documentRelease(&source);
+    return result;
+}
+
+static const char recordSchema[] = "{"
+    "\"type\": \"object\","
+    "\"required\": [\"id\", \"name\"],"
+    "\"additionalProperties\": false,"
+    "\"properties\": {"
+        "\"id\": {\"type\": \"integer\", \"minimum\": 1},"
+        "\"name\": {\"type\": \"string\", \"minLength\": 1, \"maxLength\": 4},"
+        "\"ratio\": {\"type\": [\"number\", \"null\"], \"exclusiveMaximum\": 1},"
+        "\"kind\": {\"enum\": [\"a\", \"b\", 3, null]},"
+        "\"tags\": {\"type\": \"array\", \"items\": {\"type\": \"string\"}, \"maxItems\": 2},"
+        "\"meta\": {\"title\": \"anything\"}"
+    "}"
+"}";
+
+void testJSONSchemaValid() {
+    struct JSONSchema schema;
+    assertIntegersEqual(composeSchemaText(&schema, recordSchema), STATUS_OK);
+
+    char input[] = "{\"id\": 2.0, \"name\": \"\\u00e9t\\uD83D\\uDE00\","
+        " \"ratio\": null, \"kind\": 3, \"tags\": [\"x\"], \"meta\": {\"x\": [1, {}]}}";
+    assertIntegersEqual(schemaValidate(&schema, input, NULL), STATUS_OK);
+    char minimal[] = "{\"name\": \"ab\", \"id\": 1}";
+    assertIntegersEqual(schemaValidate(&schema, minimal, NULL), STATUS_OK);
+    schemaRelease(&schema);
+}
+
+void testJSONSchemaViolations() {
+    struct JSONSchema schema;
+    assertIntegersEqual(composeSchemaText(&schema, recordSchema), STATUS_OK);
+    struct JSONToken failed;
+
+    char missing[] = "{\"id\": 1}";
+    assertIntegersEqual(schemaValidate(&schema, missing, &failed), STATUS_INPUT_ERR);
+    assertIntegersEqual(*failed.lexeme, '}');
+    char fraction[] = "{\"id\": 1.5, \"name\": \"a\"}";
+    assertIntegersEqual(schemaValidate(&schema, fraction, &failed), STATUS_INPUT_ERR);
+    assertIntegersEqual(failed.col, 7);
+    char minimum[] = "{\"id\": 0, \"name\": \"a\"}";
+    assertIntegersEqual(schemaValidate(&schema, minimum, NULL), STATUS_INPUT_ERR);
+    char tooLong[] = "{\"id\": 1, \"name\": \"abcde\"}";
+    assertIntegersEqual(schemaValidate(&schema, tooLong, NULL), STATUS_INPUT_ERR);
+    char exclusive[] = "{\"id\": 1, \"name\": \"a\", \"ratio\": 1}";
+    assertIntegersEqual(schemaValidate(&schema, exclusive, NULL), STATUS_INPUT_ERR);
+    char notInEnum[] = "{\"id\": 1, \"name\": \"a\", \"kind\": \"c\"}";
+    assertIntegersEqual(schemaValidate(&schema, notInEnum, NULL), STATUS_INPUT_ERR);
+    char itemType[] = "{\"id\": 1, \"name\": \"a\", \"tags\": [1]}";
+    assertIntegersEqual(schemaValidate(&schema, itemType, NULL), STATUS_INPUT_ERR);
+    char tooMany[] = "{\"id\": 1, \"name\": \"a\", \"tags\": [\"x\", \"y\", \"z\"]}";
+    assertIntegersEqual(schemaValidate(&schema, tooMany, NULL), STATUS_INPUT_ERR);
+    char additional[] = "{\"id\": 1, \"name\": \"a\", \"extra\": 1}";
+    assertIntegersEqual(schemaValidate(&schema, additional, &failed), STATUS_INPUT_ERR);
+    assertIntegersEqual(strncmp(failed.lexeme, "\"extra\"", 7), 0);
+    char wrongRoot[] = "[]";
+    assertIntegersEqual(schemaValidate(&schema, wrongRoot, NULL), STATUS_INPUT_ERR);
+    schemaRelease(&schema);
+}
+
+void testJSONSchemaMalformed() {
+    struct JSONSchema schema;
+    assertIntegersEqual(composeSchemaText(&schema, "true"), STATUS_OK);
+    char input[] = "{\"a\": [1, 2}";
+    assertIntegersEqual(schemaValidate(&schema, input, NULL), STATUS_PARSE_ERR);
+    char trailing[] = "{} {}";
+    assertIntegersEqual(schemaValidate(&schema, trailing, NULL), STATUS_PARSE_ERR);
+    char number[] = "[01]";
+    assertIntegersEqual(schemaValidate(&schema, number, NULL), STATUS_PARSE_ERR);
+    schemaRelease(&schema);
+
+    assertIntegersEqual(composeSchemaText(&schema, "false"), STATUS_OK);
+    char anything[] = "null";
+    assertIntegersEqual(schemaValidate(&schema, anything, NULL), STATUS_INPUT_ERR);
+    schemaRelease(&schema);
+}
+
+void testJSONSchemaUnsupported() {
+    struct JSONSchema schema;
+    assertIntegersEqual(composeSchemaText(&schema, "{\"$ref\": \"#\"}"), STATUS_INPUT_ERR);
+    assertIntegersEqual(composeSchemaText(&schema,
+        "{\"properties\": {\"a\": {\"pattern\": \"x\"}}}"), STATUS_INPUT_ERR);
+    assertIntegersEqual(composeSchemaText(&schema, "{\"type\": \"text\"}"), STATUS_INPUT_ERR);
+    assertIntegersEqual(composeSchemaText(&schema, "{\"enum\": [[1]]}"), STATUS_INPUT_ERR);
+}
+
+void testJSONSchemaParse() {
+    struct JSONSchema schema;
+    assertIntegersEqual(composeSchemaText(&schema,
+        "{\"type\": \"array\", \"items\": {\"const\": 1}, \"minItems\": 1}"), STATUS_OK);
+    struct Generic *generic = NULL;
+    char valid[] = "[1, 1]";
+    assertIntegersEqual(parseJSONValidated(&schema, &generic, valid, NULL), STATUS_OK);
+    assertNotNull(generic);
+    genericRelease(generic);
+
+    generic = NULL;
+    char empty[] = "[]";
+    assertIntegersEqual(parseJSONValidated(&schema, &generic, empty, NULL), STATUS_INPUT_ERR);
+    assertIsNull(generic);
+
+    // A value in the middle of a stream, the reader continues after it.
+    char stream[] = "[1] [2]";
+    struct JSONReader reader;
+    readerCompose(&reader, stream);
+    assertIntegersEqual(schemaValidateReader(&schema, &reader, NULL), STATUS_OK);
+    assertIntegersEqual(schemaValidateReader(&schema, &reader, NULL), STATUS_INPUT_ERR);
+    schemaRelease(&schema);
+}
+
+void testJSONSchemaFractions() {
+    // Bounds and constants keep the exact value of their lexemes.
+    struct JSONSchema schema;
+    assertIntegersEqual(composeSchemaText(&schema,
+        "{\"minimum\": 0.1, \"exclusiveMaximum\": 0.3}"), STATUS_OK);
+    char atMinimum[] = "0.1";
+    assertIntegersEqual(schemaValidate(&schema, atMinimum, NULL), STATUS_OK);
+    char below[] = "0.09999999";
+    assertIntegersEqual(schemaValidate(&schema, below, NULL), STATUS_INPUT_ERR);
+    char atMaximum[] = "3e-1";
+    assertIntegersEqual(schemaValidate(&schema, atMaximum, NULL), STATUS_INPUT_ERR);
+    schemaRelease(&schema);
+
+    assertIntegersEqual(composeSchemaText(&schema, "{\"enum\": [0.1, 1e-7, 2.5]}"), STATUS_OK);
+    char tenth[] = "0.1";
+    assertIntegersEqual(schemaValidate(&schema, tenth, NULL), STATUS_OK);
+    char small[] = "0.0000001";
+    assertIntegersEqual(schemaValidate(&schema, small, NULL), STATUS_OK);
+    char other[] = "0.2";
+    assertIntegersEqual(schemaValidate(&schema, other, NULL), STATUS_INPUT_ERR);
+    schemaRelease(&schema);
+}
+
+void testJSONSchema() {
+    testJSONSchemaValid();
+    testJSONSchemaViolations();
+    testJSONSchemaMalformed();
+    testJSONSchemaUnsupported();
+    testJSONSchemaParse();
+    testJSONSchemaFractions();
+}
@@ -0,0 +1,268 @@
+#include <limits.h>
+#include <stdlib.h>
+#include "json_snapshot.h"
+#include "cutil/src/error.h"
+#include "cutil/src/string.h"
+#include "cutil/src/map/map.h"
+
+static const char JSON_SNAPSHOT_MAGIC[4] = {'C', 'J', 'S', 'S'};
+#define JSON_SNAPSHOT_VERSION 1
+
+struct SnapshotWriter {
+    struct JSONSnapshotNode *nodes;
+    char *strings;
+    // Counted wide so a tree too large for the image's 32 bit fields is
+    // caught rather than wrapping between the sizing and writing passes.
+    size_t nodeCount;
+    size_t stringsLength;
+};
+
+static unsigned int addString(struct SnapshotWriter *writer, const char *string, uint32_t *offset) {
+    size_t length = strlen(string) + 1;
+    if(length > UINT32_MAX - writer->stringsLength) return STATUS_ALLOC_ERR;
+    *offset = writer->stringsLength;
+    if(writer->strings) memcpy(writer->strings + *offset, string, length);
+    writer->stringsLength += length;
+    return STATUS_OK;
+}
+
+// With a NULL writer->nodes only the sizes are accumulated.
+static unsigned int writeValue(
+        struct SnapshotWriter *writer,
+        struct Generic *generic,
+        const char *key) {
+    // JSON_SNAPSHOT_NONE is never a node index.
+    if(writer->nodeCount >= JSON_SNAPSHOT_NONE) return STATUS_ALLOC_ERR;
+    size_t index = writer->nodeCount++;
+    struct JSONSnapshotNode node;
+    node.key = JSON_SNAPSHOT_NONE;
+    if(key) {
+        unsigned int result = addString(writer, key, &node.key);
+        if(result) return result;
+    }
+    node.count = 0;
+    node.value.integer = 0;
+
+    if(generic->object == &Map.object || generic->object == &Array.object) {
+        int isMap = generic->object == &Map.object;
+        struct Collection *collection = (struct Collection*)generic->object;
+        struct Iterator iterator = collection->iterator(genericData(generic));
+        node.type = isMap ? JSON_SNAPSHOT_OBJECT : JSON_SNAPSHOT_ARRAY;
+        while(1) {
+            const char *childKey = isMap ? mapKey(&iterator) : NULL;
+            struct Generic *element = collection->next(&iterator);
+            if(!element) break;
+            unsigned int result = writeValue(writer, element, childKey);
+            if(result) return result;
+            node.count++;
+        }
+    } else if(generic->object == &String) {
+        const char *string = *((char**)genericData(generic));
+        uint32_t offset;
+        unsigned int result = addString(writer, string, &offset);
+        if(result) return result;
+        node.type = JSON_SNAPSHOT_STRING;
+        node.count = strlen(string);
+        node.value.string = offset;
+    } else if(generic->object == &Integer) {
+        node.type = JSON_SNAPSHOT_INTEGER;
+        node.value.integer = *((long*)genericData(generic));
+    } else if(generic->object == &Float) {
+        node.type = JSON_SNAPSHOT_FLOAT;
+        node.value.real = *((float*)genericData(generic));
+    } else if(generic->object == &Boolean) {
+        char boolValue = *((char*)genericData(generic));
+        node.type = boolValue ? JSON_SNAPSHOT_TRUE : JSON_SNAPSHOT_FALSE;
+    } else if(generic->object == &Pointer) {
+        if(*((void**)genericData(generic)) != NULL) return STATUS_INPUT_ERR;
+        node.type = JSON_SNAPSHOT_NULL;
+    } else {
+        return STATUS_INPUT_ERR;
+    }
+
+    node.end = writer->nodeCount;
+    if(writer->nodes) writer->nodes[index] = node;
+    return STATUS_OK;
+}
+
+unsigned int snapshotCreate(struct Generic *generic, char **image, size_t *imageLength) {
+    // First pass sizes the image, second pass fills it.
+    struct SnapshotWriter writer = {NULL, NULL, 0, 0};
+    unsigned int result = writeValue(&writer, generic, NULL);
+    if(result) return result;
+
+    size_t available = SIZE_MAX - sizeof(struct JSONSnapshotHeader) - writer.stringsLength;
+    if(writer.nodeCount > available / sizeof(struct JSONSnapshotNode)) return STATUS_ALLOC_ERR;
+    size_t nodesLength = writer.nodeCount * sizeof(struct JSONSnapshotNode);
+    size_t length = sizeof(struct JSONSnapshotHeader) + nodesLength + writer.stringsLength;
+    char *data = calloc(1, length);
+    if(data == NULL) return STATUS_ALLOC_ERR;
+
+    struct JSONSnapshotHeader *header = (struct JSONSnapshotHeader*)data;
+    memcpy(header->magic, JSON_SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->version = JSON_SNAPSHOT_VERSION;
+    header->nodeCount = writer.nodeCount;
+    header->stringsLength = writer.stringsLength;
+
+    writer.nodes = (struct JSONSnapshotNode*)(data + sizeof(struct JSONSnapshotHeader));
+    writer.strings = data + sizeof(struct JSONSnapshotHeader) + nodesLength;
+    writer.nodeCount = 0;
+    writer.stringsLength = 0;
+    result = writeValue(&writer, generic, NULL);
+    if(result) {
+        free(data);
+        return result;
+    }
+
+    *image = data;
+    *imageLength = length;
+    return STATUS_OK;
+}
+
+// Every offset, count and end is checked once here so the accessors can
+// follow them without bounds checks.
+static unsigned int validateNodes(const struct JSONSnapshot *snapshot) {
+    const struct JSONSnapshotNode *nodes = snapshot->nodes;
+    uint32_t nodeCount = snapshot->header->nodeCount;
+    uint32_t stringsLength = snapshot->header->stringsLength;
+    if(nodes[0].end != nodeCount) return STATUS_PARSE_ERR;
+    for(uint32_t i = 0; i < nodeCount; i++) {
+        const struct JSONSnapshotNode *node = &nodes[i];
+        if(node->type > JSON_SNAPSHOT_OBJECT) return STATUS_PARSE_ERR;
+        if(node->key != JSON_SNAPSHOT_NONE && node->key >= stringsLength) return STATUS_PARSE_ERR;
+        if(node->end <= i || node->end > nodeCount) return STATUS_PARSE_ERR;
+        if(node->type == JSON_SNAPSHOT_STRING) {
+            if(node->value.string >= stringsLength) return STATUS_PARSE_ERR;
+            if(strlen(snapshot->strings + node->value.string) != node->count) return STATUS_PARSE_ERR;
+        }
+        if(node->type != JSON_SNAPSHOT_ARRAY && node->type != JSON_SNAPSHOT_OBJECT) {
+            if(node->end != i + 1) return STATUS_PARSE_ERR;
+            continue;
+        }
+        // Children must tile the subtree exactly. Each child's end is past
+        // the child, so the walk is bounded by the subtree.
+        uint32_t child = i + 1;
+        for(uint32_t c = 0; c < node->count; c++) {
+            if(child >= node->end) return STATUS_PARSE_ERR;
+            if(node->type == JSON_SNAPSHOT_OBJECT && nodes[child].key == JSON_SNAPSHOT_NONE) {
+                return STATUS_PARSE_ERR;
+            }
+            // A child's end must not reach past its parent's.
+            if(nodes[child].end <= child || nodes[child].end > node->end) return STATUS_PARSE_ERR;
+            child = nodes[child].end;
+        }
+        if(child != node->end) return STATUS_PARSE_ERR;
+    }
+    return STATUS_OK;
+}
+
+unsigned int snapshotOpen(struct JSONSnapshot *snapshot, const void *image, size_t imageLength) {
+    const struct JSONSnapshotHeader *header = image;
+    if(imageLength < sizeof(struct JSONSnapshotHeader)) return STATUS_PARSE_ERR;
+    if(memcmp(header->magic, JSON_SNAPSHOT_MAGIC, sizeof(header->magic))) return STATUS_PARSE_ERR;
+    if(header->version != JSON_SNAPSHOT_VERSION) return STATUS_PARSE_ERR;
+    if(header->nodeCount == 0) return STATUS_PARSE_ERR;
+
+    size_t nodesLength = (size_t)header->nodeCount * sizeof(struct JSONSnapshotNode);
+    size_t length = sizeof(struct JSONSnapshotHeader) + nodesLength + header->stringsLength;
+    if(length != imageLength) return STATUS_PARSE_ERR;
+
+    const char *data = image;
+    snapshot->header = header;
+    snapshot->nodes = (const struct JSONSnapshotNode*)(data + sizeof(struct JSONSnapshotHeader));
+    snapshot->strings = data + sizeof(struct JSONSnapshotHeader) + nodesLength;
+    if(header->stringsLength && snapshot->strings[header->stringsLength - 1]) return STATUS_PARSE_ERR;
+    return validateNodes(snapshot);
+}
+
+enum JSON_SNAPSHOT_TYPE snapshotType(const struct JSONSnapshot *snapshot, uint32_t node) {
+    return snapshot->nodes[node].type;
+}
+
+unsigned int snapshotCount(const struct JSONSnapshot *snapshot, uint32_t node) {
+    return snapshot->nodes[node].count;
+}
+
+const char *snapshotKey(const struct JSONSnapshot *snapshot, uint32_t node) {
+    uint32_t key = snapshot->nodes[node].key;
+    return key == JSON_SNAPSHOT_NONE ? NULL : snapshot->strings + key;
+}
+
+const char *snapshotString(const struct JSONSnapshot *snapshot, uint32_t node) {
+    if(snapshot->nodes[node].type != JSON_SNAPSHOT_STRING) return NULL;
+    return snapshot->strings + snapshot->nodes[node].value.string;
+}
+
+long snapshotInteger(const struct JSONSnapshot *snapshot, uint32_t node) {
+    const struct JSONSnapshotNode *n = &snapshot->nodes[node];
+    if(n->type == JSON_SNAPSHOT_FLOAT) return n->value.real;
+    return n->type == JSON_SNAPSHOT_INTEGER ? n->value.integer : 0;
+}
+
+double snapshotFloat(const struct JSONSnapshot *snapshot, uint32_t node) {
+    const struct JSONSnapshotNode *n = &snapshot->nodes[node];
+    if(n->type == JSON_SNAPSHOT_INTEGER) return n->value.integer;
+    return n->type == JSON_SNAPSHOT_FLOAT ? n->value.real : 0;
+}
+
+char snapshotBoolean(const struct JSONSnapshot *snapshot, uint32_t node) {
+    return snapshot->nodes[node].type == JSON_SNAPSHOT_TRUE;
+}
+
+uint32_t snapshotRoot(const struct JSONSnapshot *snapshot) {
+    return 0;
+}
+
+uint32_t snapshotChild(const struct JSONSnapshot *snapshot, uint32_t node, unsigned int index) {
+    const struct JSONSnapshotNode *n = &snapshot->nodes[node];
+    if(n->type != JSON_SNAPSHOT_ARRAY && n->type != JSON_SNAPSHOT_OBJECT) return JSON_SNAPSHOT_NONE;
+    if(index >= n->count) return JSON_SNAPSHOT_NONE;
+    // Children are laid out back to back, hop over each sibling subtree.
+    uint32_t child = node + 1;
+    while(index--) child = snapshot->nodes[child].end;
+    return child;
+}
+
+static uint32_t findMember(
+        const struct JSONSnapshot *snapshot,
+        uint32_t node,
+        const char *key,
+        size_t keyLength) {
+    const struct JSONSnapshotNode *n = &snapshot->nodes[node];
+    if(n->type != JSON_SNAPSHOT_OBJECT) return JSON_SNAPSHOT_NONE;
+    uint32_t child = node + 1;
+    for(unsigned int i = 0; i < n->count; i++) {
+        const char *childKey = snapshot->strings + snapshot->nodes[child].key;
+        if(strncmp(childKey, key, keyLength) == 0 && childKey[keyLength] == 0) return child;
+        child = snapshot->nodes[child].end;
+    }
+    return JSON_SNAPSHOT_NONE;
+}
+
+uint32_t snapshotMember(const struct JSONSnapshot *snapshot, uint32_t node, const char *key) {
+    return findMember(snapshot, node, key, strlen(key));
+}
+
+uint32_t snapshotGetAt(const struct JSONSnapshot *snapshot, const char *path) {
+    uint32_t node = snapshotRoot(snapshot);
+    while(node != JSON_SNAPSHOT_NONE && *path) {
+        const char *end = strchr(path, '.');
+        size_t length = end ? (size_t)(end - path) : strlen(path);
+        if(snapshot->nodes[node].type == JSON_SNAPSHOT_ARRAY) {
+            // Only plain digits name an element, anything else is missing.
+            if(length == 0) return JSON_SNAPSHOT_NONE;
+            unsigned int index = 0;
+            for(size_t i = 0; i < length; i++) {
+                if(path[i] < '0' || path[i] > '9') return JSON_SNAPSHOT_NONE;
+                if(index > (UINT_MAX - 9) / 10) return JSON_SNAPSHOT_NONE;
+                index = index * 10 + (path[i] - '0');
+            }
+            node = snapshotChild(snapshot, node, index);
+        } else {
+            node = findMember(snapshot, node, path, length);
+        }
+        path += length;
+        if(*path) path++;
+    }
+    return node;
+}
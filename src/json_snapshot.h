@@ -0,0 +1,73 @@
+#ifndef __JSON_SNAPSHOT_H
+#define __JSON_SNAPSHOT_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cutil/src/generic/generic.h"
+
+// Marks a missing node or key.
+#define JSON_SNAPSHOT_NONE 0xFFFFFFFFu
+
+enum JSON_SNAPSHOT_TYPE {
+    JSON_SNAPSHOT_NULL,
+    JSON_SNAPSHOT_FALSE,
+    JSON_SNAPSHOT_TRUE,
+    JSON_SNAPSHOT_INTEGER,
+    JSON_SNAPSHOT_FLOAT,
+    JSON_SNAPSHOT_STRING,
+    JSON_SNAPSHOT_ARRAY,
+    JSON_SNAPSHOT_OBJECT
+};
+
+// Image layout: header, nodes in document order (a node's children follow
+// it directly), then a pool of null terminated strings. Every reference is
+// an index or offset so the image can be mapped anywhere and shared as is.
+struct JSONSnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t stringsLength;
+};
+
+struct JSONSnapshotNode {
+    uint32_t type;
+    uint32_t key;   // Offset of the member name, or JSON_SNAPSHOT_NONE.
+    uint32_t count; // Children of containers, length of strings.
+    uint32_t end;   // Index of the node following this subtree.
+    union {
+        int64_t integer;
+        double real;
+        uint64_t string; // Offset into the string pool.
+    } value;
+};
+
+// Read only view over an image, nothing is copied.
+struct JSONSnapshot {
+    const struct JSONSnapshotHeader *header;
+    const struct JSONSnapshotNode *nodes;
+    const char *strings;
+};
+
+unsigned int snapshotCreate(struct Generic *generic, char **image, size_t *imageLength);
+unsigned int snapshotOpen(struct JSONSnapshot *snapshot, const void *image, size_t imageLength);
+
+enum JSON_SNAPSHOT_TYPE snapshotType(const struct JSONSnapshot *snapshot, uint32_t node);
+unsigned int snapshotCount(const struct JSONSnapshot *snapshot, uint32_t node);
+const char *snapshotKey(const struct JSONSnapshot *snapshot, uint32_t node);
+const char *snapshotString(const struct JSONSnapshot *snapshot, uint32_t node);
+long snapshotInteger(const struct JSONSnapshot *snapshot, uint32_t node);
+double snapshotFloat(const struct JSONSnapshot *snapshot, uint32_t node);
+char snapshotBoolean(const struct JSONSnapshot *snapshot, uint32_t node);
+
+uint32_t snapshotRoot(const struct JSONSnapshot *snapshot);
+uint32_t snapshotChild(const struct JSONSnapshot *snapshot, uint32_t node, unsigned int index);
+uint32_t snapshotMember(const struct JSONSnapshot *snapshot, uint32_t node, const char *key);
+uint32_t snapshotGetAt(const struct JSONSnapshot *snapshot, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include "json_parser.h"
+#include "json_snapshot.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+void testJSONSnapshotRoundTrip() {
+    char input[] = "{\"a\": [\"foo\", 9, [1, 2]], \"b\": {\"d\": 21.5, \"e\": null}, \"c\": true}";
+    struct Generic *generic;
+    unsigned int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char *image;
+    size_t imageLength;
+    result = snapshotCreate(generic, &image, &imageLength);
+    assertIntegersEqual(result, STATUS_OK);
+    genericRelease(generic);
+
+    struct JSONSnapshot snapshot;
+    result = snapshotOpen(&snapshot, image, imageLength);
+    assertIntegersEqual(result, STATUS_OK);
+
+    uint32_t root = snapshotRoot(&snapshot);
+    assertIntegersEqual(snapshotType(&snapshot, root), JSON_SNAPSHOT_OBJECT);
+    assertIntegersEqual(snapshotCount(&snapshot, root), 3);
+
+    uint32_t node = snapshotGetAt(&snapshot, "a.0");
+    assertIntegersEqual(snapshotType(&snapshot, node), JSON_SNAPSHOT_STRING);
+    assertStringsEqual(snapshotString(&snapshot, node), "foo");
+    assertIntegersEqual(snapshotCount(&snapshot, node), 3);
+
+    node = snapshotGetAt(&snapshot, "a.1");
+    assertIntegersEqual(snapshotInteger(&snapshot, node), 9);
+    node = snapshotGetAt(&snapshot, "a.2.1");
+    assertIntegersEqual(snapshotInteger(&snapshot, node), 2);
+
+    node = snapshotMember(&snapshot, root, "b");
+    assertStringsEqual(snapshotKey(&snapshot, node), "b");
+    assertFloatsEqual(snapshotFloat(&snapshot, snapshotMember(&snapshot, node, "d")), 21.5);
+    assertIntegersEqual(snapshotType(&snapshot, snapshotGetAt(&snapshot, "b.e")), JSON_SNAPSHOT_NULL);
+    assertIntegersEqual(snapshotBoolean(&snapshot, snapshotGetAt(&snapshot, "c")), 1);
+
+    assertIntegersEqual(snapshotGetAt(&snapshot, "a.3"), JSON_SNAPSHOT_NONE);
+    assertIntegersEqual(snapshotGetAt(&snapshot, "z"), JSON_SNAPSHOT_NONE);
+    assertIntegersEqual(snapshotGetAt(&snapshot, "a.x"), JSON_SNAPSHOT_NONE);
+    assertIntegersEqual(snapshotGetAt(&snapshot, "a.1x"), JSON_SNAPSHOT_NONE);
+    assertIntegersEqual(snapshotGetAt(&snapshot, "a..0"), JSON_SNAPSHOT_NONE);
+    free(image);
+}
+
+void testJSONSnapshotOpenInvalid() {
+    char input[] = "[1]";
+    struct Generic *generic;
+    unsigned int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char *image;
+    size_t imageLength;
+    result = snapshotCreate(generic, &image, &imageLength);
+    assertIntegersEqual(result, STATUS_OK);
+    genericRelease(generic);
+
+    struct JSONSnapshot snapshot;
+    result = snapshotOpen(&snapshot, image, imageLength - 1);
+    assertIntegersEqual(result, STATUS_PARSE_ERR);
+    image[0] = 'X';
+    result = snapshotOpen(&snapshot, image, imageLength);
+    assertIntegersEqual(result, STATUS_PARSE_ERR);
+    free(image);
+}
+
+void testJSONSnapshotOpenCorrupt() {
+    char input[] = "{\"a\": [\"foo\", 1], \"b\": 2}";
+    struct Generic *generic;
+    unsigned int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    char *image;
+    size_t imageLength;
+    result = snapshotCreate(generic, &image, &imageLength);
+    assertIntegersEqual(result, STATUS_OK);
+    genericRelease(generic);
+
+    struct JSONSnapshot snapshot;
+    result = snapshotOpen(&snapshot, image, imageLength);
+    assertIntegersEqual(result, STATUS_OK);
+    struct JSONSnapshotNode *nodes = (struct JSONSnapshotNode*)(image + sizeof(struct JSONSnapshotHeader));
+    uint32_t array = snapshotGetAt(&snapshot, "a");
+    uint32_t string = snapshotGetAt(&snapshot, "a.0");
+    struct JSONSnapshotNode saved;
+
+    // Key offset past the string pool.
+    saved = nodes[array];
+    nodes[array].key = 1000;
+    assertIntegersEqual(snapshotOpen(&snapshot, image, imageLength), STATUS_PARSE_ERR);
+    nodes[array] = saved;
+
+    // Subtree end past the image.
+    nodes[array].end = 1000;
+    assertIntegersEqual(snapshotOpen(&snapshot, image, imageLength), STATUS_PARSE_ERR);
+    nodes[array] = saved;
+
+    // More children than the subtree holds.
+    nodes[array].count = 3;
+    assertIntegersEqual(snapshotOpen(&snapshot, image, imageLength), STATUS_PARSE_ERR);
+    nodes[array] = saved;
+
+    // Scalar claiming a subtree.
+    saved = nodes[string];
+    nodes[string].end = string + 2;
+    assertIntegersEqual(snapshotOpen(&snapshot, image, imageLength), STATUS_PARSE_ERR);
+    nodes[string] = saved;
+
+    // String offset past the pool, then a length that disagrees.
+    nodes[string].value.string = 1000;
+    assertIntegersEqual(snapshotOpen(&snapshot, image, imageLength), STATUS_PARSE_ERR);
+    nodes[string] = saved;
+    nodes[string].count = 10;
+    assertIntegersEqual(snapshotOpen(&snapshot, image, imageLength), STATUS_PARSE_ERR);
+    nodes[string] = saved;
+
+    // Unknown type.
+    nodes[string].type = 99;
+    assertIntegersEqual(snapshotOpen(&snapshot, image, imageLength), STATUS_PARSE_ERR);
+    nodes[string] = saved;
+
+    assertIntegersEqual(snapshotOpen(&snapshot, image, imageLength), STATUS_OK);
+    free(image);
+}
+
+void testJSONSnapshot() {
+    testJSONSnapshotRoundTrip();
+    testJSONSnapshotOpenInvalid();
+    testJSONSnapshotOpenCorrupt();
+}
@@ -0,0 +1,277 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "json.h"
+#include "json_stream.h"
+#include "json_number.h"
+#include "json_encoding.h"
+#include "cutil/src/error.h"
+
+enum STREAM_STATE {
+    STREAM_VALUE,
+    STREAM_VALUE_OR_CLOSE,
+    STREAM_KEY,
+    STREAM_KEY_OR_CLOSE,
+    STREAM_COLON,
+    STREAM_NEXT,
+    STREAM_DONE
+};
+
+// Token scanners return its length, 0 when it is malformed or
+// STREAM_MORE when the window ends before it does.
+#define STREAM_MORE 0xFFFFFFFFu
+
+unsigned int streamComposeSource(
+        struct JSONStream *stream,
+        unsigned int (*source)(void *context, char *data, unsigned int capacity, unsigned int *length),
+        void *context,
+        unsigned int windowSize) {
+    stream->fd = -1;
+    stream->source = source;
+    stream->sourceContext = context;
+    stream->capacity = windowSize;
+    stream->start = 0;
+    stream->end = 0;
+    stream->eof = 0;
+    stream->state = STREAM_VALUE;
+    stream->open = NULL;
+    stream->depth = 0;
+    stream->openCapacity = 0;
+    // One more byte keeps the window terminated for the number scanner.
+    stream->window = malloc(windowSize + 1);
+    if(stream->window == NULL) return STATUS_ALLOC_ERR;
+    stream->window[0] = '\0';
+    return STATUS_OK;
+}
+
+unsigned int streamCompose(struct JSONStream *stream, int fd, unsigned int windowSize) {
+    unsigned int result = streamComposeSource(stream, NULL, NULL, windowSize);
+    stream->fd = fd;
+    return result;
+}
+
+void streamRelease(struct JSONStream *stream) {
+    free(stream->window);
+    free(stream->open);
+    stream->window = NULL;
+    stream->open = NULL;
+}
+
+// Drop consumed input and read more behind what is left.
+static unsigned int streamFill(struct JSONStream *stream) {
+    if(stream->start > 0) {
+        memmove(stream->window, stream->window + stream->start, stream->end - stream->start);
+        stream->end -= stream->start;
+        stream->start = 0;
+    }
+    if(stream->end == stream->capacity) return STATUS_ALLOC_ERR;
+
+    unsigned int count;
+    unsigned int result = stream->source ?
+        stream->source(stream->sourceContext, stream->window + stream->end, stream->capacity - stream->end, &count) :
+        streamReadFile(&stream->fd, stream->window + stream->end, stream->capacity - stream->end, &count);
+    if(result) return result;
+    if(count == 0) stream->eof = 1;
+    stream->end += count;
+    stream->window[stream->end] = '\0';
+    return STATUS_OK;
+}
+
+unsigned int streamReadFile(void *context, char *data, unsigned int capacity, unsigned int *length) {
+    ssize_t count;
+    do {
+        count = read(*(int*)context, data, capacity);
+    } while(count < 0 && errno == EINTR);
+    if(count < 0) return STATUS_INPUT_ERR;
+    *length = count;
+    return STATUS_OK;
+}
+
+static int isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int isDelimiter(char c) {
+    return isWhitespace(c) || c == JSON_SEPERATOR || c == JSON_ARR_CLOSE || c == JSON_MAP_CLOSE;
+}
+
+static int isHex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static unsigned int scanString(const char *string, unsigned int available) {
+    for(unsigned int i = 1; i < available; i++) {
+        unsigned char c = string[i];
+        if(c == '"') {
+            return validateUTF8(string + 1, i - 1) ? 0 : i + 1;
+        } else if(c < 0x20) {
+            return 0;
+        } else if(c == '\\') {
+            if(++i == available) return STREAM_MORE;
+            if(string[i] == 'u') {
+                for(unsigned int digit = 0; digit < 4; digit++) {
+                    if(++i == available) return STREAM_MORE;
+                    if(!isHex(string[i])) return 0;
+                }
+            } else if(!strchr("\"\\/bfnrt", string[i])) {
+                return 0;
+            }
+        }
+    }
+    return STREAM_MORE;
+}
+
+static unsigned int scanNumber(const char *number, unsigned int available, int eof) {
+    unsigned int span = 0;
+    while(span < available && number[span] && strchr("0123456789+-.eE", number[span])) span++;
+    if(span == available && !eof) return STREAM_MORE;
+
+    // The window is terminated, so the strict scan stops at its end.
+    struct JSONNumber parsed;
+    if(numberCompose(&parsed, number) || parsed.length != span) return 0;
+    return span;
+}
+
+static unsigned int scanLiteral(const char *literal, unsigned int available, int eof, const char *expected) {
+    unsigned int length = strlen(expected);
+    unsigned int compare = available < length ? available : length;
+    if(memcmp(literal, expected, compare)) return 0;
+    if(available <= length && !eof) return STREAM_MORE;
+    if(available < length) return 0;
+    if(available > length && !isDelimiter(literal[length])) return 0;
+    return length;
+}
+
+static unsigned int streamPush(struct JSONStream *stream, char bracket) {
+    if(stream->depth == stream->openCapacity) {
+        unsigned int capacity = stream->openCapacity ? stream->openCapacity * 2 : 16;
+        char *grown = realloc(stream->open, capacity);
+        if(grown == NULL) return STATUS_ALLOC_ERR;
+        stream->open = grown;
+        stream->openCapacity = capacity;
+    }
+    stream->open[stream->depth++] = bracket;
+    stream->state = bracket == JSON_ARR_BEGIN ? STREAM_VALUE_OR_CLOSE : STREAM_KEY_OR_CLOSE;
+    return STATUS_OK;
+}
+
+static unsigned int streamClose(struct JSONStream *stream, char bracket, struct JSONEvent *event) {
+    char expected = bracket == JSON_ARR_CLOSE ? JSON_ARR_BEGIN : JSON_MAP_BEGIN;
+    if(stream->depth == 0 || stream->open[stream->depth - 1] != expected) return STATUS_PARSE_ERR;
+    stream->depth--;
+    stream->state = stream->depth ? STREAM_NEXT : STREAM_DONE;
+    stream->start++;
+    event->type = bracket == JSON_ARR_CLOSE ? JSON_EVENT_END_ARRAY : JSON_EVENT_END_OBJECT;
+    event->depth = stream->depth;
+    return STATUS_OK;
+}
+
+// Scalar or key at the start of the unconsumed input, reading more until
+// the whole token is in the window.
+static unsigned int streamToken(struct JSONStream *stream, struct JSONEvent *event) {
+    while(1) {
+        const char *token = stream->window + stream->start;
+        unsigned int available = stream->end - stream->start;
+        unsigned int length;
+        switch(*token) {
+            case '"':
+                length = scanString(token, available);
+                event->type = stream->state == STREAM_KEY || stream->state == STREAM_KEY_OR_CLOSE ?
+                    JSON_EVENT_KEY : JSON_EVENT_STRING;
+                break;
+            case 't':
+                length = scanLiteral(token, available, stream->eof, JSON_TRUE_STR);
+                event->type = JSON_EVENT_TRUE;
+                break;
+            case 'f':
+                length = scanLiteral(token, available, stream->eof, JSON_FALSE_STR);
+                event->type = JSON_EVENT_FALSE;
+                break;
+            case 'n':
+                length = scanLiteral(token, available, stream->eof, JSON_NULL_STR);
+                event->type = JSON_EVENT_NULL;
+                break;
+            default:
+                length = scanNumber(token, available, stream->eof);
+                event->type = JSON_EVENT_NUMBER;
+        }
+
+        if(length == 0) return STATUS_PARSE_ERR;
+        if(length != STREAM_MORE) {
+            // Only strings lose their quotation marks.
+            int quoted = *token == '"';
+            event->lexeme = token + quoted;
+            event->length = length - 2 * quoted;
+            event->depth = stream->depth;
+            stream->start += length;
+            return STATUS_OK;
+        }
+        if(stream->eof) return STATUS_PARSE_ERR;
+        unsigned int result = streamFill(stream);
+        if(result) return result;
+    }
+}
+
+unsigned int streamNext(struct JSONStream *stream, struct JSONEvent *event) {
+    event->lexeme = NULL;
+    event->length = 0;
+    while(1) {
+        // Skip whitespace, reading more as needed.
+        while(stream->start < stream->end && isWhitespace(stream->window[stream->start])) {
+            stream->start++;
+        }
+        if(stream->start == stream->end) {
+            if(stream->eof) {
+                if(stream->state != STREAM_DONE) return STATUS_PARSE_ERR;
+                event->type = JSON_EVENT_END;
+                event->depth = 0;
+                return STATUS_OK;
+            }
+            unsigned int result = streamFill(stream);
+            if(result) return result;
+            continue;
+        }
+
+        char c = stream->window[stream->start];
+        switch(stream->state) {
+            case STREAM_DONE:
+                // Garbage followed valid JSON.
+                return STATUS_PARSE_ERR;
+            case STREAM_COLON:
+                if(c != JSON_MEMBER_SEP) return STATUS_PARSE_ERR;
+                stream->start++;
+                stream->state = STREAM_VALUE;
+                continue;
+            case STREAM_NEXT:
+                if(c == JSON_ARR_CLOSE || c == JSON_MAP_CLOSE) return streamClose(stream, c, event);
+                if(c != JSON_SEPERATOR) return STATUS_PARSE_ERR;
+                stream->start++;
+                stream->state = stream->open[stream->depth - 1] == JSON_MAP_BEGIN ? STREAM_KEY : STREAM_VALUE;
+                continue;
+            case STREAM_KEY_OR_CLOSE:
+                if(c == JSON_MAP_CLOSE) return streamClose(stream, c, event);
+                // Fall through.
+            case STREAM_KEY: {
+                if(c != '"') return STATUS_PARSE_ERR;
+                unsigned int result = streamToken(stream, event);
+                if(!result) stream->state = STREAM_COLON;
+                return result;
+            }
+            case STREAM_VALUE_OR_CLOSE:
+                if(c == JSON_ARR_CLOSE) return streamClose(stream, c, event);
+                // Fall through.
+            default: {
+                if(c == JSON_ARR_BEGIN || c == JSON_MAP_BEGIN) {
+                    event->type = c == JSON_ARR_BEGIN ? JSON_EVENT_BEGIN_ARRAY : JSON_EVENT_BEGIN_OBJECT;
+                    event->depth = stream->depth;
+                    stream->start++;
+                    return streamPush(stream, c);
+                }
+                unsigned int result = streamToken(stream, event);
+                if(!result) stream->state = stream->depth ? STREAM_NEXT : STREAM_DONE;
+                return result;
+            }
+        }
+    }
+}
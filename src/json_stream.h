@@ -0,0 +1,75 @@
+#ifndef __JSON_STREAM_H
+#define __JSON_STREAM_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+enum JSON_EVENT {
+    JSON_EVENT_END,
+    JSON_EVENT_BEGIN_OBJECT,
+    JSON_EVENT_END_OBJECT,
+    JSON_EVENT_BEGIN_ARRAY,
+    JSON_EVENT_END_ARRAY,
+    JSON_EVENT_KEY,
+    JSON_EVENT_STRING,
+    JSON_EVENT_NUMBER,
+    JSON_EVENT_TRUE,
+    JSON_EVENT_FALSE,
+    JSON_EVENT_NULL
+};
+
+// Lexeme views into the stream's window, valid until the next call.
+// Strings and keys are escaped as in the input, without quotation marks.
+struct JSONEvent {
+    enum JSON_EVENT type;
+    const char *lexeme;
+    unsigned int length;
+    // Containers the value is nested in, 0 for the root.
+    unsigned int depth;
+};
+
+// Reads one document from a file descriptor or a source through a fixed
+// window, dropping input as soon as it has been reported. Memory stays at
+// the window plus a byte per open container whatever the input's size.
+struct JSONStream {
+    int fd;
+    // Read instead of fd when set. Supplies up to capacity bytes, setting
+    // *length to 0 at the end of the input.
+    unsigned int (*source)(void *context, char *data, unsigned int capacity, unsigned int *length);
+    void *sourceContext;
+    char *window;
+    unsigned int capacity;
+    // Unconsumed bytes are window[start, end).
+    unsigned int start;
+    unsigned int end;
+    unsigned char eof;
+    unsigned char state;
+    // Opening bracket of each open container.
+    char *open;
+    unsigned int depth;
+    unsigned int openCapacity;
+};
+
+// windowSize bounds the longest single token, a longer one fails with
+// STATUS_ALLOC_ERR.
+unsigned int streamCompose(struct JSONStream *stream, int fd, unsigned int windowSize);
+unsigned int streamComposeSource(
+    struct JSONStream *stream,
+    unsigned int (*source)(void *context, char *data, unsigned int capacity, unsigned int *length),
+    void *context,
+    unsigned int windowSize);
+void streamRelease(struct JSONStream *stream);
+
+// Next event in document order, JSON_EVENT_END once the document and any
+// trailing whitespace were read. STATUS_PARSE_ERR for malformed input, errors
+// reading it are passed on.
+unsigned int streamNext(struct JSONStream *stream, struct JSONEvent *event);
+
+// Source reading the file descriptor context points to, STATUS_INPUT_ERR
+// when reading fails.
+unsigned int streamReadFile(void *context, char *data, unsigned int capacity, unsigned int *length);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
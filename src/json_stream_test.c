@@ -0,0 +1,108 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "json_stream.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+static FILE *streamInput(const char *text) {
+    FILE *file = tmpfile();
+    fputs(text, file);
+    fflush(file);
+    rewind(file);
+    return file;
+}
+
+// Event types and lexemes as one string, failing status appended.
+static unsigned int streamEvents(const char *text, unsigned int windowSize, char *output) {
+    FILE *file = streamInput(text);
+    struct JSONStream stream;
+    unsigned int result = streamCompose(&stream, fileno(file), windowSize);
+    struct JSONEvent event;
+    *output = '\0';
+    while(!result && !(result = streamNext(&stream, &event)) && event.type != JSON_EVENT_END) {
+        sprintf(output + strlen(output), "%d:%.*s ", event.type, (int)event.length, event.lexeme ? event.lexeme : "");
+    }
+    streamRelease(&stream);
+    fclose(file);
+    return result;
+}
+
+void testJSONStreamEvents() {
+    char output[256];
+    const char *text = " {\"a\": [1, -2.5e3, \"x\\\"y\"], \"b\": {\"t\": true, \"f\": false}, \"n\": null} \n";
+    // A small window forces tokens to straddle reads.
+    unsigned int result = streamEvents(text, 8, output);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output, "1: 5:a 3: 7:1 7:-2.5e3 6:x\\\"y 4: 5:b 1: 5:t 8:true 5:f 9:false 2: 5:n 10:null 2: ");
+
+    assertIntegersEqual(streamEvents(text, 4096, output), STATUS_OK);
+    assertStringsEqual(output, "1: 5:a 3: 7:1 7:-2.5e3 6:x\\\"y 4: 5:b 1: 5:t 8:true 5:f 9:false 2: 5:n 10:null 2: ");
+
+    assertIntegersEqual(streamEvents("42", 8, output), STATUS_OK);
+    assertStringsEqual(output, "7:42 ");
+    assertIntegersEqual(streamEvents("[]", 8, output), STATUS_OK);
+    assertStringsEqual(output, "3: 4: ");
+}
+
+void testJSONStreamDepth() {
+    FILE *file = streamInput("[[{\"a\": []}], 1]");
+    struct JSONStream stream;
+    assertIntegersEqual(streamCompose(&stream, fileno(file), 8), STATUS_OK);
+    unsigned int depths[] = {0, 1, 2, 3, 3, 3, 2, 1, 1, 0};
+    struct JSONEvent event;
+    for(unsigned int i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        assertIntegersEqual(streamNext(&stream, &event), STATUS_OK);
+        assertIntegersEqual(event.depth, depths[i]);
+    }
+    assertIntegersEqual(streamNext(&stream, &event), STATUS_OK);
+    assertIntegersEqual(event.type, JSON_EVENT_END);
+    streamRelease(&stream);
+    fclose(file);
+}
+
+void testJSONStreamInvalid() {
+    char output[256];
+    const char *inputs[] = {
+        "", "[1,]", "[1 2]", "{\"a\" 1}", "{\"a\": 1,}", "{1: 2}", "[01]", "[1] 2",
+        "[\"a\"", "[1}", "{\"a\": }", "[tru]", "[truex]", "[\"\t\"]", "[\"\\x\"]", "[1.]", "[-]"
+    };
+    for(unsigned int i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        assertIntegersEqual(streamEvents(inputs[i], 8, output), STATUS_PARSE_ERR);
+    }
+    // Tokens must fit in the window.
+    assertIntegersEqual(streamEvents("[\"0123456789\"]", 8, output), STATUS_ALLOC_ERR);
+}
+
+void testJSONStreamLarge() {
+    // Far larger than the window, every element is seen once.
+    FILE *file = tmpfile();
+    fputc('[', file);
+    for(unsigned int i = 0; i < 10000; i++) {
+        fprintf(file, "%s{\"id\": %u, \"name\": \"item\"}", i ? ", " : "", i);
+    }
+    fputc(']', file);
+    fflush(file);
+    rewind(file);
+
+    struct JSONStream stream;
+    assertIntegersEqual(streamCompose(&stream, fileno(file), 64), STATUS_OK);
+    struct JSONEvent event;
+    unsigned int result;
+    unsigned long sum = 0;
+    while(!(result = streamNext(&stream, &event)) && event.type != JSON_EVENT_END) {
+        if(event.type == JSON_EVENT_NUMBER) sum += strtoul(event.lexeme, NULL, 10);
+    }
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(sum, 49995000);
+    assertIntegersEqual(stream.openCapacity, 16);
+    streamRelease(&stream);
+    fclose(file);
+}
+
+void testJSONStream() {
+    testJSONStreamEvents();
+    testJSONStreamDepth();
+    testJSONStreamInvalid();
+    testJSONStreamLarge();
+}
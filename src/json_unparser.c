@@ -1,310 +1,446 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include "json.h"
 #include "json_unparser.h"
+#include "json_cache.h"
+#include "json_vector.h"
 #include "cutil/src/string.h"
 #include "cutil/src/map/map.h"
 #include "cutil/src/error.h"
-#include "json.h"
-
-static unsigned int addToken(
-        struct List *tokens,
-        struct JSONToken *tempToken) {
-    struct JSONToken *newToken = tokenCopy(tempToken);
-    if(newToken == NULL) {
-        free(tempToken->lexeme);
-        return STATUS_ALLOC_ERR;
-    }
-    int result = listAddTail(tokens, newToken);
-    if(result) {
-        free(newToken->lexeme);
-        tokenRelease(newToken);
-    }
-    return result;
-}
 
 static unsigned int addStringToken(
-        struct List *tokens,
+        struct JSONUnparser *unparser,
         const char *stringValue) {
-    struct JSONToken tempToken;
-    // Alloc space to store the token lexeme.
-    unsigned int valueLength = strlen(stringValue) + 3;
-    tempToken.lexeme = malloc(valueLength * sizeof(char));
-    if(tempToken.lexeme == NULL) return STATUS_ALLOC_ERR;
-    // Copy the lexeme into newly allocated memory.
-    snprintf(tempToken.lexeme, valueLength, "\"%s\"", (char*)stringValue);
-    // Set the token type.
-    tempToken.token = JSON_TOKEN_STRING;
-
-    return addToken(tokens, &tempToken);
+    struct JSONBuffer *buffer = &unparser->buffer;
+    unsigned int result = bufferAppendChar(buffer, '"');
+    if(result) return result;
+    unsigned int length = strlen(stringValue);
+    if(unparser->vector && length >= unparser->vector->threshold) {
+        result = vectorReference(unparser->vector, buffer, stringValue, length);
+    } else {
+        result = bufferAppend(buffer, stringValue, length);
+    }
+    if(result) return result;
+    return bufferAppendChar(buffer, '"');
 }
 
-static unsigned int addWhitespaceToken(
-        struct List *tokens,
-        struct JSONFormat fmt) {
+unsigned int unparseWhitespace(struct JSONBuffer *buffer, struct JSONFormat fmt) {
     unsigned int indentLevel = fmt.indent*fmt.level;
     if(indentLevel == 0) return STATUS_OK;
+    return bufferAppendRepeat(buffer, fmt.useTabs ? JSON_TAB : JSON_SPACE, indentLevel);
+}
 
-    struct JSONToken tempToken;
-    tempToken.token = JSON_TOKEN_WHITESPACE;
-    tempToken.lexeme = malloc((indentLevel + 1) * sizeof(char));
-    if(tempToken.lexeme == NULL) return STATUS_ALLOC_ERR;
-    // Null terminate the token.
-    tempToken.lexeme[indentLevel] = 0;
-    // Fill token with desired whitespace.
-    for(unsigned char i = 0; i < indentLevel; i++) {
-        tempToken.lexeme[i] = fmt.useTabs ? JSON_TAB : JSON_SPACE;
-    }
-
-    return addToken(tokens, &tempToken);
+unsigned int unparseNewline(struct JSONBuffer *buffer, struct JSONFormat fmt) {
+    if(fmt.indent == 0) return STATUS_OK;
+    return bufferAppendString(buffer, ASCII_V_DELIMITERS);
 }
 
-static unsigned int addNewlineToken(struct List *tokens) {
-    struct JSONToken tempToken;
-    tempToken.lexeme = strCopy(ASCII_V_DELIMITERS);
-    if(tempToken.lexeme == NULL) return STATUS_ALLOC_ERR;
-    tempToken.token = JSON_TOKEN_NEWLINE;
+unsigned int unparseIndent(struct JSONBuffer *buffer, struct JSONFormat fmt) {
+    unsigned int result = unparseNewline(buffer, fmt);
+    if(result) return result;
+    return unparseWhitespace(buffer, fmt);
+}
 
-    return addToken(tokens, &tempToken);
+unsigned int unparseSeparator(struct JSONBuffer *buffer, int last, struct JSONFormat fmt) {
+    if(!last) return bufferAppendChar(buffer, JSON_SEPERATOR);
+    return unparseNewline(buffer, fmt);
 }
 
-static unsigned int unparseMember(
-        const void *key,
-        struct Generic *element,
-        struct List *tokens,
-        struct JSONFormat fmt);
+// Decode the escape at string into a code point, NULL when it is not one.
+// \u escapes yield a UTF-16 code unit which may be half a surrogate pair.
+static const char *decodeEscape(const char *string, unsigned long *codePoint) {
+    const char *simple = "\"\"\\\\//b\bf\fn\nr\rt\t";
+    for(const char *c = simple; *c; c += 2) {
+        if(string[1] == *c) {
+            *codePoint = (unsigned char)c[1];
+            return string + 2;
+        }
+    }
+    if(string[1] != 'u') return NULL;
+    unsigned long value = 0;
+    for(unsigned int i = 2; i < 6; i++) {
+        char c = string[i];
+        unsigned long digit;
+        if(c >= '0' && c <= '9') digit = c - '0';
+        else if(c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return NULL;
+        value = value * 16 + digit;
+    }
+    *codePoint = value;
+    return string + 6;
+}
 
-static unsigned int unparseMembers(
-        struct Generic *generic,
-        struct List *tokens,
-        struct JSONFormat fmt) {
-    struct Collection *collection = (struct Collection*)generic->object;
-    struct Iterator iterator = collection->iterator(genericData(generic));
+// Malformed sequences decode byte by byte.
+static const char *decodeUtf8(const char *string, unsigned long *codePoint) {
+    const unsigned char *s = (const unsigned char*)string;
+    unsigned int length = *s >= 0xF0 ? 4 : *s >= 0xE0 ? 3 : *s >= 0xC0 ? 2 : 1;
+    unsigned long value = length == 1 ? *s : *s & (0x3F >> (length - 1));
+    for(unsigned int i = 1; i < length; i++) {
+        if((s[i] & 0xC0) != 0x80) {
+            *codePoint = *s;
+            return string + 1;
+        }
+        value = (value << 6) | (s[i] & 0x3F);
+    }
+    *codePoint = value;
+    return string + length;
+}
 
-    struct JSONToken tempToken;
-    tempToken.token = JSON_TOKEN_SYMBOL;
+struct CodeUnits {
+    const char *string;
+    long pending;
+};
+
+// Next UTF-16 code unit of a stored string, -1 at its end.
+static long nextCodeUnit(struct CodeUnits *units) {
+    if(units->pending >= 0) {
+        long unit = units->pending;
+        units->pending = -1;
+        return unit;
+    }
+    if(!*units->string) return -1;
 
-    unsigned int result;
-    struct Generic *element = NULL;
-    const void *key;
-    while((key = mapKey(&iterator))) {
-        if(fmt.indent > 0) {
-            result = addNewlineToken(tokens);
-            if(result) return result;
-        }
+    unsigned long codePoint;
+    const char *next;
+    if(*units->string == '\\' && (next = decodeEscape(units->string, &codePoint))) {
+        units->string = next;
+        return codePoint;
+    }
+    units->string = decodeUtf8(units->string, &codePoint);
+    if(codePoint < 0x10000) return codePoint;
+    units->pending = 0xDC00 + ((codePoint - 0x10000) & 0x3FF);
+    return 0xD800 + ((codePoint - 0x10000) >> 10);
+}
 
-        element = collection->next(&iterator);
-        result = unparseMember(key, element, tokens, fmt);
-        if(result) return result;
+static int compareMembers(const void *a, const void *b) {
+    struct CodeUnits unitsA = {((const struct JSONChild*)a)->key, -1};
+    struct CodeUnits unitsB = {((const struct JSONChild*)b)->key, -1};
+    while(1) {
+        long unitA = nextCodeUnit(&unitsA);
+        long unitB = nextCodeUnit(&unitsB);
+        if(unitA != unitB || unitA < 0) return (unitA > unitB) - (unitA < unitB);
+    }
+}
 
-        if((key = mapKey(&iterator))) {
-            const char seperator[] = {JSON_SEPERATOR, 0};
-            tempToken.lexeme = strCopy(seperator);
-            if(!tempToken.lexeme) return STATUS_ALLOC_ERR;
+static unsigned int addCanonicalCodePoint(struct JSONBuffer *buffer, unsigned long codePoint) {
+    const char *escapes = "\"\"\\\\\bb\ff\nn\rr\tt";
+    for(const char *c = escapes; *c; c += 2) {
+        if(codePoint == (unsigned char)*c) {
+            char escape[2] = {'\\', c[1]};
+            return bufferAppend(buffer, escape, 2);
+        }
+    }
+    if(codePoint >= 0x20) return bufferAppendUTF8(buffer, codePoint);
+    char encoded[8];
+    unsigned int length = snprintf(encoded, sizeof(encoded), "\\u%04lx", codePoint);
+    return bufferAppend(buffer, encoded, length);
+}
 
-            result = addToken(tokens, &tempToken);
-            if(result) {
-                return result;
+// Stored strings keep their escapes, they are decoded and written back
+// with only the escapes RFC 8785 requires.
+static unsigned int addCanonicalString(
+        struct JSONBuffer *buffer,
+        const char *string) {
+    unsigned int result = bufferAppendChar(buffer, '"');
+    while(!result && *string) {
+        const char *run = string;
+        while(*string && *string != '\\' && *string != '"' && (unsigned char)*string >= 0x20) {
+            string++;
+        }
+        result = bufferAppend(buffer, run, string - run);
+        if(result || !*string) break;
+
+        unsigned long codePoint;
+        const char *next;
+        if(*string == '\\' && (next = decodeEscape(string, &codePoint))) {
+            string = next;
+            if(codePoint >= 0xDC00 && codePoint <= 0xDFFF) return STATUS_INPUT_ERR;
+            if(codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+                unsigned long low;
+                next = *string == '\\' ? decodeEscape(string, &low) : NULL;
+                if(!next || low < 0xDC00 || low > 0xDFFF) return STATUS_INPUT_ERR;
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                string = next;
             }
         } else {
-            if(fmt.indent > 0) {
-                result = addNewlineToken(tokens);
-                if(result) return result;
-            }
+            codePoint = (unsigned char)*string++;
         }
+        result = addCanonicalCodePoint(buffer, codePoint);
+    }
+    if(result) return result;
+    return bufferAppendChar(buffer, '"');
+}
+
+// Shortest digits that read back to the same value, laid out the way
+// ECMAScript prints numbers. Floats only need to round trip as floats.
+static unsigned int addCanonicalNumber(
+        struct JSONBuffer *buffer,
+        double value,
+        int isFloat) {
+    if(isnan(value) || isinf(value)) return STATUS_INPUT_ERR;
+    if(value == 0) return bufferAppendChar(buffer, '0');
+
+    char scientific[32];
+    for(int precision = 1; precision <= 17; precision++) {
+        snprintf(scientific, sizeof(scientific), "%.*e", precision - 1, value);
+        double parsed = strtod(scientific, NULL);
+        if(isFloat ? (float)parsed == (float)value : parsed == value) break;
     }
 
-    return STATUS_OK;
+    char digits[20];
+    unsigned int count = 0;
+    const char *c = scientific + (value < 0);
+    for(; *c != 'e'; c++) {
+        if(*c != '.') digits[count++] = *c;
+    }
+    while(count > 1 && digits[count - 1] == '0') count--;
+    digits[count] = '\0';
+    int point = atoi(c + 1) + 1;
+
+    char number[64];
+    char *out = number;
+    if(value < 0) *out++ = '-';
+    if((int)count <= point && point <= 21) {
+        out += sprintf(out, "%s%.*s", digits, point - (int)count, "000000000000000000000");
+    } else if(0 < point && point <= 21) {
+        out += sprintf(out, "%.*s.%s", point, digits, digits + point);
+    } else if(-6 < point && point <= 0) {
+        out += sprintf(out, "0.%.*s%s", -point, "000000", digits);
+    } else {
+        out += sprintf(out, "%c%s%s", digits[0], count > 1 ? "." : "", digits + 1);
+        out += sprintf(out, "e%c%d", point - 1 < 0 ? '-' : '+', abs(point - 1));
+    }
+    return bufferAppend(buffer, number, out - number);
 }
 
+static unsigned int unparseMember(
+        const void *key,
+        struct Generic *element,
+        struct JSONUnparser *unparser,
+        struct JSONFormat fmt);
+
 static unsigned int unparseElement(
         struct Generic *generic,
-        struct List *tokens,
+        struct JSONUnparser *unparser,
         struct JSONFormat fmt);
 
-static unsigned int unparseElements(
+// One child with the whitespace and separator around it, fmt is already
+// a level inside the container.
+static unsigned int unparseChild(
+        const struct JSONChild *child,
+        int last,
+        struct JSONUnparser *unparser,
+        struct JSONFormat fmt) {
+    unsigned int result = unparseIndent(&unparser->buffer, fmt);
+    if(result) return result;
+
+    if(child->key) {
+        result = unparseMember(child->key, child->value, unparser, fmt);
+    } else {
+        result = unparseElement(child->value, unparser, fmt);
+    }
+    if(result) return result;
+    return unparseSeparator(&unparser->buffer, last, fmt);
+}
+
+// Step to the next child, keys are only set for members.
+static int nextChild(
+        struct Collection *collection,
+        struct Iterator *iterator,
+        int isMap,
+        struct JSONChild *child) {
+    child->key = NULL;
+    if(isMap && !(child->key = mapKey(iterator))) return 0;
+    child->value = collection->next(iterator);
+    return child->value != NULL;
+}
+
+static unsigned int unparseChildren(
         struct Generic *generic,
-        struct List *tokens,
+        struct JSONUnparser *unparser,
         struct JSONFormat fmt) {
     struct Collection *collection = (struct Collection*)generic->object;
     struct Iterator iterator = collection->iterator(genericData(generic));
+    int isMap = generic->object == &Map.object;
 
-    struct JSONToken tempToken;
-    tempToken.token = JSON_TOKEN_SYMBOL;
-    unsigned int result;
-    struct Generic *element = collection->next(&iterator);
-    while(element) {
-        if(fmt.indent > 0) {
-            result = addNewlineToken(tokens);
-            if(result) return result;
-        }
-
-        result = addWhitespaceToken(tokens, fmt);
+    struct JSONChild child, following;
+    int more = nextChild(collection, &iterator, isMap, &child);
+    while(more) {
+        more = nextChild(collection, &iterator, isMap, &following);
+        unsigned int result = unparseChild(&child, !more, unparser, fmt);
         if(result) return result;
-        result = unparseElement(element, tokens, fmt);
-        if(result) return result;
-
-        if(!(element = collection->next(&iterator))) {
-            if(fmt.indent > 0) {
-                result = addNewlineToken(tokens);
-                if(result) return result;
-            }
-            break;
-        }
-
-        const char seperator[] = {JSON_SEPERATOR, 0};
-        tempToken.lexeme = strCopy(seperator);
-        if(!tempToken.lexeme) return STATUS_ALLOC_ERR;
-
-        // Add token to token list.
-        result = addToken(tokens, &tempToken);
-        if(result) {
-            return result;
-        }
+        child = following;
     }
-
     return STATUS_OK;
 }
 
-static unsigned int unparseArray(
-        struct Generic *generic,
-        struct List *tokens,
+unsigned int unparseJSONChildren(
+        struct Generic *container,
+        struct JSONChild **children,
+        unsigned int *count,
         struct JSONFormat fmt) {
-    if(generic->object != &Array.object) return STATUS_PARSE_ERR;
-    struct JSONToken tempToken;
-    tempToken.token = JSON_TOKEN_SYMBOL;
-
-    const char arrayBegin[] = {JSON_ARR_BEGIN, 0};
-    tempToken.lexeme = strCopy(arrayBegin);
-    if(!tempToken.lexeme) return STATUS_ALLOC_ERR;
-
+    *children = NULL;
+    *count = 0;
+    int isMap = container->object == &Map.object;
+    if(!isMap && container->object != &Array.object) return STATUS_INPUT_ERR;
+
+    struct Collection *collection = (struct Collection*)container->object;
+    struct Iterator iterator = collection->iterator(genericData(container));
+    struct JSONChild child;
+    unsigned int size = 0;
+    while(nextChild(collection, &iterator, isMap, &child)) size++;
+    if(size == 0) return STATUS_OK;
+
+    *children = malloc(size * sizeof(struct JSONChild));
+    if(*children == NULL) return STATUS_ALLOC_ERR;
+    iterator = collection->iterator(genericData(container));
+    while(*count < size && nextChild(collection, &iterator, isMap, &(*children)[*count])) (*count)++;
+
+    // Members in code unit order of their keys.
+    if(isMap && fmt.canonical) qsort(*children, *count, sizeof(struct JSONChild), compareMembers);
+    return STATUS_OK;
+}
 
-    unsigned int result = addToken(tokens, &tempToken);
-    if(result) {
-        return result;
-    }
+unsigned int unparseJSONOpen(
+        struct JSONUnparser *unparser,
+        struct Generic *container,
+        struct JSONFormat fmt) {
+    if(container->object == &Array.object) return bufferAppendChar(&unparser->buffer, JSON_ARR_BEGIN);
+    if(container->object == &Map.object) return bufferAppendChar(&unparser->buffer, JSON_MAP_BEGIN);
+    return STATUS_INPUT_ERR;
+}
 
+unsigned int unparseJSONChild(
+        struct JSONUnparser *unparser,
+        const struct JSONChild *child,
+        int last,
+        struct JSONFormat fmt) {
+    if(fmt.canonical) fmt.indent = 0;
     fmt.level++;
+    return unparseChild(child, last, unparser, fmt);
+}
 
-    result = unparseElements(generic, tokens, fmt);
+unsigned int unparseJSONClose(
+        struct JSONUnparser *unparser,
+        struct Generic *container,
+        struct JSONFormat fmt) {
+    if(fmt.canonical) fmt.indent = 0;
+    unsigned int result = unparseWhitespace(&unparser->buffer, fmt);
     if(result) return result;
+    if(container->object == &Array.object) return bufferAppendChar(&unparser->buffer, JSON_ARR_CLOSE);
+    if(container->object == &Map.object) return bufferAppendChar(&unparser->buffer, JSON_MAP_CLOSE);
+    return STATUS_INPUT_ERR;
+}
 
-    fmt.level--;
+static unsigned int unparseContainer(
+        struct Generic *generic,
+        struct JSONUnparser *unparser,
+        struct JSONFormat fmt) {
+    unsigned int result = unparseJSONOpen(unparser, generic, fmt);
+    if(result) return result;
 
-    result = addWhitespaceToken(tokens, fmt);
+    if(fmt.canonical && generic->object == &Map.object) {
+        struct JSONChild *children;
+        unsigned int count;
+        result = unparseJSONChildren(generic, &children, &count, fmt);
+        for(unsigned int i = 0; i < count && !result; i++) {
+            result = unparseJSONChild(unparser, &children[i], i + 1 == count, fmt);
+        }
+        free(children);
+    } else {
+        fmt.level++;
+        result = unparseChildren(generic, unparser, fmt);
+        fmt.level--;
+    }
     if(result) return result;
 
-    const char arrayClose[] = {JSON_ARR_CLOSE, 0};
-    tempToken.lexeme = strCopy(arrayClose);
-    if(!tempToken.lexeme) return STATUS_ALLOC_ERR;
+    return unparseJSONClose(unparser, generic, fmt);
+}
 
-    return addToken(tokens, &tempToken);
+static unsigned int unparseArray(
+        struct Generic *generic,
+        struct JSONUnparser *unparser,
+        struct JSONFormat fmt) {
+    if(generic->object != &Array.object) return STATUS_PARSE_ERR;
+    return unparseContainer(generic, unparser, fmt);
 }
 
 static unsigned int unparseObject(
         struct Generic *generic,
-        struct List *tokens,
+        struct JSONUnparser *unparser,
         struct JSONFormat fmt) {
     if(generic->object != &Map.object) return STATUS_PARSE_ERR;
-    struct JSONToken tempToken;
-    tempToken.token = JSON_TOKEN_SYMBOL;
-
-    const char mapOpen[] = {JSON_MAP_BEGIN, 0};
-    tempToken.lexeme = strCopy(mapOpen);
-    if(!tempToken.lexeme) return STATUS_ALLOC_ERR;
-
-    int result = addToken(tokens, &tempToken);
-    if(result) {
-        return result;
-    }
-
-    fmt.level++;
-
-    result = unparseMembers(generic, tokens, fmt);
-    if(result) return result;
-
-    fmt.level--;
-
-    result = addWhitespaceToken(tokens, fmt);
-    if(result) return result;
-
-    const char mapClose[] = {JSON_MAP_CLOSE, 0};
-    tempToken.lexeme = strCopy(mapClose);
-    if(!tempToken.lexeme) return STATUS_ALLOC_ERR;
-
-    return addToken(tokens, &tempToken);
+    return unparseContainer(generic, unparser, fmt);
 }
 
 static unsigned int unparseNull(
         struct Generic *generic,
-        struct List *tokens,
+        struct JSONUnparser *unparser,
         struct JSONFormat fmt) {
-    struct JSONToken tempToken;
-    tempToken.token = JSON_TOKEN_NULL;
-
     if(generic->object != &Pointer) return STATUS_PARSE_ERR;
     void *pointerValue = *((void**)genericData(generic));
     if(pointerValue != NULL) return STATUS_INPUT_ERR;
 
-    tempToken.lexeme = strCopy(JSON_NULL_STR);
-    if(!tempToken.lexeme) return STATUS_ALLOC_ERR;
-
-    return addToken(tokens, &tempToken);
+    return bufferAppendString(&unparser->buffer, JSON_NULL_STR);
 }
 
 static unsigned int unparseBoolean(
         struct Generic *generic,
-        struct List *tokens,
+        struct JSONUnparser *unparser,
         struct JSONFormat fmt) {
-    struct JSONToken tempToken;
-
     if(generic->object != &Boolean) return STATUS_PARSE_ERR;
     char boolValue = *((char*)genericData(generic));
 
     const char *value = boolValue ? JSON_TRUE_STR : JSON_FALSE_STR;
-
-    tempToken.lexeme = strCopy(value);
-    if(!tempToken.lexeme) return STATUS_ALLOC_ERR;
-    tempToken.token = JSON_TOKEN_BOOL;
-    return addToken(tokens, &tempToken);
+    return bufferAppendString(&unparser->buffer, value);
 }
 
 static unsigned int unparseString(
         struct Generic *generic,
-        struct List *tokens,
+        struct JSONUnparser *unparser,
         struct JSONFormat fmt) {
     if(generic->object != &String) return STATUS_PARSE_ERR;
-    return addStringToken(tokens, *((char**)genericData(generic)));
+    if(fmt.canonical) return addCanonicalString(&unparser->buffer, *((char**)genericData(generic)));
+    return addStringToken(unparser, *((char**)genericData(generic)));
 }
 
 static unsigned int unparseNumber(
         struct Generic *generic,
-        struct List *tokens,
+        struct JSONUnparser *unparser,
         struct JSONFormat fmt) {
-    struct JSONToken tempToken;
-    char buffer[100];
+    if(fmt.canonical) {
+        // Integers beyond 2^53 are written as the double they round to.
+        if(generic->object == &Integer) {
+            long integerValue = *((long*)genericData(generic));
+            if(integerValue > 9007199254740992L || integerValue < -9007199254740992L) {
+                return addCanonicalNumber(&unparser->buffer, integerValue, 0);
+            }
+        } else if(generic->object == &Float) {
+            return addCanonicalNumber(&unparser->buffer, *((float*)genericData(generic)), 1);
+        }
+    }
+
+    char number[100];
     if(generic->object == &Integer) {
         long integerValue = *((long*)genericData(generic));
-        snprintf(buffer, 100, "%ld", integerValue);
-        tempToken.lexeme = strCopy(buffer);
+        snprintf(number, 100, "%ld", integerValue);
     } else if (generic->object == &Float) {
         double doubleValue = *((float*)genericData(generic));
-        snprintf(buffer, 100, "%f", doubleValue);
-        tempToken.lexeme = strCopy(buffer);
+        snprintf(number, 100, "%f", doubleValue);
     } else {
-        return STATUS_INPUT_ERR;
+        return STATUS_PARSE_ERR;
     }
-    if(!tempToken.lexeme) return STATUS_ALLOC_ERR;
-    tempToken.token = JSON_TOKEN_NUMBER;
-
-    return addToken(tokens, &tempToken);
+    return bufferAppendString(&unparser->buffer, number);
 }
 
 static unsigned int unparseValue(
         struct Generic *generic,
-        struct List *tokens,
+        struct JSONUnparser *unparser,
         struct JSONFormat fmt) {
-    unsigned int (*unparsers[])(struct Generic*, struct List*, struct JSONFormat) = {
+    unsigned int (*unparsers[])(struct Generic*, struct JSONUnparser*, struct JSONFormat) = {
         unparseArray,
         unparseObject,
         unparseString,
@@ -313,76 +449,127 @@ static unsigned int unparseValue(
         unparseNull
     };
     for(unsigned int i = 0; i < sizeof(unparsers) / sizeof(unparsers[0]); i++) {
-        unsigned int result = unparsers[i](generic, tokens, fmt);
-        if(result == STATUS_OK) return result;
+        unsigned int result = unparsers[i](generic, unparser, fmt);
+        if(result != STATUS_PARSE_ERR) return result;
     }
     return STATUS_PARSE_ERR;
 }
 
 static unsigned int unparseElement(
         struct Generic *generic,
-        struct List *tokens,
+        struct JSONUnparser *unparser,
         struct JSONFormat fmt) {
-    return unparseValue(generic, tokens, fmt);
+    if(fmt.canonical) fmt.indent = 0;
+
+    // Cached text would miss referenced strings.
+    struct JSONCache *cache = unparser->vector ? NULL : unparser->cache;
+    if(!cache || (generic->object != &Array.object && generic->object != &Map.object)) {
+        return unparseValue(generic, unparser, fmt);
+    }
+
+    const struct JSONCacheEntry *entry = cacheFind(cache, generic, fmt);
+    if(entry) return bufferAppend(&unparser->buffer, entry->text, entry->length);
+
+    unsigned int start = unparser->buffer.length;
+    unsigned int result = unparseValue(generic, unparser, fmt);
+    if(result) return result;
+
+    // Only complete text may be cached, never a truncated fixed buffer.
+    unsigned int length = unparser->buffer.length - start;
+    if(length < cache->threshold || bufferTruncated(&unparser->buffer)) return STATUS_OK;
+    return cacheStore(cache, generic, fmt, unparser->buffer.data + start, length);
 }
 
 static unsigned int unparseMember(
         const void *key,
         struct Generic *element,
-        struct List *tokens,
+        struct JSONUnparser *unparser,
         struct JSONFormat fmt) {
-    struct JSONToken tempToken;
-    tempToken.token = JSON_TOKEN_SYMBOL;
-
-    unsigned int result = addWhitespaceToken(tokens, fmt);
+    unsigned int result = fmt.canonical ?
+        addCanonicalString(&unparser->buffer, key) :
+        addStringToken(unparser, key);
     if(result) return result;
-    result = addStringToken(tokens, key);
-    if(result) return result;
-
-    const char memberSep[] = {JSON_MEMBER_SEP, 0}; 
-    tempToken.lexeme = strCopy(memberSep);
-    if(!tempToken.lexeme) return STATUS_ALLOC_ERR;
 
-    result = addToken(tokens, &tempToken);
+    result = bufferAppendChar(&unparser->buffer, JSON_MEMBER_SEP);
     if(result) return result;
+    if(fmt.canonical) return unparseElement(element, unparser, fmt);
 
     struct JSONFormat fmtSpace = {1, 1, 0};
-    result = addWhitespaceToken(tokens, fmtSpace);
+    result = unparseWhitespace(&unparser->buffer, fmtSpace);
     if(result) return result;
-    return unparseElement(element, tokens, fmt);
+    return unparseElement(element, unparser, fmt);
 }
 
-unsigned int unparseJSON(
+void unparserCompose(struct JSONUnparser *unparser) {
+    bufferCompose(&unparser->buffer);
+    unparser->cache = NULL;
+    unparser->vector = NULL;
+}
+
+void unparserRelease(struct JSONUnparser *unparser) {
+    bufferRelease(&unparser->buffer);
+}
+
+unsigned int unparseJSONWith(
+        struct JSONUnparser *unparser,
         struct Generic *generic,
-        char **output,
+        const char **output,
         unsigned int *outputLength,
         struct JSONFormat fmt) {
-    struct List tokens;
-    listCompose(&tokens);
-    tokens.freeData = (void (*)(void*))tokenRelease;
+    bufferClear(&unparser->buffer);
+    unsigned int result = unparseElement(generic, unparser, fmt);
 
-    int result = unparseElement(generic, &tokens, fmt);
+    // Make sure an empty document still yields a valid string.
+    unsigned int terminateResult = bufferTerminate(&unparser->buffer);
+    if(terminateResult) return terminateResult;
 
-    *outputLength = 0;
-    struct Iterator it = listIterator(&tokens);
-    struct JSONToken* token;
-    while((token = listNext(&it))) {
-        *outputLength += strlen(token->lexeme);
-    }
+    *output = unparser->buffer.data;
+    *outputLength = unparser->buffer.length;
+    return result;
+}
 
-    *output = malloc(*outputLength+1);
-    if(!output){
+unsigned int unparseJSON(
+        struct Generic *generic,
+        char **output,
+        unsigned int *outputLength,
+        struct JSONFormat fmt) {
+    struct JSONUnparser unparser;
+    unparserCompose(&unparser);
 
+    const char *data;
+    unsigned int result = unparseJSONWith(&unparser, generic, &data, outputLength, fmt);
+    if(result == STATUS_ALLOC_ERR) {
+        unparserRelease(&unparser);
+        return result;
     }
-    char *ptr = *output;
-    it = listIterator(&tokens);
-    while((token = listNext(&it))) {
-        char *ptr2 = token->lexeme;
-        while(*ptr2) *ptr++ = *ptr2++;
-        free(token->lexeme);
-    }
-    *ptr = 0;
 
-    listRelease(&tokens);
+    *output = bufferDetach(&unparser.buffer, outputLength);
+    if(!*output) return STATUS_ALLOC_ERR;
+    return result;
+}
+
+unsigned int unparseJSONLength(
+        struct Generic *generic,
+        unsigned int *outputLength,
+        struct JSONFormat fmt) {
+    struct JSONUnparser unparser = {.cache = NULL};
+    bufferComposeFixed(&unparser.buffer, NULL, 0);
+    unsigned int result = unparseElement(generic, &unparser, fmt);
+    *outputLength = unparser.buffer.length;
     return result;
+}
+
+unsigned int unparseJSONInto(
+        struct Generic *generic,
+        char *output,
+        unsigned int capacity,
+        unsigned int *outputLength,
+        struct JSONFormat fmt) {
+    struct JSONUnparser unparser = {.cache = NULL};
+    bufferComposeFixed(&unparser.buffer, output, capacity);
+    unsigned int result = unparseElement(generic, &unparser, fmt);
+    bufferTerminate(&unparser.buffer);
+    *outputLength = unparser.buffer.length;
+    if(result) return result;
+    return bufferTruncated(&unparser.buffer) ? STATUS_ALLOC_ERR : STATUS_OK;
 }
\ No newline at end of file
@@ -5,20 +5,105 @@ extern "C"{
 #endif
 
 #include "json_lexer.h"
+#include "json_buffer.h"
 #include "cutil/src/generic/generic.h"
 
 struct JSONFormat {
     unsigned char indent;
     unsigned char level;
     unsigned char useTabs;
+    // RFC 8785 output: no whitespace, members sorted by UTF-16 code units,
+    // shortest round trip numbers and minimal escaping. Indentation is
+    // ignored.
+    unsigned char canonical;
 };
 
+struct JSONCache;
+struct JSONVector;
+
+// Serializer state whose output buffer is kept between documents.
+struct JSONUnparser {
+    struct JSONBuffer buffer;
+    // Optional, reuses the text of unchanged subtrees when set.
+    struct JSONCache *cache;
+    // Optional, long strings are referenced from it instead of copied.
+    struct JSONVector *vector;
+};
+
+void unparserCompose(struct JSONUnparser *unparser);
+void unparserRelease(struct JSONUnparser *unparser);
+
 unsigned int unparseJSON(
     struct Generic *generic,
     char **output,
     unsigned int *outputLength,
     struct JSONFormat fmt);
 
+// Output points into the unparser and is valid until its next use.
+unsigned int unparseJSONWith(
+    struct JSONUnparser *unparser,
+    struct Generic *generic,
+    const char **output,
+    unsigned int *outputLength,
+    struct JSONFormat fmt);
+
+// Exact length unparseJSON would produce, excluding the terminator.
+unsigned int unparseJSONLength(
+    struct Generic *generic,
+    unsigned int *outputLength,
+    struct JSONFormat fmt);
+
+// Serialize into caller storage without allocating. When the output and
+// its terminator do not fit, STATUS_ALLOC_ERR is returned, output holds a
+// terminated prefix and outputLength the length that was needed.
+unsigned int unparseJSONInto(
+    struct Generic *generic,
+    char *output,
+    unsigned int capacity,
+    unsigned int *outputLength,
+    struct JSONFormat fmt);
+
+// Layout of unparseJSON, shared with the serializers of other document
+// representations so their output matches it. Indentation is for
+// fmt.level, newlines are only written when fmt.indent is set.
+unsigned int unparseWhitespace(struct JSONBuffer *buffer, struct JSONFormat fmt);
+unsigned int unparseNewline(struct JSONBuffer *buffer, struct JSONFormat fmt);
+// Newline and indentation that start a child, fmt a level inside its
+// container.
+unsigned int unparseIndent(struct JSONBuffer *buffer, struct JSONFormat fmt);
+// Separator after a child, or the newline after the last one.
+unsigned int unparseSeparator(struct JSONBuffer *buffer, int last, struct JSONFormat fmt);
+
+// Building blocks for serializing a container's children independently,
+// see batchUnparseJSON. The container's text is unparseJSONOpen, then
+// unparseJSONChild for every child in order, then unparseJSONClose, all
+// given the container's fmt.
+struct JSONChild {
+    // NULL for array elements.
+    const char *key;
+    struct Generic *value;
+};
+
+// Children in the order they are written, to be freed by the caller.
+unsigned int unparseJSONChildren(
+    struct Generic *container,
+    struct JSONChild **children,
+    unsigned int *count,
+    struct JSONFormat fmt);
+unsigned int unparseJSONOpen(
+    struct JSONUnparser *unparser,
+    struct Generic *container,
+    struct JSONFormat fmt);
+unsigned int unparseJSONChild(
+    struct JSONUnparser *unparser,
+    const struct JSONChild *child,
+    int last,
+    struct JSONFormat fmt);
+unsigned int unparseJSONClose(
+    struct JSONUnparser *unparser,
+    struct Generic *container,
+    struct JSONFormat fmt);
+
 #ifdef __cplusplus
 }
 #endif
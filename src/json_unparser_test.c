@@ -1,4 +1,6 @@
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "json_parser.h"
 #include "json_unparser.h"
 #include "cutil/src/assertion.h"
@@ -104,6 +106,119 @@ void testJSONUnparseWhitespaceEmptyArray() {
     free(output);
 }
 
+void testJSONUnparseWithReusedUnparser() {
+    char first[] = "[[],[1],[]]";
+    char second[] = "[true,null]";
+    struct JSONUnparser unparser;
+    unparserCompose(&unparser);
+    struct JSONFormat fmt = {0, 0, 0};
+
+    struct Generic *generic;
+    int result = parseJSON(&generic, first);
+    assertIntegersEqual(result, STATUS_OK);
+    const char *output;
+    unsigned int outputLength;
+    result = unparseJSONWith(&unparser, generic, &output, &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output, first);
+    assertIntegersEqual(outputLength, sizeof(first) - 1);
+    genericRelease(generic);
+
+    result = parseJSON(&generic, second);
+    assertIntegersEqual(result, STATUS_OK);
+    result = unparseJSONWith(&unparser, generic, &output, &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output, second);
+    assertIntegersEqual(outputLength, sizeof(second) - 1);
+    genericRelease(generic);
+
+    unparserRelease(&unparser);
+}
+
+void testJSONUnparseLength() {
+    char input[] = "{\"a\": [1, 2.5, \"x\"], \"b\": null}";
+    struct Generic *generic;
+    int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    struct JSONFormat fmt = {4, 0, 1};
+    char *output;
+    unsigned int outputLength;
+    result = unparseJSON(generic, &output, &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+
+    unsigned int length;
+    result = unparseJSONLength(generic, &length, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(length, outputLength);
+    assertIntegersEqual(length, strlen(output));
+
+    free(output);
+    genericRelease(generic);
+}
+
+void testJSONUnparseInto() {
+    char input[] = "[1,[true,false],\"abc\"]";
+    struct Generic *generic;
+    int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+    struct JSONFormat fmt = {0, 0, 0};
+
+    char output[sizeof(input)];
+    unsigned int outputLength;
+    result = unparseJSONInto(generic, output, sizeof(output), &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertIntegersEqual(outputLength, sizeof(input) - 1);
+    assertStringsEqual(output, input);
+
+    // One byte short leaves no room for the terminator.
+    char small[sizeof(input) - 1];
+    result = unparseJSONInto(generic, small, sizeof(small), &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_ALLOC_ERR);
+    assertIntegersEqual(outputLength, sizeof(input) - 1);
+    assertIntegersEqual(strlen(small), sizeof(small) - 1);
+    assertIntegersEqual(strncmp(small, input, sizeof(small) - 1), 0);
+
+    genericRelease(generic);
+}
+
+void testJSONUnparseCanonical() {
+    char input[] = "{\"b\": 2, \"a\": {\"z\": null, \"\\u00e9\": 1, \"y\": true, "
+        "\"\\ud83d\\ude00\": 0, \"\\uffff\": 0}, \"c\": \"x\\u0041\\n\\/\", "
+        "\"d\": [0.1, 100.0, 1.5e-7, 1e30, 0.000001, -2.5]}";
+    struct Generic *generic;
+    int result = parseJSON(&generic, input);
+    assertIntegersEqual(result, STATUS_OK);
+
+    // Indentation is ignored, keys sort by UTF-16 code units so the
+    // surrogate pair comes before U+FFFF.
+    struct JSONFormat fmt = {2, 0, 0, 1};
+    char *output;
+    unsigned int outputLength;
+    result = unparseJSON(generic, &output, &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_OK);
+    assertStringsEqual(output,
+        "{\"a\":{\"y\":true,\"z\":null,\"\xc3\xa9\":1,\"\xf0\x9f\x98\x80\":0,\"\xef\xbf\xbf\":0},"
+        "\"b\":2,\"c\":\"xA\\n/\",\"d\":[0.1,100,1.5e-7,1e+30,0.000001,-2.5]}");
+    free(output);
+    genericRelease(generic);
+
+    char loneSurrogate[] = "[\"\\udc00\"]";
+    result = parseJSON(&generic, loneSurrogate);
+    assertIntegersEqual(result, STATUS_OK);
+    result = unparseJSON(generic, &output, &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_INPUT_ERR);
+    free(output);
+    genericRelease(generic);
+
+    generic = genericCompose(&Float);
+    *((float*)genericData(generic)) = NAN;
+    result = unparseJSON(generic, &output, &outputLength, fmt);
+    assertIntegersEqual(result, STATUS_INPUT_ERR);
+    free(output);
+    genericRelease(generic);
+}
+
 void testJSONUnparser() {
     testJSONUnparseEmptySequence();
     testJSONUnparseSeqOfSeq();
@@ -111,4 +226,8 @@ void testJSONUnparser() {
     testJSONUnparseWhitespaceArray();
     testJSONUnparseWhitespaceEmptyMap();
     testJSONUnparseWhitespaceEmptyArray();
+    testJSONUnparseWithReusedUnparser();
+    testJSONUnparseLength();
+    testJSONUnparseInto();
+    testJSONUnparseCanonical();
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include <stdlib.h>
+#include "json_vector.h"
+#include "cutil/src/error.h"
+
+void vectorCompose(struct JSONVector *vector, unsigned int threshold) {
+    bufferCompose(&vector->text);
+    vector->segments = NULL;
+    vector->count = 0;
+    vector->capacity = 0;
+    vector->threshold = threshold ? threshold : 1;
+    vector->covered = 0;
+}
+
+void vectorRelease(struct JSONVector *vector) {
+    bufferRelease(&vector->text);
+    free(vector->segments);
+    vector->segments = NULL;
+    vector->count = 0;
+    vector->capacity = 0;
+}
+
+// Text segments are added with no base, the text may still move. They are
+// resolved once it is complete.
+static unsigned int vectorAdd(struct JSONVector *vector, const void *base, size_t length) {
+    if(length == 0) return STATUS_OK;
+    if(vector->count == vector->capacity) {
+        unsigned int capacity = vector->capacity ? vector->capacity * 2 : 16;
+        struct JSONSegment *grown = realloc(vector->segments, capacity * sizeof(struct JSONSegment));
+        if(grown == NULL) return STATUS_ALLOC_ERR;
+        vector->segments = grown;
+        vector->capacity = capacity;
+    }
+    vector->segments[vector->count].base = base;
+    vector->segments[vector->count++].length = length;
+    return STATUS_OK;
+}
+
+unsigned int vectorReference(
+        struct JSONVector *vector,
+        const struct JSONBuffer *text,
+        const char *string,
+        unsigned int length) {
+    unsigned int result = vectorAdd(vector, NULL, text->length - vector->covered);
+    if(result) return result;
+    vector->covered = text->length;
+    return vectorAdd(vector, string, length);
+}
+
+unsigned int unparseJSONVector(
+        struct Generic *generic,
+        struct JSONVector *vector,
+        struct JSONFormat fmt) {
+    vector->count = 0;
+    vector->covered = 0;
+
+    struct JSONUnparser unparser = {.cache = NULL, .vector = vector};
+    unparser.buffer = vector->text;
+    const char *data;
+    unsigned int length;
+    unsigned int result = unparseJSONWith(&unparser, generic, &data, &length, fmt);
+    vector->text = unparser.buffer;
+    if(result) return result;
+
+    result = vectorAdd(vector, NULL, length - vector->covered);
+    if(result) return result;
+    vector->covered = length;
+
+    const char *next = vector->text.data;
+    for(unsigned int i = 0; i < vector->count; i++) {
+        if(vector->segments[i].base) continue;
+        vector->segments[i].base = next;
+        next += vector->segments[i].length;
+    }
+    return STATUS_OK;
+}
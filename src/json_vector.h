@@ -0,0 +1,51 @@
+#ifndef __JSON_VECTOR_H
+#define __JSON_VECTOR_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stddef.h>
+#include "json_unparser.h"
+
+// Same layout as struct iovec, so segments can be passed to writev or
+// sendmsg as they are.
+struct JSONSegment {
+    const void *base;
+    size_t length;
+};
+
+// Output as a list of segments: structural text and short values are
+// written to text, strings of at least threshold bytes are referenced
+// where they live in the Generic tree instead of being copied.
+struct JSONVector {
+    struct JSONBuffer text;
+    struct JSONSegment *segments;
+    unsigned int count;
+    unsigned int capacity;
+    unsigned int threshold;
+    // End of the text already covered by segments.
+    unsigned int covered;
+};
+
+void vectorCompose(struct JSONVector *vector, unsigned int threshold);
+void vectorRelease(struct JSONVector *vector);
+
+// Refer to length bytes of string from the next segment on, text is the
+// buffer currently being written.
+unsigned int vectorReference(
+    struct JSONVector *vector,
+    const struct JSONBuffer *text,
+    const char *string,
+    unsigned int length);
+
+// Segments are valid until the vector is reused or the tree changes.
+// Canonical output rewrites strings, so it is never referenced.
+unsigned int unparseJSONVector(
+    struct Generic *generic,
+    struct JSONVector *vector,
+    struct JSONFormat fmt);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
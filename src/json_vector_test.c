@@ -0,0 +1,72 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_parser.h"
+#include "json_vector.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+// Gathered segments must read exactly like unparseJSON's output.
+static void assertVectorMatches(struct Generic *generic, struct JSONVector *vector, struct JSONFormat fmt) {
+    char *expected;
+    unsigned int expectedLength;
+    assertIntegersEqual(unparseJSON(generic, &expected, &expectedLength, fmt), STATUS_OK);
+    assertIntegersEqual(unparseJSONVector(generic, vector, fmt), STATUS_OK);
+
+    struct JSONBuffer gathered;
+    bufferCompose(&gathered);
+    for(unsigned int i = 0; i < vector->count; i++) {
+        bufferAppend(&gathered, vector->segments[i].base, vector->segments[i].length);
+    }
+    bufferTerminate(&gathered);
+    assertStringsEqual(gathered.data, expected);
+    bufferRelease(&gathered);
+    free(expected);
+}
+
+void testJSONVectorReference() {
+    char input[] = "{\"blob\": \"0123456789abcdefghijklmnopqrstuvwxyz\", \"small\": [\"x\", 1]}";
+    struct Generic *generic;
+    assertIntegersEqual(parseJSON(&generic, input), STATUS_OK);
+
+    struct JSONVector vector;
+    vectorCompose(&vector, 16);
+    struct JSONFormat fmt = {0, 0, 0};
+    assertVectorMatches(generic, &vector, fmt);
+    // Text before, the blob itself, text after.
+    assertIntegersEqual(vector.count, 3);
+    const char *blob = *((char**)genericData(getAt(generic, "blob")));
+    assertPointersEqual(vector.segments[1].base, blob);
+    assertIntegersEqual(vector.segments[1].length, 36);
+
+    // Reused with indentation.
+    struct JSONFormat indented = {2, 0, 0};
+    assertVectorMatches(generic, &vector, indented);
+    assertIntegersEqual(vector.count, 3);
+
+    // Canonical strings are rewritten, so nothing is referenced.
+    struct JSONFormat canonical = {0, 0, 0, 1};
+    assertVectorMatches(generic, &vector, canonical);
+    assertIntegersEqual(vector.count, 1);
+
+    vectorRelease(&vector);
+    genericRelease(generic);
+}
+
+void testJSONVectorScalar() {
+    char input[] = "\"0123456789abcdefghijklmnopqrstuvwxyz\"";
+    struct Generic *generic;
+    assertIntegersEqual(parseJSON(&generic, input), STATUS_OK);
+
+    struct JSONVector vector;
+    vectorCompose(&vector, 4);
+    struct JSONFormat fmt = {0, 0, 0};
+    assertVectorMatches(generic, &vector, fmt);
+    assertIntegersEqual(vector.count, 3);
+    vectorRelease(&vector);
+    genericRelease(generic);
+}
+
+void testJSONVector() {
+    testJSONVectorReference();
+    testJSONVectorScalar();
+}
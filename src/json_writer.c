@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "json.h"
+#include "json_writer.h"
+#include "json_encoding.h"
+#include "cutil/src/string.h"
+#include "cutil/src/error.h"
+
+unsigned int writerCompose(struct JSONWriter *writer, struct JSONBuffer *buffer, struct JSONFormat fmt) {
+    writer->buffer = buffer;
+    writer->fmt = fmt;
+    writer->levels = NULL;
+    writer->depth = 0;
+    writer->capacity = 0;
+    writer->keyPending = 0;
+    writer->done = 0;
+    return fmt.canonical ? STATUS_INPUT_ERR : STATUS_OK;
+}
+
+void writerRelease(struct JSONWriter *writer) {
+    free(writer->levels);
+    writer->levels = NULL;
+    writer->depth = 0;
+    writer->capacity = 0;
+}
+
+static struct JSONWriterLevel *writerTop(struct JSONWriter *writer) {
+    return writer->depth ? &writer->levels[writer->depth - 1] : NULL;
+}
+
+// Layout at the level of the open container's children.
+static struct JSONFormat writerFormat(struct JSONWriter *writer) {
+    struct JSONFormat fmt = writer->fmt;
+    fmt.level += writer->depth;
+    return fmt;
+}
+
+// Separator and indentation of the next child of the open container.
+static unsigned int writeChildStart(struct JSONWriter *writer) {
+    struct JSONWriterLevel *top = writerTop(writer);
+    unsigned int result = STATUS_OK;
+    if(top->count++) result = bufferAppendChar(writer->buffer, JSON_SEPERATOR);
+    if(!result) result = unparseIndent(writer->buffer, writerFormat(writer));
+    return result;
+}
+
+// Check a value may be written here and lay out what precedes it.
+static unsigned int writeValueStart(struct JSONWriter *writer) {
+    if(writer->done) return STATUS_INPUT_ERR;
+    struct JSONWriterLevel *top = writerTop(writer);
+    if(!top) return STATUS_OK;
+    if(top->bracket == JSON_MAP_BEGIN) {
+        if(!writer->keyPending) return STATUS_INPUT_ERR;
+        writer->keyPending = 0;
+        return STATUS_OK;
+    }
+    return writeChildStart(writer);
+}
+
+static void writeValueEnd(struct JSONWriter *writer) {
+    if(writer->depth == 0) writer->done = 1;
+}
+
+static unsigned int writerBegin(struct JSONWriter *writer, char bracket) {
+    if(writer->depth == writer->capacity) {
+        unsigned int capacity = writer->capacity ? writer->capacity * 2 : 16;
+        struct JSONWriterLevel *grown = realloc(writer->levels, capacity * sizeof(struct JSONWriterLevel));
+        if(grown == NULL) return STATUS_ALLOC_ERR;
+        writer->levels = grown;
+        writer->capacity = capacity;
+    }
+
+    unsigned int result = writeValueStart(writer);
+    if(!result) result = bufferAppendChar(writer->buffer, bracket);
+    if(result) return result;
+    writer->levels[writer->depth].bracket = bracket;
+    writer->levels[writer->depth++].count = 0;
+    return STATUS_OK;
+}
+
+static unsigned int writerEnd(struct JSONWriter *writer, char bracket, char close) {
+    struct JSONWriterLevel *top = writerTop(writer);
+    if(!top || top->bracket != bracket || writer->keyPending) return STATUS_INPUT_ERR;
+
+    unsigned int result = top->count ? unparseNewline(writer->buffer, writer->fmt) : STATUS_OK;
+    writer->depth--;
+    if(!result) result = unparseWhitespace(writer->buffer, writerFormat(writer));
+    if(!result) result = bufferAppendChar(writer->buffer, close);
+    writeValueEnd(writer);
+    return result;
+}
+
+unsigned int writerBeginObject(struct JSONWriter *writer) {
+    return writerBegin(writer, JSON_MAP_BEGIN);
+}
+
+unsigned int writerEndObject(struct JSONWriter *writer) {
+    return writerEnd(writer, JSON_MAP_BEGIN, JSON_MAP_CLOSE);
+}
+
+unsigned int writerBeginArray(struct JSONWriter *writer) {
+    return writerBegin(writer, JSON_ARR_BEGIN);
+}
+
+unsigned int writerEndArray(struct JSONWriter *writer) {
+    return writerEnd(writer, JSON_ARR_BEGIN, JSON_ARR_CLOSE);
+}
+
+unsigned int writerKey(struct JSONWriter *writer, const char *key) {
+    struct JSONWriterLevel *top = writerTop(writer);
+    if(!top || top->bracket != JSON_MAP_BEGIN || writer->keyPending) return STATUS_INPUT_ERR;
+    if(validateUTF8(key, strlen(key))) return STATUS_INPUT_ERR;
+
+    unsigned int result = writeChildStart(writer);
+    if(!result) result = bufferAppendQuoted(writer->buffer, key);
+    if(!result) result = bufferAppendChar(writer->buffer, JSON_MEMBER_SEP);
+    if(!result) result = bufferAppendChar(writer->buffer, JSON_SPACE);
+    if(result) return result;
+    writer->keyPending = 1;
+    return STATUS_OK;
+}
+
+// Scalars share the checks, text is already formatted.
+static unsigned int writeScalar(struct JSONWriter *writer, const char *text, unsigned int length) {
+    unsigned int result = writeValueStart(writer);
+    if(!result) result = bufferAppend(writer->buffer, text, length);
+    if(result) return result;
+    writeValueEnd(writer);
+    return STATUS_OK;
+}
+
+unsigned int writerString(struct JSONWriter *writer, const char *string) {
+    if(validateUTF8(string, strlen(string))) return STATUS_INPUT_ERR;
+    unsigned int result = writeValueStart(writer);
+    if(!result) result = bufferAppendQuoted(writer->buffer, string);
+    if(result) return result;
+    writeValueEnd(writer);
+    return STATUS_OK;
+}
+
+unsigned int writerInteger(struct JSONWriter *writer, int64_t value) {
+    char number[32];
+    unsigned int length = snprintf(number, sizeof(number), "%lld", (long long)value);
+    return writeScalar(writer, number, length);
+}
+
+unsigned int writerDouble(struct JSONWriter *writer, double value) {
+    // Refused before anything is laid out.
+    if(isnan(value) || isinf(value)) return STATUS_INPUT_ERR;
+    unsigned int result = writeValueStart(writer);
+    if(!result) result = bufferAppendDouble(writer->buffer, value);
+    if(result) return result;
+    writeValueEnd(writer);
+    return STATUS_OK;
+}
+
+unsigned int writerBoolean(struct JSONWriter *writer, int value) {
+    const char *text = value ? JSON_TRUE_STR : JSON_FALSE_STR;
+    return writeScalar(writer, text, strlen(text));
+}
+
+unsigned int writerNull(struct JSONWriter *writer) {
+    return writeScalar(writer, JSON_NULL_STR, strlen(JSON_NULL_STR));
+}
+
+unsigned int writerFinish(struct JSONWriter *writer) {
+    return writer->done ? STATUS_OK : STATUS_INPUT_ERR;
+}
@@ -0,0 +1,52 @@
+#ifndef __JSON_WRITER_H
+#define __JSON_WRITER_H
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#include <stdint.h>
+#include "json_unparser.h"
+
+struct JSONWriterLevel {
+    char bracket;
+    unsigned int count;
+};
+
+// Writes JSON straight to a buffer, growable, fixed or sink, in the same
+// layout as unparseJSON without building a Generic tree. Calls that would
+// produce invalid JSON fail with STATUS_INPUT_ERR and write nothing.
+struct JSONWriter {
+    struct JSONBuffer *buffer;
+    struct JSONFormat fmt;
+    struct JSONWriterLevel *levels;
+    unsigned int depth;
+    unsigned int capacity;
+    // A key was written and its value comes next.
+    unsigned char keyPending;
+    // The root value is complete.
+    unsigned char done;
+};
+
+// Members are written in call order, so canonical output is refused.
+unsigned int writerCompose(struct JSONWriter *writer, struct JSONBuffer *buffer, struct JSONFormat fmt);
+void writerRelease(struct JSONWriter *writer);
+
+unsigned int writerBeginObject(struct JSONWriter *writer);
+unsigned int writerEndObject(struct JSONWriter *writer);
+unsigned int writerBeginArray(struct JSONWriter *writer);
+unsigned int writerEndArray(struct JSONWriter *writer);
+// Keys and strings are plain UTF-8 and escaped as needed.
+unsigned int writerKey(struct JSONWriter *writer, const char *key);
+unsigned int writerString(struct JSONWriter *writer, const char *string);
+unsigned int writerInteger(struct JSONWriter *writer, int64_t value);
+// Shortest digits that read back to value, NaN and infinities refused.
+unsigned int writerDouble(struct JSONWriter *writer, double value);
+unsigned int writerBoolean(struct JSONWriter *writer, int value);
+unsigned int writerNull(struct JSONWriter *writer);
+// STATUS_INPUT_ERR unless exactly one complete value was written.
+unsigned int writerFinish(struct JSONWriter *writer);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_parser.h"
+#include "json_writer.h"
+#include "cutil/src/assertion.h"
+#include "cutil/src/error.h"
+
+static void writeTestDocument(struct JSONWriter *writer) {
+    writerBeginArray(writer);
+    writerInteger(writer, -9223372036854775807LL - 1);
+    writerDouble(writer, 0.1);
+    writerString(writer, "tab\there \"quoted\" \x01");
+    writerBeginObject(writer);
+    writerKey(writer, "a");
+    writerBeginArray(writer);
+    writerEndArray(writer);
+    writerKey(writer, "b");
+    writerNull(writer);
+    writerEndObject(writer);
+    writerBeginObject(writer);
+    writerEndObject(writer);
+    writerBoolean(writer, 1);
+    writerEndArray(writer);
+}
+
+void testJSONWriterCompact() {
+    struct JSONBuffer buffer;
+    bufferCompose(&buffer);
+    struct JSONWriter writer;
+    struct JSONFormat fmt = {0, 0, 0};
+    assertIntegersEqual(writerCompose(&writer, &buffer, fmt), STATUS_OK);
+    writeTestDocument(&writer);
+    assertIntegersEqual(writerFinish(&writer), STATUS_OK);
+    assertStringsEqual(buffer.data,
+        "[-9223372036854775808,0.1,\"tab\\there \\\"quoted\\\" \\u0001\","
+        "{\"a\": [],\"b\": null},{},true]");
+    writerRelease(&writer);
+    bufferRelease(&buffer);
+}
+
+void testJSONWriterMatchesUnparse() {
+    // Single member objects keep the comparison independent of map order.
+    char input[] = "[1, [], {\"a\": [true, {\"b\": null}]}, [[\"x\"]], {}]";
+    struct Generic *generic;
+    assertIntegersEqual(parseJSON(&generic, input), STATUS_OK);
+
+    struct JSONFormat formats[] = {{0, 0, 0}, {2, 0, 0}, {1, 2, 1}};
+    for(unsigned int i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        char *expected;
+        unsigned int expectedLength;
+        unparseJSON(generic, &expected, &expectedLength, formats[i]);
+
+        struct JSONBuffer buffer;
+        bufferCompose(&buffer);
+        struct JSONWriter writer;
+        writerCompose(&writer, &buffer, formats[i]);
+        writerBeginArray(&writer);
+        writerInteger(&writer, 1);
+        writerBeginArray(&writer);
+        writerEndArray(&writer);
+        writerBeginObject(&writer);
+        writerKey(&writer, "a");
+        writerBeginArray(&writer);
+        writerBoolean(&writer, 1);
+        writerBeginObject(&writer);
+        writerKey(&writer, "b");
+        writerNull(&writer);
+        writerEndObject(&writer);
+        writerEndArray(&writer);
+        writerEndObject(&writer);
+        writerBeginArray(&writer);
+        writerBeginArray(&writer);
+        writerString(&writer, "x");
+        writerEndArray(&writer);
+        writerEndArray(&writer);
+        writerBeginObject(&writer);
+        writerEndObject(&writer);
+        writerEndArray(&writer);
+        assertIntegersEqual(writerFinish(&writer), STATUS_OK);
+        assertStringsEqual(buffer.data, expected);
+
+        writerRelease(&writer);
+        bufferRelease(&buffer);
+        free(expected);
+    }
+    genericRelease(generic);
+}
+
+void testJSONWriterMisuse() {
+    struct JSONBuffer buffer;
+    bufferCompose(&buffer);
+    struct JSONWriter writer;
+    struct JSONFormat fmt = {0, 0, 0};
+    writerCompose(&writer, &buffer, fmt);
+    assertIntegersEqual(writerFinish(&writer), STATUS_INPUT_ERR);
+    assertIntegersEqual(writerKey(&writer, "a"), STATUS_INPUT_ERR);
+    assertIntegersEqual(writerEndArray(&writer), STATUS_INPUT_ERR);
+
+    assertIntegersEqual(writerBeginObject(&writer), STATUS_OK);
+    // Values need a key first, and keys their value.
+    assertIntegersEqual(writerInteger(&writer, 1), STATUS_INPUT_ERR);
+    assertIntegersEqual(writerBeginArray(&writer), STATUS_INPUT_ERR);
+    assertIntegersEqual(writerKey(&writer, "a"), STATUS_OK);
+    assertIntegersEqual(writerKey(&writer, "b"), STATUS_INPUT_ERR);
+    assertIntegersEqual(writerEndObject(&writer), STATUS_INPUT_ERR);
+    assertIntegersEqual(writerDouble(&writer, 1.0 / 0.0), STATUS_INPUT_ERR);
+    assertIntegersEqual(writerString(&writer, "\xC0\xAF"), STATUS_INPUT_ERR);
+    assertIntegersEqual(writerBeginArray(&writer), STATUS_OK);
+    assertIntegersEqual(writerKey(&writer, "c"), STATUS_INPUT_ERR);
+    assertIntegersEqual(writerEndObject(&writer), STATUS_INPUT_ERR);
+    assertIntegersEqual(writerEndArray(&writer), STATUS_OK);
+    assertIntegersEqual(writerFinish(&writer), STATUS_INPUT_ERR);
+    assertIntegersEqual(writerEndObject(&writer), STATUS_OK);
+
+    // Only one root value.
+    assertIntegersEqual(writerNull(&writer), STATUS_INPUT_ERR);
+    assertIntegersEqual(writerFinish(&writer), STATUS_OK);
+    assertStringsEqual(buffer.data, "{\"a\": []}");
+    writerRelease(&writer);
+
+    struct JSONFormat canonical = {0, 0, 0, 1};
+    assertIntegersEqual(writerCompose(&writer, &buffer, canonical), STATUS_INPUT_ERR);
+    bufferRelease(&buffer);
+}
+
+void testJSONWriter() {
+    testJSONWriterCompact();
+    testJSONWriterMatchesUnparse();
+    testJSONWriterMisuse();
+}
@@ -6,11 +6,53 @@ int asserts_failed = 0;
 void testJSONLexer();
 void testJSONParser();
 void testJSONUnparser();
+void testJSONBinding();
+void testJSONSnapshot();
+void testJSONMsgPack();
+void testJSONCBOR();
+void testJSONBatch();
+void testJSONCache();
+void testJSONPatch();
+void testJSONDiff();
+void testJSONDigest();
+void testJSONEncoding();
+void testJSONNumber();
+void testJSONDom();
+void testJSONStream();
+void testJSONCodec();
+void testJSONVector();
+void testJSONWriter();
+void testJSONSchema();
+void testJSONFrozen();
+void testJSONPersistent();
+void testJSONIndex();
+void testJSONColumns();
 
 int main() {
     testJSONLexer();
     testJSONParser();
     testJSONUnparser();
+    testJSONBinding();
+    testJSONSnapshot();
+    testJSONMsgPack();
+    testJSONCBOR();
+    testJSONBatch();
+    testJSONCache();
+    testJSONPatch();
+    testJSONDiff();
+    testJSONDigest();
+    testJSONEncoding();
+    testJSONNumber();
+    testJSONDom();
+    testJSONStream();
+    testJSONCodec();
+    testJSONVector();
+    testJSONWriter();
+    testJSONSchema();
+    testJSONFrozen();
+    testJSONPersistent();
+    testJSONIndex();
+    testJSONColumns();
 
     printf("Asserts Passed: %d, Failed: %d\n",
         asserts_passed, asserts_failed);